@@ -0,0 +1,29 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: benchmarkclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "benchmarkclass.h"
+
+
+BenchmarkClass::BenchmarkClass()
+{
+	m_start = std::chrono::high_resolution_clock::now();
+}
+
+
+BenchmarkClass::~BenchmarkClass()
+{
+}
+
+
+void BenchmarkClass::StartTimer()
+{
+	m_start = std::chrono::high_resolution_clock::now();
+
+	return;
+}
+
+
+float BenchmarkClass::GetTime()
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - m_start).count();
+}
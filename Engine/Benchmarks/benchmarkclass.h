@@ -0,0 +1,46 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: benchmarkclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _BENCHMARKCLASS_H_
+#define _BENCHMARKCLASS_H_
+
+
+/////////////
+// LINKING //
+/////////////
+#pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "d3dx11.lib")
+#pragma comment(lib, "d3dx10.lib")
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <chrono>
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: BenchmarkClass
+////////////////////////////////////////////////////////////////////////////////
+// One benchmark of the generation code, run from the command line by its name.
+// Run builds what it measures, prints a table of results and releases it all
+// again, so the benchmarks can run one after another in the same process. The
+// timer measures wall clock milliseconds.
+class BenchmarkClass
+{
+public:
+	BenchmarkClass();
+	virtual ~BenchmarkClass();
+
+	virtual const char* GetName() = 0;
+	virtual bool Run() = 0;
+
+protected:
+	void StartTimer();
+	float GetTime();
+
+private:
+	std::chrono::high_resolution_clock::time_point m_start;
+};
+
+#endif
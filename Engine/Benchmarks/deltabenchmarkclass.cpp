@@ -0,0 +1,252 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: deltabenchmarkclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "deltabenchmarkclass.h"
+#include <cstdio>
+#include <cstring>
+
+
+DeltaBenchmarkClass::DeltaBenchmarkClass()
+{
+	m_Terrain = 0;
+}
+
+
+DeltaBenchmarkClass::DeltaBenchmarkClass(const DeltaBenchmarkClass& other)
+{
+}
+
+
+DeltaBenchmarkClass::~DeltaBenchmarkClass()
+{
+}
+
+
+const char* DeltaBenchmarkClass::GetName()
+{
+	return "delta";
+}
+
+
+bool DeltaBenchmarkClass::Run()
+{
+	const generationOperationData perlin[] = { { TerrainClass::GENERATE_PERLIN, 0, 7 } };
+	const generationOperationData dungeon[] = { { TerrainClass::GENERATE_PERLIN, 0, 7 }, { TerrainClass::GENERATE_DUNGEON, 5, 11 } };
+	const generationOperationData reseeded[] = { { TerrainClass::GENERATE_PERLIN, 0, 7 }, { TerrainClass::GENERATE_DUNGEON, 5, 12 } };
+	const generationOperationData smoothed[] = { { TerrainClass::GENERATE_PERLIN, 0, 7 }, { TerrainClass::GENERATE_DUNGEON, 5, 12 }, { TerrainClass::GENERATE_SMOOTH, 1, 0 } };
+	const generationOperationData eroded[] = { { TerrainClass::GENERATE_PERLIN, 0, 7 }, { TerrainClass::GENERATE_DUNGEON, 5, 12 }, { TerrainClass::GENERATE_SMOOTH, 1, 0 }, { TerrainClass::GENERATE_EROSION, 20, 0 } };
+	dungeonCellData room;
+	bool result;
+
+
+	result = InitializeTerrain();
+	if(!result)
+	{
+		ShutdownTerrain();
+		return false;
+	}
+
+	// Make every version before timing anything.
+	TakeSnapshot(m_flat);
+	result = Generate(perlin, 1, m_perlin) && Generate(dungeon, 2, m_dungeon) && Generate(reseeded, 2, m_reseeded) && Generate(smoothed, 3, m_smoothed) && Generate(eroded, 4, m_eroded);
+	ShutdownTerrain();
+	if(!result)
+	{
+		printf("Could not generate the terrains.\n");
+		return false;
+	}
+
+	// A hand edit: raise a small square and add a room.
+	m_edited = m_eroded;
+	for(int y=100; y<100 + DELTA_EDIT_SIZE; y++)
+	{
+		for(int x=200; x<200 + DELTA_EDIT_SIZE; x++)
+		{
+			m_edited.heights[(y * DELTA_TERRAIN_SIZE) + x] += 0.5f;
+		}
+	}
+
+	room.xBottomLeft = 200.0f;
+	room.yBottomLeft = 100.0f;
+	room.xTopRight = 200.0f + (float)DELTA_EDIT_SIZE;
+	room.yTopRight = 100.0f + (float)DELTA_EDIT_SIZE;
+	m_edited.rooms.push_back(room);
+
+	printf("%-22s %9s %10s %7s %10s %10s %10s %6s\n", "change", "changed", "delta B", "of raw", "encode ms", "Mcells/s", "apply ms", "same");
+
+	result = RunCase("flat -> perlin", m_flat, m_perlin);
+	result = RunCase("perlin -> dungeon", m_perlin, m_dungeon) && result;
+	result = RunCase("dungeon -> new seed", m_dungeon, m_reseeded) && result;
+	result = RunCase("dungeon -> smoothed", m_reseeded, m_smoothed) && result;
+	result = RunCase("smoothed -> eroded", m_smoothed, m_eroded) && result;
+	result = RunCase("32x32 edit", m_eroded, m_edited) && result;
+	result = RunCase("no change", m_eroded, m_eroded) && result;
+
+	return result;
+}
+
+
+bool DeltaBenchmarkClass::InitializeTerrain()
+{
+	bool result;
+
+
+	m_Terrain = new TerrainClass;
+	if(!m_Terrain)
+	{
+		return false;
+	}
+
+	result = m_Terrain->InitializeTerrain(0, DELTA_TERRAIN_SIZE, DELTA_TERRAIN_SIZE, 0, 0, 0);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Run the jobs on this thread, and shut the disk cache so every version is really generated.
+	if(m_Terrain->m_generationThread.joinable())
+	{
+		m_Terrain->m_generationMutex.lock();
+		m_Terrain->m_generationQuit = true;
+		m_Terrain->m_generationMutex.unlock();
+
+		m_Terrain->m_generationCondition.notify_one();
+		m_Terrain->m_generationThread.join();
+		m_Terrain->m_generationQuit = false;
+	}
+	m_Terrain->m_generationThreaded = false;
+
+	if(m_Terrain->m_DiskCache)
+	{
+		m_Terrain->m_DiskCache->Shutdown();
+		delete m_Terrain->m_DiskCache;
+		m_Terrain->m_DiskCache = 0;
+	}
+
+	return true;
+}
+
+
+void DeltaBenchmarkClass::ShutdownTerrain()
+{
+	if(m_Terrain)
+	{
+		m_Terrain->Shutdown();
+		delete m_Terrain;
+		m_Terrain = 0;
+	}
+
+	return;
+}
+
+
+bool DeltaBenchmarkClass::Generate(const generationOperationData* operations, int operationCount, SnapshotType& snapshot)
+{
+	bool result;
+
+
+	result = m_Terrain->RequestRecipe(0, operations, operationCount);
+	if(!result)
+	{
+		return false;
+	}
+
+	// A budget of zero runs the job to the end in one slice.
+	while(m_Terrain->IsGenerating())
+	{
+		m_Terrain->UpdateGeneration(0);
+	}
+
+	TakeSnapshot(snapshot);
+
+	return true;
+}
+
+
+void DeltaBenchmarkClass::TakeSnapshot(SnapshotType& snapshot)
+{
+	const BitGridClass& walkGrid = m_Terrain->m_frontWalkGrid;
+
+
+	snapshot.heights.resize(DELTA_TERRAIN_SIZE * DELTA_TERRAIN_SIZE);
+	for(unsigned int i=0; i<snapshot.heights.size(); i++)
+	{
+		snapshot.heights[i] = m_Terrain->m_frontHeightMap[i].y;
+	}
+
+	snapshot.words.assign(walkGrid.GetWords(), walkGrid.GetWords() + walkGrid.GetWordCount());
+	snapshot.rooms = m_Terrain->m_frontRooms;
+	snapshot.corridors = m_Terrain->m_frontCorridors;
+
+	return;
+}
+
+
+bool DeltaBenchmarkClass::RunCase(const char* name, const SnapshotType& oldVersion, const SnapshotType& newVersion)
+{
+	float encodeTime, applyTime, rawBytes;
+	int cellCount;
+	bool result, same;
+
+
+	cellCount = (int)newVersion.heights.size();
+
+	StartTimer();
+	for(int i=0; i<DELTA_RUNS; i++)
+	{
+		m_delta.Encode(oldVersion.heights.data(), newVersion.heights.data(), cellCount, 1, oldVersion.words.data(), newVersion.words.data(), (int)newVersion.words.size(),
+			oldVersion.rooms, newVersion.rooms, oldVersion.corridors, newVersion.corridors);
+	}
+	encodeTime = GetTime() / (float)DELTA_RUNS;
+
+	// Every apply starts again from the old version, and only the apply is timed.
+	result = true;
+	applyTime = 0.0f;
+	for(int i=0; i<DELTA_RUNS; i++)
+	{
+		m_applied = oldVersion;
+
+		StartTimer();
+		result = m_delta.Apply(m_applied.heights.data(), cellCount, 1, m_applied.words.data(), (int)m_applied.words.size(), m_applied.rooms, m_applied.corridors) && result;
+		applyTime += GetTime();
+	}
+	applyTime /= (float)DELTA_RUNS;
+
+	same = result && IsSame(m_applied, newVersion);
+
+	// The raw size is what sending the new version whole would take.
+	rawBytes = ((float)cellCount * sizeof(float)) + ((float)newVersion.words.size() * sizeof(unsigned long long)) +
+		((float)(newVersion.rooms.size() + newVersion.corridors.size()) * sizeof(dungeonCellData));
+
+	printf("%-22s %9d %10d %6.1f%% %10.2f %10.0f %10.3f %6s\n", name, m_delta.GetChangedCount(), (int)m_delta.GetData().size(), (100.0f * (float)m_delta.GetData().size()) / rawBytes,
+		encodeTime, (float)cellCount / (encodeTime * 1000.0f), applyTime, same ? "yes" : "NO");
+
+	return same;
+}
+
+
+bool DeltaBenchmarkClass::IsSame(const SnapshotType& a, const SnapshotType& b)
+{
+	if((a.heights.size() != b.heights.size()) || (a.words != b.words) || (a.rooms.size() != b.rooms.size()) || (a.corridors.size() != b.corridors.size()))
+	{
+		return false;
+	}
+
+	// The heights and rectangles are compared as bits.
+	if(memcmp(a.heights.data(), b.heights.data(), a.heights.size() * sizeof(float)) != 0)
+	{
+		return false;
+	}
+
+	if(memcmp(a.rooms.data(), b.rooms.data(), a.rooms.size() * sizeof(dungeonCellData)) != 0)
+	{
+		return false;
+	}
+
+	if(memcmp(a.corridors.data(), b.corridors.data(), a.corridors.size() * sizeof(dungeonCellData)) != 0)
+	{
+		return false;
+	}
+
+	return true;
+}
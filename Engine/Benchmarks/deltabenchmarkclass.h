@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: deltabenchmarkclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _DELTABENCHMARKCLASS_H_
+#define _DELTABENCHMARKCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "benchmarkclass.h"
+#include "terrainclass.h"
+#include "terraindeltaclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int DELTA_TERRAIN_SIZE = 1024;
+const int DELTA_RUNS = 10;
+const int DELTA_EDIT_SIZE = 32;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: DeltaBenchmarkClass
+////////////////////////////////////////////////////////////////////////////////
+// Reports the size of the delta between two versions of a 1024x1024 terrain,
+// and how long it takes to encode and to apply, for the changes a player makes:
+// noise on a flat map, a dungeon dug in, the dungeon made again with another
+// seed, a smoothing pass, erosion, a small hand edit and no change at all. The
+// versions are generated by a terrain without a device, one recipe after the
+// other, and the heights are taken out of it one float per cell. The times are
+// the mean of 10 runs, and every delta must turn the old version into the new
+// one bit for bit.
+class DeltaBenchmarkClass : public BenchmarkClass
+{
+private:
+	struct SnapshotType
+	{
+		std::vector<float> heights;
+		std::vector<unsigned long long> words;
+		std::vector<dungeonCellData> rooms, corridors;
+	};
+
+public:
+	DeltaBenchmarkClass();
+	DeltaBenchmarkClass(const DeltaBenchmarkClass&);
+	~DeltaBenchmarkClass();
+
+	const char* GetName();
+	bool Run();
+
+private:
+	bool InitializeTerrain();
+	void ShutdownTerrain();
+	bool Generate(const generationOperationData* operations, int operationCount, SnapshotType& snapshot);
+	void TakeSnapshot(SnapshotType& snapshot);
+	bool RunCase(const char* name, const SnapshotType& oldVersion, const SnapshotType& newVersion);
+	bool IsSame(const SnapshotType& a, const SnapshotType& b);
+
+private:
+	TerrainClass* m_Terrain;
+	TerrainDeltaClass m_delta;
+	SnapshotType m_flat, m_perlin, m_dungeon, m_reseeded, m_smoothed, m_eroded, m_edited, m_applied;
+};
+
+#endif
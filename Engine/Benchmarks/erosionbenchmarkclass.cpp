@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: erosionbenchmarkclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "erosionbenchmarkclass.h"
+#include "erosionclass.h"
+#include "noisecombinerclass.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+
+ErosionBenchmarkClass::ErosionBenchmarkClass()
+{
+}
+
+
+ErosionBenchmarkClass::ErosionBenchmarkClass(const ErosionBenchmarkClass& other)
+{
+}
+
+
+ErosionBenchmarkClass::~ErosionBenchmarkClass()
+{
+}
+
+
+const char* ErosionBenchmarkClass::GetName()
+{
+	return "erosion";
+}
+
+
+bool ErosionBenchmarkClass::Run()
+{
+	bool result;
+
+
+	printf("%6s %8s %10s %14s %12s %8s %6s\n", "size", "threads", "iterations", "ms/iteration", "iterations/s", "speedup", "same");
+
+	result = RunSize(1024);
+	result = RunSize(4096) && result;
+
+	m_field.Shutdown();
+	m_output.Shutdown();
+	std::vector<float>().swap(m_reference);
+	std::vector<float>().swap(m_heights);
+
+	return result;
+}
+
+
+bool ErosionBenchmarkClass::RunSize(int size)
+{
+	float time, singleTime;
+	int iterations, maxThreads;
+	bool result, same;
+
+
+	result = FillField(size);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_output.Initialize(size, size, HeightFieldClass::LAYOUT_ROW_MAJOR);
+	if(!result)
+	{
+		return false;
+	}
+
+	iterations = std::max(EROSION_BENCHMARK_CELLS / (size * size), 1);
+	maxThreads = std::max((int)std::thread::hardware_concurrency(), EROSION_MIN_THREADS);
+
+	singleTime = 0.0f;
+	for(int threadCount=1; threadCount<=maxThreads; threadCount*=2)
+	{
+		result = RunThreads(threadCount, iterations, time);
+		if(!result)
+		{
+			return false;
+		}
+
+		// The single thread run is the one the others have to match.
+		if(threadCount == 1)
+		{
+			m_reference.swap(m_heights);
+			singleTime = time;
+			same = true;
+		}
+		else
+		{
+			same = (memcmp(&m_heights[0], &m_reference[0], m_reference.size() * sizeof(float)) == 0);
+		}
+
+		printf("%6d %8d %10d %14.1f %12.2f %8.2f %6s\n", size, threadCount, iterations, time / (float)iterations, ((float)iterations * 1000.0f) / time,
+			singleTime / time, same ? "yes" : "NO");
+
+		if(!same)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool ErosionBenchmarkClass::RunThreads(int threadCount, int iterations, float& time)
+{
+	ThreadPoolClass threadPool;
+	ErosionClass erosion;
+	bool result;
+
+
+	result = threadPool.Initialize(threadCount);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = erosion.Initialize(m_field.GetWidth(), m_field.GetHeight(), &threadPool);
+	if(!result)
+	{
+		threadPool.Shutdown();
+		return false;
+	}
+
+	for(int y=0; y<m_field.GetHeight(); y++)
+	{
+		erosion.LoadRow(m_field, y);
+	}
+
+	StartTimer();
+	for(int i=0; i<iterations; i++)
+	{
+		erosion.Iterate();
+	}
+	time = GetTime();
+
+	for(int y=0; y<m_output.GetHeight(); y++)
+	{
+		erosion.StoreRow(m_output, y);
+	}
+
+	erosion.Shutdown();
+	threadPool.Shutdown();
+
+	ReadOutput();
+
+	return true;
+}
+
+
+bool ErosionBenchmarkClass::FillField(int size)
+{
+	PerlinNoiseClass perlin;
+	FractalNoiseClass fractal;
+	float* span;
+	int length;
+	bool result;
+
+
+	result = perlin.Initialize(38);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = fractal.Initialize(&perlin, NOISE_OCTAVES, NOISE_FREQUENCY, 2.0f, 0.5f);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_field.Initialize(size, size, HeightFieldClass::LAYOUT_ROW_MAJOR);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Hills of fractal noise, steep enough in places for the slopes to slump.
+	for(int y=0; y<size; y++)
+	{
+		span = m_field.GetSpan(0, y, length);
+		fractal.SampleRow(0.0f, (float)y, 1.0f, length, span);
+		for(int x=0; x<length; x++)
+		{
+			span[x] *= EROSION_BENCHMARK_HEIGHT;
+		}
+	}
+
+	perlin.Shutdown();
+
+	return true;
+}
+
+
+void ErosionBenchmarkClass::ReadOutput()
+{
+	const float* span;
+	int width, length;
+
+
+	width = m_output.GetWidth();
+	m_heights.resize(width * m_output.GetHeight());
+
+	for(int y=0; y<m_output.GetHeight(); y++)
+	{
+		span = m_output.GetSpan(0, y, length);
+		memcpy(&m_heights[y * width], span, length * sizeof(float));
+	}
+
+	return;
+}
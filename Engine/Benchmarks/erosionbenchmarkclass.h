@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: erosionbenchmarkclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _EROSIONBENCHMARKCLASS_H_
+#define _EROSIONBENCHMARKCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "benchmarkclass.h"
+#include "heightfieldclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int EROSION_BENCHMARK_CELLS = 16 * 1024 * 1024;
+const int EROSION_MIN_THREADS = 4;
+const float EROSION_BENCHMARK_HEIGHT = 32.0f;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ErosionBenchmarkClass
+////////////////////////////////////////////////////////////////////////////////
+// Reports erosion iterations per second on 1024 and 4096 square maps of fractal
+// noise, with 1, 2, 4 and so on threads up to the hardware thread count (and at
+// least 4). Each map gets enough iterations to cover 16M cells, 16 at 1024 and
+// 1 at 4096. The speedup is against the one thread run, and the heights every
+// thread count leaves must be bit for bit the ones the single thread left.
+class ErosionBenchmarkClass : public BenchmarkClass
+{
+public:
+	ErosionBenchmarkClass();
+	ErosionBenchmarkClass(const ErosionBenchmarkClass&);
+	~ErosionBenchmarkClass();
+
+	const char* GetName();
+	bool Run();
+
+private:
+	bool RunSize(int size);
+	bool RunThreads(int threadCount, int iterations, float& time);
+	bool FillField(int size);
+	void ReadOutput();
+
+private:
+	HeightFieldClass m_field, m_output;
+	std::vector<float> m_reference, m_heights;
+};
+
+#endif
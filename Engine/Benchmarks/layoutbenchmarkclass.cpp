@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: layoutbenchmarkclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "layoutbenchmarkclass.h"
+#include <cstdio>
+#include <new>
+
+
+LayoutBenchmarkClass::LayoutBenchmarkClass()
+{
+	m_Terrain = 0;
+}
+
+
+LayoutBenchmarkClass::LayoutBenchmarkClass(const LayoutBenchmarkClass& other)
+{
+}
+
+
+LayoutBenchmarkClass::~LayoutBenchmarkClass()
+{
+}
+
+
+const char* LayoutBenchmarkClass::GetName()
+{
+	return "layout";
+}
+
+
+bool LayoutBenchmarkClass::Run()
+{
+	bool result;
+
+
+	// Only the stencils and their fields are used, the terrain itself is never initialized.
+	m_Terrain = new TerrainClass;
+	if(!m_Terrain)
+	{
+		return false;
+	}
+
+	printf("%6s %-10s %6s %14s %14s\n", "size", "layout", "passes", "smooth ms", "normals ms");
+
+	result = true;
+	for(int size=LAYOUT_MIN_SIZE; size<=LAYOUT_MAX_SIZE; size*=2)
+	{
+		result = RunSize(size, HeightFieldClass::LAYOUT_ROW_MAJOR) && result;
+		result = RunSize(size, HeightFieldClass::LAYOUT_TILED) && result;
+	}
+
+	delete m_Terrain;
+	m_Terrain = 0;
+
+	return result;
+}
+
+
+bool LayoutBenchmarkClass::RunSize(int size, HeightFieldClass::LayoutType layout)
+{
+	TerrainClass::VectorType* normals;
+	float smoothTime, normalTime;
+	int passes, tileCount;
+	bool result;
+
+
+	m_Terrain->m_terrainWidth = size;
+	m_Terrain->m_terrainHeight = size;
+
+	passes = LAYOUT_PASS_CELLS / (size * size);
+	if(passes < 1)
+	{
+		passes = 1;
+	}
+
+	// Smoothing reads one field and writes the other.
+	result = m_Terrain->m_heightField.Initialize(size, size, layout);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_Terrain->m_smoothField.Initialize(size, size, layout);
+	if(!result)
+	{
+		m_Terrain->m_heightField.Shutdown();
+		return false;
+	}
+
+	FillField(m_Terrain->m_heightField);
+	tileCount = m_Terrain->m_heightField.GetTileCount();
+
+	StartTimer();
+	for(int i=0; i<passes; i++)
+	{
+		for(int tile=0; tile<tileCount; tile++)
+		{
+			m_Terrain->SmoothHeightTile(tile);
+		}
+	}
+	smoothTime = GetTime() / (float)passes;
+
+	m_Terrain->m_smoothField.Shutdown();
+
+	// The face normals need 12 bytes a cell, which may not be there at the largest size.
+	normals = new(std::nothrow) TerrainClass::VectorType[(size_t)(size - 1) * (size_t)(size - 1)];
+	if(normals)
+	{
+		StartTimer();
+		for(int i=0; i<passes; i++)
+		{
+			for(int tile=0; tile<tileCount; tile++)
+			{
+				m_Terrain->CalculateFaceNormals(tile, normals);
+			}
+		}
+		normalTime = GetTime() / (float)passes;
+
+		delete [] normals;
+		normals = 0;
+
+		printf("%6d %-10s %6d %14.2f %14.2f\n", size, (layout == HeightFieldClass::LAYOUT_TILED) ? "tiled" : "row-major", passes, smoothTime, normalTime);
+	}
+	else
+	{
+		printf("%6d %-10s %6d %14.2f %14s\n", size, (layout == HeightFieldClass::LAYOUT_TILED) ? "tiled" : "row-major", passes, smoothTime, "no memory");
+	}
+
+	m_Terrain->m_heightField.Shutdown();
+
+	return true;
+}
+
+
+void LayoutBenchmarkClass::FillField(HeightFieldClass& field)
+{
+	float* span;
+	int length;
+
+
+	// Any heights will do, the stencils do the same work whatever they are.
+	for(int y=0; y<field.GetHeight(); y++)
+	{
+		for(int x=0; x<field.GetWidth(); x+=length)
+		{
+			span = field.GetSpan(x, y, length);
+			for(int i=0; i<length; i++)
+			{
+				span[i] = (float)((((x + i) * 7) + (y * 13)) % 101);
+			}
+		}
+	}
+
+	return;
+}
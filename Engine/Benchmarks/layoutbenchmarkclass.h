@@ -0,0 +1,50 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: layoutbenchmarkclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _LAYOUTBENCHMARKCLASS_H_
+#define _LAYOUTBENCHMARKCLASS_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "benchmarkclass.h"
+#include "terrainclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int LAYOUT_MIN_SIZE = 1024;
+const int LAYOUT_MAX_SIZE = (sizeof(void*) > 4) ? 16384 : 8192;
+const int LAYOUT_PASS_CELLS = 4096 * 4096;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: LayoutBenchmarkClass
+////////////////////////////////////////////////////////////////////////////////
+// Times the smoothing and face normal stencils of the terrain on row-major and
+// tiled height fields, on square maps from 1024 to 16384. The stencils are the
+// terrain's own, run on fields set up here rather than through a whole terrain,
+// which would not fit at the larger sizes. Small maps get several passes so every
+// time covers about 16M cells. A 32-bit build cannot hold the 1GB fields of the
+// 16384 map and stops at 8192.
+class LayoutBenchmarkClass : public BenchmarkClass
+{
+public:
+	LayoutBenchmarkClass();
+	LayoutBenchmarkClass(const LayoutBenchmarkClass&);
+	~LayoutBenchmarkClass();
+
+	const char* GetName();
+	bool Run();
+
+private:
+	bool RunSize(int size, HeightFieldClass::LayoutType layout);
+	void FillField(HeightFieldClass& field);
+
+private:
+	TerrainClass* m_Terrain;
+};
+
+#endif
@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: main.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "routerbenchmarkclass.h"
+#include "layoutbenchmarkclass.h"
+#include "erosionbenchmarkclass.h"
+#include "noisebenchmarkclass.h"
+#include "servicebenchmarkclass.h"
+#include "deltabenchmarkclass.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+int main(int argc, char* argv[])
+{
+	std::vector<BenchmarkClass*> benchmarks;
+	bool result, found;
+
+
+	// Create the benchmarks.
+	benchmarks.push_back(new RouterBenchmarkClass);
+	benchmarks.push_back(new LayoutBenchmarkClass);
+	benchmarks.push_back(new ErosionBenchmarkClass);
+	benchmarks.push_back(new NoiseBenchmarkClass);
+	benchmarks.push_back(new ServiceBenchmarkClass);
+	benchmarks.push_back(new DeltaBenchmarkClass);
+
+	// Run the benchmark named on the command line, or all of them without a name.
+	result = true;
+	found = false;
+	for(unsigned int i=0; i<benchmarks.size(); i++)
+	{
+		if((argc < 2) || (strcmp(argv[1], benchmarks[i]->GetName()) == 0))
+		{
+			printf("%s\n", benchmarks[i]->GetName());
+			result = benchmarks[i]->Run() && result;
+			printf("\n");
+			found = true;
+		}
+	}
+
+	if(!found)
+	{
+		printf("There is no benchmark called %s.\n", argv[1]);
+		result = false;
+	}
+
+	// Release the benchmarks.
+	for(unsigned int i=0; i<benchmarks.size(); i++)
+	{
+		delete benchmarks[i];
+		benchmarks[i] = 0;
+	}
+
+	return result ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noisebenchmarkclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "noisebenchmarkclass.h"
+#include "perlin.h"
+#include <cstdio>
+#include <cstring>
+
+
+NoiseBenchmarkClass::NoiseBenchmarkClass()
+{
+}
+
+
+NoiseBenchmarkClass::NoiseBenchmarkClass(const NoiseBenchmarkClass& other)
+{
+}
+
+
+NoiseBenchmarkClass::~NoiseBenchmarkClass()
+{
+}
+
+
+const char* NoiseBenchmarkClass::GetName()
+{
+	return "noise";
+}
+
+
+bool NoiseBenchmarkClass::Run()
+{
+	bool result;
+
+
+	result = InitializeGraph();
+	if(!result)
+	{
+		ShutdownGraph();
+		return false;
+	}
+
+	m_row.resize(NOISE_BENCHMARK_SIZE);
+
+	printf("%-14s %12s %6s\n", "source", "Msamples/s", "same");
+
+	// The sources and the single combinators are sampled a fraction of a cell apart, the octave graphs a cell apart.
+	result = RunSource("perlin", m_perlin, NOISE_BENCHMARK_STEP);
+	result = RunSource("simplex", m_simplex, NOISE_BENCHMARK_STEP) && result;
+	result = RunSource("value", m_value, NOISE_BENCHMARK_STEP) && result;
+	result = RunSource("ridged", m_ridged, NOISE_BENCHMARK_STEP) && result;
+	result = RunSource("billow", m_billow, NOISE_BENCHMARK_STEP) && result;
+	result = RunSource("scale/offset", m_scaled, NOISE_BENCHMARK_STEP) && result;
+	result = RunSource("domain warp", m_warped, NOISE_BENCHMARK_STEP) && result;
+	result = RunSource("fractal x5", m_fractal, 1.0f) && result;
+	result = RunSource("terrain", m_terrain, 1.0f) && result;
+
+	RunPerlinClass();
+
+	ShutdownGraph();
+	std::vector<float>().swap(m_row);
+
+	return result;
+}
+
+
+bool NoiseBenchmarkClass::InitializeGraph()
+{
+	bool result;
+
+
+	// The sources.
+	result = m_perlin.Initialize(58);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_simplex.Initialize(59);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_value.Initialize(60);
+	if(!result)
+	{
+		return false;
+	}
+
+	// One of each combinator over Perlin noise.
+	result = m_ridged.Initialize(&m_perlin);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_billow.Initialize(&m_perlin);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_fractal.Initialize(&m_perlin, NOISE_OCTAVES, 1.0f / 64.0f, 2.0f, 0.5f);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_warped.Initialize(&m_perlin, &m_simplex, 4.0f);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_scaled.Initialize(&m_perlin, 0.5f, 6.0f, 1.0f);
+	if(!result)
+	{
+		return false;
+	}
+
+	// The graph of the perlin operation, made as the terrain makes it.
+	result = m_ridgedFractal.Initialize(&m_ridged, NOISE_OCTAVES, NOISE_FREQUENCY, 2.0f, 0.5f);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_warpFractal.Initialize(&m_simplex, 2, NOISE_FREQUENCY * 0.5f, 2.0f, 0.5f);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_terrainWarp.Initialize(&m_ridgedFractal, &m_warpFractal, NOISE_WARP);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_terrain.Initialize(&m_terrainWarp, 1.0f, NOISE_AMPLITUDE, 0.0f);
+	if(!result)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+void NoiseBenchmarkClass::ShutdownGraph()
+{
+	m_value.Shutdown();
+	m_simplex.Shutdown();
+	m_perlin.Shutdown();
+
+	return;
+}
+
+
+bool NoiseBenchmarkClass::RunSource(const char* name, const NoiseSourceClass& source, float step)
+{
+	float time, x, y, value;
+	bool same;
+
+
+	StartTimer();
+	for(int j=0; j<NOISE_BENCHMARK_SIZE; j++)
+	{
+		source.SampleRow(0.0f, (float)j * step, step, NOISE_BENCHMARK_SIZE, &m_row[0]);
+	}
+	time = GetTime();
+
+	// Sample the last row again a point at a time.
+	same = true;
+	y = (float)(NOISE_BENCHMARK_SIZE - 1) * step;
+	for(int i=0; i<NOISE_BENCHMARK_SIZE; i++)
+	{
+		x = (float)i * step;
+		source.Sample(&x, &y, 1, &value);
+		if(memcmp(&value, &m_row[i], sizeof(float)) != 0)
+		{
+			same = false;
+		}
+	}
+
+	printf("%-14s %12.1f %6s\n", name, ((float)NOISE_BENCHMARK_SIZE * (float)NOISE_BENCHMARK_SIZE) / (time * 1000.0f), same ? "yes" : "NO");
+
+	return same;
+}
+
+
+void NoiseBenchmarkClass::RunPerlinClass()
+{
+	perlin noise(58);
+	double sum;
+	float time;
+
+
+	sum = 0.0;
+	StartTimer();
+	for(int j=0; j<NOISE_BENCHMARK_SIZE; j++)
+	{
+		for(int i=0; i<NOISE_BENCHMARK_SIZE; i++)
+		{
+			sum += noise.noise((double)i * NOISE_BENCHMARK_STEP, (double)j * NOISE_BENCHMARK_STEP, 1.1);
+		}
+	}
+	time = GetTime();
+
+	// The sum is printed so the calls cannot be left out.
+	printf("%-14s %12.1f %6s (a sample per call, sum %.1f)\n", "perlin class", ((float)NOISE_BENCHMARK_SIZE * (float)NOISE_BENCHMARK_SIZE) / (time * 1000.0f), "-", sum);
+
+	return;
+}
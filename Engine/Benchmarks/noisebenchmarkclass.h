@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noisebenchmarkclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _NOISEBENCHMARKCLASS_H_
+#define _NOISEBENCHMARKCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "benchmarkclass.h"
+#include "noisecombinerclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int NOISE_BENCHMARK_SIZE = 1024;
+const float NOISE_BENCHMARK_STEP = 0.037f;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: NoiseBenchmarkClass
+////////////////////////////////////////////////////////////////////////////////
+// Reports samples per second for every noise source and combinator, each over
+// 1024x1024 points taken a row at a time through SampleRow. The combinators sit
+// on Perlin noise, so their cost over the plain Perlin line is their own. The
+// terrain line is the graph the perlin operation samples. Each also checks that
+// a row sampled as a batch gives the same values as sampling its points one at
+// a time. The old perlin class, a double per call, is timed last to compare.
+class NoiseBenchmarkClass : public BenchmarkClass
+{
+public:
+	NoiseBenchmarkClass();
+	NoiseBenchmarkClass(const NoiseBenchmarkClass&);
+	~NoiseBenchmarkClass();
+
+	const char* GetName();
+	bool Run();
+
+private:
+	bool InitializeGraph();
+	void ShutdownGraph();
+	bool RunSource(const char* name, const NoiseSourceClass& source, float step);
+	void RunPerlinClass();
+
+private:
+	PerlinNoiseClass m_perlin;
+	SimplexNoiseClass m_simplex;
+	ValueNoiseClass m_value;
+	RidgedNoiseClass m_ridged;
+	BillowNoiseClass m_billow;
+	FractalNoiseClass m_fractal;
+	DomainWarpNoiseClass m_warped;
+	ScaleOffsetNoiseClass m_scaled;
+	FractalNoiseClass m_ridgedFractal, m_warpFractal;
+	DomainWarpNoiseClass m_terrainWarp;
+	ScaleOffsetNoiseClass m_terrain;
+	std::vector<float> m_row;
+};
+
+#endif
@@ -0,0 +1,163 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: routerbenchmarkclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "routerbenchmarkclass.h"
+#include "arenaclass.h"
+#include "corridorplannerclass.h"
+#include "corridorrouterclass.h"
+#include "randomhash.h"
+#include "roomindexclass.h"
+#include <cstdio>
+
+
+RouterBenchmarkClass::RouterBenchmarkClass()
+{
+}
+
+
+RouterBenchmarkClass::RouterBenchmarkClass(const RouterBenchmarkClass& other)
+{
+}
+
+
+RouterBenchmarkClass::~RouterBenchmarkClass()
+{
+}
+
+
+const char* RouterBenchmarkClass::GetName()
+{
+	return "router";
+}
+
+
+bool RouterBenchmarkClass::Run()
+{
+	bool result;
+
+
+	printf("%6s %6s %6s %12s %12s %10s %12s %8s\n", "size", "rooms", "edges", "L-shape ms", "routed ms", "us/route", "nodes/route", "failed");
+
+	result = RunSize(1024);
+	result = RunSize(2048) && result;
+	result = RunSize(4096) && result;
+
+	std::vector<dungeonCellData>().swap(m_rooms);
+	std::vector<dungeonCellData>().swap(m_corridors);
+
+	return result;
+}
+
+
+bool RouterBenchmarkClass::RunSize(int size)
+{
+	ArenaClass arena;
+	CorridorPlannerClass planner;
+	CorridorRouterClass router;
+	float plannerTime, routerTime;
+	int edgeCount, failed;
+	bool result;
+
+
+	PlaceRooms(size, (size * size) / ROUTER_CELLS_PER_ROOM, (unsigned long long)size);
+
+	// Join the rooms the way a dungeon operation does.
+	result = arena.Initialize(ROUTER_ARENA_SIZE);
+	if(!result)
+	{
+		return false;
+	}
+
+	planner.Seed(size);
+	result = planner.Plan(m_rooms, CORRIDOR_LOOP_FRACTION, arena);
+	if(!result)
+	{
+		arena.Shutdown();
+		return false;
+	}
+
+	const std::vector<CorridorPlannerClass::EdgeType>& edges = planner.GetEdges();
+	edgeCount = (int)edges.size();
+
+	// Lay the edges out as straight and L-shaped pieces, through whatever is in the way.
+	m_corridors.clear();
+	StartTimer();
+	planner.RouteCorridors(m_rooms, m_corridors);
+	plannerTime = GetTime();
+
+	// Route the same edges round the rooms, including the time to mark the rooms in the grid.
+	result = router.Initialize(size, size);
+	if(!result)
+	{
+		arena.Shutdown();
+		return false;
+	}
+
+	m_corridors.clear();
+	failed = 0;
+	StartTimer();
+	for(unsigned int i=0; i<m_rooms.size(); i++)
+	{
+		router.MarkRoom(m_rooms[i]);
+	}
+
+	for(int i=0; i<edgeCount; i++)
+	{
+		if(!router.RouteRooms(m_rooms[edges[i].roomA], m_rooms[edges[i].roomB], m_corridors))
+		{
+			failed++;
+		}
+	}
+	routerTime = GetTime();
+
+	printf("%6d %6d %6d %12.2f %12.2f %10.1f %12.0f %8d\n", size, (int)m_rooms.size(), edgeCount, plannerTime, routerTime,
+		(edgeCount > 0) ? (routerTime * 1000.0f) / (float)edgeCount : 0.0f,
+		(edgeCount > 0) ? (float)router.GetExpandedNodeCount() / (float)edgeCount : 0.0f, failed);
+
+	router.Shutdown();
+	arena.Shutdown();
+
+	return failed == 0;
+}
+
+
+void RouterBenchmarkClass::PlaceRooms(int size, int count, unsigned long long seed)
+{
+	RoomIndexClass index;
+	dungeonCellData room, spaced;
+	unsigned long long state;
+	int width, height;
+
+
+	m_rooms.clear();
+
+	index.Initialize(size, size, ROOM_INDEX_CELL_SIZE);
+
+	// Throw rooms at the map and keep those a cell or more clear of the rest, as the dungeon's rooms are.
+	state = MixBits(seed) | 1;
+	for(int i=0; (i<count * 4) && ((int)m_rooms.size() < count); i++)
+	{
+		width = RandomRange(state, ROUTER_MIN_ROOM_SIZE, ROUTER_MAX_ROOM_SIZE);
+		height = RandomRange(state, ROUTER_MIN_ROOM_SIZE, ROUTER_MAX_ROOM_SIZE);
+
+		room.xBottomLeft = (float)RandomRange(state, 1, size - width - 2);
+		room.yBottomLeft = (float)RandomRange(state, 1, size - height - 2);
+		room.xTopRight = room.xBottomLeft + (float)width;
+		room.yTopRight = room.yBottomLeft + (float)height;
+
+		spaced.xBottomLeft = room.xBottomLeft - 1.0f;
+		spaced.yBottomLeft = room.yBottomLeft - 1.0f;
+		spaced.xTopRight = room.xTopRight + 1.0f;
+		spaced.yTopRight = room.yTopRight + 1.0f;
+
+		if(!index.Overlaps(spaced))
+		{
+			index.Insert(room);
+			m_rooms.push_back(room);
+		}
+	}
+
+	index.Shutdown();
+
+	return;
+}
@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: routerbenchmarkclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _ROUTERBENCHMARKCLASS_H_
+#define _ROUTERBENCHMARKCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "benchmarkclass.h"
+#include "dungeoncelldata.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int ROUTER_CELLS_PER_ROOM = 8192;
+const int ROUTER_MIN_ROOM_SIZE = 4;
+const int ROUTER_MAX_ROOM_SIZE = 20;
+const int ROUTER_ARENA_SIZE = 256 * 1024;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: RouterBenchmarkClass
+////////////////////////////////////////////////////////////////////////////////
+// Times the corridor routing of generated dungeons at 1024, 2048 and 4096 cells
+// square. Rooms are placed apart from each other at one per 8192 cells, which is
+// 2048 rooms at 4096, and joined by the corridor planner. Every planned edge is
+// then laid out both as the planner's L-shaped pieces and with the jump point
+// router, on the same rooms.
+class RouterBenchmarkClass : public BenchmarkClass
+{
+public:
+	RouterBenchmarkClass();
+	RouterBenchmarkClass(const RouterBenchmarkClass&);
+	~RouterBenchmarkClass();
+
+	const char* GetName();
+	bool Run();
+
+private:
+	bool RunSize(int size);
+	void PlaceRooms(int size, int count, unsigned long long seed);
+
+private:
+	std::vector<dungeonCellData> m_rooms, m_corridors;
+};
+
+#endif
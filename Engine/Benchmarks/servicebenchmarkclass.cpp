@@ -0,0 +1,277 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: servicebenchmarkclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "servicebenchmarkclass.h"
+#include "generationclientclass.h"
+#include "randomhash.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+
+ServiceBenchmarkClass::ServiceBenchmarkClass()
+{
+	m_tileKey = 0;
+	m_seedBase = 0;
+	m_phaseSeed = 0;
+	m_setupResult = false;
+	m_runningClients = 0;
+}
+
+
+ServiceBenchmarkClass::ServiceBenchmarkClass(const ServiceBenchmarkClass& other)
+{
+}
+
+
+ServiceBenchmarkClass::~ServiceBenchmarkClass()
+{
+}
+
+
+const char* ServiceBenchmarkClass::GetName()
+{
+	return "service";
+}
+
+
+bool ServiceBenchmarkClass::Run()
+{
+	GenerationServiceClass service;
+	DiskCacheClass cache;
+	std::thread setup;
+	bool result;
+
+
+	// The service and its clients share the disk cache, so check the directory can be made before blaming the service.
+	result = cache.Initialize(DISK_CACHE_DIRECTORY, 0, DISK_CACHE_VERSION);
+	cache.Shutdown();
+	if(!result)
+	{
+		printf("Could not make the cache directory %s.\n", DISK_CACHE_DIRECTORY);
+		return false;
+	}
+
+	result = service.Initialize(SERVICE_BENCHMARK_NAME, SERVICE_TERRAIN_SIZE, SERVICE_TERRAIN_SIZE, SERVICE_WORKERS);
+	if(!result)
+	{
+		printf("Could not start the service, either the name %s is taken or its terrains could not be made.\n", SERVICE_BENCHMARK_NAME);
+		return false;
+	}
+
+	m_seedBase = (unsigned int)MixBits((unsigned long long)std::chrono::system_clock::now().time_since_epoch().count());
+
+	// Generate the terrain the tiles are fetched from before any load starts.
+	m_runningClients = 1;
+	setup = std::thread(&ServiceBenchmarkClass::SetupThread, this);
+	PumpService(service);
+	setup.join();
+
+	if(!m_setupResult)
+	{
+		printf("Could not generate the terrain to fetch tiles from.\n");
+		service.Shutdown();
+		return false;
+	}
+
+	printf("%6s %-10s %7s %10s %10s %10s %7s\n", "rate", "request", "count", "p50 ms", "p99 ms", "max ms", "failed");
+
+	// Each rate gets a pool of seeds of its own, so it makes its own terrains.
+	m_phaseSeed = m_seedBase + 1;
+	result = RunPhase(service, 25);
+	m_phaseSeed += SERVICE_SEED_POOL;
+	result = RunPhase(service, 50) && result;
+	m_phaseSeed += SERVICE_SEED_POOL;
+	result = RunPhase(service, 100) && result;
+	m_phaseSeed += SERVICE_SEED_POOL;
+	result = RunPhase(service, 200) && result;
+
+	printf("requests %d, coalesced %d, generated %d\n", service.GetRequestCount(), service.GetCoalescedCount(), service.GetGeneratedCount());
+
+	service.Shutdown();
+	std::vector<float>().swap(m_latencies);
+
+	return result;
+}
+
+
+bool ServiceBenchmarkClass::RunPhase(GenerationServiceClass& service, int rate)
+{
+	int generateFailures, fetchFailures;
+
+
+	// Split the rate between the clients and start them.
+	m_runningClients = SERVICE_CLIENTS;
+	for(int i=0; i<SERVICE_CLIENTS; i++)
+	{
+		m_clients[i].index = i;
+		m_clients[i].rate = (float)rate / (float)SERVICE_CLIENTS;
+		m_clients[i].generateLatencies.clear();
+		m_clients[i].fetchLatencies.clear();
+		m_clients[i].generateFailures = 0;
+		m_clients[i].fetchFailures = 0;
+		m_clients[i].thread = std::thread(&ServiceBenchmarkClass::ClientThread, this, &m_clients[i]);
+	}
+
+	PumpService(service);
+
+	for(int i=0; i<SERVICE_CLIENTS; i++)
+	{
+		m_clients[i].thread.join();
+	}
+
+	// Put the latencies of every client together, one kind of request at a time.
+	m_latencies.clear();
+	generateFailures = 0;
+	for(int i=0; i<SERVICE_CLIENTS; i++)
+	{
+		m_latencies.insert(m_latencies.end(), m_clients[i].generateLatencies.begin(), m_clients[i].generateLatencies.end());
+		generateFailures += m_clients[i].generateFailures;
+	}
+	PrintLatencies(rate, "generate", m_latencies, generateFailures);
+
+	m_latencies.clear();
+	fetchFailures = 0;
+	for(int i=0; i<SERVICE_CLIENTS; i++)
+	{
+		m_latencies.insert(m_latencies.end(), m_clients[i].fetchLatencies.begin(), m_clients[i].fetchLatencies.end());
+		fetchFailures += m_clients[i].fetchFailures;
+	}
+	PrintLatencies(rate, "fetch tile", m_latencies, fetchFailures);
+
+	return (generateFailures == 0) && (fetchFailures == 0);
+}
+
+
+void ServiceBenchmarkClass::PumpService(GenerationServiceClass& service)
+{
+	// Run the frame loop until the clients are done.
+	while(m_runningClients > 0)
+	{
+		service.Frame(SERVICE_FRAME_BUDGET);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return;
+}
+
+
+void ServiceBenchmarkClass::SetupThread()
+{
+	GenerationClientClass client;
+	generationOperationData operations[2];
+
+
+	m_setupResult = client.Initialize(SERVICE_BENCHMARK_NAME, DISK_CACHE_DIRECTORY);
+	if(m_setupResult)
+	{
+		MakeRecipe(m_seedBase, operations);
+		m_setupResult = client.Generate(operations, 2, m_tileKey);
+	}
+
+	client.Shutdown();
+
+	m_runningClients--;
+
+	return;
+}
+
+
+void ServiceBenchmarkClass::ClientThread(ClientType* client)
+{
+	GenerationClientClass connection;
+	generationOperationData operations[2];
+	std::chrono::steady_clock::time_point start, due;
+	std::vector<float> heights;
+	unsigned long long state, key;
+	int requestCount, x, y;
+	float latency;
+	bool result, generate;
+
+
+	requestCount = (int)(client->rate * (float)SERVICE_PHASE_SECONDS);
+
+	result = connection.Initialize(SERVICE_BENCHMARK_NAME, DISK_CACHE_DIRECTORY);
+	if(!result)
+	{
+		client->fetchFailures = requestCount;
+		m_runningClients--;
+		return;
+	}
+
+	state = MixBits(m_phaseSeed + client->index) | 1;
+	start = std::chrono::steady_clock::now();
+	for(int i=0; i<requestCount; i++)
+	{
+		// Send on the schedule, and count the time from when the request was due, not from when it went.
+		due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>((float)i / client->rate));
+		std::this_thread::sleep_until(due);
+
+		generate = (RandomRange(state, 0, 99) < SERVICE_GENERATE_PERCENT);
+		if(generate)
+		{
+			MakeRecipe(m_phaseSeed + RandomRange(state, 0, SERVICE_SEED_POOL - 1), operations);
+			result = connection.Generate(operations, 2, key);
+		}
+		else
+		{
+			x = RandomRange(state, 0, SERVICE_TERRAIN_SIZE - SERVICE_TILE_SIZE);
+			y = RandomRange(state, 0, SERVICE_TERRAIN_SIZE - SERVICE_TILE_SIZE);
+			result = connection.FetchTile(m_tileKey, x, y, SERVICE_TILE_SIZE, SERVICE_TILE_SIZE, heights);
+		}
+
+		latency = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - due).count();
+		if(generate)
+		{
+			client->generateLatencies.push_back(latency);
+			client->generateFailures += result ? 0 : 1;
+		}
+		else
+		{
+			client->fetchLatencies.push_back(latency);
+			client->fetchFailures += result ? 0 : 1;
+		}
+	}
+
+	connection.Shutdown();
+
+	m_runningClients--;
+
+	return;
+}
+
+
+void ServiceBenchmarkClass::MakeRecipe(unsigned int seed, generationOperationData* operations)
+{
+	// A noise terrain with a dungeon dug into it. A client has only the numbers of the operation types.
+	operations[0].type = SERVICE_PERLIN_OPERATION;
+	operations[0].runs = 0;
+	operations[0].seed = seed;
+
+	operations[1].type = SERVICE_DUNGEON_OPERATION;
+	operations[1].runs = 5;
+	operations[1].seed = seed;
+
+	return;
+}
+
+
+void ServiceBenchmarkClass::PrintLatencies(int rate, const char* name, std::vector<float>& latencies, int failures)
+{
+	int count;
+
+
+	count = (int)latencies.size();
+	if(count == 0)
+	{
+		printf("%6d %-10s %7d %10s %10s %10s %7d\n", rate, name, 0, "-", "-", "-", failures);
+		return;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+
+	printf("%6d %-10s %7d %10.2f %10.2f %10.2f %7d\n", rate, name, count, latencies[count / 2], latencies[std::min((count * 99) / 100, count - 1)],
+		latencies[count - 1], failures);
+
+	return;
+}
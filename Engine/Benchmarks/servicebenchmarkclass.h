@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: servicebenchmarkclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _SERVICEBENCHMARKCLASS_H_
+#define _SERVICEBENCHMARKCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+#include <thread>
+#include <atomic>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "benchmarkclass.h"
+#include "generationserviceclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const char* const SERVICE_BENCHMARK_NAME = "dungeongen-benchmark";
+const int SERVICE_TERRAIN_SIZE = 512;
+const int SERVICE_WORKERS = 2;
+const int SERVICE_CLIENTS = 4;
+const int SERVICE_PHASE_SECONDS = 4;
+const int SERVICE_GENERATE_PERCENT = 10;
+const int SERVICE_SEED_POOL = 8;
+const int SERVICE_TILE_SIZE = 64;
+const int SERVICE_FRAME_BUDGET = 4000;
+const int SERVICE_PERLIN_OPERATION = 2;
+const int SERVICE_DUNGEON_OPERATION = 3;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ServiceBenchmarkClass
+////////////////////////////////////////////////////////////////////////////////
+// Starts a generation service and puts it under load from client threads, each
+// on its own connection, at a fixed total rate of 25, 50, 100 and 200 requests
+// a second. Requests go out on a schedule whether or not the last one has been
+// answered, and latency counts from when a request was due, so a service that
+// falls behind shows it. One request in ten generates a recipe from a small
+// pool of seeds, so some are made, some coalesce and some are already cached.
+// The rest fetch a 64x64 tile of heights. The seeds start from the clock, so a
+// run does not find the last run's terrains in the cache. The frame loop runs on
+// the calling thread as the engine's does.
+class ServiceBenchmarkClass : public BenchmarkClass
+{
+private:
+	struct ClientType
+	{
+		std::thread thread;
+		int index;
+		float rate;
+		std::vector<float> generateLatencies, fetchLatencies;
+		int generateFailures, fetchFailures;
+	};
+
+public:
+	ServiceBenchmarkClass();
+	ServiceBenchmarkClass(const ServiceBenchmarkClass&);
+	~ServiceBenchmarkClass();
+
+	const char* GetName();
+	bool Run();
+
+private:
+	bool RunPhase(GenerationServiceClass& service, int rate);
+	void PumpService(GenerationServiceClass& service);
+	void SetupThread();
+	void ClientThread(ClientType* client);
+	void MakeRecipe(unsigned int seed, generationOperationData* operations);
+	void PrintLatencies(int rate, const char* name, std::vector<float>& latencies, int failures);
+
+private:
+	ClientType m_clients[SERVICE_CLIENTS];
+	std::vector<float> m_latencies;
+	unsigned long long m_tileKey;
+	unsigned int m_seedBase, m_phaseSeed;
+	bool m_setupResult;
+	std::atomic<int> m_runningClients;
+};
+
+#endif
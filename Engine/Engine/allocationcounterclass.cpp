@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: allocationcounterclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "allocationcounterclass.h"
+#include <cstdlib>
+#include <new>
+
+
+#ifdef COUNT_ALLOCATIONS
+
+/////////////
+// GLOBALS //
+/////////////
+static thread_local int g_allocationCount = 0;
+static thread_local long long g_allocationBytes = 0;
+
+
+void* operator new(size_t size)
+{
+	void* memory;
+
+
+	g_allocationCount++;
+	g_allocationBytes += size;
+
+	memory = malloc((size > 0) ? size : 1);
+	if(!memory)
+	{
+		throw std::bad_alloc();
+	}
+
+	return memory;
+}
+
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	g_allocationCount++;
+	g_allocationBytes += size;
+
+	return malloc((size > 0) ? size : 1);
+}
+
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+
+	return;
+}
+
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	free(memory);
+
+	return;
+}
+
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+
+	return;
+}
+
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+
+	return;
+}
+
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	free(memory);
+
+	return;
+}
+
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+
+	return;
+}
+
+
+bool AllocationCounterClass::IsCounting()
+{
+	return true;
+}
+
+
+int AllocationCounterClass::GetCount()
+{
+	return g_allocationCount;
+}
+
+
+long long AllocationCounterClass::GetBytes()
+{
+	return g_allocationBytes;
+}
+
+#else
+
+bool AllocationCounterClass::IsCounting()
+{
+	return false;
+}
+
+
+int AllocationCounterClass::GetCount()
+{
+	return 0;
+}
+
+
+long long AllocationCounterClass::GetBytes()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,27 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: allocationcounterclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _ALLOCATIONCOUNTERCLASS_H_
+#define _ALLOCATIONCOUNTERCLASS_H_
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: AllocationCounterClass
+////////////////////////////////////////////////////////////////////////////////
+// Counts the heap allocations made through operator new, which is replaced in
+// allocationcounterclass.cpp. The counts are kept per thread, so reading them
+// before and after a piece of work gives what that work allocated no matter
+// what the other threads were doing at the time.
+//
+// The replacement is only built when COUNT_ALLOCATIONS is defined, as it is in
+// the Instrumented configuration. Other builds keep the runtime's own new and
+// delete, and the counts stay at zero.
+class AllocationCounterClass
+{
+public:
+	static bool IsCounting();
+	static int GetCount();
+	static long long GetBytes();
+};
+
+#endif
@@ -10,6 +10,9 @@ ApplicationClass::ApplicationClass()
 	m_Direct3D = 0;
 	m_Camera = 0;
 	m_Terrain = 0;
+	m_GenerationService = 0;
+	m_World = 0;
+	m_DungeonStack = 0;
 	m_Timer = 0;
 	m_Position = 0;
 	m_Fps = 0;
@@ -113,6 +116,66 @@ bool ApplicationClass::Initialize(HINSTANCE hinstance, HWND hwnd, int screenWidt
 		return false;
 	}
 
+	// Start the generation service, which makes terrains for other processes on worker terrains of the same size.
+	if(GENERATION_SERVICE)
+	{
+		m_GenerationService = new GenerationServiceClass;
+		if(!m_GenerationService)
+		{
+			return false;
+		}
+
+		// Another copy of the engine may be serving already, this one then runs without.
+		result = m_GenerationService->Initialize("dungeongen", 512, 512, GENERATION_SERVICE_WORKERS);
+		if(!result)
+		{
+			m_GenerationService->Shutdown();
+			delete m_GenerationService;
+			m_GenerationService = 0;
+		}
+	}
+
+	// In the infinite world the terrain above is only there for the editing keys, what is drawn is made a chunk at a time around the camera.
+	if(INFINITE_WORLD)
+	{
+		m_World = new ChunkWorldClass;
+		if(!m_World)
+		{
+			return false;
+		}
+
+		result = m_World->Initialize(m_Direct3D->GetDevice(), WORLD_SEED, WORLD_WORKERS, L"../Engine/data/DungeonTileTexture.bmp", L"../Engine/data/DungeonWallTexture.bmp", L"../Engine/data/DungeonStoneTexture.png");
+		if(!result)
+		{
+			MessageBox(hwnd, L"Could not initialize the world object.", L"Error", MB_OK);
+			return false;
+		}
+	}
+
+	// Create the dungeon stack, the levels the terrain goes down and up through. Making every level holds up the
+	// start, so it is only done when asked for.
+	if(DUNGEON_STACK)
+	{
+		m_DungeonStack = new DungeonStackClass;
+		if(!m_DungeonStack)
+		{
+			return false;
+		}
+
+		// Make every level now, on as many threads as the machine has. Without them the level keys do nothing.
+		result = m_DungeonStack->Initialize(512, 512, DUNGEON_LEVELS, DUNGEON_WORKERS);
+		if(result)
+		{
+			result = m_DungeonStack->Generate((unsigned int)time(NULL));
+		}
+		if(!result)
+		{
+			m_DungeonStack->Shutdown();
+			delete m_DungeonStack;
+			m_DungeonStack = 0;
+		}
+	}
+
 	// Create the timer object.
 	m_Timer = new TimerClass;
 	if(!m_Timer)
@@ -291,6 +354,30 @@ void ApplicationClass::Shutdown()
 		m_Timer = 0;
 	}
 
+	// Release the dungeon stack object.
+	if(m_DungeonStack)
+	{
+		m_DungeonStack->Shutdown();
+		delete m_DungeonStack;
+		m_DungeonStack = 0;
+	}
+
+	// Release the world object.
+	if(m_World)
+	{
+		m_World->Shutdown();
+		delete m_World;
+		m_World = 0;
+	}
+
+	// Release the generation service.
+	if(m_GenerationService)
+	{
+		m_GenerationService->Shutdown();
+		delete m_GenerationService;
+		m_GenerationService = 0;
+	}
+
 	// Release the terrain object.
 	if(m_Terrain)
 	{
@@ -350,7 +437,7 @@ bool ApplicationClass::Frame()
 	m_Cpu->Frame();
 
 	// Update the FPS value in the text object.
-	result = m_Text->SetFps(m_Fps->GetFps(), m_Direct3D->GetDeviceContext());
+	result = m_Text->SetFps(m_Fps->GetFps(), m_Fps->GetWorstFrameTime(), m_Direct3D->GetDeviceContext());
 	if(!result)
 	{
 		return false;
@@ -397,9 +484,15 @@ bool ApplicationClass::HandleInput(float frameTime)
 	keyDown = m_Input->IsKPressed();
 	m_Terrain->SmoothVertex(m_Direct3D->GetDevice(), keyDown);
 
+	keyDown = m_Input->IsRPressed();
+	m_Terrain->SmoothPasses(m_Direct3D->GetDevice(), keyDown);
+
 	keyDown = m_Input->IsQPressed();
 	m_Terrain->spacePartitioning(m_Direct3D->GetDevice(), keyDown, 5);
 
+	keyDown = m_Input->IsCPressed();
+	m_Terrain->cellularCaves(m_Direct3D->GetDevice(), keyDown, CAVE_ITERATIONS);
+
 	keyDown = m_Input->IsLeftPressed();
 	m_Position->TurnLeft(keyDown);
 
@@ -418,6 +511,43 @@ bool ApplicationClass::HandleInput(float frameTime)
 	keyDown = m_Input->IsPPressed();
 	m_Terrain->performPerlin(m_Direct3D->GetDevice(), keyDown);
 
+	keyDown = m_Input->IsEPressed();
+	m_Terrain->erodeTerrain(m_Direct3D->GetDevice(), keyDown, EROSION_ITERATIONS);
+
+	keyDown = m_Input->IsF2Pressed();
+	m_Terrain->undoTerrain(m_Direct3D->GetDevice(), keyDown);
+
+	keyDown = m_Input->IsF3Pressed();
+	m_Terrain->redoTerrain(m_Direct3D->GetDevice(), keyDown);
+
+	keyDown = m_Input->IsLPressed();
+	m_Terrain->levelDown(m_Direct3D->GetDevice(), keyDown, m_DungeonStack);
+
+	keyDown = m_Input->IsUPressed();
+	m_Terrain->levelUp(m_Direct3D->GetDevice(), keyDown, m_DungeonStack);
+
+	keyDown = m_Input->IsF5Pressed();
+	m_Terrain->saveDungeon(keyDown, "../Engine/data/dungeon.sav");
+
+	keyDown = m_Input->IsF6Pressed();
+	m_Terrain->exportMesh(keyDown, "../Engine/data/dungeon.glb", MeshExportClass::FORMAT_GLB);
+
+	keyDown = m_Input->IsF7Pressed();
+	m_Terrain->exportImages(keyDown, "../Engine/data/dungeon", ImageExportClass::FORMAT_PNG);
+
+	keyDown = m_Input->IsF9Pressed();
+	m_Terrain->loadDungeon(m_Direct3D->GetDevice(), keyDown, "../Engine/data/dungeon.sav");
+
+	// Swap in a finished terrain, the old one is drawn until then. On a single core this is also where
+	// generation runs, a slice of at most GENERATION_FRAME_BUDGET microseconds each frame.
+	m_Terrain->UpdateGeneration(GENERATION_FRAME_BUDGET);
+
+	// Hand queued service requests to idle workers and put away the terrains they have finished.
+	if(m_GenerationService)
+	{
+		m_GenerationService->Frame(GENERATION_FRAME_BUDGET);
+	}
+
 	keyDown = m_Input->IsZPressed();
 	m_Position->MoveDownward(keyDown);
 
@@ -431,6 +561,15 @@ bool ApplicationClass::HandleInput(float frameTime)
 	m_Position->GetPosition(posX, posY, posZ);
 	m_Position->GetRotation(rotX, rotY, rotZ);
 
+	// Let the terrain know where the camera is, for anything it streams.
+	m_Terrain->SetViewPosition(posX, posZ);
+
+	// Queue the chunks that have come into view and start drawing the ones the workers have finished.
+	if(m_World)
+	{
+		m_World->Frame(posX, posZ);
+	}
+
 	// Set the position of the camera.
 	m_Camera->SetPosition(posX, posY, posZ);
 	m_Camera->SetRotation(rotX, rotY, rotZ);
@@ -455,7 +594,7 @@ bool ApplicationClass::HandleInput(float frameTime)
 
 bool ApplicationClass::RenderGraphics()
 {
-	D3DXMATRIX worldMatrix, viewMatrix, projectionMatrix, orthoMatrix;
+	D3DXMATRIX worldMatrix, viewMatrix, projectionMatrix, orthoMatrix, chunkMatrix;
 	bool result;
 
 
@@ -471,15 +610,31 @@ bool ApplicationClass::RenderGraphics()
 	m_Direct3D->GetProjectionMatrix(projectionMatrix);
 	m_Direct3D->GetOrthoMatrix(orthoMatrix);
 
-	// Render the terrain buffers.
-	m_Terrain->Render(m_Direct3D->GetDeviceContext());
+	if(m_World)
+	{
+		// Render each chunk that is ready, moved out to its place in the world.
+		for(int i=0; i<m_World->GetChunkCount(); i++)
+		{
+			m_World->Render(m_Direct3D->GetDeviceContext(), i, worldMatrix, chunkMatrix);
 
-	// Render the terrain using the terrain shader.
-	// Render the terrain using the terrain shader.
-	result = m_TerrainShader->Render(m_Direct3D->GetDeviceContext(), m_Terrain->GetIndexCount(), worldMatrix, viewMatrix, projectionMatrix, m_Light->GetAmbientColor(), m_Light->GetDiffuseColor(), m_Light->GetDirection(), m_Terrain->GetGrassTexture(), m_Terrain->GetSlopeTexture(), m_Terrain->GetRockTexture());
-	if (!result)
+			result = m_TerrainShader->Render(m_Direct3D->GetDeviceContext(), m_World->GetIndexCount(), chunkMatrix, viewMatrix, projectionMatrix, m_Light->GetAmbientColor(), m_Light->GetDiffuseColor(), m_Light->GetDirection(), m_World->GetGrassTexture(), m_World->GetSlopeTexture(), m_World->GetRockTexture());
+			if(!result)
+			{
+				return false;
+			}
+		}
+	}
+	else
 	{
-		return false;
+		// Render the terrain buffers.
+		m_Terrain->Render(m_Direct3D->GetDeviceContext());
+
+		// Render the terrain using the terrain shader.
+		result = m_TerrainShader->Render(m_Direct3D->GetDeviceContext(), m_Terrain->GetIndexCount(), worldMatrix, viewMatrix, projectionMatrix, m_Light->GetAmbientColor(), m_Light->GetDiffuseColor(), m_Light->GetDirection(), m_Terrain->GetGrassTexture(), m_Terrain->GetSlopeTexture(), m_Terrain->GetRockTexture());
+		if (!result)
+		{
+			return false;
+		}
 	}
 
 	// Turn off the Z buffer to begin all 2D rendering.
@@ -12,6 +12,14 @@ const bool FULL_SCREEN = false;
 const bool VSYNC_ENABLED = true;
 const float SCREEN_DEPTH = 1000.0f;
 const float SCREEN_NEAR = 0.1f;
+const int GENERATION_FRAME_BUDGET = 4000;
+const bool GENERATION_SERVICE = false;
+const int GENERATION_SERVICE_WORKERS = 2;
+const bool INFINITE_WORLD = false;
+const unsigned int WORLD_SEED = 1;
+const bool DUNGEON_STACK = false;
+const int DUNGEON_LEVELS = 50;
+const int DUNGEON_WORKERS = 0;
 
 
 ///////////////////////
@@ -21,6 +29,9 @@ const float SCREEN_NEAR = 0.1f;
 #include "d3dclass.h"
 #include "cameraclass.h"
 #include "terrainclass.h"
+#include "generationserviceclass.h"
+#include "chunkworldclass.h"
+#include "dungeonstackclass.h"
 #include "timerclass.h"
 #include "positionclass.h"
 #include "fpsclass.h"
@@ -54,6 +65,9 @@ private:
 	D3DClass* m_Direct3D;
 	CameraClass* m_Camera;
 	TerrainClass* m_Terrain;
+	GenerationServiceClass* m_GenerationService;
+	ChunkWorldClass* m_World;
+	DungeonStackClass* m_DungeonStack;
 	TimerClass* m_Timer;
 	PositionClass* m_Position;
 	FpsClass* m_Fps;
@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: arenaclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "arenaclass.h"
+#include <algorithm>
+
+
+ArenaClass::ArenaClass()
+{
+	m_blockSize = 0;
+	m_block = 0;
+	m_offset = 0;
+	m_usedBytes = 0;
+	m_reservedBytes = 0;
+}
+
+
+ArenaClass::ArenaClass(const ArenaClass& other)
+{
+}
+
+
+ArenaClass::~ArenaClass()
+{
+}
+
+
+bool ArenaClass::Initialize(int blockSize)
+{
+	BlockType block;
+
+
+	if(blockSize <= 0)
+	{
+		return false;
+	}
+
+	m_blockSize = blockSize;
+
+	// Start with one block so the first job only grows the arena if it needs more.
+	block.data = new unsigned char[m_blockSize];
+	if(!block.data)
+	{
+		return false;
+	}
+	block.size = m_blockSize;
+
+	m_blocks.push_back(block);
+	m_reservedBytes = m_blockSize;
+
+	Reset();
+
+	return true;
+}
+
+
+void ArenaClass::Shutdown()
+{
+	for(unsigned int i=0; i<m_blocks.size(); i++)
+	{
+		delete [] m_blocks[i].data;
+	}
+	std::vector<BlockType>().swap(m_blocks);
+
+	m_block = 0;
+	m_offset = 0;
+	m_usedBytes = 0;
+	m_reservedBytes = 0;
+
+	return;
+}
+
+
+void ArenaClass::Reset()
+{
+	m_block = 0;
+	m_offset = 0;
+	m_usedBytes = 0;
+
+	return;
+}
+
+
+void* ArenaClass::Allocate(int size)
+{
+	BlockType block;
+	void* memory;
+
+
+	// Round every allocation up so the one after it starts aligned too.
+	size = (std::max(size, 1) + (ARENA_ALIGNMENT - 1)) & ~(ARENA_ALIGNMENT - 1);
+
+	// Move on through the kept blocks until one has room, the space left at the end of the others is lost until the reset.
+	while((m_block < (int)m_blocks.size()) && (m_offset + size > m_blocks[m_block].size))
+	{
+		m_block++;
+		m_offset = 0;
+	}
+
+	// Only a job bigger than any before it gets here.
+	if(m_block == (int)m_blocks.size())
+	{
+		block.size = std::max(m_blockSize, size);
+		block.data = new unsigned char[block.size];
+		if(!block.data)
+		{
+			return 0;
+		}
+
+		m_blocks.push_back(block);
+		m_reservedBytes += block.size;
+	}
+
+	memory = m_blocks[m_block].data + m_offset;
+	m_offset += size;
+	m_usedBytes += size;
+
+	return memory;
+}
+
+
+int ArenaClass::GetUsedBytes()
+{
+	return m_usedBytes;
+}
+
+
+int ArenaClass::GetReservedBytes()
+{
+	return m_reservedBytes;
+}
@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: arenaclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _ARENACLASS_H_
+#define _ARENACLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int ARENA_ALIGNMENT = 16;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ArenaClass
+////////////////////////////////////////////////////////////////////////////////
+// Bump allocator for the scratch arrays a generation job needs while a stage
+// runs. Nothing is freed on its own, one Reset gives everything back at once.
+// The blocks are kept through a reset, so once a job has grown the arena to its
+// size the jobs after it take no memory from the heap.
+class ArenaClass
+{
+private:
+	struct BlockType
+	{
+		unsigned char* data;
+		int size;
+	};
+
+public:
+	ArenaClass();
+	ArenaClass(const ArenaClass&);
+	~ArenaClass();
+
+	bool Initialize(int blockSize);
+	void Shutdown();
+	void Reset();
+
+	void* Allocate(int size);
+
+	// Only for types that need no constructor, the memory is handed out as it is.
+	template <class T> T* AllocateArray(int count)
+	{
+		return (T*)Allocate(count * (int)sizeof(T));
+	}
+
+	int GetUsedBytes();
+	int GetReservedBytes();
+
+private:
+	std::vector<BlockType> m_blocks;
+	int m_blockSize, m_block, m_offset;
+	int m_usedBytes, m_reservedBytes;
+};
+
+#endif
@@ -0,0 +1,520 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: bitgridclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "bitgridclass.h"
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace
+{
+	int LowestBit(unsigned long long word)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+
+		// The 64 bit scan is not available on 32 bit builds, so scan each half.
+		if(_BitScanForward(&index, (unsigned long)word))
+		{
+			return (int)index;
+		}
+		_BitScanForward(&index, (unsigned long)(word >> 32));
+		return (int)index + 32;
+#else
+		return __builtin_ctzll(word);
+#endif
+	}
+
+	int HighestBit(unsigned long long word)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+
+		if(_BitScanReverse(&index, (unsigned long)(word >> 32)))
+		{
+			return (int)index + 32;
+		}
+		_BitScanReverse(&index, (unsigned long)word);
+		return (int)index;
+#else
+		return 63 - __builtin_clzll(word);
+#endif
+	}
+
+	int CountBits(unsigned long long word)
+	{
+		// Sum bits in pairs, then nibbles, then bytes, and add the bytes up with one multiply.
+		word = word - ((word >> 1) & 0x5555555555555555ULL);
+		word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+		word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		return (int)((word * 0x0101010101010101ULL) >> 56);
+	}
+}
+
+
+BitGridClass::BitGridClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_wordsPerRow = 0;
+	m_lastWordMask = 0;
+}
+
+
+BitGridClass::BitGridClass(const BitGridClass& other)
+{
+}
+
+
+BitGridClass::~BitGridClass()
+{
+}
+
+
+bool BitGridClass::Initialize(int width, int height)
+{
+	if((width <= 0) || (height <= 0))
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_wordsPerRow = (width + 63) / 64;
+
+	// Mask of the bits in the last word of a row that are real cells rather than padding.
+	m_lastWordMask = ((width % 64) == 0) ? ~0ULL : ((1ULL << (width % 64)) - 1ULL);
+
+	m_words.assign(m_wordsPerRow * m_height, 0ULL);
+	m_rowScratch.assign(m_wordsPerRow * 3, 0ULL);
+
+	return true;
+}
+
+
+void BitGridClass::Shutdown()
+{
+	std::vector<unsigned long long>().swap(m_words);
+	std::vector<unsigned long long>().swap(m_rowScratch);
+
+	m_width = 0;
+	m_height = 0;
+	m_wordsPerRow = 0;
+
+	return;
+}
+
+
+void BitGridClass::Clear()
+{
+	std::fill(m_words.begin(), m_words.end(), 0ULL);
+
+	return;
+}
+
+
+bool BitGridClass::Get(int x, int y) const
+{
+	return ((m_words[(y * m_wordsPerRow) + (x >> 6)] >> (x & 63)) & 1ULL) != 0;
+}
+
+
+void BitGridClass::Set(int x, int y, bool value)
+{
+	unsigned long long& word = m_words[(y * m_wordsPerRow) + (x >> 6)];
+
+	if(value)
+	{
+		word |= (1ULL << (x & 63));
+	}
+	else
+	{
+		word &= ~(1ULL << (x & 63));
+	}
+
+	return;
+}
+
+
+void BitGridClass::FillRect(int xStart, int yStart, int xEnd, int yEnd, bool value)
+{
+	int firstWord, lastWord;
+	unsigned long long firstMask, lastMask, mask;
+
+
+	// Clip to the grid, the rectangle covers [start, end).
+	xStart = std::max(xStart, 0);
+	yStart = std::max(yStart, 0);
+	xEnd = std::min(xEnd, m_width);
+	yEnd = std::min(yEnd, m_height);
+	if((xStart >= xEnd) || (yStart >= yEnd))
+	{
+		return;
+	}
+
+	firstWord = xStart >> 6;
+	lastWord = (xEnd - 1) >> 6;
+	firstMask = ~0ULL << (xStart & 63);
+	lastMask = ~0ULL >> (63 - ((xEnd - 1) & 63));
+
+	// Whole words in the middle of the span are written in one go.
+	for(int y=yStart; y<yEnd; y++)
+	{
+		unsigned long long* row = &m_words[y * m_wordsPerRow];
+
+		for(int w=firstWord; w<=lastWord; w++)
+		{
+			mask = ~0ULL;
+			if(w == firstWord)
+			{
+				mask &= firstMask;
+			}
+			if(w == lastWord)
+			{
+				mask &= lastMask;
+			}
+
+			if(value)
+			{
+				row[w] |= mask;
+			}
+			else
+			{
+				row[w] &= ~mask;
+			}
+		}
+	}
+
+	return;
+}
+
+
+int BitGridClass::FindNextSet(int x, int y, int xEnd) const
+{
+	const unsigned long long* row;
+	unsigned long long word;
+	int w, lastWord, found;
+
+
+	// Find the first set cell in [x, xEnd) of the row, or -1.
+	xEnd = std::min(xEnd, m_width);
+	if(x >= xEnd)
+	{
+		return -1;
+	}
+
+	row = &m_words[y * m_wordsPerRow];
+	w = x >> 6;
+	lastWord = (xEnd - 1) >> 6;
+	word = row[w] & (~0ULL << (x & 63));
+
+	while(true)
+	{
+		if(word != 0)
+		{
+			found = (w * 64) + LowestBit(word);
+			return (found < xEnd) ? found : -1;
+		}
+
+		w++;
+		if(w > lastWord)
+		{
+			return -1;
+		}
+		word = row[w];
+	}
+}
+
+
+int BitGridClass::FindNextClear(int x, int y, int xEnd) const
+{
+	const unsigned long long* row;
+	unsigned long long word;
+	int w, lastWord, found;
+
+
+	// Find the first clear cell in [x, xEnd) of the row, or xEnd if the span is all set.
+	xEnd = std::min(xEnd, m_width);
+	if(x >= xEnd)
+	{
+		return xEnd;
+	}
+
+	row = &m_words[y * m_wordsPerRow];
+	w = x >> 6;
+	lastWord = (xEnd - 1) >> 6;
+	word = ~row[w] & (~0ULL << (x & 63));
+
+	while(true)
+	{
+		if(word != 0)
+		{
+			found = (w * 64) + LowestBit(word);
+			return (found < xEnd) ? found : xEnd;
+		}
+
+		w++;
+		if(w > lastWord)
+		{
+			return xEnd;
+		}
+		word = ~row[w];
+	}
+}
+
+
+int BitGridClass::FindPreviousSet(int x, int y, int xEnd) const
+{
+	const unsigned long long* row;
+	unsigned long long word;
+	int w, lastWord, found;
+
+
+	// Find the last set cell in (xEnd, x] of the row, or -1.
+	xEnd = std::max(xEnd, -1);
+	if(x <= xEnd)
+	{
+		return -1;
+	}
+
+	row = &m_words[y * m_wordsPerRow];
+	w = x >> 6;
+	lastWord = (xEnd + 1) >> 6;
+	word = row[w] & (~0ULL >> (63 - (x & 63)));
+
+	while(true)
+	{
+		if(word != 0)
+		{
+			found = (w * 64) + HighestBit(word);
+			return (found > xEnd) ? found : -1;
+		}
+
+		w--;
+		if(w < lastWord)
+		{
+			return -1;
+		}
+		word = row[w];
+	}
+}
+
+
+void BitGridClass::CopyFrom(const BitGridClass& other)
+{
+	m_words = other.m_words;
+
+	return;
+}
+
+
+void BitGridClass::Union(const BitGridClass& other)
+{
+	for(unsigned int i=0; i<m_words.size(); i++)
+	{
+		m_words[i] |= other.m_words[i];
+	}
+
+	return;
+}
+
+
+void BitGridClass::Intersect(const BitGridClass& other)
+{
+	for(unsigned int i=0; i<m_words.size(); i++)
+	{
+		m_words[i] &= other.m_words[i];
+	}
+
+	return;
+}
+
+
+void BitGridClass::Subtract(const BitGridClass& other)
+{
+	for(unsigned int i=0; i<m_words.size(); i++)
+	{
+		m_words[i] &= ~other.m_words[i];
+	}
+
+	return;
+}
+
+
+void BitGridClass::Invert()
+{
+	for(unsigned int i=0; i<m_words.size(); i++)
+	{
+		m_words[i] = ~m_words[i];
+	}
+
+	// Padding bits must stay clear or they would count as cells.
+	for(int y=0; y<m_height; y++)
+	{
+		ClearPadding(&m_words[y * m_wordsPerRow]);
+	}
+
+	return;
+}
+
+
+void BitGridClass::Dilate()
+{
+	unsigned long long *above, *current, *below, *row;
+	int w;
+
+
+	// Grow the set by one cell in all eight directions. Each row is first spread sideways into a
+	// scratch row, then every output row is the OR of the spread rows above, on and below it.
+	// Three scratch rows roll down the grid so the output can overwrite the input in place.
+	above = &m_rowScratch[0];
+	current = &m_rowScratch[m_wordsPerRow];
+	below = &m_rowScratch[2 * m_wordsPerRow];
+
+	std::fill(above, above + m_wordsPerRow, 0ULL);
+	SpreadRow(&m_words[0], current, true);
+
+	for(int y=0; y<m_height; y++)
+	{
+		if(y + 1 < m_height)
+		{
+			SpreadRow(&m_words[(y + 1) * m_wordsPerRow], below, true);
+		}
+		else
+		{
+			std::fill(below, below + m_wordsPerRow, 0ULL);
+		}
+
+		row = &m_words[y * m_wordsPerRow];
+		for(w=0; w<m_wordsPerRow; w++)
+		{
+			row[w] = above[w] | current[w] | below[w];
+		}
+		ClearPadding(row);
+
+		std::swap(above, current);
+		std::swap(current, below);
+	}
+
+	return;
+}
+
+
+void BitGridClass::Erode()
+{
+	unsigned long long *above, *current, *below, *row;
+	int w;
+
+
+	// Shrink the set by one cell: a cell survives only if its whole 3x3 neighbourhood is set.
+	// Cells outside the grid count as clear.
+	above = &m_rowScratch[0];
+	current = &m_rowScratch[m_wordsPerRow];
+	below = &m_rowScratch[2 * m_wordsPerRow];
+
+	std::fill(above, above + m_wordsPerRow, 0ULL);
+	SpreadRow(&m_words[0], current, false);
+
+	for(int y=0; y<m_height; y++)
+	{
+		if(y + 1 < m_height)
+		{
+			SpreadRow(&m_words[(y + 1) * m_wordsPerRow], below, false);
+		}
+		else
+		{
+			std::fill(below, below + m_wordsPerRow, 0ULL);
+		}
+
+		row = &m_words[y * m_wordsPerRow];
+		for(w=0; w<m_wordsPerRow; w++)
+		{
+			row[w] = above[w] & current[w] & below[w];
+		}
+
+		std::swap(above, current);
+		std::swap(current, below);
+	}
+
+	return;
+}
+
+
+int BitGridClass::PopCount() const
+{
+	int count;
+
+
+	count = 0;
+	for(unsigned int i=0; i<m_words.size(); i++)
+	{
+		count += CountBits(m_words[i]);
+	}
+
+	return count;
+}
+
+
+int BitGridClass::GetWidth() const
+{
+	return m_width;
+}
+
+
+int BitGridClass::GetHeight() const
+{
+	return m_height;
+}
+
+
+int BitGridClass::GetWordCount() const
+{
+	return (int)m_words.size();
+}
+
+
+unsigned long long* BitGridClass::GetWords()
+{
+	return &m_words[0];
+}
+
+
+const unsigned long long* BitGridClass::GetWords() const
+{
+	return &m_words[0];
+}
+
+
+void BitGridClass::SpreadRow(const unsigned long long* row, unsigned long long* output, bool dilate)
+{
+	unsigned long long left, right;
+
+
+	// Combine every cell with its left and right neighbour, carrying bits across word boundaries.
+	for(int w=0; w<m_wordsPerRow; w++)
+	{
+		left = (row[w] << 1) | ((w > 0) ? (row[w - 1] >> 63) : 0ULL);
+		right = (row[w] >> 1) | ((w + 1 < m_wordsPerRow) ? (row[w + 1] << 63) : 0ULL);
+
+		if(dilate)
+		{
+			output[w] = row[w] | left | right;
+		}
+		else
+		{
+			output[w] = row[w] & left & right;
+		}
+	}
+
+	return;
+}
+
+
+void BitGridClass::ClearPadding(unsigned long long* row)
+{
+	row[m_wordsPerRow - 1] &= m_lastWordMask;
+
+	return;
+}
@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: bitgridclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _BITGRIDCLASS_H_
+#define _BITGRIDCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: BitGridClass
+////////////////////////////////////////////////////////////////////////////////
+// One bit per terrain cell, 64 cells to a word. Rows are padded to a whole number
+// of words and the padding bits are always kept clear, so whole-grid operations
+// can work a word at a time.
+class BitGridClass
+{
+public:
+	BitGridClass();
+	BitGridClass(const BitGridClass&);
+	~BitGridClass();
+
+	bool Initialize(int width, int height);
+	void Shutdown();
+	void Clear();
+
+	bool Get(int x, int y) const;
+	void Set(int x, int y, bool value);
+	void FillRect(int xStart, int yStart, int xEnd, int yEnd, bool value);
+	int FindNextSet(int x, int y, int xEnd) const;
+	int FindNextClear(int x, int y, int xEnd) const;
+	int FindPreviousSet(int x, int y, int xEnd) const;
+
+	void CopyFrom(const BitGridClass& other);
+	void Union(const BitGridClass& other);
+	void Intersect(const BitGridClass& other);
+	void Subtract(const BitGridClass& other);
+	void Invert();
+	void Dilate();
+	void Erode();
+
+	int PopCount() const;
+
+	int GetWidth() const;
+	int GetHeight() const;
+	int GetWordCount() const;
+	unsigned long long* GetWords();
+	const unsigned long long* GetWords() const;
+
+private:
+	void SpreadRow(const unsigned long long* row, unsigned long long* output, bool dilate);
+	void ClearPadding(unsigned long long* row);
+
+private:
+	int m_width, m_height, m_wordsPerRow;
+	unsigned long long m_lastWordMask;
+	std::vector<unsigned long long> m_words;
+	std::vector<unsigned long long> m_rowScratch;
+};
+
+#endif
@@ -0,0 +1,288 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: caveclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "caveclass.h"
+#include "randomhash.h"
+#include <algorithm>
+#include <chrono>
+
+
+namespace
+{
+	void FullAdd(unsigned long long a, unsigned long long b, unsigned long long c, unsigned long long& sum, unsigned long long& carry)
+	{
+		sum = a ^ b ^ c;
+		carry = (a & b) | (c & (a ^ b));
+	}
+}
+
+
+CaveClass::CaveClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_wordsPerRow = 0;
+	m_paddingMask = 0;
+	m_stepParts = 0;
+	m_stepTime = 0.0f;
+	m_threadPool = 0;
+}
+
+
+CaveClass::CaveClass(const CaveClass& other)
+{
+}
+
+
+CaveClass::~CaveClass()
+{
+}
+
+
+bool CaveClass::Initialize(int width, int height, ThreadPoolClass* threadPool)
+{
+	int bandCount, rowsPerBand;
+	bool result;
+
+
+	if((width <= 0) || (height <= 0) || !threadPool)
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_threadPool = threadPool;
+	m_wordsPerRow = (width + 63) / 64;
+
+	// The bits past the right edge are walls, like the rest of the outside.
+	m_paddingMask = ((width % 64) == 0) ? 0ULL : (~0ULL << (width % 64));
+
+	m_walls.assign(m_wordsPerRow * m_height, ~0ULL);
+	m_nextWalls.assign(m_wordsPerRow * m_height, ~0ULL);
+
+	result = m_floor.Initialize(width, height);
+	if(!result)
+	{
+		return false;
+	}
+
+	// One band of rows per thread of the pool, the same split as the connectivity labelling.
+	bandCount = m_threadPool->GetThreadCount();
+	bandCount = std::max(std::min(bandCount, height / 64), 1);
+	rowsPerBand = (height + bandCount - 1) / bandCount;
+
+	m_bands.resize(bandCount);
+	for(int i=0; i<bandCount; i++)
+	{
+		m_bands[i].rowStart = std::min(i * rowsPerBand, height);
+		m_bands[i].rowEnd = std::min((i + 1) * rowsPerBand, height);
+	}
+
+	// Every band steps the same number of parts, the last of a short band does nothing.
+	m_stepParts = (rowsPerBand + CAVE_PART_ROWS - 1) / CAVE_PART_ROWS;
+
+	return true;
+}
+
+
+void CaveClass::Shutdown()
+{
+	// The pool belongs to the caller and is left running.
+	m_threadPool = 0;
+
+	std::vector<unsigned long long>().swap(m_walls);
+	std::vector<unsigned long long>().swap(m_nextWalls);
+	std::vector<BandType>().swap(m_bands);
+	m_floor.Shutdown();
+
+	return;
+}
+
+
+void CaveClass::Seed(float fill, unsigned int seed)
+{
+	unsigned long long state, word, random;
+	int level;
+
+
+	// Each bit has to be a wall with chance fill. Working from the lowest bit of fill in 1/256ths up,
+	// AND with a random word for a 0 and OR for a 1 gives each bit exactly that chance.
+	level = std::min(std::max((int)(fill * 256.0f), 0), 256);
+	state = ((unsigned long long)seed << 1) | 1ULL;
+
+	for(unsigned int i=0; i<m_walls.size(); i++)
+	{
+		if(level == 256)
+		{
+			word = ~0ULL;
+		}
+		else
+		{
+			word = 0ULL;
+			for(int bit=0; bit<8; bit++)
+			{
+				random = NextRandom(state);
+				word = ((level >> bit) & 1) ? (word | random) : (word & random);
+			}
+		}
+
+		m_walls[i] = word;
+	}
+
+	for(int y=0; y<m_height; y++)
+	{
+		m_walls[(y * m_wordsPerRow) + (m_wordsPerRow - 1)] |= m_paddingMask;
+	}
+
+	return;
+}
+
+
+void CaveClass::Step()
+{
+	for(int i=0; i<m_stepParts; i++)
+	{
+		StepPart(i);
+	}
+
+	return;
+}
+
+
+int CaveClass::GetStepParts()
+{
+	return m_stepParts;
+}
+
+
+void CaveClass::StepPart(int part)
+{
+	std::chrono::high_resolution_clock::time_point start;
+
+
+	start = std::chrono::high_resolution_clock::now();
+	if(part == 0)
+	{
+		m_stepTime = 0.0f;
+	}
+
+	// Step the part of every band on its own thread of the pool, the first band runs on this one.
+	m_threadPool->Run((int)m_bands.size(), [this, part](int band) { StepBand(m_bands[band], part); });
+
+	// The next step reads the walls this one wrote once every row is done.
+	if(part == (m_stepParts - 1))
+	{
+		m_walls.swap(m_nextWalls);
+	}
+
+	m_stepTime += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return;
+}
+
+
+void CaveClass::BuildFloor()
+{
+	unsigned long long* floor;
+
+
+	// Floor is everything that is not wall, with the padding bits cleared as the bit grid expects.
+	floor = m_floor.GetWords();
+	for(int y=0; y<m_height; y++)
+	{
+		for(int w=0; w<m_wordsPerRow; w++)
+		{
+			floor[(y * m_wordsPerRow) + w] = ~m_walls[(y * m_wordsPerRow) + w];
+		}
+		floor[(y * m_wordsPerRow) + (m_wordsPerRow - 1)] &= ~m_paddingMask;
+	}
+
+	return;
+}
+
+
+const BitGridClass& CaveClass::GetFloor()
+{
+	return m_floor;
+}
+
+
+float CaveClass::GetStepTime()
+{
+	return m_stepTime;
+}
+
+
+void CaveClass::StepBand(const BandType& band, int part)
+{
+	static const unsigned long long outside = ~0ULL;
+	const unsigned long long *rows[3], *row;
+	unsigned long long neighbours[8], sum1, sum2, sum3, carry1, carry2, carry3, carry4, carry5, twos;
+	unsigned long long bit0, bit1, bit2, bit3, atLeastFive, exactlyFour, current;
+	int n, rowStart, rowEnd;
+
+
+	rowStart = std::min(band.rowStart + (part * CAVE_PART_ROWS), band.rowEnd);
+	rowEnd = std::min(rowStart + CAVE_PART_ROWS, band.rowEnd);
+
+	for(int y=rowStart; y<rowEnd; y++)
+	{
+		rows[0] = (y > 0) ? &m_walls[(y - 1) * m_wordsPerRow] : 0;
+		rows[1] = &m_walls[y * m_wordsPerRow];
+		rows[2] = (y + 1 < m_height) ? &m_walls[(y + 1) * m_wordsPerRow] : 0;
+
+		for(int w=0; w<m_wordsPerRow; w++)
+		{
+			// Line up the eight neighbours of every cell in the word. Bit i is the cell at 64w + i, so
+			// shifting left brings in the west neighbour and right the east one, carrying the edge bit
+			// over from the next word. Rows and words off the map are all wall.
+			n = 0;
+			for(int r=0; r<3; r++)
+			{
+				row = rows[r];
+				if(!row)
+				{
+					neighbours[n++] = outside;
+					neighbours[n++] = outside;
+					if(r != 1)
+					{
+						neighbours[n++] = outside;
+					}
+					continue;
+				}
+
+				neighbours[n++] = (row[w] << 1) | ((w > 0) ? (row[w - 1] >> 63) : 1ULL);
+				neighbours[n++] = (row[w] >> 1) | ((w + 1 < m_wordsPerRow) ? (row[w + 1] << 63) : (1ULL << 63));
+				if(r != 1)
+				{
+					neighbours[n++] = row[w];
+				}
+			}
+
+			// Add the eight one-bit counts in every bit position at once with full adders, down to a
+			// four bit count per cell held as the bit planes bit3..bit0.
+			FullAdd(neighbours[0], neighbours[1], neighbours[2], sum1, carry1);
+			FullAdd(neighbours[3], neighbours[4], neighbours[5], sum2, carry2);
+			sum3 = neighbours[6] ^ neighbours[7];
+			carry3 = neighbours[6] & neighbours[7];
+
+			FullAdd(sum1, sum2, sum3, bit0, carry4);
+			FullAdd(carry1, carry2, carry3, twos, carry5);
+			bit1 = twos ^ carry4;
+			bit2 = carry5 ^ (twos & carry4);
+			bit3 = carry5 & (twos & carry4);
+
+			// Five or more wall neighbours makes a wall, exactly four keeps one.
+			atLeastFive = bit3 | (bit2 & (bit1 | bit0));
+			exactlyFour = ~bit3 & bit2 & ~bit1 & ~bit0;
+
+			current = rows[1][w];
+			m_nextWalls[(y * m_wordsPerRow) + w] = atLeastFive | (current & exactlyFour);
+		}
+
+		m_nextWalls[(y * m_wordsPerRow) + (m_wordsPerRow - 1)] |= m_paddingMask;
+	}
+
+	return;
+}
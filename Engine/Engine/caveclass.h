@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: caveclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _CAVECLASS_H_
+#define _CAVECLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "bitgridclass.h"
+#include "threadpoolclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const float CAVE_FILL = 0.45f;
+const int CAVE_ITERATIONS = 5;
+const int MAX_CAVE_STEPS = 64;
+const int CAVE_PART_ROWS = 64;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: CaveClass
+////////////////////////////////////////////////////////////////////////////////
+// Grows caves with the 4-5 cellular automaton: a wall stays a wall with four or
+// more wall neighbours and floor turns to wall with five or more. Walls are kept
+// one bit per cell, and each step counts the eight neighbours of 64 cells at once
+// with a tree of bitwise adders over shifted copies of the rows around them.
+// Everything outside the map counts as wall. Bands of rows are stepped on the
+// threads of the pool Initialize is given, one band per thread. A step can also
+// be made in parts of CAVE_PART_ROWS rows per band, so a caller on a time budget
+// can stop between them.
+class CaveClass
+{
+private:
+	struct BandType
+	{
+		int rowStart, rowEnd;
+	};
+
+public:
+	CaveClass();
+	CaveClass(const CaveClass&);
+	~CaveClass();
+
+	bool Initialize(int width, int height, ThreadPoolClass* threadPool);
+	void Shutdown();
+
+	void Seed(float fill, unsigned int seed);
+	void Step();
+	int GetStepParts();
+	void StepPart(int part);
+	void BuildFloor();
+	const BitGridClass& GetFloor();
+
+	float GetStepTime();
+
+private:
+	void StepBand(const BandType& band, int part);
+
+private:
+	int m_width, m_height, m_wordsPerRow;
+	unsigned long long m_paddingMask;
+	std::vector<unsigned long long> m_walls, m_nextWalls;
+	BitGridClass m_floor;
+	std::vector<BandType> m_bands;
+	int m_stepParts;
+	float m_stepTime;
+	ThreadPoolClass* m_threadPool;
+};
+
+#endif
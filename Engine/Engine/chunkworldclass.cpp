@@ -0,0 +1,958 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: chunkworldclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "chunkworldclass.h"
+#include "randomhash.h"
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+	// The same world seed, kind and coordinate always hash the same, on any thread and in any order.
+	unsigned long long HashChunk(unsigned int seed, int kind, int x, int z)
+	{
+		unsigned long long hash;
+
+
+		hash = MixBits(((unsigned long long)seed << 8) | (unsigned long long)kind);
+		hash = MixBits(hash ^ (unsigned long long)(unsigned int)x);
+		hash = MixBits(hash ^ ((unsigned long long)(unsigned int)z << 32));
+		return hash;
+	}
+
+	int PositiveModulo(int value, int divisor)
+	{
+		return ((value % divisor) + divisor) % divisor;
+	}
+}
+
+
+ChunkWorldClass::ChunkWorldClass()
+{
+	m_device = 0;
+	m_indexBuffer = 0;
+	m_GrassTexture = 0;
+	m_SlopeTexture = 0;
+	m_RockTexture = 0;
+	m_seed = 0;
+	m_indexCount = 0;
+	m_centerX = 0;
+	m_centerZ = 0;
+	m_centered = false;
+	m_chunksChanged = false;
+	m_quit = false;
+	m_builtCount = 0;
+}
+
+
+ChunkWorldClass::ChunkWorldClass(const ChunkWorldClass& other)
+{
+}
+
+
+ChunkWorldClass::~ChunkWorldClass()
+{
+}
+
+
+bool ChunkWorldClass::Initialize(ID3D11Device* device, unsigned int seed, int workerCount, WCHAR* grassTextureFilename, WCHAR* slopeTextureFilename, WCHAR* rockTextureFilename)
+{
+	int span, size;
+	bool result;
+
+
+	m_device = device;
+	m_seed = seed;
+
+	result = InitializeNoise(seed);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = InitializeIndexBuffer(device);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = LoadTextures(device, grassTextureFilename, slopeTextureFilename, rockTextureFilename);
+	if(!result)
+	{
+		return false;
+	}
+
+	// A slot for every chunk in view and the ring kept around it, never more.
+	span = (2 * (WORLD_VIEW_RADIUS + 1)) + 1;
+
+	m_chunks.resize(span * span);
+	for(unsigned int i=0; i<m_chunks.size(); i++)
+	{
+		m_chunks[i].x = 0;
+		m_chunks[i].z = 0;
+		m_chunks[i].state = CHUNK_FREE;
+		m_chunks[i].stamp = 0;
+		m_chunks[i].vertexBuffer = 0;
+	}
+
+	m_resident.resize(span * span);
+	m_queue.reserve(span * span);
+	m_drawList.reserve(span * span);
+
+	// Each worker has the arrays for one chunk of its own, made once.
+	size = WORLD_CHUNK_SIZE + 3;
+
+	m_workers.resize(std::max(workerCount, 1));
+	for(unsigned int i=0; i<m_workers.size(); i++)
+	{
+		m_workers[i].heights.resize(size * size);
+		m_workers[i].faceNormals.resize((size - 1) * (size - 1) * 3);
+		m_workers[i].normals.resize((WORLD_CHUNK_SIZE + 1) * (WORLD_CHUNK_SIZE + 1) * 3);
+		m_workers[i].vertices.resize(m_indexCount);
+		m_workers[i].rooms.reserve(WORLD_ROOM_ATTEMPTS);
+	}
+
+	for(unsigned int i=0; i<m_workers.size(); i++)
+	{
+		m_workers[i].thread = std::thread(&ChunkWorldClass::WorkerThread, this, &m_workers[i]);
+	}
+
+	return true;
+}
+
+
+void ChunkWorldClass::Shutdown()
+{
+	// Wake the workers to quit, a chunk being built is finished first.
+	m_chunkMutex.lock();
+	m_quit = true;
+	m_chunkMutex.unlock();
+	m_chunkCondition.notify_all();
+
+	for(unsigned int i=0; i<m_workers.size(); i++)
+	{
+		if(m_workers[i].thread.joinable())
+		{
+			m_workers[i].thread.join();
+		}
+	}
+	std::vector<WorkerType>().swap(m_workers);
+
+	// Release the chunk vertex buffers.
+	for(unsigned int i=0; i<m_chunks.size(); i++)
+	{
+		if(m_chunks[i].vertexBuffer)
+		{
+			m_chunks[i].vertexBuffer->Release();
+			m_chunks[i].vertexBuffer = 0;
+		}
+	}
+	std::vector<ChunkType>().swap(m_chunks);
+	std::vector<int>().swap(m_resident);
+	std::vector<int>().swap(m_queue);
+	std::vector<int>().swap(m_drawList);
+
+	// Release the index buffer.
+	if(m_indexBuffer)
+	{
+		m_indexBuffer->Release();
+		m_indexBuffer = 0;
+	}
+
+	ReleaseTextures();
+
+	return;
+}
+
+
+void ChunkWorldClass::Frame(float positionX, float positionZ)
+{
+	int centerX, centerZ;
+	bool moved;
+
+
+	// Find the chunk the viewer is in.
+	centerX = (int)floorf(positionX / (float)WORLD_CHUNK_SIZE);
+	centerZ = (int)floorf(positionZ / (float)WORLD_CHUNK_SIZE);
+
+	m_chunkMutex.lock();
+
+	moved = !m_centered || (centerX != m_centerX) || (centerZ != m_centerZ);
+	if(moved)
+	{
+		Recenter(centerX, centerZ);
+	}
+
+	// The chunks to draw are only looked through again when one has come or gone.
+	if(m_chunksChanged)
+	{
+		m_drawList.clear();
+		for(unsigned int i=0; i<m_chunks.size(); i++)
+		{
+			if(m_chunks[i].state == CHUNK_READY)
+			{
+				m_drawList.push_back(i);
+			}
+		}
+
+		m_chunksChanged = false;
+	}
+
+	m_chunkMutex.unlock();
+
+	if(moved)
+	{
+		m_chunkCondition.notify_all();
+	}
+
+	return;
+}
+
+
+void ChunkWorldClass::Render(ID3D11DeviceContext* deviceContext, int chunk, const D3DXMATRIX& worldMatrix, D3DXMATRIX& chunkMatrix)
+{
+	D3DXMATRIX translation;
+	ChunkType* slot;
+	unsigned int stride;
+	unsigned int offset;
+
+
+	// The vertices are in chunk cells, the world matrix moves them out to where the chunk is. Only Frame
+	// lets go of a ready chunk, so it is safe to use here without the lock.
+	slot = &m_chunks[m_drawList[chunk]];
+
+	D3DXMatrixTranslation(&translation, (float)(slot->x * WORLD_CHUNK_SIZE), 0.0f, (float)(slot->z * WORLD_CHUNK_SIZE));
+	D3DXMatrixMultiply(&chunkMatrix, &worldMatrix, &translation);
+
+	// Set vertex buffer stride and offset.
+	stride = sizeof(VertexType);
+	offset = 0;
+
+	// Set the vertex buffer to active in the input assembler so it can be rendered.
+	deviceContext->IASetVertexBuffers(0, 1, &slot->vertexBuffer, &stride, &offset);
+
+	// Set the index buffer to active in the input assembler so it can be rendered.
+	deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
+	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	return;
+}
+
+
+int ChunkWorldClass::GetChunkCount()
+{
+	return (int)m_drawList.size();
+}
+
+
+int ChunkWorldClass::GetIndexCount()
+{
+	return m_indexCount;
+}
+
+
+int ChunkWorldClass::GetBuiltCount()
+{
+	std::lock_guard<std::mutex> lock(m_chunkMutex);
+
+	return m_builtCount;
+}
+
+
+ID3D11ShaderResourceView* ChunkWorldClass::GetGrassTexture()
+{
+	return m_GrassTexture->GetTexture();
+}
+
+
+ID3D11ShaderResourceView* ChunkWorldClass::GetSlopeTexture()
+{
+	return m_SlopeTexture->GetTexture();
+}
+
+
+ID3D11ShaderResourceView* ChunkWorldClass::GetRockTexture()
+{
+	return m_RockTexture->GetTexture();
+}
+
+
+bool ChunkWorldClass::InitializeNoise(unsigned int seed)
+{
+	bool result;
+
+
+	// The same noise as the terrain's, seeded by the world.
+	result = m_perlinNoise.Initialize(seed);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_simplexNoise.Initialize(seed + 1);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_ridgedNoise.Initialize(&m_perlinNoise);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_ridgedFractal.Initialize(&m_ridgedNoise, NOISE_OCTAVES, NOISE_FREQUENCY, 2.0f, 0.5f);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_warpFractal.Initialize(&m_simplexNoise, 2, NOISE_FREQUENCY * 0.5f, 2.0f, 0.5f);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_warpedNoise.Initialize(&m_ridgedFractal, &m_warpFractal, NOISE_WARP);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_terrainNoise.Initialize(&m_warpedNoise, 1.0f, NOISE_AMPLITUDE, 0.0f);
+	if(!result)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+bool ChunkWorldClass::InitializeIndexBuffer(ID3D11Device* device)
+{
+	unsigned long* indices;
+	D3D11_BUFFER_DESC indexBufferDesc;
+	D3D11_SUBRESOURCE_DATA indexData;
+	HRESULT result;
+
+
+	// Every chunk is the same two triangles a cell, six vertices each, so they all share one index buffer.
+	m_indexCount = WORLD_CHUNK_SIZE * WORLD_CHUNK_SIZE * 6;
+
+	// Create the index array.
+	indices = new unsigned long[m_indexCount];
+	if(!indices)
+	{
+		return false;
+	}
+
+	for(int i=0; i<m_indexCount; i++)
+	{
+		indices[i] = i;
+	}
+
+	// Set up the description of the static index buffer.
+	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	indexBufferDesc.ByteWidth = sizeof(unsigned long) * m_indexCount;
+	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDesc.CPUAccessFlags = 0;
+	indexBufferDesc.MiscFlags = 0;
+	indexBufferDesc.StructureByteStride = 0;
+
+	// Give the subresource structure a pointer to the index data.
+	indexData.pSysMem = indices;
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
+
+	// Create the index buffer.
+	result = device->CreateBuffer(&indexBufferDesc, &indexData, &m_indexBuffer);
+
+	// Release the array now that the buffer has been created and loaded.
+	delete [] indices;
+	indices = 0;
+
+	if(FAILED(result))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+bool ChunkWorldClass::LoadTextures(ID3D11Device* device, WCHAR* grassTextureFilename, WCHAR* slopeTextureFilename, WCHAR* rockTextureFilename)
+{
+	bool result;
+
+
+	// Create the grass texture object.
+	m_GrassTexture = new TextureClass;
+	if(!m_GrassTexture)
+	{
+		return false;
+	}
+
+	// Initialize the grass texture object.
+	result = m_GrassTexture->Initialize(device, grassTextureFilename);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the slope texture object.
+	m_SlopeTexture = new TextureClass;
+	if(!m_SlopeTexture)
+	{
+		return false;
+	}
+
+	// Initialize the slope texture object.
+	result = m_SlopeTexture->Initialize(device, slopeTextureFilename);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the rock texture object.
+	m_RockTexture = new TextureClass;
+	if(!m_RockTexture)
+	{
+		return false;
+	}
+
+	// Initialize the rock texture object.
+	result = m_RockTexture->Initialize(device, rockTextureFilename);
+	if(!result)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+void ChunkWorldClass::ReleaseTextures()
+{
+	// Release the texture objects.
+	if(m_GrassTexture)
+	{
+		m_GrassTexture->Shutdown();
+		delete m_GrassTexture;
+		m_GrassTexture = 0;
+	}
+
+	if(m_SlopeTexture)
+	{
+		m_SlopeTexture->Shutdown();
+		delete m_SlopeTexture;
+		m_SlopeTexture = 0;
+	}
+
+	if(m_RockTexture)
+	{
+		m_RockTexture->Shutdown();
+		delete m_RockTexture;
+		m_RockTexture = 0;
+	}
+
+	return;
+}
+
+
+void ChunkWorldClass::Recenter(int centerX, int centerZ)
+{
+	int keep, span, aheadX, aheadZ, x, z, slot;
+	ChunkType* chunk;
+
+
+	keep = WORLD_VIEW_RADIUS + 1;
+	span = (2 * keep) + 1;
+
+	// Lean the order chunks are made in towards the way the viewer went.
+	aheadX = centerX;
+	aheadZ = centerZ;
+	if(m_centered)
+	{
+		aheadX += std::max(-1, std::min(1, centerX - m_centerX));
+		aheadZ += std::max(-1, std::min(1, centerZ - m_centerZ));
+	}
+
+	// Let go of every chunk past the ring kept around the view and note where the rest are.
+	std::fill(m_resident.begin(), m_resident.end(), -1);
+
+	for(unsigned int i=0; i<m_chunks.size(); i++)
+	{
+		chunk = &m_chunks[i];
+		if(chunk->state == CHUNK_FREE)
+		{
+			continue;
+		}
+
+		x = (chunk->x - centerX) + keep;
+		z = (chunk->z - centerZ) + keep;
+
+		if((x < 0) || (x >= span) || (z < 0) || (z >= span))
+		{
+			// One still being built is thrown away by its worker when it sees the stamp has moved on.
+			if(chunk->vertexBuffer)
+			{
+				chunk->vertexBuffer->Release();
+				chunk->vertexBuffer = 0;
+			}
+
+			chunk->state = CHUNK_FREE;
+			chunk->stamp++;
+			m_chunksChanged = true;
+		}
+		else
+		{
+			m_resident[(z * span) + x] = i;
+		}
+	}
+
+	// Give every chunk in view that is missing a free slot. Everything left is inside the kept ring, so
+	// there is always one.
+	slot = 0;
+	for(z=-WORLD_VIEW_RADIUS; z<=WORLD_VIEW_RADIUS; z++)
+	{
+		for(x=-WORLD_VIEW_RADIUS; x<=WORLD_VIEW_RADIUS; x++)
+		{
+			if(m_resident[((z + keep) * span) + (x + keep)] != -1)
+			{
+				continue;
+			}
+
+			while(m_chunks[slot].state != CHUNK_FREE)
+			{
+				slot++;
+			}
+
+			m_chunks[slot].x = centerX + x;
+			m_chunks[slot].z = centerZ + z;
+			m_chunks[slot].state = CHUNK_QUEUED;
+			m_resident[((z + keep) * span) + (x + keep)] = slot;
+		}
+	}
+
+	// Queue the chunks not started yet with the nearest at the back, where the workers take from.
+	m_queue.clear();
+	for(unsigned int i=0; i<m_chunks.size(); i++)
+	{
+		if(m_chunks[i].state == CHUNK_QUEUED)
+		{
+			m_queue.push_back(i);
+		}
+	}
+
+	std::sort(m_queue.begin(), m_queue.end(), [&](int first, int second)
+	{
+		int firstX, firstZ, secondX, secondZ;
+
+
+		firstX = m_chunks[first].x - aheadX;
+		firstZ = m_chunks[first].z - aheadZ;
+		secondX = m_chunks[second].x - aheadX;
+		secondZ = m_chunks[second].z - aheadZ;
+		return ((firstX * firstX) + (firstZ * firstZ)) > ((secondX * secondX) + (secondZ * secondZ));
+	});
+
+	m_centerX = centerX;
+	m_centerZ = centerZ;
+	m_centered = true;
+
+	return;
+}
+
+
+void ChunkWorldClass::WorkerThread(WorkerType* worker)
+{
+	std::unique_lock<std::mutex> lock(m_chunkMutex);
+	ID3D11Buffer* vertexBuffer;
+	int slot, chunkX, chunkZ;
+	unsigned int stamp;
+	bool result;
+
+
+	while(true)
+	{
+		// Sleep until there is a chunk to build.
+		m_chunkCondition.wait(lock, [this]() { return m_quit || !m_queue.empty(); });
+		if(m_quit)
+		{
+			break;
+		}
+
+		// Take the nearest one and build it with the lock let go.
+		slot = m_queue.back();
+		m_queue.pop_back();
+
+		m_chunks[slot].state = CHUNK_BUILDING;
+		chunkX = m_chunks[slot].x;
+		chunkZ = m_chunks[slot].z;
+		stamp = m_chunks[slot].stamp;
+
+		lock.unlock();
+
+		vertexBuffer = 0;
+		result = BuildChunk(worker, chunkX, chunkZ, &vertexBuffer);
+
+		lock.lock();
+
+		// Keep it unless the viewer moved far enough away for the slot to be let go of meanwhile.
+		if(result && (m_chunks[slot].stamp == stamp))
+		{
+			m_chunks[slot].vertexBuffer = vertexBuffer;
+			m_chunks[slot].state = CHUNK_READY;
+			m_chunksChanged = true;
+			m_builtCount++;
+		}
+		else
+		{
+			if(vertexBuffer)
+			{
+				vertexBuffer->Release();
+			}
+
+			// One that failed is let go of and queued again the next time the viewer changes chunk.
+			if(m_chunks[slot].stamp == stamp)
+			{
+				m_chunks[slot].state = CHUNK_FREE;
+				m_chunks[slot].stamp++;
+			}
+		}
+	}
+
+	return;
+}
+
+
+bool ChunkWorldClass::BuildChunk(WorkerType* worker, int chunkX, int chunkZ, ID3D11Buffer** vertexBuffer)
+{
+	D3D11_BUFFER_DESC vertexBufferDesc;
+	D3D11_SUBRESOURCE_DATA vertexData;
+	HRESULT result;
+	int size;
+
+
+	// The heights are the noise at world positions, from a cell before the chunk to a cell past it.
+	size = WORLD_CHUNK_SIZE + 3;
+
+	for(int j=0; j<size; j++)
+	{
+		m_terrainNoise.SampleRow((float)((chunkX * WORLD_CHUNK_SIZE) - 1), (float)((chunkZ * WORLD_CHUNK_SIZE) - 1 + j), 1.0f, size, &worker->heights[j * size]);
+	}
+
+	// Carve the rooms, then a corridor from the door on every edge to the nearest of them.
+	PlaceRooms(worker, chunkX, chunkZ);
+
+	for(int i=EDGE_WEST; i<=EDGE_NORTH; i++)
+	{
+		CarveDoor(worker, i, chunkX, chunkZ);
+	}
+
+	CalculateNormals(worker);
+	BuildVertices(worker, chunkX, chunkZ);
+
+	// The device is free threaded, so the buffer is made here and Frame only has to start drawing it.
+	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	vertexBufferDesc.ByteWidth = sizeof(VertexType) * m_indexCount;
+	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDesc.CPUAccessFlags = 0;
+	vertexBufferDesc.MiscFlags = 0;
+	vertexBufferDesc.StructureByteStride = 0;
+
+	vertexData.pSysMem = &worker->vertices[0];
+	vertexData.SysMemPitch = 0;
+	vertexData.SysMemSlicePitch = 0;
+
+	result = m_device->CreateBuffer(&vertexBufferDesc, &vertexData, vertexBuffer);
+	if(FAILED(result))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+void ChunkWorldClass::PlaceRooms(WorkerType* worker, int chunkX, int chunkZ)
+{
+	unsigned long long state;
+	RectType room;
+	int width, height, centerX, centerZ, lastX, lastZ;
+	bool overlaps;
+
+
+	// Each chunk has a random sequence of its own, so it comes out the same whatever order chunks are built in.
+	state = HashChunk(m_seed, 2, chunkX, chunkZ) | 1ULL;
+
+	worker->rooms.clear();
+	for(int i=0; i<WORLD_ROOM_ATTEMPTS; i++)
+	{
+		width = WORLD_ROOM_MIN_SIZE + (int)(NextRandom(state) % (WORLD_ROOM_MAX_SIZE - WORLD_ROOM_MIN_SIZE + 1));
+		height = WORLD_ROOM_MIN_SIZE + (int)(NextRandom(state) % (WORLD_ROOM_MAX_SIZE - WORLD_ROOM_MIN_SIZE + 1));
+
+		room.left = WORLD_ROOM_MARGIN + (int)(NextRandom(state) % (WORLD_CHUNK_SIZE - (2 * WORLD_ROOM_MARGIN) - width + 1));
+		room.bottom = WORLD_ROOM_MARGIN + (int)(NextRandom(state) % (WORLD_CHUNK_SIZE - (2 * WORLD_ROOM_MARGIN) - height + 1));
+		room.right = room.left + width;
+		room.top = room.bottom + height;
+
+		// Keep a wall between rooms. The first always fits, so there is at least one.
+		overlaps = false;
+		for(unsigned int j=0; j<worker->rooms.size(); j++)
+		{
+			if((room.left < (worker->rooms[j].right + 2)) && (worker->rooms[j].left < (room.right + 2)) &&
+			   (room.bottom < (worker->rooms[j].top + 2)) && (worker->rooms[j].bottom < (room.top + 2)))
+			{
+				overlaps = true;
+				break;
+			}
+		}
+
+		if(!overlaps)
+		{
+			worker->rooms.push_back(room);
+		}
+	}
+
+	// Carve them and join each to the one before.
+	lastX = 0;
+	lastZ = 0;
+	for(unsigned int i=0; i<worker->rooms.size(); i++)
+	{
+		CarveRect(worker, worker->rooms[i].left, worker->rooms[i].bottom, worker->rooms[i].right, worker->rooms[i].top);
+
+		centerX = worker->rooms[i].left + ((worker->rooms[i].right - worker->rooms[i].left - WORLD_CORRIDOR_WIDTH) / 2);
+		centerZ = worker->rooms[i].bottom + ((worker->rooms[i].top - worker->rooms[i].bottom - WORLD_CORRIDOR_WIDTH) / 2);
+
+		if(i > 0)
+		{
+			CarveCorridor(worker, lastX, lastZ, centerX, centerZ);
+		}
+
+		lastX = centerX;
+		lastZ = centerZ;
+	}
+
+	return;
+}
+
+
+void ChunkWorldClass::CarveDoor(WorkerType* worker, int edge, int chunkX, int chunkZ)
+{
+	int kind, edgeX, edgeZ, offset, startX, startZ, centerX, centerZ, distance, nearest, roomX, roomZ;
+
+
+	// An edge is hashed by the line it is on and which chunk along it, the same from the chunks on either side.
+	kind = ((edge == EDGE_WEST) || (edge == EDGE_EAST)) ? 0 : 1;
+	edgeX = chunkX + ((edge == EDGE_EAST) ? 1 : 0);
+	edgeZ = chunkZ + ((edge == EDGE_NORTH) ? 1 : 0);
+
+	offset = WORLD_ROOM_MARGIN + (int)(HashChunk(m_seed, kind, edgeX, edgeZ) % (WORLD_CHUNK_SIZE - (2 * WORLD_ROOM_MARGIN) - WORLD_CORRIDOR_WIDTH + 1));
+
+	// Carve straight in from a cell past the edge to the margin. The neighbour carves the same cells from its
+	// side, and nothing else comes within the margin, so the heights on and around the edge agree.
+	switch(edge)
+	{
+		case EDGE_WEST:
+			startX = WORLD_ROOM_MARGIN;
+			startZ = offset;
+			CarveRect(worker, -1, offset, WORLD_ROOM_MARGIN + WORLD_CORRIDOR_WIDTH, offset + WORLD_CORRIDOR_WIDTH);
+			break;
+
+		case EDGE_EAST:
+			startX = WORLD_CHUNK_SIZE - WORLD_ROOM_MARGIN - WORLD_CORRIDOR_WIDTH;
+			startZ = offset;
+			CarveRect(worker, startX, offset, WORLD_CHUNK_SIZE + 2, offset + WORLD_CORRIDOR_WIDTH);
+			break;
+
+		case EDGE_SOUTH:
+			startX = offset;
+			startZ = WORLD_ROOM_MARGIN;
+			CarveRect(worker, offset, -1, offset + WORLD_CORRIDOR_WIDTH, WORLD_ROOM_MARGIN + WORLD_CORRIDOR_WIDTH);
+			break;
+
+		default:
+			startX = offset;
+			startZ = WORLD_CHUNK_SIZE - WORLD_ROOM_MARGIN - WORLD_CORRIDOR_WIDTH;
+			CarveRect(worker, offset, startZ, offset + WORLD_CORRIDOR_WIDTH, WORLD_CHUNK_SIZE + 2);
+			break;
+	}
+
+	// Then on to the nearest room.
+	nearest = -1;
+	roomX = startX;
+	roomZ = startZ;
+	for(unsigned int i=0; i<worker->rooms.size(); i++)
+	{
+		centerX = worker->rooms[i].left + ((worker->rooms[i].right - worker->rooms[i].left - WORLD_CORRIDOR_WIDTH) / 2);
+		centerZ = worker->rooms[i].bottom + ((worker->rooms[i].top - worker->rooms[i].bottom - WORLD_CORRIDOR_WIDTH) / 2);
+
+		distance = ((centerX - startX) * (centerX - startX)) + ((centerZ - startZ) * (centerZ - startZ));
+		if((nearest == -1) || (distance < nearest))
+		{
+			nearest = distance;
+			roomX = centerX;
+			roomZ = centerZ;
+		}
+	}
+
+	CarveCorridor(worker, startX, startZ, roomX, roomZ);
+
+	return;
+}
+
+
+void ChunkWorldClass::CarveCorridor(WorkerType* worker, int startX, int startZ, int endX, int endZ)
+{
+	// Across first, then along.
+	CarveRect(worker, std::min(startX, endX), startZ, std::max(startX, endX) + WORLD_CORRIDOR_WIDTH, startZ + WORLD_CORRIDOR_WIDTH);
+	CarveRect(worker, endX, std::min(startZ, endZ), endX + WORLD_CORRIDOR_WIDTH, std::max(startZ, endZ) + WORLD_CORRIDOR_WIDTH);
+
+	return;
+}
+
+
+void ChunkWorldClass::CarveRect(WorkerType* worker, int left, int bottom, int right, int top)
+{
+	int size;
+
+
+	// Cells are in chunk coordinates, the height array starts a cell before them.
+	size = WORLD_CHUNK_SIZE + 3;
+
+	left = std::max(left, -1);
+	bottom = std::max(bottom, -1);
+	right = std::min(right, WORLD_CHUNK_SIZE + 2);
+	top = std::min(top, WORLD_CHUNK_SIZE + 2);
+
+	for(int z=bottom; z<top; z++)
+	{
+		for(int x=left; x<right; x++)
+		{
+			worker->heights[((z + 1) * size) + (x + 1)] = -(float)ROOM_DEPTH;
+		}
+	}
+
+	return;
+}
+
+
+void ChunkWorldClass::CalculateNormals(WorkerType* worker)
+{
+	const float *row, *next, *face;
+	float edge1, edge2, sum[3], length;
+	int size, index;
+
+
+	size = WORLD_CHUNK_SIZE + 3;
+
+	// Face normals for every quad of the height array, the cell past the edges included, worked out from the
+	// height differences the same way the terrain does.
+	for(int j=0; j<(size - 1); j++)
+	{
+		row = &worker->heights[j * size];
+		next = row + size;
+
+		for(int i=0; i<(size - 1); i++)
+		{
+			edge1 = row[i] - next[i];
+			edge2 = next[i] - row[i + 1];
+
+			index = ((j * (size - 1)) + i) * 3;
+
+			worker->faceNormals[index] = edge1 + edge2;
+			worker->faceNormals[index + 1] = 1.0f;
+			worker->faceNormals[index + 2] = edge1;
+		}
+	}
+
+	// Every vertex of the chunk has all four of its faces, so the average is the one its neighbour works out.
+	for(int j=0; j<=WORLD_CHUNK_SIZE; j++)
+	{
+		for(int i=0; i<=WORLD_CHUNK_SIZE; i++)
+		{
+			sum[0] = 0.0f;
+			sum[1] = 0.0f;
+			sum[2] = 0.0f;
+
+			for(int k=0; k<4; k++)
+			{
+				face = &worker->faceNormals[(((j + (k / 2)) * (size - 1)) + (i + (k % 2))) * 3];
+
+				sum[0] += face[0];
+				sum[1] += face[1];
+				sum[2] += face[2];
+			}
+
+			sum[0] = sum[0] / 4.0f;
+			sum[1] = sum[1] / 4.0f;
+			sum[2] = sum[2] / 4.0f;
+
+			length = sqrtf((sum[0] * sum[0]) + (sum[1] * sum[1]) + (sum[2] * sum[2]));
+
+			index = ((j * (WORLD_CHUNK_SIZE + 1)) + i) * 3;
+
+			worker->normals[index] = sum[0] / length;
+			worker->normals[index + 1] = sum[1] / length;
+			worker->normals[index + 2] = sum[2] / length;
+		}
+	}
+
+	return;
+}
+
+
+void ChunkWorldClass::BuildVertices(WorkerType* worker, int chunkX, int chunkZ)
+{
+	VertexType* vertices;
+
+
+	// Each quad is two triangles, six vertices, laid out row after row as on the terrain.
+	vertices = &worker->vertices[0];
+
+	for(int j=0; j<WORLD_CHUNK_SIZE; j++)
+	{
+		for(int i=0; i<WORLD_CHUNK_SIZE; i++)
+		{
+			GetVertex(worker, chunkX, chunkZ, i, j + 1, false, true, vertices[0]);          // Upper left.
+			GetVertex(worker, chunkX, chunkZ, i + 1, j + 1, true, true, vertices[1]);       // Upper right.
+			GetVertex(worker, chunkX, chunkZ, i, j, false, false, vertices[2]);             // Bottom left.
+			vertices[3] = vertices[2];                                                      // Bottom left.
+			vertices[4] = vertices[1];                                                      // Upper right.
+			GetVertex(worker, chunkX, chunkZ, i + 1, j, true, false, vertices[5]);          // Bottom right.
+			vertices += 6;
+		}
+	}
+
+	return;
+}
+
+
+void ChunkWorldClass::GetVertex(WorkerType* worker, int chunkX, int chunkZ, int i, int j, bool right, bool top, VertexType& vertex)
+{
+	const float* normal;
+	float tu, tv;
+
+
+	vertex.position = D3DXVECTOR3((float)i, worker->heights[((j + 1) * (WORLD_CHUNK_SIZE + 3)) + (i + 1)], (float)j);
+
+	// The textures repeat every WORLD_TEXTURE_CELLS world cells, so they line up across the chunks.
+	tu = (float)PositiveModulo((chunkX * WORLD_CHUNK_SIZE) + i, WORLD_TEXTURE_CELLS) / (float)WORLD_TEXTURE_CELLS;
+	tv = 1.0f - ((float)PositiveModulo((chunkZ * WORLD_CHUNK_SIZE) + j, WORLD_TEXTURE_CELLS) / (float)WORLD_TEXTURE_CELLS);
+
+	// Modify the texture coordinates to cover the top and right edge.
+	if(right && (tu == 0.0f)) { tu = 1.0f; }
+	if(top && (tv == 1.0f)) { tv = 0.0f; }
+
+	vertex.texture = D3DXVECTOR2(tu, tv);
+
+	normal = &worker->normals[((j * (WORLD_CHUNK_SIZE + 1)) + i) * 3];
+	vertex.normal = D3DXVECTOR3(normal[0], normal[1], normal[2]);
+
+	return;
+}
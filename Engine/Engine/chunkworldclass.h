@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: chunkworldclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _CHUNKWORLDCLASS_H_
+#define _CHUNKWORLDCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <d3d11.h>
+#include <d3dx10math.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "textureclass.h"
+#include "noisecombinerclass.h"
+#include "terrainclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int WORLD_CHUNK_SIZE = 64;
+const int WORLD_VIEW_RADIUS = 3;
+const int WORLD_WORKERS = 2;
+const int WORLD_ROOM_ATTEMPTS = 6;
+const int WORLD_ROOM_MIN_SIZE = 6;
+const int WORLD_ROOM_MAX_SIZE = 16;
+const int WORLD_ROOM_MARGIN = 6;
+const int WORLD_CORRIDOR_WIDTH = 3;
+const int WORLD_TEXTURE_CELLS = 32;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ChunkWorldClass
+////////////////////////////////////////////////////////////////////////////////
+// A dungeon without edges, made a square chunk at a time around the viewer.
+// Everything in a chunk comes from the world seed and the chunk's coordinate,
+// so walking away and back makes it again exactly as it was. The heights are
+// the terrain's noise sampled at world positions and run straight on across
+// the borders. Rooms stay WORLD_ROOM_MARGIN cells inside their chunk, and each
+// edge has one door at a place hashed from the edge itself, so the chunks on
+// either side carve the same corridor through it without knowing of each other.
+// Each chunk is made a cell past its edges so the normals there match as well.
+//
+// A fixed set of chunk slots covers WORLD_VIEW_RADIUS chunks each way of the
+// viewer and a ring more, so a chunk is only thrown away once it is two rings
+// behind. When the viewer steps into another chunk the missing ones are queued
+// nearest first, leaning the way they are going, and a pool of worker threads
+// builds them, vertex buffer and all. Frame does nothing else, so memory and
+// the cost of a frame stay the same however far the viewer walks.
+class ChunkWorldClass
+{
+private:
+	struct VertexType
+	{
+		D3DXVECTOR3 position;
+		D3DXVECTOR2 texture;
+		D3DXVECTOR3 normal;
+	};
+
+	struct RectType
+	{
+		int left, bottom, right, top;
+	};
+
+	struct ChunkType
+	{
+		int x, z;
+		int state;
+		unsigned int stamp;
+		ID3D11Buffer* vertexBuffer;
+	};
+
+	struct WorkerType
+	{
+		std::thread thread;
+		std::vector<float> heights, faceNormals, normals;
+		std::vector<VertexType> vertices;
+		std::vector<RectType> rooms;
+	};
+
+	enum ChunkStateType
+	{
+		CHUNK_FREE,
+		CHUNK_QUEUED,
+		CHUNK_BUILDING,
+		CHUNK_READY
+	};
+
+	enum EdgeType
+	{
+		EDGE_WEST,
+		EDGE_EAST,
+		EDGE_SOUTH,
+		EDGE_NORTH
+	};
+
+public:
+	ChunkWorldClass();
+	ChunkWorldClass(const ChunkWorldClass&);
+	~ChunkWorldClass();
+
+	bool Initialize(ID3D11Device* device, unsigned int seed, int workerCount, WCHAR* grassTextureFilename, WCHAR* slopeTextureFilename, WCHAR* rockTextureFilename);
+	void Shutdown();
+	void Frame(float positionX, float positionZ);
+	void Render(ID3D11DeviceContext* deviceContext, int chunk, const D3DXMATRIX& worldMatrix, D3DXMATRIX& chunkMatrix);
+
+	int GetChunkCount();
+	int GetIndexCount();
+	int GetBuiltCount();
+
+	ID3D11ShaderResourceView* GetGrassTexture();
+	ID3D11ShaderResourceView* GetSlopeTexture();
+	ID3D11ShaderResourceView* GetRockTexture();
+
+private:
+	bool InitializeNoise(unsigned int seed);
+	bool InitializeIndexBuffer(ID3D11Device* device);
+	bool LoadTextures(ID3D11Device* device, WCHAR* grassTextureFilename, WCHAR* slopeTextureFilename, WCHAR* rockTextureFilename);
+	void ReleaseTextures();
+
+	void Recenter(int centerX, int centerZ);
+	void WorkerThread(WorkerType* worker);
+	bool BuildChunk(WorkerType* worker, int chunkX, int chunkZ, ID3D11Buffer** vertexBuffer);
+	void PlaceRooms(WorkerType* worker, int chunkX, int chunkZ);
+	void CarveDoor(WorkerType* worker, int edge, int chunkX, int chunkZ);
+	void CarveCorridor(WorkerType* worker, int startX, int startZ, int endX, int endZ);
+	void CarveRect(WorkerType* worker, int left, int bottom, int right, int top);
+	void CalculateNormals(WorkerType* worker);
+	void BuildVertices(WorkerType* worker, int chunkX, int chunkZ);
+	void GetVertex(WorkerType* worker, int chunkX, int chunkZ, int i, int j, bool right, bool top, VertexType& vertex);
+
+private:
+	ID3D11Device* m_device;
+	ID3D11Buffer* m_indexBuffer;
+	TextureClass *m_GrassTexture, *m_SlopeTexture, *m_RockTexture;
+	unsigned int m_seed;
+	int m_indexCount;
+
+	PerlinNoiseClass m_perlinNoise;
+	SimplexNoiseClass m_simplexNoise;
+	RidgedNoiseClass m_ridgedNoise;
+	FractalNoiseClass m_ridgedFractal, m_warpFractal;
+	DomainWarpNoiseClass m_warpedNoise;
+	ScaleOffsetNoiseClass m_terrainNoise;
+
+	std::vector<ChunkType> m_chunks;
+	std::vector<int> m_resident, m_queue, m_drawList;
+	std::vector<WorkerType> m_workers;
+	int m_centerX, m_centerZ;
+	bool m_centered, m_chunksChanged, m_quit;
+	int m_builtCount;
+
+	std::mutex m_chunkMutex;
+	std::condition_variable m_chunkCondition;
+};
+
+#endif
@@ -0,0 +1,452 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: connectivityclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "connectivityclass.h"
+#include <algorithm>
+#include <chrono>
+
+
+ConnectivityClass::ConnectivityClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_bandParts = 0;
+	m_rowParts = 0;
+	m_rootComponents = 0;
+	m_labelFailed = false;
+	m_labelTime = 0.0f;
+	m_threadPool = 0;
+}
+
+
+ConnectivityClass::ConnectivityClass(const ConnectivityClass& other)
+{
+}
+
+
+ConnectivityClass::~ConnectivityClass()
+{
+}
+
+
+bool ConnectivityClass::Initialize(int width, int height, ThreadPoolClass* threadPool)
+{
+	int bandCount, rowsPerBand;
+
+
+	if((width <= 0) || (height <= 0) || !threadPool)
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_threadPool = threadPool;
+
+	// One band of rows per thread of the pool, but never so thin that stitching the borders dominates.
+	bandCount = m_threadPool->GetThreadCount();
+	bandCount = std::max(std::min(bandCount, height / 64), 1);
+	rowsPerBand = (height + bandCount - 1) / bandCount;
+
+	m_bands.resize(bandCount);
+	for(int i=0; i<bandCount; i++)
+	{
+		m_bands[i].rowStart = std::min(i * rowsPerBand, height);
+		m_bands[i].rowEnd = std::min((i + 1) * rowsPerBand, height);
+	}
+
+	m_rowOffsets.resize(height + 1);
+
+	// The bands are labelled in parts of their rows, then the components are found over the rows of the whole map.
+	m_bandParts = (rowsPerBand + CONNECTIVITY_PART_ROWS - 1) / CONNECTIVITY_PART_ROWS;
+	m_rowParts = (height + CONNECTIVITY_PART_ROWS - 1) / CONNECTIVITY_PART_ROWS;
+
+	return true;
+}
+
+
+void ConnectivityClass::Shutdown()
+{
+	// The pool belongs to the caller and is left running.
+	m_threadPool = 0;
+
+	std::vector<BandType>().swap(m_bands);
+	std::vector<RunType>().swap(m_runs);
+	std::vector<int>().swap(m_rowOffsets);
+	std::vector<int>().swap(m_parents);
+	std::vector<int>().swap(m_runComponents);
+	std::vector<ComponentType>().swap(m_components);
+	std::vector<ComponentType>().swap(m_sortedComponents);
+
+	return;
+}
+
+
+int ConnectivityClass::Label(const BitGridClass& grid, ArenaClass& arena)
+{
+	for(int i=0; i<GetLabelParts(); i++)
+	{
+		LabelPart(grid, arena, i);
+	}
+
+	return (int)m_components.size();
+}
+
+
+int ConnectivityClass::GetLabelParts()
+{
+	// The band parts, the gather, the parts of the component search, then the sort.
+	return m_bandParts + 1 + m_rowParts + 1;
+}
+
+
+void ConnectivityClass::LabelPart(const BitGridClass& grid, ArenaClass& arena, int part)
+{
+	std::chrono::high_resolution_clock::time_point start;
+
+
+	start = std::chrono::high_resolution_clock::now();
+	if(part == 0)
+	{
+		m_labelTime = 0.0f;
+		m_labelFailed = false;
+	}
+
+	// Once the arena has run out there are no components to report, the parts left do nothing.
+	if(m_labelFailed)
+	{
+		return;
+	}
+
+	if(part < m_bandParts)
+	{
+		// Label the part of every band on its own thread of the pool, the first band runs on this one.
+		m_threadPool->Run((int)m_bands.size(), [this, &grid, part](int band) { LabelBand(grid, m_bands[band], part); });
+	}
+	else if(part == m_bandParts)
+	{
+		GatherBands();
+
+		m_components.clear();
+		m_runComponents.resize(m_runs.size());
+		m_rootComponents = arena.AllocateArray<int>((int)m_runs.size());
+		if(!m_rootComponents)
+		{
+			m_labelFailed = true;
+		}
+		else
+		{
+			std::fill(m_rootComponents, m_rootComponents + m_runs.size(), -1);
+		}
+	}
+	else if(part < (m_bandParts + 1 + m_rowParts))
+	{
+		FindComponents(part - (m_bandParts + 1));
+	}
+	else
+	{
+		SortComponents(arena);
+	}
+
+	if(m_labelFailed)
+	{
+		m_components.clear();
+	}
+
+	m_labelTime += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return;
+}
+
+
+int ConnectivityClass::GetComponentCount()
+{
+	return (int)m_components.size();
+}
+
+
+int ConnectivityClass::GetComponentSize(int component)
+{
+	return m_components[component].size;
+}
+
+
+void ConnectivityClass::GetComponentCell(int component, int& x, int& y)
+{
+	x = m_components[component].x;
+	y = m_components[component].y;
+
+	return;
+}
+
+
+int ConnectivityClass::GetComponentAt(int x, int y)
+{
+	int low, high, middle;
+
+
+	if((x < 0) || (y < 0) || (x >= m_width) || (y >= m_height))
+	{
+		return -1;
+	}
+
+	// The runs of a row are sorted, so binary search for the one covering x.
+	low = m_rowOffsets[y];
+	high = m_rowOffsets[y + 1] - 1;
+	while(low <= high)
+	{
+		middle = (low + high) / 2;
+		if(x < m_runs[middle].start)
+		{
+			high = middle - 1;
+		}
+		else if(x >= m_runs[middle].end)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			return m_runComponents[middle];
+		}
+	}
+
+	return -1;
+}
+
+
+float ConnectivityClass::GetLabelTime()
+{
+	return m_labelTime;
+}
+
+
+void ConnectivityClass::LabelBand(const BitGridClass& grid, BandType& band, int part)
+{
+	RunType run;
+	int x, previousStart, rowStart, rowEnd, firstRun;
+
+
+	rowStart = std::min(band.rowStart + (part * CONNECTIVITY_PART_ROWS), band.rowEnd);
+	rowEnd = std::min(rowStart + CONNECTIVITY_PART_ROWS, band.rowEnd);
+
+	// Each part adds its rows to what the parts before it found.
+	if(part == 0)
+	{
+		band.runs.clear();
+		band.parents.clear();
+		band.rowOffsets.resize((band.rowEnd - band.rowStart) + 1);
+	}
+	firstRun = (int)band.runs.size();
+
+	for(int row = rowStart; row < rowEnd; row++)
+	{
+		band.rowOffsets[row - band.rowStart] = (int)band.runs.size();
+
+		// Pull the runs of floor out of the row a word at a time.
+		x = grid.FindNextSet(0, row, m_width);
+		while(x != -1)
+		{
+			run.start = x;
+			run.end = grid.FindNextClear(x, row, m_width);
+			band.runs.push_back(run);
+
+			x = grid.FindNextSet(run.end, row, m_width);
+		}
+	}
+	band.rowOffsets[rowEnd - band.rowStart] = (int)band.runs.size();
+
+	// Each run starts as its own set, then is merged with the runs it touches in the row above.
+	band.parents.resize(band.runs.size());
+	for(unsigned int i=firstRun; i<band.parents.size(); i++)
+	{
+		band.parents[i] = (int)i;
+	}
+
+	for(int row = std::max(rowStart, band.rowStart + 1); row < rowEnd; row++)
+	{
+		int local = row - band.rowStart;
+
+		previousStart = band.rowOffsets[local - 1];
+		LinkRows(band.runs.data() + previousStart, band.rowOffsets[local] - previousStart, previousStart,
+		         band.runs.data() + band.rowOffsets[local], band.rowOffsets[local + 1] - band.rowOffsets[local], band.rowOffsets[local], band.parents);
+	}
+
+	return;
+}
+
+
+void ConnectivityClass::GatherBands()
+{
+	int base, row;
+
+
+	// Gather the band results into one run list, shifting local run numbers by where each band starts.
+	m_runs.clear();
+	m_parents.clear();
+	for(unsigned int i=0; i<m_bands.size(); i++)
+	{
+		BandType& band = m_bands[i];
+
+		base = (int)m_runs.size();
+		for(row = band.rowStart; row < band.rowEnd; row++)
+		{
+			m_rowOffsets[row] = base + band.rowOffsets[row - band.rowStart];
+		}
+
+		m_runs.insert(m_runs.end(), band.runs.begin(), band.runs.end());
+		for(unsigned int j=0; j<band.parents.size(); j++)
+		{
+			m_parents.push_back(band.parents[j] + base);
+		}
+	}
+	m_rowOffsets[m_height] = (int)m_runs.size();
+
+	// Stitch each band to the one above it along their shared border.
+	for(unsigned int i=1; i<m_bands.size(); i++)
+	{
+		row = m_bands[i].rowStart;
+		if(row == 0 || row >= m_height)
+		{
+			continue;
+		}
+
+		LinkRows(&m_runs[0] + m_rowOffsets[row - 1], m_rowOffsets[row] - m_rowOffsets[row - 1], m_rowOffsets[row - 1],
+		         &m_runs[0] + m_rowOffsets[row], m_rowOffsets[row + 1] - m_rowOffsets[row], m_rowOffsets[row], m_parents);
+	}
+
+	return;
+}
+
+
+void ConnectivityClass::FindComponents(int part)
+{
+	ComponentType component;
+	int runIndex, root, rowStart, rowEnd;
+
+
+	rowStart = part * CONNECTIVITY_PART_ROWS;
+	rowEnd = std::min(rowStart + CONNECTIVITY_PART_ROWS, m_height);
+
+	// Give every root a component and add up the floor area under it.
+	for(int row = rowStart; row < rowEnd; row++)
+	{
+		for(runIndex = m_rowOffsets[row]; runIndex < m_rowOffsets[row + 1]; runIndex++)
+		{
+			root = FindRoot(m_parents, runIndex);
+			if(m_rootComponents[root] == -1)
+			{
+				m_rootComponents[root] = (int)m_components.size();
+
+				component.size = 0;
+				component.x = m_runs[runIndex].start;
+				component.y = row;
+				m_components.push_back(component);
+			}
+
+			m_runComponents[runIndex] = m_rootComponents[root];
+			m_components[m_rootComponents[root]].size += m_runs[runIndex].end - m_runs[runIndex].start;
+		}
+	}
+
+	return;
+}
+
+
+void ConnectivityClass::SortComponents(ArenaClass& arena)
+{
+	int *order, *remap;
+	int componentCount;
+
+
+	// Renumber the components largest first, ties keep the order they were found in.
+	componentCount = (int)m_components.size();
+	order = arena.AllocateArray<int>(componentCount);
+	remap = arena.AllocateArray<int>(componentCount);
+	if(!order || !remap)
+	{
+		m_labelFailed = true;
+		return;
+	}
+
+	for(int i=0; i<componentCount; i++)
+	{
+		order[i] = i;
+	}
+	std::sort(order, order + componentCount, [this](int a, int b)
+	{
+		if(m_components[a].size != m_components[b].size)
+		{
+			return m_components[a].size > m_components[b].size;
+		}
+		return a < b;
+	});
+
+	m_sortedComponents.resize(componentCount);
+	for(int i=0; i<componentCount; i++)
+	{
+		remap[order[i]] = i;
+		m_sortedComponents[i] = m_components[order[i]];
+	}
+	m_components.swap(m_sortedComponents);
+	for(unsigned int i=0; i<m_runComponents.size(); i++)
+	{
+		m_runComponents[i] = remap[m_runComponents[i]];
+	}
+
+	return;
+}
+
+
+void ConnectivityClass::LinkRows(const RunType* above, int aboveCount, int aboveBase, const RunType* below, int belowCount, int belowBase, std::vector<int>& parents)
+{
+	int a, b, rootA, rootB;
+
+
+	// Walk both sorted run lists together, joining every pair of runs that share a column.
+	a = 0;
+	b = 0;
+	while((a < aboveCount) && (b < belowCount))
+	{
+		if((above[a].start < below[b].end) && (below[b].start < above[a].end))
+		{
+			rootA = FindRoot(parents, aboveBase + a);
+			rootB = FindRoot(parents, belowBase + b);
+			if(rootA != rootB)
+			{
+				// Point the later run at the earlier one so roots stay at the top of the component.
+				if(rootA < rootB)
+				{
+					parents[rootB] = rootA;
+				}
+				else
+				{
+					parents[rootA] = rootB;
+				}
+			}
+		}
+
+		// Move on whichever run finishes first.
+		if(above[a].end < below[b].end)
+		{
+			a++;
+		}
+		else
+		{
+			b++;
+		}
+	}
+
+	return;
+}
+
+
+int ConnectivityClass::FindRoot(std::vector<int>& parents, int run)
+{
+	while(parents[run] != run)
+	{
+		parents[run] = parents[parents[run]];
+		run = parents[run];
+	}
+
+	return run;
+}
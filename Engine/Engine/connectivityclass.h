@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: connectivityclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _CONNECTIVITYCLASS_H_
+#define _CONNECTIVITYCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "bitgridclass.h"
+#include "arenaclass.h"
+#include "threadpoolclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int CONNECTIVITY_PART_ROWS = 64;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ConnectivityClass
+////////////////////////////////////////////////////////////////////////////////
+// Labels the 4-connected regions of floor in a walkability grid. Floor is read a
+// word at a time as runs of set cells, so the work scales with the number of runs
+// rather than cells. The grid is cut into bands of rows, one per thread of the
+// pool Initialize is given, that are labelled with a union-find over the runs,
+// then the bands are stitched together along their border rows. Components are
+// reported largest first. Labelling can be done in parts of
+// CONNECTIVITY_PART_ROWS rows, for callers that work to a time budget.
+class ConnectivityClass
+{
+private:
+	struct RunType
+	{
+		int start, end;
+	};
+
+	struct BandType
+	{
+		int rowStart, rowEnd;
+		std::vector<RunType> runs;
+		std::vector<int> rowOffsets;
+		std::vector<int> parents;
+	};
+
+	struct ComponentType
+	{
+		int size;
+		int x, y;
+	};
+
+public:
+	ConnectivityClass();
+	ConnectivityClass(const ConnectivityClass&);
+	~ConnectivityClass();
+
+	bool Initialize(int width, int height, ThreadPoolClass* threadPool);
+	void Shutdown();
+
+	int Label(const BitGridClass& grid, ArenaClass& arena);
+	int GetLabelParts();
+	void LabelPart(const BitGridClass& grid, ArenaClass& arena, int part);
+
+	int GetComponentCount();
+	int GetComponentSize(int component);
+	void GetComponentCell(int component, int& x, int& y);
+	int GetComponentAt(int x, int y);
+	float GetLabelTime();
+
+private:
+	void LabelBand(const BitGridClass& grid, BandType& band, int part);
+	void GatherBands();
+	void FindComponents(int part);
+	void SortComponents(ArenaClass& arena);
+	void LinkRows(const RunType* above, int aboveCount, int aboveBase, const RunType* below, int belowCount, int belowBase, std::vector<int>& parents);
+	int FindRoot(std::vector<int>& parents, int run);
+
+private:
+	int m_width, m_height;
+	std::vector<BandType> m_bands;
+	int m_bandParts, m_rowParts;
+
+	std::vector<RunType> m_runs;
+	std::vector<int> m_rowOffsets;
+	std::vector<int> m_parents;
+	std::vector<int> m_runComponents;
+	std::vector<ComponentType> m_components, m_sortedComponents;
+	int* m_rootComponents;
+	bool m_labelFailed;
+
+	float m_labelTime;
+	ThreadPoolClass* m_threadPool;
+};
+
+#endif
@@ -0,0 +1,793 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: corridorplannerclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "corridorplannerclass.h"
+#include "randomhash.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+
+namespace
+{
+	const double EPSILON = 1.0e-12;
+
+	double Orient(double ax, double ay, double bx, double by, double cx, double cy)
+	{
+		return ((ay - cy) * (bx - cx)) - ((ax - cx) * (by - cy));
+	}
+
+	bool InCircle(double ax, double ay, double bx, double by, double cx, double cy, double px, double py)
+	{
+		double dx, dy, ex, ey, fx, fy, ap, bp, cp;
+
+
+		dx = ax - px;
+		dy = ay - py;
+		ex = bx - px;
+		ey = by - py;
+		fx = cx - px;
+		fy = cy - py;
+
+		ap = (dx * dx) + (dy * dy);
+		bp = (ex * ex) + (ey * ey);
+		cp = (fx * fx) + (fy * fy);
+
+		return ((dx * ((ey * cp) - (bp * fy))) - (dy * ((ex * cp) - (bp * fx))) + (ap * ((ex * fy) - (ey * fx)))) < 0.0;
+	}
+
+	void Circumcenter(double ax, double ay, double bx, double by, double cx, double cy, double& x, double& y)
+	{
+		double dx, dy, ex, ey, bl, cl, d;
+
+
+		dx = bx - ax;
+		dy = by - ay;
+		ex = cx - ax;
+		ey = cy - ay;
+
+		bl = (dx * dx) + (dy * dy);
+		cl = (ex * ex) + (ey * ey);
+		d = 0.5 / ((dx * ey) - (dy * ex));
+
+		x = ax + (((ey * bl) - (dy * cl)) * d);
+		y = ay + (((dx * cl) - (ex * bl)) * d);
+	}
+
+	double Circumradius(double ax, double ay, double bx, double by, double cx, double cy)
+	{
+		double x, y;
+
+
+		Circumcenter(ax, ay, bx, by, cx, cy, x, y);
+		x -= ax;
+		y -= ay;
+
+		// Collinear points give an infinite or NaN circle, both of which must lose every comparison.
+		if(!((x * x) + (y * y) < std::numeric_limits<double>::infinity()))
+		{
+			return std::numeric_limits<double>::infinity();
+		}
+
+		return (x * x) + (y * y);
+	}
+
+	double PseudoAngle(double dx, double dy)
+	{
+		double p;
+
+
+		// Monotonic in the real angle but without the trigonometry, in the range [0, 1].
+		p = dx / (fabs(dx) + fabs(dy));
+		return ((dy > 0.0) ? (3.0 - p) : (1.0 + p)) / 4.0;
+	}
+
+	float ElapsedMs(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+
+CorridorPlannerClass::CorridorPlannerClass()
+{
+	m_pointCount = 0;
+	m_triangleLength = 0;
+	m_hullStart = 0;
+	m_hashSize = 0;
+	m_centerX = 0.0;
+	m_centerY = 0.0;
+	m_spanningEdgeCount = 0;
+	m_randomState = 0;
+
+	m_triangulationTime = 0.0f;
+	m_spanningTreeTime = 0.0f;
+	m_routingTime = 0.0f;
+}
+
+
+CorridorPlannerClass::CorridorPlannerClass(const CorridorPlannerClass& other)
+{
+}
+
+
+CorridorPlannerClass::~CorridorPlannerClass()
+{
+}
+
+
+void CorridorPlannerClass::Seed(unsigned int seed)
+{
+	// Never zero, which is what leaves the choices to rand().
+	m_randomState = ((unsigned long long)seed << 1) | 1ULL;
+
+	return;
+}
+
+
+bool CorridorPlannerClass::Plan(const std::vector<dungeonCellData>& rooms, float loopFraction, ArenaClass& arena)
+{
+	std::chrono::high_resolution_clock::time_point start;
+	bool result;
+
+
+	// The graph is built over the centre of every room.
+	m_pointCount = (int)rooms.size();
+	m_coords.resize(m_pointCount * 2);
+	for(int i=0; i<m_pointCount; i++)
+	{
+		m_coords[(2 * i)] = (rooms[i].xBottomLeft + rooms[i].xTopRight) * 0.5;
+		m_coords[(2 * i) + 1] = (rooms[i].yBottomLeft + rooms[i].yTopRight) * 0.5;
+	}
+
+	m_graphEdges.clear();
+	m_edges.clear();
+	m_spanningEdgeCount = 0;
+
+	// Build the Delaunay graph of the room centres.
+	start = std::chrono::high_resolution_clock::now();
+	result = Triangulate(arena);
+	if(!result)
+	{
+		return false;
+	}
+	m_triangulationTime = ElapsedMs(start);
+
+	// Keep its minimum spanning tree plus some of the other edges as loops.
+	start = std::chrono::high_resolution_clock::now();
+	result = BuildSpanningTree(loopFraction, arena);
+	if(!result)
+	{
+		return false;
+	}
+	m_spanningTreeTime = ElapsedMs(start);
+
+	return true;
+}
+
+
+void CorridorPlannerClass::RouteCorridors(const std::vector<dungeonCellData>& rooms, std::vector<dungeonCellData>& corridors)
+{
+	std::chrono::high_resolution_clock::time_point start;
+
+
+	start = std::chrono::high_resolution_clock::now();
+
+	corridors.clear();
+	for(unsigned int i=0; i<m_edges.size(); i++)
+	{
+		RouteEdge(rooms[m_edges[i].roomA], rooms[m_edges[i].roomB], corridors);
+	}
+
+	m_routingTime = ElapsedMs(start);
+
+	return;
+}
+
+
+const std::vector<CorridorPlannerClass::EdgeType>& CorridorPlannerClass::GetEdges()
+{
+	return m_edges;
+}
+
+
+int CorridorPlannerClass::GetSpanningEdgeCount()
+{
+	return m_spanningEdgeCount;
+}
+
+
+float CorridorPlannerClass::GetTriangulationTime()
+{
+	return m_triangulationTime;
+}
+
+
+float CorridorPlannerClass::GetSpanningTreeTime()
+{
+	return m_spanningTreeTime;
+}
+
+
+float CorridorPlannerClass::GetRoutingTime()
+{
+	return m_routingTime;
+}
+
+
+bool CorridorPlannerClass::Triangulate(ArenaClass& arena)
+{
+	int* ids;
+	double* dists;
+	double minX, minY, maxX, maxY, distance, minDistance, minRadius, radius, x, y, previousX, previousY;
+	int i0, i1, i2, start, e, q, n, t, key, maxTriangles;
+	EdgeType edge;
+
+
+	if(m_pointCount < 3)
+	{
+		return LinkCollinear(arena);
+	}
+
+	// Find the bounding box and its centre.
+	minX = minY = std::numeric_limits<double>::infinity();
+	maxX = maxY = -std::numeric_limits<double>::infinity();
+	for(int i=0; i<m_pointCount; i++)
+	{
+		minX = std::min(minX, m_coords[(2 * i)]);
+		minY = std::min(minY, m_coords[(2 * i) + 1]);
+		maxX = std::max(maxX, m_coords[(2 * i)]);
+		maxY = std::max(maxY, m_coords[(2 * i) + 1]);
+	}
+	x = (minX + maxX) * 0.5;
+	y = (minY + maxY) * 0.5;
+
+	// Pick the seed triangle: the point nearest the centre, its nearest neighbour, and the
+	// third point giving the smallest circumcircle with those two.
+	i0 = i1 = i2 = -1;
+	minDistance = std::numeric_limits<double>::infinity();
+	for(int i=0; i<m_pointCount; i++)
+	{
+		distance = ((m_coords[(2 * i)] - x) * (m_coords[(2 * i)] - x)) + ((m_coords[(2 * i) + 1] - y) * (m_coords[(2 * i) + 1] - y));
+		if(distance < minDistance)
+		{
+			i0 = i;
+			minDistance = distance;
+		}
+	}
+
+	minDistance = std::numeric_limits<double>::infinity();
+	for(int i=0; i<m_pointCount; i++)
+	{
+		if(i == i0)
+		{
+			continue;
+		}
+
+		distance = ((m_coords[(2 * i)] - m_coords[(2 * i0)]) * (m_coords[(2 * i)] - m_coords[(2 * i0)])) +
+		           ((m_coords[(2 * i) + 1] - m_coords[(2 * i0) + 1]) * (m_coords[(2 * i) + 1] - m_coords[(2 * i0) + 1]));
+		if((distance < minDistance) && (distance > 0.0))
+		{
+			i1 = i;
+			minDistance = distance;
+		}
+	}
+
+	minRadius = std::numeric_limits<double>::infinity();
+	for(int i=0; (i1 != -1) && (i<m_pointCount); i++)
+	{
+		if((i == i0) || (i == i1))
+		{
+			continue;
+		}
+
+		radius = Circumradius(m_coords[(2 * i0)], m_coords[(2 * i0) + 1], m_coords[(2 * i1)], m_coords[(2 * i1) + 1], m_coords[(2 * i)], m_coords[(2 * i) + 1]);
+		if(radius < minRadius)
+		{
+			i2 = i;
+			minRadius = radius;
+		}
+	}
+
+	// Every centre lies on one line, so there is nothing to triangulate.
+	if(i2 == -1)
+	{
+		return LinkCollinear(arena);
+	}
+
+	// Make the seed triangle wind the same way as every triangle added after it.
+	if(Orient(m_coords[(2 * i0)], m_coords[(2 * i0) + 1], m_coords[(2 * i1)], m_coords[(2 * i1) + 1], m_coords[(2 * i2)], m_coords[(2 * i2) + 1]) < 0.0)
+	{
+		std::swap(i1, i2);
+	}
+
+	Circumcenter(m_coords[(2 * i0)], m_coords[(2 * i0) + 1], m_coords[(2 * i1)], m_coords[(2 * i1) + 1], m_coords[(2 * i2)], m_coords[(2 * i2) + 1], m_centerX, m_centerY);
+
+	// Sort the points by distance from the seed circumcentre so each new point lands just outside the hull.
+	ids = arena.AllocateArray<int>(m_pointCount);
+	dists = arena.AllocateArray<double>(m_pointCount);
+	if(!ids || !dists)
+	{
+		return false;
+	}
+
+	for(int i=0; i<m_pointCount; i++)
+	{
+		ids[i] = i;
+		dists[i] = ((m_coords[(2 * i)] - m_centerX) * (m_coords[(2 * i)] - m_centerX)) + ((m_coords[(2 * i) + 1] - m_centerY) * (m_coords[(2 * i) + 1] - m_centerY));
+	}
+	std::sort(ids, ids + m_pointCount, [dists](int a, int b) { return dists[a] < dists[b]; });
+
+	// Allocate the triangle and hull storage.
+	maxTriangles = std::max((2 * m_pointCount) - 5, 1);
+	m_triangles.assign(maxTriangles * 3, 0);
+	m_halfedges.assign(maxTriangles * 3, -1);
+	m_triangleLength = 0;
+
+	m_hashSize = (int)ceil(sqrt((double)m_pointCount));
+	m_hullPrev.assign(m_pointCount, 0);
+	m_hullNext.assign(m_pointCount, 0);
+	m_hullTri.assign(m_pointCount, 0);
+	m_hullHash.assign(m_hashSize, -1);
+	m_edgeStack.resize(512);
+
+	// The seed triangle is the starting hull.
+	m_hullStart = i0;
+	m_hullNext[i0] = m_hullPrev[i2] = i1;
+	m_hullNext[i1] = m_hullPrev[i0] = i2;
+	m_hullNext[i2] = m_hullPrev[i1] = i0;
+
+	m_hullTri[i0] = 0;
+	m_hullTri[i1] = 1;
+	m_hullTri[i2] = 2;
+
+	m_hullHash[HashKey(m_coords[(2 * i0)], m_coords[(2 * i0) + 1])] = i0;
+	m_hullHash[HashKey(m_coords[(2 * i1)], m_coords[(2 * i1) + 1])] = i1;
+	m_hullHash[HashKey(m_coords[(2 * i2)], m_coords[(2 * i2) + 1])] = i2;
+
+	AddTriangle(i0, i1, i2, -1, -1, -1);
+
+	previousX = previousY = 0.0;
+	for(int k=0; k<m_pointCount; k++)
+	{
+		int i = ids[k];
+		x = m_coords[(2 * i)];
+		y = m_coords[(2 * i) + 1];
+
+		// Skip near duplicate points and the seed points.
+		if((k > 0) && (fabs(x - previousX) <= EPSILON) && (fabs(y - previousY) <= EPSILON))
+		{
+			continue;
+		}
+		previousX = x;
+		previousY = y;
+
+		if((i == i0) || (i == i1) || (i == i2))
+		{
+			continue;
+		}
+
+		// Find a hull edge visible from the point, starting from the hash bucket for its angle.
+		start = 0;
+		key = HashKey(x, y);
+		for(int j=0; j<m_hashSize; j++)
+		{
+			start = m_hullHash[(key + j) % m_hashSize];
+			if((start != -1) && (start != m_hullNext[start]))
+			{
+				break;
+			}
+		}
+
+		start = m_hullPrev[start];
+		e = start;
+		while(q = m_hullNext[e], Orient(x, y, m_coords[(2 * e)], m_coords[(2 * e) + 1], m_coords[(2 * q)], m_coords[(2 * q) + 1]) >= 0.0)
+		{
+			e = q;
+			if(e == start)
+			{
+				e = -1;
+				break;
+			}
+		}
+
+		if(e == -1)
+		{
+			continue;
+		}
+
+		// Add the first triangle from the point and flip until it is Delaunay.
+		t = AddTriangle(e, i, m_hullNext[e], -1, -1, m_hullTri[e]);
+		m_hullTri[i] = Legalize(t + 2);
+		m_hullTri[e] = t;
+
+		// Walk forward along the hull adding a triangle for every other visible edge.
+		n = m_hullNext[e];
+		while(q = m_hullNext[n], Orient(x, y, m_coords[(2 * n)], m_coords[(2 * n) + 1], m_coords[(2 * q)], m_coords[(2 * q) + 1]) < 0.0)
+		{
+			t = AddTriangle(n, i, q, m_hullTri[i], -1, m_hullTri[n]);
+			m_hullTri[i] = Legalize(t + 2);
+			m_hullNext[n] = n;
+			n = q;
+		}
+
+		// Then walk backward from the other side.
+		if(e == start)
+		{
+			while(q = m_hullPrev[e], Orient(x, y, m_coords[(2 * q)], m_coords[(2 * q) + 1], m_coords[(2 * e)], m_coords[(2 * e) + 1]) < 0.0)
+			{
+				t = AddTriangle(q, i, e, -1, m_hullTri[e], m_hullTri[q]);
+				Legalize(t + 2);
+				m_hullTri[q] = t;
+				m_hullNext[e] = e;
+				e = q;
+			}
+		}
+
+		// Update the hull links and the angle hash.
+		m_hullStart = m_hullPrev[i] = e;
+		m_hullNext[e] = m_hullPrev[n] = i;
+		m_hullNext[i] = n;
+
+		m_hullHash[HashKey(x, y)] = i;
+		m_hullHash[HashKey(m_coords[(2 * e)], m_coords[(2 * e) + 1])] = e;
+	}
+
+	// Every halfedge pair is one graph edge, only keep each pair once.
+	m_graphEdges.reserve(m_triangleLength);
+	for(int h=0; h<m_triangleLength; h++)
+	{
+		if(m_halfedges[h] < h)
+		{
+			edge.roomA = m_triangles[h];
+			edge.roomB = m_triangles[((h % 3) == 2) ? (h - 2) : (h + 1)];
+			m_graphEdges.push_back(edge);
+		}
+	}
+
+	return true;
+}
+
+
+bool CorridorPlannerClass::LinkCollinear(ArenaClass& arena)
+{
+	int* ids;
+	EdgeType edge;
+
+
+	// With fewer than three rooms, or all of them in a line, chain them in order along the line.
+	ids = arena.AllocateArray<int>(m_pointCount);
+	if(!ids)
+	{
+		return false;
+	}
+
+	for(int i=0; i<m_pointCount; i++)
+	{
+		ids[i] = i;
+	}
+
+	std::sort(ids, ids + m_pointCount, [this](int a, int b)
+	{
+		if(m_coords[(2 * a)] != m_coords[(2 * b)])
+		{
+			return m_coords[(2 * a)] < m_coords[(2 * b)];
+		}
+		return m_coords[(2 * a) + 1] < m_coords[(2 * b) + 1];
+	});
+
+	for(int i=1; i<m_pointCount; i++)
+	{
+		edge.roomA = ids[i - 1];
+		edge.roomB = ids[i];
+		m_graphEdges.push_back(edge);
+	}
+
+	return true;
+}
+
+
+int CorridorPlannerClass::Legalize(int a)
+{
+	int i, ar, b, a0, b0, al, bl, br, p0, pr, pl, p1, hbl, e;
+	bool illegal;
+
+
+	// Flip edges until the pair of triangles either side of each one is Delaunay. The recursion is
+	// replaced with an explicit stack of edges still to check.
+	i = 0;
+	ar = 0;
+	while(true)
+	{
+		b = m_halfedges[a];
+
+		a0 = a - (a % 3);
+		ar = a0 + ((a + 2) % 3);
+
+		// A hull edge has nothing to flip against.
+		if(b == -1)
+		{
+			if(i == 0)
+			{
+				break;
+			}
+			a = m_edgeStack[--i];
+			continue;
+		}
+
+		b0 = b - (b % 3);
+		al = a0 + ((a + 1) % 3);
+		bl = b0 + ((b + 2) % 3);
+
+		p0 = m_triangles[ar];
+		pr = m_triangles[a];
+		pl = m_triangles[al];
+		p1 = m_triangles[bl];
+
+		illegal = InCircle(m_coords[(2 * p0)], m_coords[(2 * p0) + 1], m_coords[(2 * pr)], m_coords[(2 * pr) + 1],
+		                   m_coords[(2 * pl)], m_coords[(2 * pl) + 1], m_coords[(2 * p1)], m_coords[(2 * p1) + 1]);
+
+		if(illegal)
+		{
+			m_triangles[a] = p1;
+			m_triangles[b] = p0;
+
+			// If the far edge was on the hull, the hull now has to point at the flipped triangle.
+			hbl = m_halfedges[bl];
+			if(hbl == -1)
+			{
+				e = m_hullStart;
+				do
+				{
+					if(m_hullTri[e] == bl)
+					{
+						m_hullTri[e] = a;
+						break;
+					}
+					e = m_hullPrev[e];
+				} while(e != m_hullStart);
+			}
+
+			Link(a, hbl);
+			Link(b, m_halfedges[ar]);
+			Link(ar, bl);
+
+			br = b0 + ((b + 1) % 3);
+
+			if(i < (int)m_edgeStack.size())
+			{
+				m_edgeStack[i++] = br;
+			}
+			else
+			{
+				m_edgeStack.push_back(br);
+				i++;
+			}
+		}
+		else
+		{
+			if(i == 0)
+			{
+				break;
+			}
+			a = m_edgeStack[--i];
+		}
+	}
+
+	return ar;
+}
+
+
+int CorridorPlannerClass::AddTriangle(int i0, int i1, int i2, int a, int b, int c)
+{
+	int t;
+
+
+	t = m_triangleLength;
+
+	m_triangles[t] = i0;
+	m_triangles[t + 1] = i1;
+	m_triangles[t + 2] = i2;
+
+	Link(t, a);
+	Link(t + 1, b);
+	Link(t + 2, c);
+
+	m_triangleLength += 3;
+
+	return t;
+}
+
+
+void CorridorPlannerClass::Link(int a, int b)
+{
+	m_halfedges[a] = b;
+	if(b != -1)
+	{
+		m_halfedges[b] = a;
+	}
+
+	return;
+}
+
+
+int CorridorPlannerClass::HashKey(double x, double y)
+{
+	return (int)floor(PseudoAngle(x - m_centerX, y - m_centerY) * m_hashSize) % m_hashSize;
+}
+
+
+bool CorridorPlannerClass::BuildSpanningTree(float loopFraction, ArenaClass& arena)
+{
+	double* lengths;
+	int* order;
+	double dx, dy;
+	int edgeCount, rootA, rootB, loopThreshold;
+
+
+	// Sort the graph edges shortest first.
+	edgeCount = (int)m_graphEdges.size();
+	lengths = arena.AllocateArray<double>(edgeCount);
+	order = arena.AllocateArray<int>(edgeCount);
+	if(!lengths || !order)
+	{
+		return false;
+	}
+
+	for(int i=0; i<edgeCount; i++)
+	{
+		dx = m_coords[(2 * m_graphEdges[i].roomA)] - m_coords[(2 * m_graphEdges[i].roomB)];
+		dy = m_coords[(2 * m_graphEdges[i].roomA) + 1] - m_coords[(2 * m_graphEdges[i].roomB) + 1];
+		lengths[i] = (dx * dx) + (dy * dy);
+		order[i] = i;
+	}
+	std::sort(order, order + edgeCount, [lengths](int a, int b) { return lengths[a] < lengths[b]; });
+
+	m_parents.resize(m_pointCount);
+	for(int i=0; i<m_pointCount; i++)
+	{
+		m_parents[i] = i;
+	}
+
+	// Kruskal: an edge joining two separate groups of rooms goes in the tree, the rest are loop candidates.
+	loopThreshold = (int)(std::min(std::max(loopFraction, 0.0f), 1.0f) * RAND_MAX);
+	for(int i=0; i<edgeCount; i++)
+	{
+		const EdgeType& edge = m_graphEdges[order[i]];
+
+		rootA = FindRoot(edge.roomA);
+		rootB = FindRoot(edge.roomB);
+		if(rootA != rootB)
+		{
+			m_parents[rootA] = rootB;
+			m_edges.push_back(edge);
+			m_spanningEdgeCount++;
+		}
+		else if((loopThreshold > 0) && (Random() <= loopThreshold))
+		{
+			m_edges.push_back(edge);
+		}
+	}
+
+	// Rooms dropped as duplicates by the triangulation still have to be reachable.
+	for(int i=1; i<m_pointCount; i++)
+	{
+		rootA = FindRoot(i - 1);
+		rootB = FindRoot(i);
+		if(rootA != rootB)
+		{
+			EdgeType edge;
+
+			edge.roomA = i - 1;
+			edge.roomB = i;
+
+			m_parents[rootA] = rootB;
+			m_edges.push_back(edge);
+			m_spanningEdgeCount++;
+		}
+	}
+
+	return true;
+}
+
+
+int CorridorPlannerClass::FindRoot(int room)
+{
+	// Path halving keeps the trees flat without recursion.
+	while(m_parents[room] != room)
+	{
+		m_parents[room] = m_parents[m_parents[room]];
+		room = m_parents[room];
+	}
+
+	return room;
+}
+
+
+void CorridorPlannerClass::RouteEdge(const dungeonCellData& roomA, const dungeonCellData& roomB, std::vector<dungeonCellData>& corridors)
+{
+	dungeonCellData corridor;
+	float overlapLow, overlapHigh, start;
+	int centerAX, centerAY, centerBX, centerBY;
+
+
+	// Rooms sharing a wide enough span in x are joined by one straight vertical corridor.
+	overlapLow = std::max(roomA.xBottomLeft, roomB.xBottomLeft);
+	overlapHigh = std::min(roomA.xTopRight, roomB.xTopRight);
+	if((overlapHigh - overlapLow) >= CORRIDOR_WIDTH)
+	{
+		start = floor((overlapLow + overlapHigh - CORRIDOR_WIDTH) * 0.5f);
+
+		corridor.xBottomLeft = start;
+		corridor.xTopRight = start + CORRIDOR_WIDTH;
+		corridor.yBottomLeft = std::min(roomA.yTopRight, roomB.yTopRight);
+		corridor.yTopRight = std::max(roomA.yBottomLeft, roomB.yBottomLeft);
+
+		if(corridor.yBottomLeft < corridor.yTopRight)
+		{
+			corridors.push_back(corridor);
+		}
+		return;
+	}
+
+	// Likewise in y with a horizontal corridor.
+	overlapLow = std::max(roomA.yBottomLeft, roomB.yBottomLeft);
+	overlapHigh = std::min(roomA.yTopRight, roomB.yTopRight);
+	if((overlapHigh - overlapLow) >= CORRIDOR_WIDTH)
+	{
+		start = floor((overlapLow + overlapHigh - CORRIDOR_WIDTH) * 0.5f);
+
+		corridor.yBottomLeft = start;
+		corridor.yTopRight = start + CORRIDOR_WIDTH;
+		corridor.xBottomLeft = std::min(roomA.xTopRight, roomB.xTopRight);
+		corridor.xTopRight = std::max(roomA.xBottomLeft, roomB.xBottomLeft);
+
+		if(corridor.xBottomLeft < corridor.xTopRight)
+		{
+			corridors.push_back(corridor);
+		}
+		return;
+	}
+
+	// Otherwise run an L between the two room centres, with the elbow picked at random.
+	centerAX = (int)((roomA.xBottomLeft + roomA.xTopRight) * 0.5f) - (CORRIDOR_WIDTH / 2);
+	centerAY = (int)((roomA.yBottomLeft + roomA.yTopRight) * 0.5f) - (CORRIDOR_WIDTH / 2);
+	centerBX = (int)((roomB.xBottomLeft + roomB.xTopRight) * 0.5f) - (CORRIDOR_WIDTH / 2);
+	centerBY = (int)((roomB.yBottomLeft + roomB.yTopRight) * 0.5f) - (CORRIDOR_WIDTH / 2);
+
+	if((Random() % 2) == 0)
+	{
+		std::swap(centerAX, centerBX);
+		std::swap(centerAY, centerBY);
+	}
+
+	// Horizontal leg along the first room's row.
+	corridor.xBottomLeft = (float)std::min(centerAX, centerBX);
+	corridor.xTopRight = (float)(std::max(centerAX, centerBX) + CORRIDOR_WIDTH);
+	corridor.yBottomLeft = (float)centerAY;
+	corridor.yTopRight = (float)(centerAY + CORRIDOR_WIDTH);
+	corridors.push_back(corridor);
+
+	// Vertical leg along the second room's column.
+	corridor.xBottomLeft = (float)centerBX;
+	corridor.xTopRight = (float)(centerBX + CORRIDOR_WIDTH);
+	corridor.yBottomLeft = (float)std::min(centerAY, centerBY);
+	corridor.yTopRight = (float)(std::max(centerAY, centerBY) + CORRIDOR_WIDTH);
+	corridors.push_back(corridor);
+
+	return;
+}
+
+
+int CorridorPlannerClass::Random()
+{
+	if(m_randomState == 0)
+	{
+		return rand();
+	}
+
+	// Xorshift, cut down to the range rand() gives so the callers need not care which it was.
+	return (int)((NextRandom(m_randomState) >> 33) % ((unsigned long long)RAND_MAX + 1ULL));
+}
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: corridorplannerclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _CORRIDORPLANNERCLASS_H_
+#define _CORRIDORPLANNERCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "dungeoncelldata.h"
+#include "arenaclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int CORRIDOR_WIDTH = 3;
+const float CORRIDOR_LOOP_FRACTION = 0.15f;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: CorridorPlannerClass
+////////////////////////////////////////////////////////////////////////////////
+// Decides which rooms get joined by a corridor. The room centres are triangulated
+// (sweep hull Delaunay, O(n log n)), a minimum spanning tree of that graph keeps
+// every room reachable, and a fraction of the left over Delaunay edges are added
+// back in as loops. Each chosen edge is then laid out as one straight or two
+// L-shaped corridor rectangles.
+//
+// The loops and the elbows are picked with rand() unless Seed is called, after
+// which the planner draws from a sequence of its own, so planners on several
+// threads each make the same choices whatever the others do.
+class CorridorPlannerClass
+{
+public:
+	struct EdgeType
+	{
+		int roomA, roomB;
+	};
+
+public:
+	CorridorPlannerClass();
+	CorridorPlannerClass(const CorridorPlannerClass&);
+	~CorridorPlannerClass();
+
+	void Seed(unsigned int seed);
+	bool Plan(const std::vector<dungeonCellData>& rooms, float loopFraction, ArenaClass& arena);
+	void RouteCorridors(const std::vector<dungeonCellData>& rooms, std::vector<dungeonCellData>& corridors);
+
+	const std::vector<EdgeType>& GetEdges();
+	int GetSpanningEdgeCount();
+
+	float GetTriangulationTime();
+	float GetSpanningTreeTime();
+	float GetRoutingTime();
+
+private:
+	bool Triangulate(ArenaClass& arena);
+	bool LinkCollinear(ArenaClass& arena);
+	int Legalize(int edge);
+	int AddTriangle(int i0, int i1, int i2, int a, int b, int c);
+	void Link(int a, int b);
+	int HashKey(double x, double y);
+	bool BuildSpanningTree(float loopFraction, ArenaClass& arena);
+	int FindRoot(int room);
+	void RouteEdge(const dungeonCellData& roomA, const dungeonCellData& roomB, std::vector<dungeonCellData>& corridors);
+	int Random();
+
+private:
+	int m_pointCount;
+	std::vector<double> m_coords;
+	std::vector<int> m_triangles, m_halfedges;
+	int m_triangleLength;
+
+	std::vector<int> m_hullPrev, m_hullNext, m_hullTri, m_hullHash;
+	int m_hullStart, m_hashSize;
+	double m_centerX, m_centerY;
+	std::vector<int> m_edgeStack;
+
+	std::vector<EdgeType> m_graphEdges;
+	std::vector<EdgeType> m_edges;
+	std::vector<int> m_parents;
+	int m_spanningEdgeCount;
+
+	unsigned long long m_randomState;
+
+	float m_triangulationTime, m_spanningTreeTime, m_routingTime;
+};
+
+#endif
@@ -0,0 +1,625 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: corridorrouterclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "corridorrouterclass.h"
+#include "corridorplannerclass.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+
+namespace
+{
+	// Orders the open list so the cheapest estimate is on top.
+	struct CheaperThan
+	{
+		template<class T> bool operator()(const T& a, const T& b) const
+		{
+			return a.estimate > b.estimate;
+		}
+	};
+}
+
+
+CorridorRouterClass::CorridorRouterClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_jumpPointsDirty = true;
+	m_slotMask = 0;
+
+	m_routeCount = 0;
+	m_expandedNodeCount = 0;
+	m_routingTime = 0.0f;
+}
+
+
+CorridorRouterClass::CorridorRouterClass(const CorridorRouterClass& other)
+{
+}
+
+
+CorridorRouterClass::~CorridorRouterClass()
+{
+}
+
+
+bool CorridorRouterClass::Initialize(int width, int height)
+{
+	bool result;
+
+
+	m_width = width;
+	m_height = height;
+
+	// Create the occupancy grids and the per search closed set.
+	result = m_roomGrid.Initialize(width, height);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_corridorGrid.Initialize(width, height);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_jumpGrid.Initialize(width, height);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_scratchGrid.Initialize(width, height);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_closedGrid.Initialize(width, height);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Start the node table off big enough for a typical corridor search.
+	m_slots.assign(4096, -1);
+	m_slotMask = 4095;
+	m_nodes.reserve(2048);
+	m_open.reserve(2048);
+
+	m_jumpPointsDirty = true;
+
+	return true;
+}
+
+
+void CorridorRouterClass::Shutdown()
+{
+	m_roomGrid.Shutdown();
+	m_corridorGrid.Shutdown();
+	m_jumpGrid.Shutdown();
+	m_scratchGrid.Shutdown();
+	m_closedGrid.Shutdown();
+
+	std::vector<NodeType>().swap(m_nodes);
+	std::vector<int>().swap(m_slots);
+	std::vector<OpenType>().swap(m_open);
+	std::vector<PointType>().swap(m_path);
+
+	return;
+}
+
+
+void CorridorRouterClass::Clear()
+{
+	// Forget the rooms and corridors of the last dungeon.
+	m_roomGrid.Clear();
+	m_corridorGrid.Clear();
+	m_jumpPointsDirty = true;
+
+	return;
+}
+
+
+void CorridorRouterClass::MarkRoom(const dungeonCellData& room)
+{
+	m_roomGrid.FillRect((int)room.xBottomLeft, (int)room.yBottomLeft, (int)room.xTopRight, (int)room.yTopRight, true);
+	m_jumpPointsDirty = true;
+
+	return;
+}
+
+
+void CorridorRouterClass::MarkCorridor(const dungeonCellData& corridor)
+{
+	m_corridorGrid.FillRect((int)corridor.xBottomLeft, (int)corridor.yBottomLeft, (int)corridor.xTopRight, (int)corridor.yTopRight, true);
+
+	// A corridor only moves the jump points just around itself, so patch those instead of rebuilding the grid.
+	if(!m_jumpPointsDirty)
+	{
+		UpdateJumpPoints((int)corridor.xBottomLeft - 1, (int)corridor.yBottomLeft - 1, (int)corridor.xTopRight + 1, (int)corridor.yTopRight + 1);
+	}
+
+	return;
+}
+
+
+bool CorridorRouterClass::Route(int startX, int startY, int goalX, int goalY, std::vector<PointType>& path)
+{
+	static const int directions[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+	OpenType open;
+	PointType point;
+	bool created, found;
+	int node, x, y, jumpX, jumpY, stepCost, cost, next, goalCell;
+
+
+	path.clear();
+
+	if((startX < 0) || (startY < 0) || (startX >= m_width) || (startY >= m_height) ||
+	   (goalX < 0) || (goalY < 0) || (goalX >= m_width) || (goalY >= m_height))
+	{
+		return false;
+	}
+
+	// The jump points only change when rooms or corridors have been added since the last search.
+	if(m_jumpPointsDirty)
+	{
+		BuildJumpPoints();
+	}
+
+	ResetSearch();
+
+	goalCell = (goalY * m_width) + goalX;
+
+	node = FindNode((startY * m_width) + startX, true, created);
+	m_nodes[node].cost = 0;
+	m_nodes[node].parent = -1;
+
+	open.estimate = (abs(goalX - startX) + abs(goalY - startY)) * CORRIDOR_STEP_COST;
+	open.node = node;
+	m_open.push_back(open);
+
+	found = false;
+	while(!m_open.empty())
+	{
+		// Take the cheapest node off the open list, skipping stale copies of nodes already closed.
+		std::pop_heap(m_open.begin(), m_open.end(), CheaperThan());
+		node = m_open.back().node;
+		m_open.pop_back();
+
+		x = m_nodes[node].cell % m_width;
+		y = m_nodes[node].cell / m_width;
+		if(m_closedGrid.Get(x, y))
+		{
+			continue;
+		}
+		m_closedGrid.Set(x, y, true);
+		m_expandedNodeCount++;
+
+		if(m_nodes[node].cell == goalCell)
+		{
+			found = true;
+			break;
+		}
+
+		// Jump in each direction to the next jump point and relax it.
+		for(int d=0; d<4; d++)
+		{
+			if(!Jump(x, y, directions[d][0], directions[d][1], goalX, goalY, jumpX, jumpY, stepCost))
+			{
+				continue;
+			}
+
+			if(m_closedGrid.Get(jumpX, jumpY))
+			{
+				continue;
+			}
+
+			cost = m_nodes[node].cost + stepCost;
+			next = FindNode((jumpY * m_width) + jumpX, true, created);
+			if(created || (cost < m_nodes[next].cost))
+			{
+				m_nodes[next].cost = cost;
+				m_nodes[next].parent = node;
+
+				open.estimate = cost + ((abs(goalX - jumpX) + abs(goalY - jumpY)) * CORRIDOR_STEP_COST);
+				open.node = next;
+				m_open.push_back(open);
+				std::push_heap(m_open.begin(), m_open.end(), CheaperThan());
+			}
+		}
+	}
+
+	if(!found)
+	{
+		return false;
+	}
+
+	// Walk back from the goal to recover the jump points, then put them in start to goal order.
+	for(; node != -1; node = m_nodes[node].parent)
+	{
+		point.x = m_nodes[node].cell % m_width;
+		point.y = m_nodes[node].cell / m_width;
+		path.push_back(point);
+	}
+	std::reverse(path.begin(), path.end());
+
+	return true;
+}
+
+
+bool CorridorRouterClass::RouteRooms(const dungeonCellData& roomA, const dungeonCellData& roomB, std::vector<dungeonCellData>& corridors)
+{
+	std::chrono::high_resolution_clock::time_point start;
+	dungeonCellData corridor;
+	int startX, startY, goalX, goalY, half;
+	bool result;
+
+
+	start = std::chrono::high_resolution_clock::now();
+
+	// Leave each room through the wall facing the other one.
+	GetDoorway(roomA, roomB, startX, startY);
+	GetDoorway(roomB, roomA, goalX, goalY);
+
+	result = Route(startX, startY, goalX, goalY, m_path);
+	if(result)
+	{
+		// Each pair of jump points is a straight run, widen it to a full corridor.
+		half = CORRIDOR_WIDTH / 2;
+		for(unsigned int i=0; i<m_path.size(); i++)
+		{
+			const PointType& from = m_path[(i == 0) ? 0 : (i - 1)];
+			const PointType& to = m_path[i];
+
+			if((i == 0) && (m_path.size() > 1))
+			{
+				continue;
+			}
+
+			corridor.xBottomLeft = (float)(std::min(from.x, to.x) - half);
+			corridor.xTopRight = (float)(std::max(from.x, to.x) - half + CORRIDOR_WIDTH);
+			corridor.yBottomLeft = (float)(std::min(from.y, to.y) - half);
+			corridor.yTopRight = (float)(std::max(from.y, to.y) - half + CORRIDOR_WIDTH);
+
+			corridors.push_back(corridor);
+			MarkCorridor(corridor);
+		}
+	}
+
+	m_routeCount++;
+	m_routingTime += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return result;
+}
+
+
+int CorridorRouterClass::GetRouteCount()
+{
+	return m_routeCount;
+}
+
+
+int CorridorRouterClass::GetExpandedNodeCount()
+{
+	return m_expandedNodeCount;
+}
+
+
+float CorridorRouterClass::GetRoutingTime()
+{
+	return m_routingTime;
+}
+
+
+void CorridorRouterClass::ResetStatistics()
+{
+	m_routeCount = 0;
+	m_expandedNodeCount = 0;
+	m_routingTime = 0.0f;
+
+	return;
+}
+
+
+void CorridorRouterClass::BuildJumpPoints()
+{
+	BitGridClass* masks[2];
+
+
+	// A cell is a jump point when anything in its 3x3 neighbourhood is a different type of cell,
+	// which is the dilation of each type minus its erosion. Rock is whatever is neither room nor
+	// corridor, so its edges are already covered by the other two.
+	masks[0] = &m_roomGrid;
+	masks[1] = &m_corridorGrid;
+
+	m_jumpGrid.Clear();
+	for(int i=0; i<2; i++)
+	{
+		m_scratchGrid.CopyFrom(*masks[i]);
+		m_scratchGrid.Dilate();
+
+		m_closedGrid.CopyFrom(*masks[i]);
+		m_closedGrid.Erode();
+
+		m_scratchGrid.Subtract(m_closedGrid);
+		m_jumpGrid.Union(m_scratchGrid);
+	}
+
+	// The closed set was borrowed as scratch space.
+	m_closedGrid.Clear();
+	m_jumpPointsDirty = false;
+
+	return;
+}
+
+
+void CorridorRouterClass::UpdateJumpPoints(int xStart, int yStart, int xEnd, int yEnd)
+{
+	const BitGridClass* masks[2];
+	bool any, all, jump;
+
+
+	masks[0] = &m_roomGrid;
+	masks[1] = &m_corridorGrid;
+
+	xStart = std::max(xStart, 0);
+	yStart = std::max(yStart, 0);
+	xEnd = std::min(xEnd, m_width);
+	yEnd = std::min(yEnd, m_height);
+
+	// Same rule as the full rebuild, a cell is a jump point unless its 3x3 neighbourhood is all inside
+	// or all outside each mask. Cells off the grid count as outside, as they do for the erosion.
+	for(int y=yStart; y<yEnd; y++)
+	{
+		for(int x=xStart; x<xEnd; x++)
+		{
+			jump = false;
+			for(int i=0; (i<2) && !jump; i++)
+			{
+				any = false;
+				all = true;
+				for(int ny=y-1; ny<=y+1; ny++)
+				{
+					for(int nx=x-1; nx<=x+1; nx++)
+					{
+						if((nx < 0) || (ny < 0) || (nx >= m_width) || (ny >= m_height) || !masks[i]->Get(nx, ny))
+						{
+							all = false;
+						}
+						else
+						{
+							any = true;
+						}
+					}
+				}
+				jump = any && !all;
+			}
+
+			m_jumpGrid.Set(x, y, jump);
+		}
+	}
+
+	return;
+}
+
+
+int CorridorRouterClass::StepCost(int x, int y)
+{
+	if(m_corridorGrid.Get(x, y))
+	{
+		return CORRIDOR_STEP_COST;
+	}
+
+	if(m_roomGrid.Get(x, y))
+	{
+		return ROOM_STEP_COST;
+	}
+
+	return ROCK_STEP_COST;
+}
+
+
+bool CorridorRouterClass::Jump(int x, int y, int dx, int dy, int goalX, int goalY, int& jumpX, int& jumpY, int& cost)
+{
+	int runCost, stop;
+
+
+	// Take the first step, which may land straight on a jump point.
+	x += dx;
+	y += dy;
+	if((x < 0) || (y < 0) || (x >= m_width) || (y >= m_height))
+	{
+		return false;
+	}
+
+	cost = StepCost(x, y);
+	if(m_jumpGrid.Get(x, y) || ((dx != 0) && (x == goalX)) || ((dy != 0) && (y == goalY)))
+	{
+		jumpX = x;
+		jumpY = y;
+		return true;
+	}
+
+	// Cells between jump points all share the type of the first one, so each step costs the same.
+	runCost = cost;
+
+	if(dx != 0)
+	{
+		// Going sideways the next jump point can be found a word at a time, stopping early at the goal column.
+		if(dx > 0)
+		{
+			stop = m_jumpGrid.FindNextSet(x + 1, y, m_width);
+			if((goalX > x) && ((stop == -1) || (stop > goalX)))
+			{
+				stop = goalX;
+			}
+		}
+		else
+		{
+			stop = m_jumpGrid.FindPreviousSet(x - 1, y, -1);
+			if((goalX < x) && ((stop == -1) || (stop < goalX)))
+			{
+				stop = goalX;
+			}
+		}
+
+		// Ran off the edge of the map without finding anything worth stopping for.
+		if(stop == -1)
+		{
+			return false;
+		}
+
+		cost += (abs(stop - x) - 1) * runCost + StepCost(stop, y);
+		jumpX = stop;
+		jumpY = y;
+		return true;
+	}
+
+	// Going up or down check one row at a time.
+	while(true)
+	{
+		y += dy;
+		if((y < 0) || (y >= m_height))
+		{
+			return false;
+		}
+
+		if(m_jumpGrid.Get(x, y) || (y == goalY))
+		{
+			cost += StepCost(x, y);
+			jumpX = x;
+			jumpY = y;
+			return true;
+		}
+
+		cost += runCost;
+	}
+}
+
+
+int CorridorRouterClass::FindNode(int cell, bool create, bool& created)
+{
+	unsigned int slot;
+	NodeType node;
+
+
+	created = false;
+
+	// Linear probing from the hashed slot.
+	slot = ((unsigned int)cell * 2654435761u) & m_slotMask;
+	while(m_slots[slot] != -1)
+	{
+		if(m_nodes[m_slots[slot]].cell == cell)
+		{
+			return m_slots[slot];
+		}
+		slot = (slot + 1) & m_slotMask;
+	}
+
+	if(!create)
+	{
+		return -1;
+	}
+
+	node.cell = cell;
+	node.cost = 0;
+	node.parent = -1;
+	node.slot = (int)slot;
+
+	m_slots[slot] = (int)m_nodes.size();
+	m_nodes.push_back(node);
+	created = true;
+
+	// Keep the table at most half full so probes stay short.
+	if((m_nodes.size() * 2) > m_slots.size())
+	{
+		GrowNodeTable();
+	}
+
+	return (int)m_nodes.size() - 1;
+}
+
+
+void CorridorRouterClass::GrowNodeTable()
+{
+	unsigned int slot;
+
+
+	m_slots.assign(m_slots.size() * 2, -1);
+	m_slotMask = (unsigned int)m_slots.size() - 1;
+
+	for(unsigned int i=0; i<m_nodes.size(); i++)
+	{
+		slot = ((unsigned int)m_nodes[i].cell * 2654435761u) & m_slotMask;
+		while(m_slots[slot] != -1)
+		{
+			slot = (slot + 1) & m_slotMask;
+		}
+
+		m_slots[slot] = (int)i;
+		m_nodes[i].slot = (int)slot;
+	}
+
+	return;
+}
+
+
+void CorridorRouterClass::ResetSearch()
+{
+	// Only undo what the last search touched, so the tables never need clearing in full.
+	for(unsigned int i=0; i<m_nodes.size(); i++)
+	{
+		m_slots[m_nodes[i].slot] = -1;
+		m_closedGrid.Set(m_nodes[i].cell % m_width, m_nodes[i].cell / m_width, false);
+	}
+
+	m_nodes.clear();
+	m_open.clear();
+
+	return;
+}
+
+
+void CorridorRouterClass::GetDoorway(const dungeonCellData& room, const dungeonCellData& target, int& x, int& y)
+{
+	int targetX, targetY, left, right, bottom, top;
+
+
+	targetX = (int)((target.xBottomLeft + target.xTopRight) * 0.5f);
+	targetY = (int)((target.yBottomLeft + target.yTopRight) * 0.5f);
+
+	left = (int)room.xBottomLeft;
+	right = (int)room.xTopRight;
+	bottom = (int)room.yBottomLeft;
+	top = (int)room.yTopRight;
+
+	// Pick the cell just outside the wall that faces the target room.
+	if(targetX < left)
+	{
+		x = left - 1;
+		y = std::min(std::max(targetY, bottom), top - 1);
+	}
+	else if(targetX >= right)
+	{
+		x = right;
+		y = std::min(std::max(targetY, bottom), top - 1);
+	}
+	else if(targetY < bottom)
+	{
+		x = targetX;
+		y = bottom - 1;
+	}
+	else
+	{
+		x = targetX;
+		y = top;
+	}
+
+	x = std::min(std::max(x, 0), m_width - 1);
+	y = std::min(std::max(y, 0), m_height - 1);
+
+	return;
+}
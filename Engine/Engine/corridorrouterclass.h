@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: corridorrouterclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _CORRIDORROUTERCLASS_H_
+#define _CORRIDORROUTERCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "dungeoncelldata.h"
+#include "bitgridclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int CORRIDOR_STEP_COST = 1;
+const int ROCK_STEP_COST = 3;
+const int ROOM_STEP_COST = 24;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: CorridorRouterClass
+////////////////////////////////////////////////////////////////////////////////
+// Routes corridors between rooms with A* over a bit packed occupancy grid. Cells
+// are corridor (cheap, so corridors get reused), rock, or room interior (dear, so
+// corridors go round other rooms). Instead of single steps the search jumps in
+// straight lines and only stops on jump points: cells next to a change of cell
+// type, including the diagonal corners, and cells lined up with the goal. The
+// open list is a binary heap and the node table a hash, both kept between calls,
+// and the closed set is a bit grid.
+class CorridorRouterClass
+{
+private:
+	struct NodeType
+	{
+		int cell;
+		int cost;
+		int parent;
+		int slot;
+	};
+
+	struct OpenType
+	{
+		int estimate;
+		int node;
+	};
+
+public:
+	struct PointType
+	{
+		int x, y;
+	};
+
+public:
+	CorridorRouterClass();
+	CorridorRouterClass(const CorridorRouterClass&);
+	~CorridorRouterClass();
+
+	bool Initialize(int width, int height);
+	void Shutdown();
+	void Clear();
+
+	void MarkRoom(const dungeonCellData& room);
+	void MarkCorridor(const dungeonCellData& corridor);
+
+	bool Route(int startX, int startY, int goalX, int goalY, std::vector<PointType>& path);
+	bool RouteRooms(const dungeonCellData& roomA, const dungeonCellData& roomB, std::vector<dungeonCellData>& corridors);
+
+	int GetRouteCount();
+	int GetExpandedNodeCount();
+	float GetRoutingTime();
+	void ResetStatistics();
+
+private:
+	void BuildJumpPoints();
+	void UpdateJumpPoints(int xStart, int yStart, int xEnd, int yEnd);
+	int StepCost(int x, int y);
+	bool Jump(int x, int y, int dx, int dy, int goalX, int goalY, int& jumpX, int& jumpY, int& cost);
+	int FindNode(int cell, bool create, bool& created);
+	void GrowNodeTable();
+	void ResetSearch();
+	void GetDoorway(const dungeonCellData& room, const dungeonCellData& target, int& x, int& y);
+
+private:
+	int m_width, m_height;
+	BitGridClass m_roomGrid, m_corridorGrid, m_jumpGrid, m_scratchGrid, m_closedGrid;
+	bool m_jumpPointsDirty;
+
+	std::vector<NodeType> m_nodes;
+	std::vector<int> m_slots;
+	unsigned int m_slotMask;
+	std::vector<OpenType> m_open;
+	std::vector<PointType> m_path;
+
+	int m_routeCount, m_expandedNodeCount;
+	float m_routingTime;
+};
+
+#endif
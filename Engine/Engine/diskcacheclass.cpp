@@ -0,0 +1,503 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: diskcacheclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "diskcacheclass.h"
+#include <algorithm>
+#include <cstring>
+#include <stdio.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#endif
+
+
+/////////////
+// GLOBALS //
+/////////////
+// The header is written a field at a time so its layout does not hang on how a compiler pads the struct.
+const int HEADER_SIZE = 4 + 4 + 8 + 8;
+
+
+DiskCacheClass::DiskCacheClass()
+{
+	m_maxBytes = 0;
+	m_cachedBytes = 0;
+	m_version = 0;
+	m_tempCount = 0;
+	m_hitCount = 0;
+	m_missCount = 0;
+	m_storeCount = 0;
+
+	m_view = 0;
+	m_viewSize = 0;
+
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = 0;
+#endif
+}
+
+
+DiskCacheClass::DiskCacheClass(const DiskCacheClass& other)
+{
+}
+
+
+DiskCacheClass::~DiskCacheClass()
+{
+}
+
+
+bool DiskCacheClass::Initialize(const char* directory, long long maxBytes, unsigned int version)
+{
+	std::vector<FileType> files;
+	bool result;
+
+
+	if(maxBytes < 0)
+	{
+		return false;
+	}
+
+	m_directory = directory;
+	m_maxBytes = maxBytes;
+	m_version = version;
+
+	// Make the directory, and any above it that are missing, if this is the first process to use it.
+	result = MakeDirectory(m_directory);
+	if(!result)
+	{
+		return false;
+	}
+
+	// With no size the directory is only read from.
+	if(m_maxBytes == 0)
+	{
+		return true;
+	}
+
+	// Count what is already there, and trim it if the size has come down since.
+	ListFiles(files);
+	m_cachedBytes = 0;
+	for(unsigned int i=0; i<files.size(); i++)
+	{
+		m_cachedBytes += files[i].size;
+	}
+
+	if(m_cachedBytes > m_maxBytes)
+	{
+		Evict();
+	}
+
+	return true;
+}
+
+
+void DiskCacheClass::Shutdown()
+{
+	Unmap();
+
+	return;
+}
+
+
+const unsigned char* DiskCacheClass::Map(unsigned long long key, long long& size)
+{
+	HeaderType header;
+	std::string filename;
+	long long fileSize;
+
+
+	// One blob is mapped at a time.
+	Unmap();
+
+	filename = GetFilename(key);
+
+#ifdef _WIN32
+	LARGE_INTEGER length;
+	FILETIME now;
+
+	// Other processes may replace or delete the file while it is open here.
+	m_file = CreateFileA(filename.c_str(), GENERIC_READ | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(m_file == INVALID_HANDLE_VALUE)
+	{
+		m_missCount++;
+		return 0;
+	}
+
+	if(!GetFileSizeEx(m_file, &length) || (length.QuadPart < (LONGLONG)HEADER_SIZE))
+	{
+		Unmap();
+		m_missCount++;
+		return 0;
+	}
+	fileSize = length.QuadPart;
+
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(m_mapping)
+	{
+		m_view = (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+
+	// Using it makes it the most recent.
+	GetSystemTimeAsFileTime(&now);
+	SetFileTime(m_file, NULL, NULL, &now);
+#else
+	struct stat status;
+	void* view;
+	int file;
+
+	file = open(filename.c_str(), O_RDONLY);
+	if(file == -1)
+	{
+		m_missCount++;
+		return 0;
+	}
+
+	view = MAP_FAILED;
+	fileSize = 0;
+	if((fstat(file, &status) == 0) && (status.st_size >= (off_t)HEADER_SIZE))
+	{
+		fileSize = status.st_size;
+		view = mmap(0, (size_t)fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+	}
+
+	futimens(file, NULL);
+	close(file);
+
+	if(view != MAP_FAILED)
+	{
+		m_view = (const unsigned char*)view;
+	}
+#endif
+
+	if(!m_view)
+	{
+		Unmap();
+		m_missCount++;
+		return 0;
+	}
+	m_viewSize = fileSize;
+
+	// A file that is not the blob asked for, or is cut short, counts as not there.
+	ReadHeader(m_view, header);
+	if((memcmp(header.magic, "DGCC", 4) != 0) || (header.version != m_version) || (header.key != key) || (header.size != (unsigned long long)(fileSize - HEADER_SIZE)))
+	{
+		Unmap();
+		m_missCount++;
+		return 0;
+	}
+
+	m_hitCount++;
+	size = (long long)header.size;
+
+	return m_view + HEADER_SIZE;
+}
+
+
+void DiskCacheClass::Unmap()
+{
+#ifdef _WIN32
+	if(m_view)
+	{
+		UnmapViewOfFile(m_view);
+	}
+
+	if(m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = 0;
+	}
+
+	if(m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if(m_view)
+	{
+		munmap((void*)m_view, (size_t)m_viewSize);
+	}
+#endif
+
+	m_view = 0;
+	m_viewSize = 0;
+
+	return;
+}
+
+
+bool DiskCacheClass::Store(unsigned long long key, const std::vector<unsigned char>& data)
+{
+	HeaderType header;
+	unsigned char headerData[HEADER_SIZE];
+	std::string filename;
+	char tempName[64];
+	FILE* file;
+	bool result;
+	int processId;
+
+
+	if(m_maxBytes == 0)
+	{
+		return false;
+	}
+
+	// The key names the contents, so a file that is already there is this blob.
+	filename = GetFilename(key);
+	if(fopen_s(&file, filename.c_str(), "rb") == 0)
+	{
+		fclose(file);
+		return true;
+	}
+
+	// Write it under a name no other process or call uses, then move it into place in one step.
+#ifdef _WIN32
+	processId = (int)GetCurrentProcessId();
+#else
+	processId = (int)getpid();
+#endif
+	snprintf(tempName, sizeof(tempName), ".%d.%u.tmp", processId, m_tempCount++);
+
+	if(fopen_s(&file, (filename + tempName).c_str(), "wb") != 0)
+	{
+		return false;
+	}
+
+	memcpy(header.magic, "DGCC", 4);
+	header.version = m_version;
+	header.key = key;
+	header.size = data.size();
+
+	WriteHeader(header, headerData);
+
+	result = (fwrite(headerData, HEADER_SIZE, 1, file) == 1);
+	if(result && !data.empty())
+	{
+		result = (fwrite(&data[0], 1, data.size(), file) == data.size());
+	}
+
+	if(fclose(file) != 0)
+	{
+		result = false;
+	}
+
+	if(result)
+	{
+#ifdef _WIN32
+		result = (MoveFileExA((filename + tempName).c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0);
+#else
+		result = (rename((filename + tempName).c_str(), filename.c_str()) == 0);
+#endif
+	}
+
+	if(!result)
+	{
+		remove((filename + tempName).c_str());
+		return false;
+	}
+
+	m_storeCount++;
+	m_cachedBytes += HEADER_SIZE + data.size();
+	if(m_cachedBytes > m_maxBytes)
+	{
+		Evict();
+	}
+
+	return true;
+}
+
+
+int DiskCacheClass::GetHitCount()
+{
+	return m_hitCount;
+}
+
+
+int DiskCacheClass::GetMissCount()
+{
+	return m_missCount;
+}
+
+
+int DiskCacheClass::GetStoreCount()
+{
+	return m_storeCount;
+}
+
+
+long long DiskCacheClass::GetCachedBytes()
+{
+	return m_cachedBytes;
+}
+
+
+std::string DiskCacheClass::GetFilename(unsigned long long key)
+{
+	char name[32];
+
+
+	// Mix the version in so a new generator gets names of its own.
+	key ^= (unsigned long long)m_version * 0x9E3779B97F4A7C15ULL;
+	snprintf(name, sizeof(name), "/%016llx.dgc", key);
+
+	return m_directory + name;
+}
+
+
+bool DiskCacheClass::MakeDirectory(const std::string& directory)
+{
+	std::string parent;
+
+
+	// Make each directory on the path in turn. A part that cannot be made, like a drive or one that
+	// already exists, is passed over, only the last has to be there at the end.
+	for(unsigned int i=1; i<directory.size(); i++)
+	{
+		if((directory[i] == '/') || (directory[i] == '\\'))
+		{
+			parent = directory.substr(0, i);
+#ifdef _WIN32
+			CreateDirectoryA(parent.c_str(), NULL);
+#else
+			mkdir(parent.c_str(), 0755);
+#endif
+		}
+	}
+
+#ifdef _WIN32
+	if(!CreateDirectoryA(directory.c_str(), NULL) && (GetLastError() != ERROR_ALREADY_EXISTS))
+	{
+		return false;
+	}
+#else
+	if((mkdir(directory.c_str(), 0755) != 0) && (errno != EEXIST))
+	{
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+
+void DiskCacheClass::WriteHeader(const HeaderType& header, unsigned char* output)
+{
+	memcpy(output, header.magic, 4);
+	memcpy(output + 4, &header.version, 4);
+	memcpy(output + 8, &header.key, 8);
+	memcpy(output + 16, &header.size, 8);
+
+	return;
+}
+
+
+void DiskCacheClass::ReadHeader(const unsigned char* input, HeaderType& header)
+{
+	memcpy(header.magic, input, 4);
+	memcpy(&header.version, input + 4, 4);
+	memcpy(&header.key, input + 8, 8);
+	memcpy(&header.size, input + 16, 8);
+
+	return;
+}
+
+
+void DiskCacheClass::ListFiles(std::vector<FileType>& files)
+{
+	FileType file;
+
+
+	files.clear();
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find;
+
+	find = FindFirstFileA((m_directory + "/*.dgc").c_str(), &data);
+	if(find == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	do
+	{
+		file.name = m_directory + "/" + data.cFileName;
+		file.size = ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+		file.time = ((long long)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+		files.push_back(file);
+	}
+	while(FindNextFileA(find, &data));
+
+	FindClose(find);
+#else
+	struct stat status;
+	struct dirent* entry;
+	DIR* directory;
+	size_t length;
+
+	directory = opendir(m_directory.c_str());
+	if(!directory)
+	{
+		return;
+	}
+
+	while((entry = readdir(directory)) != 0)
+	{
+		length = strlen(entry->d_name);
+		if((length < 4) || (strcmp(entry->d_name + length - 4, ".dgc") != 0))
+		{
+			continue;
+		}
+
+		file.name = m_directory + "/" + entry->d_name;
+		if(stat(file.name.c_str(), &status) != 0)
+		{
+			continue;
+		}
+		file.size = status.st_size;
+		file.time = ((long long)status.st_mtim.tv_sec * 1000000000LL) + status.st_mtim.tv_nsec;
+		files.push_back(file);
+	}
+
+	closedir(directory);
+#endif
+
+	return;
+}
+
+
+void DiskCacheClass::Evict()
+{
+	std::vector<FileType> files;
+	long long total;
+
+
+	// Count the directory again, since other processes write to it too, then delete the oldest first.
+	ListFiles(files);
+	std::sort(files.begin(), files.end(), [](const FileType& a, const FileType& b) { return a.time < b.time; });
+
+	total = 0;
+	for(unsigned int i=0; i<files.size(); i++)
+	{
+		total += files[i].size;
+	}
+
+	// Going well under the limit keeps this from running again on the next store.
+	for(unsigned int i=0; (i<files.size()) && (total > ((m_maxBytes / 4) * 3)); i++)
+	{
+		if(remove(files[i].name.c_str()) == 0)
+		{
+			total -= files[i].size;
+		}
+	}
+
+	m_cachedBytes = total;
+
+	return;
+}
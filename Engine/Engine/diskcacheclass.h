@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: diskcacheclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _DISKCACHECLASS_H_
+#define _DISKCACHECLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <vector>
+#include <string>
+
+
+/////////////
+// GLOBALS //
+/////////////
+const char* const DISK_CACHE_DIRECTORY = "../Engine/data/cache";
+const long long DISK_CACHE_SIZE = 512LL * 1024LL * 1024LL;
+const unsigned int DISK_CACHE_VERSION = 3;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: DiskCacheClass
+////////////////////////////////////////////////////////////////////////////////
+// Keeps generated blobs in a directory of files named by their key, so they
+// outlive the process and can be shared by every process that points at the
+// same directory. Keys are the PipelineClass ones, which already hash a stage's
+// name, parameters and inputs, mixed with a generator version so blobs from
+// older generation code are never matched.
+//
+// A lookup maps the file read only and hands back a pointer into the view, so a
+// hit costs a file open rather than the generation. A blob is written to a file
+// of its own and renamed into place, which is atomic, so another process never
+// sees half of one. Hits touch the file's time, and once the directory grows
+// past its size the least recently used files are deleted down to three
+// quarters of it. The directory is only counted when the class starts and when
+// it evicts, so space taken meanwhile by other processes is found then. Started
+// with no size, it only maps what other processes have stored.
+class DiskCacheClass
+{
+private:
+	struct HeaderType
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned long long key;
+		unsigned long long size;
+	};
+
+	struct FileType
+	{
+		std::string name;
+		long long size;
+		long long time;
+	};
+
+public:
+	DiskCacheClass();
+	DiskCacheClass(const DiskCacheClass&);
+	~DiskCacheClass();
+
+	bool Initialize(const char* directory, long long maxBytes, unsigned int version);
+	void Shutdown();
+
+	const unsigned char* Map(unsigned long long key, long long& size);
+	void Unmap();
+	bool Store(unsigned long long key, const std::vector<unsigned char>& data);
+
+	int GetHitCount();
+	int GetMissCount();
+	int GetStoreCount();
+	long long GetCachedBytes();
+
+private:
+	bool MakeDirectory(const std::string& directory);
+	std::string GetFilename(unsigned long long key);
+	void WriteHeader(const HeaderType& header, unsigned char* output);
+	void ReadHeader(const unsigned char* input, HeaderType& header);
+	void ListFiles(std::vector<FileType>& files);
+	void Evict();
+
+private:
+	std::string m_directory;
+	long long m_maxBytes, m_cachedBytes;
+	unsigned int m_version;
+	unsigned int m_tempCount;
+	int m_hitCount, m_missCount, m_storeCount;
+
+	const unsigned char* m_view;
+	long long m_viewSize;
+
+#ifdef _WIN32
+	HANDLE m_file, m_mapping;
+#endif
+};
+
+#endif
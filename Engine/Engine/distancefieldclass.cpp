@@ -0,0 +1,310 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: distancefieldclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "distancefieldclass.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+DistanceFieldClass::DistanceFieldClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_columnParts = 0;
+	m_rowParts = 0;
+	m_computeTime = 0.0f;
+
+	m_workFloor = 0;
+	m_workDistances = 0;
+	m_threadPool = 0;
+}
+
+
+DistanceFieldClass::DistanceFieldClass(const DistanceFieldClass& other)
+{
+}
+
+
+DistanceFieldClass::~DistanceFieldClass()
+{
+}
+
+
+bool DistanceFieldClass::Initialize(int width, int height, ThreadPoolClass* threadPool)
+{
+	int bandCount, rowsPerBand, columnsPerBand;
+
+
+	if((width <= 0) || (height <= 0) || !threadPool)
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_threadPool = threadPool;
+	m_columnDistances.assign(m_width * m_height, 0.0f);
+
+	// One band per thread of the pool. The column pass splits the columns between them, the row pass the rows.
+	bandCount = m_threadPool->GetThreadCount();
+	bandCount = std::max(std::min(bandCount, std::min(width, height) / 64), 1);
+	rowsPerBand = (height + bandCount - 1) / bandCount;
+	columnsPerBand = (width + bandCount - 1) / bandCount;
+
+	m_bands.resize(bandCount);
+	for(int i=0; i<bandCount; i++)
+	{
+		m_bands[i].rowStart = std::min(i * rowsPerBand, height);
+		m_bands[i].rowEnd = std::min((i + 1) * rowsPerBand, height);
+		m_bands[i].columnStart = std::min(i * columnsPerBand, width);
+		m_bands[i].columnEnd = std::min((i + 1) * columnsPerBand, width);
+		m_bands[i].columnRuns.resize(m_bands[i].columnEnd - m_bands[i].columnStart);
+		m_bands[i].parabolas.resize(width);
+		m_bands[i].bounds.resize(width + 1);
+	}
+
+	// The column pass goes over every row of the map twice, the row pass over the rows of each band.
+	m_columnParts = (height + DISTANCE_PART_ROWS - 1) / DISTANCE_PART_ROWS;
+	m_rowParts = (rowsPerBand + DISTANCE_PART_ROWS - 1) / DISTANCE_PART_ROWS;
+
+	return true;
+}
+
+
+void DistanceFieldClass::Shutdown()
+{
+	// The pool belongs to the caller and is left running.
+	m_threadPool = 0;
+
+	std::vector<BandType>().swap(m_bands);
+	std::vector<float>().swap(m_columnDistances);
+
+	return;
+}
+
+
+void DistanceFieldClass::Compute(const BitGridClass& floor, float* distances)
+{
+	for(int i=0; i<GetComputeParts(); i++)
+	{
+		ComputePart(floor, distances, i);
+	}
+
+	return;
+}
+
+
+int DistanceFieldClass::GetComputeParts()
+{
+	return (2 * m_columnParts) + m_rowParts;
+}
+
+
+void DistanceFieldClass::ComputePart(const BitGridClass& floor, float* distances, int part)
+{
+	std::chrono::high_resolution_clock::time_point start;
+
+
+	start = std::chrono::high_resolution_clock::now();
+	if(part == 0)
+	{
+		m_computeTime = 0.0f;
+	}
+
+	m_workFloor = &floor;
+	m_workDistances = distances;
+
+	// The row pass reads whole rows of the column pass, so every band has to finish the first before any starts the second.
+	if(part < m_columnParts)
+	{
+		RunPass(PASS_COLUMNS_DOWN, part);
+	}
+	else if(part < (2 * m_columnParts))
+	{
+		RunPass(PASS_COLUMNS_UP, part - m_columnParts);
+	}
+	else
+	{
+		RunPass(PASS_ROWS, part - (2 * m_columnParts));
+	}
+
+	m_workFloor = 0;
+	m_workDistances = 0;
+
+	m_computeTime += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return;
+}
+
+
+float DistanceFieldClass::GetComputeTime()
+{
+	return m_computeTime;
+}
+
+
+void DistanceFieldClass::RunPass(PassType pass, int part)
+{
+	// Run the part of every band on its own thread of the pool, the first band runs on this one.
+	m_threadPool->Run((int)m_bands.size(), [this, pass, part](int band) { RunBand(pass, m_bands[band], part); });
+
+	return;
+}
+
+
+void DistanceFieldClass::RunBand(PassType pass, BandType& band, int part)
+{
+	switch(pass)
+	{
+		case PASS_COLUMNS_DOWN:
+			ColumnDownBand(band, part);
+			break;
+		case PASS_COLUMNS_UP:
+			ColumnUpBand(band, part);
+			break;
+		case PASS_ROWS:
+			RowBand(band, part);
+			break;
+	}
+
+	return;
+}
+
+
+void DistanceFieldClass::ColumnDownBand(BandType& band, int part)
+{
+	const BitGridClass& floor = *m_workFloor;
+	float* row;
+	int run, width, rowStart, rowEnd;
+
+
+	width = band.columnEnd - band.columnStart;
+	rowStart = part * DISTANCE_PART_ROWS;
+	rowEnd = std::min(rowStart + DISTANCE_PART_ROWS, m_height);
+
+	// Walk down the band a row at a time so memory is read in order, counting how far each column is below its last wall.
+	// The row above the map is wall. The count carries over from one part to the next.
+	if(part == 0)
+	{
+		for(int x=0; x<width; x++)
+		{
+			band.columnRuns[x] = 0;
+		}
+	}
+
+	for(int y=rowStart; y<rowEnd; y++)
+	{
+		row = &m_columnDistances[(y * m_width) + band.columnStart];
+		for(int x=0; x<width; x++)
+		{
+			run = floor.Get(band.columnStart + x, y) ? (band.columnRuns[x] + 1) : 0;
+			band.columnRuns[x] = run;
+			row[x] = (float)run;
+		}
+	}
+
+	return;
+}
+
+
+void DistanceFieldClass::ColumnUpBand(BandType& band, int part)
+{
+	float* row;
+	int down, width, rowStart, rowEnd;
+
+
+	width = band.columnEnd - band.columnStart;
+	rowStart = m_height - 1 - (part * DISTANCE_PART_ROWS);
+	rowEnd = std::max(rowStart - DISTANCE_PART_ROWS, -1);
+
+	// Then walk back up counting the distance to the wall below, keeping the nearer of the two, squared for the row pass.
+	if(part == 0)
+	{
+		for(int x=0; x<width; x++)
+		{
+			band.columnRuns[x] = 0;
+		}
+	}
+
+	for(int y=rowStart; y>rowEnd; y--)
+	{
+		row = &m_columnDistances[(y * m_width) + band.columnStart];
+		for(int x=0; x<width; x++)
+		{
+			down = (row[x] > 0.0f) ? (band.columnRuns[x] + 1) : 0;
+			band.columnRuns[x] = down;
+			row[x] = std::min(row[x], (float)down);
+			row[x] = row[x] * row[x];
+		}
+	}
+
+	return;
+}
+
+
+void DistanceFieldClass::RowBand(BandType& band, int part)
+{
+	const float* squared;
+	float* distances;
+	int* parabolas;
+	float* bounds;
+	float crossing, distance, edge;
+	int k, vertex, rowStart, rowEnd;
+
+
+	parabolas = &band.parabolas[0];
+	bounds = &band.bounds[0];
+	rowStart = std::min(band.rowStart + (part * DISTANCE_PART_ROWS), band.rowEnd);
+	rowEnd = std::min(rowStart + DISTANCE_PART_ROWS, band.rowEnd);
+
+	for(int y=rowStart; y<rowEnd; y++)
+	{
+		squared = &m_columnDistances[y * m_width];
+		distances = &m_workDistances[y * m_width];
+
+		// Build the lower envelope of the parabolas (x - q)^2 + squared[q]. Each new parabola pops the ones it hides,
+		// bounds[k] is where parabola k starts to be the lowest.
+		k = 0;
+		parabolas[0] = 0;
+		bounds[0] = -HUGE_VALF;
+		bounds[1] = HUGE_VALF;
+		for(int q=1; q<m_width; q++)
+		{
+			// bounds[0] is minus infinity, so the first parabola is never popped.
+			while(true)
+			{
+				vertex = parabolas[k];
+				crossing = ((squared[q] + (float)(q * q)) - (squared[vertex] + (float)(vertex * vertex))) / (float)(2 * (q - vertex));
+				if(crossing > bounds[k])
+				{
+					break;
+				}
+				k--;
+			}
+
+			k++;
+			parabolas[k] = q;
+			bounds[k] = crossing;
+			bounds[k + 1] = HUGE_VALF;
+		}
+
+		// Read the envelope back out. The columns off either end of the row are wall too.
+		k = 0;
+		for(int q=0; q<m_width; q++)
+		{
+			while(bounds[k + 1] < (float)q)
+			{
+				k++;
+			}
+
+			vertex = parabolas[k];
+			distance = (float)((q - vertex) * (q - vertex)) + squared[vertex];
+
+			edge = (float)std::min(q + 1, m_width - q);
+			distances[q] = std::min(std::sqrt(distance), edge);
+		}
+	}
+
+	return;
+}
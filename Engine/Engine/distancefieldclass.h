@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: distancefieldclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _DISTANCEFIELDCLASS_H_
+#define _DISTANCEFIELDCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "bitgridclass.h"
+#include "threadpoolclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int DISTANCE_PART_ROWS = 32;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: DistanceFieldClass
+////////////////////////////////////////////////////////////////////////////////
+// Works out the exact Euclidean distance from every floor cell of a walkability
+// grid to the nearest wall, walls being 0 and everything off the map counting as
+// wall. It is the separable Felzenszwalb-Huttenlocher transform: a pass down the
+// columns finds the nearest wall in each column, then a pass along the rows takes
+// the lower envelope of the parabolas they give. Both passes are linear in the
+// cells and split into bands, one per thread of the pool Initialize is given.
+// The column pass walks down the rows and back up, so it and the row pass can be
+// run in parts of DISTANCE_PART_ROWS rows for callers on a time budget.
+class DistanceFieldClass
+{
+private:
+	struct BandType
+	{
+		int rowStart, rowEnd;
+		int columnStart, columnEnd;
+		std::vector<int> columnRuns;
+		std::vector<int> parabolas;
+		std::vector<float> bounds;
+	};
+
+	enum PassType
+	{
+		PASS_COLUMNS_DOWN,
+		PASS_COLUMNS_UP,
+		PASS_ROWS
+	};
+
+public:
+	DistanceFieldClass();
+	DistanceFieldClass(const DistanceFieldClass&);
+	~DistanceFieldClass();
+
+	bool Initialize(int width, int height, ThreadPoolClass* threadPool);
+	void Shutdown();
+
+	void Compute(const BitGridClass& floor, float* distances);
+	int GetComputeParts();
+	void ComputePart(const BitGridClass& floor, float* distances, int part);
+
+	float GetComputeTime();
+
+private:
+	void RunPass(PassType pass, int part);
+	void RunBand(PassType pass, BandType& band, int part);
+	void ColumnDownBand(BandType& band, int part);
+	void ColumnUpBand(BandType& band, int part);
+	void RowBand(BandType& band, int part);
+
+private:
+	int m_width, m_height;
+	std::vector<BandType> m_bands;
+	int m_columnParts, m_rowParts;
+	std::vector<float> m_columnDistances;
+	float m_computeTime;
+
+	const BitGridClass* m_workFloor;
+	float* m_workDistances;
+	ThreadPoolClass* m_threadPool;
+};
+
+#endif
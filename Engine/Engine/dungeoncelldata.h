@@ -0,0 +1,18 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: dungeoncelldata.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _DUNGEONCELLDATA_H_
+#define _DUNGEONCELLDATA_H_
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Struct name: dungeonCellData
+////////////////////////////////////////////////////////////////////////////////
+// An axis aligned rectangle on the terrain grid, in height map cells. Used for the
+// partition cells, the rooms and the corridor pieces of the dungeon.
+struct dungeonCellData
+{
+	float xTopRight, xBottomLeft, yTopRight, yBottomLeft;
+};
+
+#endif
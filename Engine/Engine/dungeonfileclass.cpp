@@ -0,0 +1,463 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: dungeonfileclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "dungeonfileclass.h"
+#include <stdio.h>
+#include <cstring>
+
+
+DungeonFileClass::DungeonFileClass()
+{
+	m_width = 0;
+	m_height = 0;
+}
+
+
+DungeonFileClass::DungeonFileClass(const DungeonFileClass& other)
+{
+}
+
+
+DungeonFileClass::~DungeonFileClass()
+{
+}
+
+
+bool DungeonFileClass::Write(const char* filename)
+{
+	std::vector<unsigned char> data;
+	unsigned long long checksum;
+	FILE* filePtr;
+	size_t count;
+
+
+	// The header: a tag, the version, whether the terrain is included and the size of the map.
+	data.insert(data.end(), { 'D', 'G', 'S', 'V' });
+	WriteNumber(data, DUNGEON_FILE_VERSION);
+	WriteNumber(data, m_terrain.empty() ? 0 : 1);
+	WriteNumber(data, m_width);
+	WriteNumber(data, m_height);
+
+	// The recipe.
+	WriteNumber(data, m_operations.size());
+	for(unsigned int i=0; i<m_operations.size(); i++)
+	{
+		WriteNumber(data, m_operations[i].type);
+		WriteNumber(data, m_operations[i].seed);
+		WriteNumber(data, m_operations[i].runs);
+		WriteNumber(data, m_operations[i].passes);
+	}
+
+	// The layout, then the starting terrain.
+	WriteRects(data, m_rooms);
+	WriteRects(data, m_corridors);
+
+	WriteNumber(data, m_baseDelta.size());
+	data.insert(data.end(), m_baseDelta.begin(), m_baseDelta.end());
+
+	if(!m_terrain.empty())
+	{
+		WriteNumber(data, m_terrain.size());
+		data.insert(data.end(), m_terrain.begin(), m_terrain.end());
+	}
+
+	checksum = Hash(&data[0], (int)data.size());
+	data.insert(data.end(), (unsigned char*)&checksum, (unsigned char*)&checksum + sizeof(checksum));
+
+	// Write it out in one go.
+	if(fopen_s(&filePtr, filename, "wb") != 0)
+	{
+		return false;
+	}
+
+	count = fwrite(&data[0], 1, data.size(), filePtr);
+	if(fclose(filePtr) != 0)
+	{
+		return false;
+	}
+
+	return (count == data.size());
+}
+
+
+bool DungeonFileClass::Read(const char* filename)
+{
+	std::vector<unsigned char> data;
+	unsigned long long checksum, version, flags, width, height, count, value[4];
+	FILE* filePtr;
+	long size;
+	int position, end;
+
+
+	// Read the whole file in one go.
+	if(fopen_s(&filePtr, filename, "rb") != 0)
+	{
+		return false;
+	}
+
+	fseek(filePtr, 0, SEEK_END);
+	size = ftell(filePtr);
+	fseek(filePtr, 0, SEEK_SET);
+	if(size < (long)(4 + sizeof(checksum)))
+	{
+		fclose(filePtr);
+		return false;
+	}
+
+	data.resize(size);
+	count = fread(&data[0], 1, size, filePtr);
+	fclose(filePtr);
+	if(count != (unsigned long long)size)
+	{
+		return false;
+	}
+
+	// Check the tag and the checksum before reading anything else.
+	end = (int)size - (int)sizeof(checksum);
+	memcpy(&checksum, &data[end], sizeof(checksum));
+	if((memcmp(&data[0], "DGSV", 4) != 0) || (checksum != Hash(&data[0], end)))
+	{
+		return false;
+	}
+
+	position = 4;
+	if(!ReadNumber(data, position, end, version) || (version != DUNGEON_FILE_VERSION))
+	{
+		return false;
+	}
+
+	if(!ReadNumber(data, position, end, flags) || !ReadNumber(data, position, end, width) || !ReadNumber(data, position, end, height))
+	{
+		return false;
+	}
+	m_width = (int)width;
+	m_height = (int)height;
+
+	// The recipe.
+	if(!ReadNumber(data, position, end, count) || (count > (unsigned long long)(end - position)))
+	{
+		return false;
+	}
+
+	m_operations.resize((int)count);
+	for(unsigned int i=0; i<m_operations.size(); i++)
+	{
+		for(int j=0; j<4; j++)
+		{
+			if(!ReadNumber(data, position, end, value[j]))
+			{
+				return false;
+			}
+		}
+
+		m_operations[i].type = (int)value[0];
+		m_operations[i].seed = (unsigned int)value[1];
+		m_operations[i].runs = (int)value[2];
+		m_operations[i].passes = (int)value[3];
+	}
+
+	// The layout, then the starting terrain.
+	if(!ReadRects(data, position, end, m_rooms) || !ReadRects(data, position, end, m_corridors))
+	{
+		return false;
+	}
+
+	if(!ReadNumber(data, position, end, count) || (count > (unsigned long long)(end - position)))
+	{
+		return false;
+	}
+	m_baseDelta.assign(data.begin() + position, data.begin() + position + (int)count);
+	position += (int)count;
+
+	m_terrain.clear();
+	if(flags & 1)
+	{
+		if(!ReadNumber(data, position, end, count) || (count > (unsigned long long)(end - position)))
+		{
+			return false;
+		}
+		m_terrain.assign(data.begin() + position, data.begin() + position + (int)count);
+		position += (int)count;
+	}
+
+	return (position == end);
+}
+
+
+void DungeonFileClass::SetSize(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+
+	return;
+}
+
+
+int DungeonFileClass::GetWidth()
+{
+	return m_width;
+}
+
+
+int DungeonFileClass::GetHeight()
+{
+	return m_height;
+}
+
+
+std::vector<DungeonFileClass::OperationType>& DungeonFileClass::GetOperations()
+{
+	return m_operations;
+}
+
+
+std::vector<dungeonCellData>& DungeonFileClass::GetRooms()
+{
+	return m_rooms;
+}
+
+
+std::vector<dungeonCellData>& DungeonFileClass::GetCorridors()
+{
+	return m_corridors;
+}
+
+
+std::vector<unsigned char>& DungeonFileClass::GetBaseDelta()
+{
+	return m_baseDelta;
+}
+
+
+std::vector<unsigned char>& DungeonFileClass::GetTerrain()
+{
+	return m_terrain;
+}
+
+
+void DungeonFileClass::EncodeDelta(const float* values, int count, int stride, std::vector<unsigned char>& data)
+{
+	int i, zeros, literals;
+
+
+	// Alternate runs of cells that are exactly zero and runs that are not, the second kept as raw floats.
+	data.clear();
+	i = 0;
+	while(i < count)
+	{
+		zeros = 0;
+		while(((i + zeros) < count) && (values[(i + zeros) * stride] == 0.0f))
+		{
+			zeros++;
+		}
+
+		literals = 0;
+		while(((i + zeros + literals) < count) && (values[(i + zeros + literals) * stride] != 0.0f))
+		{
+			literals++;
+		}
+
+		WriteNumber(data, zeros);
+		WriteNumber(data, literals);
+		for(int j=0; j<literals; j++)
+		{
+			data.insert(data.end(), (const unsigned char*)&values[(i + zeros + j) * stride], (const unsigned char*)&values[(i + zeros + j) * stride] + sizeof(float));
+		}
+
+		i += zeros + literals;
+	}
+
+	return;
+}
+
+
+bool DungeonFileClass::DecodeDelta(const std::vector<unsigned char>& data, float* values, int count, int stride)
+{
+	unsigned long long zeros, literals;
+	int i, position;
+
+
+	i = 0;
+	position = 0;
+	while(i < count)
+	{
+		if(!ReadNumber(data, position, (int)data.size(), zeros) || !ReadNumber(data, position, (int)data.size(), literals))
+		{
+			return false;
+		}
+
+		// A run may not go past the end of the map or of the data.
+		if(((zeros + literals) > (unsigned long long)(count - i)) || ((literals * sizeof(float)) > (unsigned long long)(data.size() - position)))
+		{
+			return false;
+		}
+
+		for(int j=0; j<(int)zeros; j++)
+		{
+			values[(i + j) * stride] = 0.0f;
+		}
+		i += (int)zeros;
+
+		for(int j=0; j<(int)literals; j++)
+		{
+			memcpy(&values[(i + j) * stride], &data[position], sizeof(float));
+			position += sizeof(float);
+		}
+		i += (int)literals;
+	}
+
+	return (position == (int)data.size());
+}
+
+
+unsigned long long DungeonFileClass::Hash(const void* data, int size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash;
+
+
+	// 64 bit FNV-1a.
+	hash = 14695981039346656037ULL;
+	for(int i=0; i<size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+void DungeonFileClass::WriteNumber(std::vector<unsigned char>& data, unsigned long long value)
+{
+	// Seven bits a byte, low first, the top bit set on all but the last.
+	while(value >= 0x80)
+	{
+		data.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	data.push_back((unsigned char)value);
+
+	return;
+}
+
+
+bool DungeonFileClass::ReadNumber(const std::vector<unsigned char>& data, int& position, int end, unsigned long long& value)
+{
+	return ReadNumber(data.data(), position, end, value);
+}
+
+
+bool DungeonFileClass::ReadNumber(const unsigned char* data, int& position, int end, unsigned long long& value)
+{
+	int shift;
+
+
+	value = 0;
+	for(shift=0; shift<64; shift+=7)
+	{
+		if(position >= end)
+		{
+			return false;
+		}
+
+		value |= (unsigned long long)(data[position] & 0x7f) << shift;
+		position++;
+
+		if(!(data[position - 1] & 0x80))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void DungeonFileClass::WriteRects(std::vector<unsigned char>& data, const std::vector<dungeonCellData>& rects)
+{
+	float corners[4];
+	int whole;
+
+
+	// Rectangles are on whole cells, so a corner is nearly always a small integer. It is written doubled and
+	// zigzagged so the sign is in the low bits, and anything else is written as 1 followed by the raw float.
+	WriteNumber(data, rects.size());
+	for(unsigned int i=0; i<rects.size(); i++)
+	{
+		corners[0] = rects[i].xTopRight;
+		corners[1] = rects[i].xBottomLeft;
+		corners[2] = rects[i].yTopRight;
+		corners[3] = rects[i].yBottomLeft;
+		for(int j=0; j<4; j++)
+		{
+			whole = (int)corners[j];
+			if(((float)whole == corners[j]) && (whole > -(1 << 29)) && (whole < (1 << 29)))
+			{
+				WriteNumber(data, (unsigned long long)(((whole << 1) ^ (whole >> 31)) << 1));
+			}
+			else
+			{
+				WriteNumber(data, 1);
+				data.insert(data.end(), (const unsigned char*)&corners[j], (const unsigned char*)&corners[j] + sizeof(float));
+			}
+		}
+	}
+
+	return;
+}
+
+
+bool DungeonFileClass::ReadRects(const std::vector<unsigned char>& data, int& position, int end, std::vector<dungeonCellData>& rects)
+{
+	return ReadRects(data.data(), position, end, rects);
+}
+
+
+bool DungeonFileClass::ReadRects(const unsigned char* data, int& position, int end, std::vector<dungeonCellData>& rects)
+{
+	unsigned long long count, value;
+	float corners[4];
+	unsigned int zigzag;
+
+
+	// Every corner takes at least a byte.
+	if(!ReadNumber(data, position, end, count) || ((count * 4) > (unsigned long long)(end - position)))
+	{
+		return false;
+	}
+
+	rects.resize((int)count);
+	for(unsigned int i=0; i<rects.size(); i++)
+	{
+		for(int j=0; j<4; j++)
+		{
+			if(!ReadNumber(data, position, end, value))
+			{
+				return false;
+			}
+
+			if(value & 1)
+			{
+				if((end - position) < (int)sizeof(float))
+				{
+					return false;
+				}
+				memcpy(&corners[j], &data[position], sizeof(float));
+				position += sizeof(float);
+			}
+			else
+			{
+				zigzag = (unsigned int)(value >> 1);
+				corners[j] = (float)((int)(zigzag >> 1) ^ -(int)(zigzag & 1));
+			}
+		}
+
+		rects[i].xTopRight = corners[0];
+		rects[i].xBottomLeft = corners[1];
+		rects[i].yTopRight = corners[2];
+		rects[i].yBottomLeft = corners[3];
+	}
+
+	return true;
+}
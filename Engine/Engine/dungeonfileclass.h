@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: dungeonfileclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _DUNGEONFILECLASS_H_
+#define _DUNGEONFILECLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "dungeoncelldata.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const unsigned int DUNGEON_FILE_VERSION = 2;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: DungeonFileClass
+////////////////////////////////////////////////////////////////////////////////
+// A saved dungeon. Generation is deterministic given its recipe, so what is kept
+// is the recipe itself: each operation with its seed and parameters. It also
+// keeps the room and corridor rectangles and the starting terrain as a delta
+// against flat ground, which is a few bytes when the terrain started flat. The
+// whole generated terrain can be stored as well, to be loaded without running
+// the recipe again. Integers are variable length, and the file ends in a
+// checksum of everything before it, so a damaged file is refused.
+class DungeonFileClass
+{
+public:
+	struct OperationType
+	{
+		int type;
+		unsigned int seed;
+		int runs;
+		int passes;
+	};
+
+public:
+	DungeonFileClass();
+	DungeonFileClass(const DungeonFileClass&);
+	~DungeonFileClass();
+
+	bool Write(const char* filename);
+	bool Read(const char* filename);
+
+	void SetSize(int width, int height);
+	int GetWidth();
+	int GetHeight();
+
+	std::vector<OperationType>& GetOperations();
+	std::vector<dungeonCellData>& GetRooms();
+	std::vector<dungeonCellData>& GetCorridors();
+	std::vector<unsigned char>& GetBaseDelta();
+	std::vector<unsigned char>& GetTerrain();
+
+	static void EncodeDelta(const float* values, int count, int stride, std::vector<unsigned char>& data);
+	static bool DecodeDelta(const std::vector<unsigned char>& data, float* values, int count, int stride);
+	static unsigned long long Hash(const void* data, int size);
+	static void WriteNumber(std::vector<unsigned char>& data, unsigned long long value);
+	static bool ReadNumber(const std::vector<unsigned char>& data, int& position, int end, unsigned long long& value);
+	static bool ReadNumber(const unsigned char* data, int& position, int end, unsigned long long& value);
+	static void WriteRects(std::vector<unsigned char>& data, const std::vector<dungeonCellData>& rects);
+	static bool ReadRects(const std::vector<unsigned char>& data, int& position, int end, std::vector<dungeonCellData>& rects);
+	static bool ReadRects(const unsigned char* data, int& position, int end, std::vector<dungeonCellData>& rects);
+
+private:
+	int m_width, m_height;
+	std::vector<OperationType> m_operations;
+	std::vector<dungeonCellData> m_rooms, m_corridors;
+	std::vector<unsigned char> m_baseDelta, m_terrain;
+};
+
+#endif
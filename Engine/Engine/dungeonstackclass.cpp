@@ -0,0 +1,737 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: dungeonstackclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "dungeonstackclass.h"
+#include "randomhash.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+namespace
+{
+	unsigned long long HashLevel(unsigned int seed, int level, int kind)
+	{
+		return MixBits(((unsigned long long)seed << 32) ^ ((unsigned long long)(unsigned int)level << 4) ^ (unsigned long long)kind);
+	}
+}
+
+
+DungeonStackClass::DungeonStackClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_levelCount = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_seed = 0;
+	m_nextJob = 0;
+	m_failed = false;
+	m_generationTime = 0.0f;
+	m_clockHand = 0;
+	m_rasterizedCount = 0;
+}
+
+
+DungeonStackClass::DungeonStackClass(const DungeonStackClass& other)
+{
+}
+
+
+DungeonStackClass::~DungeonStackClass()
+{
+}
+
+
+bool DungeonStackClass::Initialize(int width, int height, int levelCount, int workerCount)
+{
+	bool result;
+
+
+	if((width <= 0) || (height <= 0) || (levelCount <= 0))
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_levelCount = levelCount;
+	m_tilesX = (width + STACK_TILE_SIZE - 1) / STACK_TILE_SIZE;
+	m_tilesY = (height + STACK_TILE_SIZE - 1) / STACK_TILE_SIZE;
+
+	m_levels.resize(levelCount);
+
+	// One worker for each thread the machine has unless told otherwise, never more than there are levels.
+	if(workerCount <= 0)
+	{
+		workerCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+	workerCount = std::min(workerCount, levelCount);
+
+	// Each worker has its own room index, planner, router and arena, made once and used for level after level.
+	for(int i=0; i<workerCount; i++)
+	{
+		m_workers.push_back(new WorkerType);
+		if(!m_workers.back())
+		{
+			return false;
+		}
+
+		result = m_workers.back()->roomIndex.Initialize(width, height, ROOM_INDEX_CELL_SIZE);
+		if(!result)
+		{
+			return false;
+		}
+
+		result = m_workers.back()->corridorRouter.Initialize(width, height);
+		if(!result)
+		{
+			return false;
+		}
+
+		result = m_workers.back()->arena.Initialize(GENERATION_ARENA_SIZE);
+		if(!result)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+void DungeonStackClass::Shutdown()
+{
+	// Release the workers.
+	for(unsigned int i=0; i<m_workers.size(); i++)
+	{
+		if(m_workers[i])
+		{
+			m_workers[i]->roomIndex.Shutdown();
+			m_workers[i]->corridorRouter.Shutdown();
+			m_workers[i]->arena.Shutdown();
+			delete m_workers[i];
+			m_workers[i] = 0;
+		}
+	}
+	std::vector<WorkerType*>().swap(m_workers);
+
+	std::vector<LevelType>().swap(m_levels);
+	std::vector<SlotType>().swap(m_slots);
+	m_tileSlots.clear();
+
+	return;
+}
+
+
+bool DungeonStackClass::Generate(unsigned int seed)
+{
+	std::chrono::high_resolution_clock::time_point start;
+
+
+	start = std::chrono::high_resolution_clock::now();
+
+	m_seed = seed;
+	m_failed = false;
+
+	// Tiles drawn from the last dungeon are no good for this one.
+	m_tileMutex.lock();
+	for(unsigned int i=0; i<m_slots.size(); i++)
+	{
+		m_slots[i].key = ~0ULL;
+		m_slots[i].referenced = false;
+	}
+	m_tileSlots.clear();
+	m_tileMutex.unlock();
+
+	// The levels are made on their own, the stairs between each two then only read the rooms of both, and
+	// the bands of a level need the landings and stairs the levels either side gave it.
+	RunPhase(PHASE_LEVELS, m_levelCount);
+	RunPhase(PHASE_STAIRS, m_levelCount - 1);
+	RunPhase(PHASE_BANDS, m_levelCount);
+
+	m_generationTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return !m_failed;
+}
+
+
+bool DungeonStackClass::ReadTile(int level, int tileX, int tileY, float* heights)
+{
+	std::lock_guard<std::mutex> lock(m_tileMutex);
+	std::map<unsigned long long, int>::iterator found;
+	unsigned long long key;
+	int slot;
+
+
+	if((level < 0) || (level >= m_levelCount) || (tileX < 0) || (tileX >= m_tilesX) || (tileY < 0) || (tileY >= m_tilesY))
+	{
+		return false;
+	}
+
+	key = ((unsigned long long)level << 32) | (unsigned long long)((tileY * m_tilesX) + tileX);
+
+	found = m_tileSlots.find(key);
+	if(found != m_tileSlots.end())
+	{
+		slot = found->second;
+	}
+	else
+	{
+		// Draw the tile into a new slot until there are enough, then into the one the clock picks: the slots are
+		// swept in turn and the first not used since the last sweep goes.
+		if((int)m_slots.size() < STACK_RESIDENT_TILES)
+		{
+			m_slots.push_back(SlotType());
+			m_slots.back().heights.resize(STACK_TILE_SIZE * STACK_TILE_SIZE);
+			slot = (int)m_slots.size() - 1;
+		}
+		else
+		{
+			while(m_slots[m_clockHand].referenced)
+			{
+				m_slots[m_clockHand].referenced = false;
+				m_clockHand = (m_clockHand + 1) % (int)m_slots.size();
+			}
+
+			slot = m_clockHand;
+			m_clockHand = (m_clockHand + 1) % (int)m_slots.size();
+			m_tileSlots.erase(m_slots[slot].key);
+		}
+
+		RasterizeTile(level, tileX, tileY, &m_slots[slot].heights[0]);
+		m_slots[slot].key = key;
+		m_tileSlots[key] = slot;
+		m_rasterizedCount++;
+	}
+
+	m_slots[slot].referenced = true;
+	memcpy(heights, &m_slots[slot].heights[0], STACK_TILE_SIZE * STACK_TILE_SIZE * sizeof(float));
+
+	return true;
+}
+
+
+bool DungeonStackClass::ReadLevel(int level, std::vector<float>& heights)
+{
+	std::vector<float> tile;
+	int width, height;
+	bool result;
+
+
+	heights.resize(m_width * m_height);
+	tile.resize(STACK_TILE_SIZE * STACK_TILE_SIZE);
+
+	for(int tileY=0; tileY<m_tilesY; tileY++)
+	{
+		for(int tileX=0; tileX<m_tilesX; tileX++)
+		{
+			result = ReadTile(level, tileX, tileY, &tile[0]);
+			if(!result)
+			{
+				return false;
+			}
+
+			// The last tiles in each direction may hang over the edge of the level.
+			width = std::min(STACK_TILE_SIZE, m_width - (tileX * STACK_TILE_SIZE));
+			height = std::min(STACK_TILE_SIZE, m_height - (tileY * STACK_TILE_SIZE));
+
+			for(int y=0; y<height; y++)
+			{
+				memcpy(&heights[(((tileY * STACK_TILE_SIZE) + y) * m_width) + (tileX * STACK_TILE_SIZE)], &tile[y * STACK_TILE_SIZE], width * sizeof(float));
+			}
+		}
+	}
+
+	return true;
+}
+
+
+int DungeonStackClass::GetWidth()
+{
+	return m_width;
+}
+
+
+int DungeonStackClass::GetHeight()
+{
+	return m_height;
+}
+
+
+int DungeonStackClass::GetLevelCount()
+{
+	return m_levelCount;
+}
+
+
+const std::vector<dungeonCellData>& DungeonStackClass::GetRooms(int level)
+{
+	return m_levels[level].rooms;
+}
+
+
+const std::vector<dungeonCellData>& DungeonStackClass::GetStairs(int level)
+{
+	return m_levels[level].stairsDown;
+}
+
+
+long long DungeonStackClass::GetStoredBytes()
+{
+	long long bytes;
+
+
+	// What the levels keep between generations, the workers' scratch is not counted.
+	bytes = 0;
+	for(unsigned int i=0; i<m_levels.size(); i++)
+	{
+		bytes += (long long)(m_levels[i].rooms.capacity() + m_levels[i].corridors.capacity() + m_levels[i].landings.capacity()) * sizeof(dungeonCellData);
+		bytes += (long long)(m_levels[i].stairsDown.capacity() + m_levels[i].stairsUp.capacity()) * sizeof(dungeonCellData);
+		bytes += (long long)(m_levels[i].bandStarts.capacity() + m_levels[i].bandRects.capacity()) * sizeof(int);
+	}
+
+	std::lock_guard<std::mutex> lock(m_tileMutex);
+	bytes += (long long)m_slots.size() * STACK_TILE_SIZE * STACK_TILE_SIZE * sizeof(float);
+
+	return bytes;
+}
+
+
+int DungeonStackClass::GetResidentTileCount()
+{
+	std::lock_guard<std::mutex> lock(m_tileMutex);
+
+	return (int)m_slots.size();
+}
+
+
+int DungeonStackClass::GetRasterizedTileCount()
+{
+	std::lock_guard<std::mutex> lock(m_tileMutex);
+
+	return m_rasterizedCount;
+}
+
+
+float DungeonStackClass::GetGenerationTime()
+{
+	return m_generationTime;
+}
+
+
+void DungeonStackClass::RunPhase(int phase, int jobCount)
+{
+	std::vector<std::thread> threads;
+
+
+	// The jobs are handed out one at a time from a counter, and the calling thread works through them too.
+	m_nextJob = 0;
+
+	for(unsigned int i=1; i<m_workers.size(); i++)
+	{
+		threads.push_back(std::thread(&DungeonStackClass::WorkerThread, this, phase, jobCount, m_workers[i]));
+	}
+
+	WorkerThread(phase, jobCount, m_workers[0]);
+
+	for(unsigned int i=0; i<threads.size(); i++)
+	{
+		threads[i].join();
+	}
+
+	return;
+}
+
+
+void DungeonStackClass::WorkerThread(int phase, int jobCount, WorkerType* worker)
+{
+	int job;
+	bool result;
+
+
+	for(job = m_nextJob++; job < jobCount; job = m_nextJob++)
+	{
+		result = true;
+
+		switch(phase)
+		{
+			case PHASE_LEVELS:
+				result = GenerateLevel(worker, job);
+				break;
+
+			case PHASE_STAIRS:
+				result = PlaceStairs(worker, job);
+				break;
+
+			case PHASE_BANDS:
+				BuildBands(job);
+				break;
+		}
+
+		if(!result)
+		{
+			m_failed = true;
+		}
+	}
+
+	return;
+}
+
+
+bool DungeonStackClass::GenerateLevel(WorkerType* worker, int level)
+{
+	LevelType& data = m_levels[level];
+	unsigned long long state;
+	dungeonCellData cell, room;
+	float midpointX, midpointY;
+	int head, splits, width, height;
+	bool result;
+
+
+	state = HashLevel(m_seed, level, 0) | 1ULL;
+
+	data.rooms.clear();
+	data.corridors.clear();
+	data.landings.clear();
+	data.stairsDown.clear();
+	data.stairsUp.clear();
+
+	// Split the level into quarters breadth first, the biggest cells first, a random number of times.
+	cell.xBottomLeft = 0.0f;
+	cell.yBottomLeft = 0.0f;
+	cell.xTopRight = (float)m_width;
+	cell.yTopRight = (float)m_height;
+
+	worker->cells.assign(1, cell);
+	head = 0;
+
+	splits = RandomRange(state, 20, 90);
+	for(int i=0; (i < splits) && (head < (int)worker->cells.size()); i++)
+	{
+		cell = worker->cells[head];
+		if(((cell.xTopRight - cell.xBottomLeft) < (2 * STACK_MIN_CELL_SIZE)) || ((cell.yTopRight - cell.yBottomLeft) < (2 * STACK_MIN_CELL_SIZE)))
+		{
+			break;
+		}
+		head++;
+
+		// Move the split point about a little so the cells are not all the same.
+		midpointX = (float)(int)((cell.xBottomLeft + cell.xTopRight) * 0.5f) + (float)RandomRange(state, -STACK_MIN_CELL_SIZE / 4, STACK_MIN_CELL_SIZE / 4);
+		midpointY = (float)(int)((cell.yBottomLeft + cell.yTopRight) * 0.5f) + (float)RandomRange(state, -STACK_MIN_CELL_SIZE / 4, STACK_MIN_CELL_SIZE / 4);
+
+		for(int quarter=0; quarter<4; quarter++)
+		{
+			dungeonCellData newCell;
+
+			newCell.xBottomLeft = (quarter % 2) ? midpointX : cell.xBottomLeft;
+			newCell.xTopRight = (quarter % 2) ? cell.xTopRight : midpointX;
+			newCell.yBottomLeft = (quarter / 2) ? midpointY : cell.yBottomLeft;
+			newCell.yTopRight = (quarter / 2) ? cell.yTopRight : midpointY;
+			worker->cells.push_back(newCell);
+		}
+	}
+
+	// A room in most of the cells left, inside a wall a cell thick. Cells are apart, so rooms never overlap.
+	worker->roomIndex.Clear();
+	for(unsigned int i=head; i<worker->cells.size(); i++)
+	{
+		cell = worker->cells[i];
+		if(RandomRange(state, 0, 3) == 0)
+		{
+			continue;
+		}
+
+		width = RandomRange(state, MIN_ROOM_SIZE, std::max((int)(cell.xTopRight - cell.xBottomLeft) - 2, MIN_ROOM_SIZE));
+		height = RandomRange(state, MIN_ROOM_SIZE, std::max((int)(cell.yTopRight - cell.yBottomLeft) - 2, MIN_ROOM_SIZE));
+		if(((width + 2) > (int)(cell.xTopRight - cell.xBottomLeft)) || ((height + 2) > (int)(cell.yTopRight - cell.yBottomLeft)))
+		{
+			continue;
+		}
+
+		room.xBottomLeft = cell.xBottomLeft + (float)RandomRange(state, 1, (int)(cell.xTopRight - cell.xBottomLeft) - width - 1);
+		room.yBottomLeft = cell.yBottomLeft + (float)RandomRange(state, 1, (int)(cell.yTopRight - cell.yBottomLeft) - height - 1);
+		room.xTopRight = room.xBottomLeft + (float)width;
+		room.yTopRight = room.yBottomLeft + (float)height;
+
+		worker->roomIndex.Insert(room);
+		data.rooms.push_back(room);
+	}
+
+	if(data.rooms.size() < 2)
+	{
+		return true;
+	}
+
+	// Join the rooms the way the terrain does, with the planner drawing from the level's own seed.
+	worker->arena.Reset();
+	worker->corridorPlanner.Seed((unsigned int)HashLevel(m_seed, level, 1));
+
+	result = worker->corridorPlanner.Plan(data.rooms, CORRIDOR_LOOP_FRACTION, worker->arena);
+	if(!result)
+	{
+		return false;
+	}
+
+	if(ROUTE_CORRIDORS_AROUND_ROOMS)
+	{
+		worker->corridorRouter.Clear();
+		for(unsigned int i=0; i<data.rooms.size(); i++)
+		{
+			worker->corridorRouter.MarkRoom(data.rooms[i]);
+		}
+
+		const std::vector<CorridorPlannerClass::EdgeType>& edges = worker->corridorPlanner.GetEdges();
+		for(unsigned int i=0; i<edges.size(); i++)
+		{
+			worker->corridorRouter.RouteRooms(data.rooms[edges[i].roomA], data.rooms[edges[i].roomB], data.corridors);
+		}
+	}
+	else
+	{
+		worker->corridorPlanner.RouteCorridors(data.rooms, data.corridors);
+	}
+
+	// Keep no more than the rectangles take.
+	std::vector<dungeonCellData>(data.rooms).swap(data.rooms);
+	std::vector<dungeonCellData>(data.corridors).swap(data.corridors);
+
+	return true;
+}
+
+
+bool DungeonStackClass::PlaceStairs(WorkerType* worker, int level)
+{
+	LevelType& upper = m_levels[level];
+	LevelType& lower = m_levels[level + 1];
+	dungeonCellData stair, corridor;
+	std::vector<int> nearest;
+	float overlapLeft, overlapRight, overlapBottom, overlapTop, centerX, centerY;
+	int start, placed, roomCount, targetX, targetY, stairX, stairY;
+
+
+	if(upper.rooms.empty() || lower.rooms.empty())
+	{
+		return true;
+	}
+
+	// Put the rooms below in the index, then look up the rooms above in it in an order hashed from the level.
+	worker->roomIndex.Clear();
+	for(unsigned int i=0; i<lower.rooms.size(); i++)
+	{
+		worker->roomIndex.Insert(lower.rooms[i]);
+	}
+
+	roomCount = (int)upper.rooms.size();
+	start = (int)(HashLevel(m_seed, level, 2) % (unsigned long long)roomCount);
+	placed = 0;
+
+	for(int i=0; (i < roomCount) && (placed < STACK_STAIRS_PER_LEVEL); i++)
+	{
+		const dungeonCellData& room = upper.rooms[(start + i) % roomCount];
+
+		worker->roomIndex.FindOverlaps(room, worker->overlaps);
+		for(unsigned int j=0; j<worker->overlaps.size(); j++)
+		{
+			const dungeonCellData& other = worker->roomIndex.GetRoom(worker->overlaps[j]);
+
+			// A stair needs floor under the whole of it on both levels.
+			overlapLeft = std::max(room.xBottomLeft, other.xBottomLeft);
+			overlapRight = std::min(room.xTopRight, other.xTopRight);
+			overlapBottom = std::max(room.yBottomLeft, other.yBottomLeft);
+			overlapTop = std::min(room.yTopRight, other.yTopRight);
+			if(((overlapRight - overlapLeft) < STACK_STAIR_SIZE) || ((overlapTop - overlapBottom) < STACK_STAIR_SIZE))
+			{
+				continue;
+			}
+
+			stair.xBottomLeft = (float)(int)((overlapLeft + overlapRight - STACK_STAIR_SIZE) * 0.5f);
+			stair.yBottomLeft = (float)(int)((overlapBottom + overlapTop - STACK_STAIR_SIZE) * 0.5f);
+			stair.xTopRight = stair.xBottomLeft + STACK_STAIR_SIZE;
+			stair.yTopRight = stair.yBottomLeft + STACK_STAIR_SIZE;
+
+			upper.stairsDown.push_back(stair);
+			lower.stairsUp.push_back(stair);
+			placed++;
+			break;
+		}
+	}
+
+	if(placed > 0)
+	{
+		return true;
+	}
+
+	// No two rooms line up, so the stair goes down from the middle of a room above into a landing, and a
+	// corridor runs from that to the nearest room below.
+	const dungeonCellData& room = upper.rooms[start];
+
+	centerX = (room.xBottomLeft + room.xTopRight) * 0.5f;
+	centerY = (room.yBottomLeft + room.yTopRight) * 0.5f;
+
+	stair.xBottomLeft = (float)(int)(centerX - (STACK_STAIR_SIZE * 0.5f));
+	stair.yBottomLeft = (float)(int)(centerY - (STACK_STAIR_SIZE * 0.5f));
+	stair.xTopRight = stair.xBottomLeft + STACK_STAIR_SIZE;
+	stair.yTopRight = stair.yBottomLeft + STACK_STAIR_SIZE;
+
+	if(worker->roomIndex.FindNearest(centerX, centerY, 1, nearest) == 0)
+	{
+		return false;
+	}
+
+	const dungeonCellData& target = worker->roomIndex.GetRoom(nearest[0]);
+
+	stairX = (int)stair.xBottomLeft;
+	stairY = (int)stair.yBottomLeft;
+	targetX = (int)((target.xBottomLeft + target.xTopRight) * 0.5f) - (CORRIDOR_WIDTH / 2);
+	targetY = (int)((target.yBottomLeft + target.yTopRight) * 0.5f) - (CORRIDOR_WIDTH / 2);
+
+	lower.landings.push_back(stair);
+
+	// Across along the landing's row, then along the room's column.
+	corridor.xBottomLeft = (float)std::min(stairX, targetX);
+	corridor.xTopRight = (float)(std::max(stairX, targetX) + CORRIDOR_WIDTH);
+	corridor.yBottomLeft = (float)stairY;
+	corridor.yTopRight = (float)(stairY + CORRIDOR_WIDTH);
+	lower.landings.push_back(corridor);
+
+	corridor.xBottomLeft = (float)targetX;
+	corridor.xTopRight = (float)(targetX + CORRIDOR_WIDTH);
+	corridor.yBottomLeft = (float)std::min(stairY, targetY);
+	corridor.yTopRight = (float)(std::max(stairY, targetY) + CORRIDOR_WIDTH);
+	lower.landings.push_back(corridor);
+
+	upper.stairsDown.push_back(stair);
+	lower.stairsUp.push_back(stair);
+
+	return true;
+}
+
+
+void DungeonStackClass::BuildBands(int level)
+{
+	LevelType& data = m_levels[level];
+	std::vector<int> cursors;
+	int rectCount, first, last;
+
+
+	// Each band is a row of tiles, and lists every floor rectangle that reaches into it.
+	rectCount = (int)(data.rooms.size() + data.corridors.size() + data.landings.size());
+
+	// Count the rectangles in each band.
+	data.bandStarts.assign(m_tilesY + 1, 0);
+	for(int i=0; i<rectCount; i++)
+	{
+		const dungeonCellData& rect = GetRect(data, i);
+
+		first = std::max((int)rect.yBottomLeft, 0) / STACK_TILE_SIZE;
+		last = (std::min((int)rect.yTopRight, m_height) - 1) / STACK_TILE_SIZE;
+		for(int band=first; band<=last; band++)
+		{
+			data.bandStarts[band + 1]++;
+		}
+	}
+
+	// Turn the counts into where each band starts, then fill them in.
+	for(int band=0; band<m_tilesY; band++)
+	{
+		data.bandStarts[band + 1] += data.bandStarts[band];
+	}
+
+	data.bandRects.resize(data.bandStarts[m_tilesY]);
+	cursors.assign(data.bandStarts.begin(), data.bandStarts.end() - 1);
+
+	for(int i=0; i<rectCount; i++)
+	{
+		const dungeonCellData& rect = GetRect(data, i);
+
+		first = std::max((int)rect.yBottomLeft, 0) / STACK_TILE_SIZE;
+		last = (std::min((int)rect.yTopRight, m_height) - 1) / STACK_TILE_SIZE;
+		for(int band=first; band<=last; band++)
+		{
+			data.bandRects[cursors[band]++] = i;
+		}
+	}
+
+	std::vector<int>(data.bandRects).swap(data.bandRects);
+
+	return;
+}
+
+
+const dungeonCellData& DungeonStackClass::GetRect(const LevelType& level, int rect)
+{
+	// The rooms, then the corridors, then the landings, as one list.
+	if(rect < (int)level.rooms.size())
+	{
+		return level.rooms[rect];
+	}
+	rect -= (int)level.rooms.size();
+
+	if(rect < (int)level.corridors.size())
+	{
+		return level.corridors[rect];
+	}
+
+	return level.landings[rect - level.corridors.size()];
+}
+
+
+void DungeonStackClass::RasterizeTile(int level, int tileX, int tileY, float* heights)
+{
+	const LevelType& data = m_levels[level];
+	int xStart, yStart, xEnd, yEnd, tileLeft, tileBottom;
+
+
+	tileLeft = tileX * STACK_TILE_SIZE;
+	tileBottom = tileY * STACK_TILE_SIZE;
+
+	// Rock everywhere, then the floor of every rectangle in the band sunk in as the terrain carves rooms.
+	for(int i=0; i<(STACK_TILE_SIZE * STACK_TILE_SIZE); i++)
+	{
+		heights[i] = 0.0f;
+	}
+
+	for(int i=data.bandStarts[tileY]; i<data.bandStarts[tileY + 1]; i++)
+	{
+		const dungeonCellData& rect = GetRect(data, data.bandRects[i]);
+
+		xStart = std::max((int)rect.xBottomLeft, tileLeft);
+		yStart = std::max((int)rect.yBottomLeft, tileBottom);
+		xEnd = std::min(std::min((int)rect.xTopRight, tileLeft + STACK_TILE_SIZE), m_width);
+		yEnd = std::min(std::min((int)rect.yTopRight, tileBottom + STACK_TILE_SIZE), m_height);
+
+		for(int y=yStart; y<yEnd; y++)
+		{
+			for(int x=xStart; x<xEnd; x++)
+			{
+				heights[((y - tileBottom) * STACK_TILE_SIZE) + (x - tileLeft)] = -(float)ROOM_DEPTH;
+			}
+		}
+	}
+
+	// Stairs are ramps across x, down to the level below from this one and up to the level above.
+	for(int pass=0; pass<2; pass++)
+	{
+		const std::vector<dungeonCellData>& stairs = (pass == 0) ? data.stairsDown : data.stairsUp;
+
+		for(unsigned int i=0; i<stairs.size(); i++)
+		{
+			xStart = std::max((int)stairs[i].xBottomLeft, tileLeft);
+			yStart = std::max((int)stairs[i].yBottomLeft, tileBottom);
+			xEnd = std::min(std::min((int)stairs[i].xTopRight, tileLeft + STACK_TILE_SIZE), m_width);
+			yEnd = std::min(std::min((int)stairs[i].yTopRight, tileBottom + STACK_TILE_SIZE), m_height);
+
+			for(int y=yStart; y<yEnd; y++)
+			{
+				for(int x=xStart; x<xEnd; x++)
+				{
+					heights[((y - tileBottom) * STACK_TILE_SIZE) + (x - tileLeft)] = -(float)ROOM_DEPTH + (((pass == 0) ? -1.0f : 1.0f) * (float)ROOM_DEPTH *
+						(float)(x - (int)stairs[i].xBottomLeft + 1) / (float)(STACK_STAIR_SIZE + 1));
+				}
+			}
+		}
+	}
+
+	return;
+}
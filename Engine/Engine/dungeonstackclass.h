@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: dungeonstackclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _DUNGEONSTACKCLASS_H_
+#define _DUNGEONSTACKCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "terrainclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int STACK_TILE_SIZE = 64;
+const int STACK_RESIDENT_TILES = 256;
+const int STACK_MIN_CELL_SIZE = 24;
+const int STACK_STAIRS_PER_LEVEL = 2;
+const int STACK_STAIR_SIZE = 4;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: DungeonStackClass
+////////////////////////////////////////////////////////////////////////////////
+// A dungeon of several levels one below the other, each the size of the terrain.
+// Every level is made from a seed of its own hashed from the dungeon's seed and
+// its number, so the levels are made on as many threads as there are and come
+// out the same however many that is. A level is split into cells breadth first,
+// a room is put in most of them and the planner and router join the rooms, as
+// on the terrain, only without a height map.
+//
+// Stairs then join each level to the one below. The rooms of the lower level go
+// in a room index, and the rooms above are looked up in it for one they overlap
+// by enough to hold a stair. If no two rooms line up, the stair goes down from a
+// room above into a landing with a corridor to the nearest room below.
+//
+// A level is kept as its rectangles only: rooms, corridors, landings and stairs,
+// plus a list of which rectangles reach into each band of tile rows. Heights are
+// drawn from those a tile at a time when asked for, and the last
+// STACK_RESIDENT_TILES tiles are kept, so memory goes with how much is in the
+// levels rather than how big they are. ReadTile and ReadLevel may be called from
+// any thread once Generate has returned.
+class DungeonStackClass
+{
+private:
+	struct LevelType
+	{
+		std::vector<dungeonCellData> rooms, corridors, landings;
+		std::vector<dungeonCellData> stairsDown, stairsUp;
+		std::vector<int> bandStarts, bandRects;
+	};
+
+	struct WorkerType
+	{
+		RoomIndexClass roomIndex;
+		CorridorPlannerClass corridorPlanner;
+		CorridorRouterClass corridorRouter;
+		ArenaClass arena;
+		std::vector<dungeonCellData> cells;
+		std::vector<int> overlaps;
+	};
+
+	struct SlotType
+	{
+		unsigned long long key;
+		std::vector<float> heights;
+		bool referenced;
+	};
+
+	enum PhaseType
+	{
+		PHASE_LEVELS,
+		PHASE_STAIRS,
+		PHASE_BANDS
+	};
+
+public:
+	DungeonStackClass();
+	DungeonStackClass(const DungeonStackClass&);
+	~DungeonStackClass();
+
+	bool Initialize(int width, int height, int levelCount, int workerCount);
+	void Shutdown();
+	bool Generate(unsigned int seed);
+
+	bool ReadTile(int level, int tileX, int tileY, float* heights);
+	bool ReadLevel(int level, std::vector<float>& heights);
+
+	int GetWidth();
+	int GetHeight();
+	int GetLevelCount();
+	const std::vector<dungeonCellData>& GetRooms(int level);
+	const std::vector<dungeonCellData>& GetStairs(int level);
+	long long GetStoredBytes();
+	int GetResidentTileCount();
+	int GetRasterizedTileCount();
+	float GetGenerationTime();
+
+private:
+	void RunPhase(int phase, int jobCount);
+	void WorkerThread(int phase, int jobCount, WorkerType* worker);
+	bool GenerateLevel(WorkerType* worker, int level);
+	bool PlaceStairs(WorkerType* worker, int level);
+	void BuildBands(int level);
+	const dungeonCellData& GetRect(const LevelType& level, int rect);
+	void RasterizeTile(int level, int tileX, int tileY, float* heights);
+
+private:
+	int m_width, m_height, m_levelCount;
+	int m_tilesX, m_tilesY;
+	unsigned int m_seed;
+	std::vector<LevelType> m_levels;
+	std::vector<WorkerType*> m_workers;
+
+	std::atomic<int> m_nextJob;
+	std::atomic<bool> m_failed;
+	float m_generationTime;
+
+	std::mutex m_tileMutex;
+	std::vector<SlotType> m_slots;
+	std::map<unsigned long long, int> m_tileSlots;
+	int m_clockHand, m_rasterizedCount;
+};
+
+#endif
@@ -0,0 +1,494 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: erosionclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "erosionclass.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+namespace
+{
+	const int NEIGHBOUR_X[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+	const int NEIGHBOUR_Y[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+	const int PASS_COUNT = 5;
+}
+
+
+ErosionClass::ErosionClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_passParts = 0;
+	m_iterationTime = 0.0f;
+	m_threadPool = 0;
+}
+
+
+ErosionClass::ErosionClass(const ErosionClass& other)
+{
+}
+
+
+ErosionClass::~ErosionClass()
+{
+}
+
+
+bool ErosionClass::Initialize(int width, int height, ThreadPoolClass* threadPool)
+{
+	int bandCount, rowsPerBand, cellCount;
+
+
+	if((width <= 0) || (height <= 0) || !threadPool)
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_threadPool = threadPool;
+	cellCount = width * height;
+
+	m_terrain.assign(cellCount, 0.0f);
+	m_nextTerrain.assign(cellCount, 0.0f);
+	m_water.assign(cellCount, 0.0f);
+	m_nextWater.assign(cellCount, 0.0f);
+	m_sediment.assign(cellCount, 0.0f);
+	m_nextSediment.assign(cellCount, 0.0f);
+	m_fluxLeft.assign(cellCount, 0.0f);
+	m_fluxRight.assign(cellCount, 0.0f);
+	m_fluxUp.assign(cellCount, 0.0f);
+	m_fluxDown.assign(cellCount, 0.0f);
+	m_sedimentShare.assign(cellCount, 0.0f);
+	m_talus.assign(cellCount, 0.0f);
+
+	// One band of rows per thread of the pool.
+	bandCount = m_threadPool->GetThreadCount();
+	bandCount = std::max(std::min(bandCount, height / 16), 1);
+	rowsPerBand = (height + bandCount - 1) / bandCount;
+
+	m_bands.resize(bandCount);
+	for(int i=0; i<bandCount; i++)
+	{
+		m_bands[i].rowStart = std::min(i * rowsPerBand, height);
+		m_bands[i].rowEnd = std::min((i + 1) * rowsPerBand, height);
+	}
+
+	// Every band runs a pass in the same number of parts, the last of a short band does nothing.
+	m_passParts = (rowsPerBand + EROSION_PART_ROWS - 1) / EROSION_PART_ROWS;
+
+	return true;
+}
+
+
+void ErosionClass::Shutdown()
+{
+	// The pool belongs to the caller and is left running.
+	m_threadPool = 0;
+
+	std::vector<BandType>().swap(m_bands);
+	std::vector<float>().swap(m_terrain);
+	std::vector<float>().swap(m_nextTerrain);
+	std::vector<float>().swap(m_water);
+	std::vector<float>().swap(m_nextWater);
+	std::vector<float>().swap(m_sediment);
+	std::vector<float>().swap(m_nextSediment);
+	std::vector<float>().swap(m_fluxLeft);
+	std::vector<float>().swap(m_fluxRight);
+	std::vector<float>().swap(m_fluxUp);
+	std::vector<float>().swap(m_fluxDown);
+	std::vector<float>().swap(m_sedimentShare);
+	std::vector<float>().swap(m_talus);
+
+	return;
+}
+
+
+void ErosionClass::LoadRow(const HeightFieldClass& field, int y)
+{
+	const float* span;
+	int length, index;
+
+
+	// Copy the row of heights in and start it dry, with nothing flowing and nothing carried.
+	for(int x=0; x<m_width; x+=length)
+	{
+		span = field.GetSpan(x, y, length);
+		for(int k=0; k<length; k++)
+		{
+			m_terrain[(y * m_width) + x + k] = span[k];
+		}
+	}
+
+	index = y * m_width;
+	std::fill(m_water.begin() + index, m_water.begin() + index + m_width, 0.0f);
+	std::fill(m_sediment.begin() + index, m_sediment.begin() + index + m_width, 0.0f);
+	std::fill(m_fluxLeft.begin() + index, m_fluxLeft.begin() + index + m_width, 0.0f);
+	std::fill(m_fluxRight.begin() + index, m_fluxRight.begin() + index + m_width, 0.0f);
+	std::fill(m_fluxUp.begin() + index, m_fluxUp.begin() + index + m_width, 0.0f);
+	std::fill(m_fluxDown.begin() + index, m_fluxDown.begin() + index + m_width, 0.0f);
+
+	return;
+}
+
+
+void ErosionClass::Iterate()
+{
+	for(int i=0; i<(PASS_COUNT * m_passParts); i++)
+	{
+		IteratePart(i);
+	}
+
+	return;
+}
+
+
+int ErosionClass::GetIterationParts()
+{
+	return PASS_COUNT * m_passParts;
+}
+
+
+void ErosionClass::IteratePart(int part)
+{
+	std::chrono::high_resolution_clock::time_point start;
+	PassType pass;
+	int passPart;
+
+
+	start = std::chrono::high_resolution_clock::now();
+	if(part == 0)
+	{
+		m_iterationTime = 0.0f;
+	}
+
+	// Water first: the outflows, then the water level and what it dissolves or drops, then carry the sediment.
+	// Then let the slopes that are too steep slump. Each pass is run in parts and finishes before the next starts.
+	pass = (PassType)(part / m_passParts);
+	passPart = part % m_passParts;
+	RunPass(pass, passPart);
+
+	// The water and thermal passes write the next terrain, which takes over once every row of them is done.
+	if(((pass == PASS_WATER) || (pass == PASS_THERMAL)) && (passPart == (m_passParts - 1)))
+	{
+		m_terrain.swap(m_nextTerrain);
+	}
+
+	m_iterationTime += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return;
+}
+
+
+void ErosionClass::StoreRow(HeightFieldClass& field, int y)
+{
+	float* span;
+	int length, index;
+
+
+	// Whatever sediment the water still carries is dropped where it is.
+	for(int x=0; x<m_width; x+=length)
+	{
+		span = field.GetSpan(x, y, length);
+		for(int k=0; k<length; k++)
+		{
+			index = (y * m_width) + x + k;
+			span[k] = m_terrain[index] + m_sediment[index];
+		}
+	}
+
+	return;
+}
+
+
+float ErosionClass::GetIterationTime()
+{
+	return m_iterationTime;
+}
+
+
+void ErosionClass::RunPass(PassType pass, int part)
+{
+	// Run the part of every band on its own thread of the pool, the first band runs on this one.
+	m_threadPool->Run((int)m_bands.size(), [this, pass, part](int band) { RunBand(pass, m_bands[band], part); });
+
+	return;
+}
+
+
+void ErosionClass::RunBand(PassType pass, const BandType& band, int part)
+{
+	BandType rows;
+
+
+	// The passes work on the rows of the part as if they were a band of their own.
+	rows.rowStart = std::min(band.rowStart + (part * EROSION_PART_ROWS), band.rowEnd);
+	rows.rowEnd = std::min(rows.rowStart + EROSION_PART_ROWS, band.rowEnd);
+
+	switch(pass)
+	{
+		case PASS_FLUX:
+			FluxBand(rows);
+			break;
+		case PASS_WATER:
+			WaterBand(rows);
+			break;
+		case PASS_TRANSPORT:
+			TransportBand(rows);
+			break;
+		case PASS_TALUS:
+			TalusBand(rows);
+			break;
+		case PASS_THERMAL:
+			ThermalBand(rows);
+			break;
+	}
+
+	return;
+}
+
+
+void ErosionClass::FluxBand(const BandType& band)
+{
+	float level, depth, left, right, up, down, total, scale;
+	int index;
+
+
+	// Each pipe speeds up with the difference in water level across it, nothing flows off the map.
+	for(int y=band.rowStart; y<band.rowEnd; y++)
+	{
+		for(int x=0; x<m_width; x++)
+		{
+			index = (y * m_width) + x;
+			level = m_terrain[index] + m_water[index];
+
+			left = 0.0f;
+			right = 0.0f;
+			up = 0.0f;
+			down = 0.0f;
+
+			if(x > 0)
+			{
+				left = std::max(m_fluxLeft[index] + (EROSION_TIME_STEP * EROSION_GRAVITY * (level - m_terrain[index - 1] - m_water[index - 1])), 0.0f);
+			}
+			if(x < (m_width - 1))
+			{
+				right = std::max(m_fluxRight[index] + (EROSION_TIME_STEP * EROSION_GRAVITY * (level - m_terrain[index + 1] - m_water[index + 1])), 0.0f);
+			}
+			if(y > 0)
+			{
+				up = std::max(m_fluxUp[index] + (EROSION_TIME_STEP * EROSION_GRAVITY * (level - m_terrain[index - m_width] - m_water[index - m_width])), 0.0f);
+			}
+			if(y < (m_height - 1))
+			{
+				down = std::max(m_fluxDown[index] + (EROSION_TIME_STEP * EROSION_GRAVITY * (level - m_terrain[index + m_width] - m_water[index + m_width])), 0.0f);
+			}
+
+			// A cell can not send out more water than it has, including this step's rain.
+			depth = m_water[index] + EROSION_RAIN;
+			total = (left + right + up + down) * EROSION_TIME_STEP;
+			scale = (total > depth) ? (depth / total) : 1.0f;
+
+			m_fluxLeft[index] = left * scale;
+			m_fluxRight[index] = right * scale;
+			m_fluxUp[index] = up * scale;
+			m_fluxDown[index] = down * scale;
+		}
+	}
+
+	return;
+}
+
+
+void ErosionClass::WaterBand(const BandType& band)
+{
+	float fromLeft, fromRight, fromUp, fromDown, outflow, depth, newDepth, flowX, flowY;
+	float slopeX, slopeY, slope, tilt, capacity, sediment, amount;
+	int index, xLow, xHigh, yLow, yHigh;
+
+
+	for(int y=band.rowStart; y<band.rowEnd; y++)
+	{
+		for(int x=0; x<m_width; x++)
+		{
+			index = (y * m_width) + x;
+
+			// Move the water through the pipes.
+			fromLeft = (x > 0) ? m_fluxRight[index - 1] : 0.0f;
+			fromRight = (x < (m_width - 1)) ? m_fluxLeft[index + 1] : 0.0f;
+			fromUp = (y > 0) ? m_fluxDown[index - m_width] : 0.0f;
+			fromDown = (y < (m_height - 1)) ? m_fluxUp[index + m_width] : 0.0f;
+			outflow = m_fluxLeft[index] + m_fluxRight[index] + m_fluxUp[index] + m_fluxDown[index];
+
+			depth = m_water[index] + EROSION_RAIN;
+			newDepth = std::max(depth + (EROSION_TIME_STEP * (fromLeft + fromRight + fromUp + fromDown - outflow)), 0.0f);
+
+			// The mean flow through the cell, the water speed times its depth.
+			flowX = (fromLeft - m_fluxLeft[index] + m_fluxRight[index] - fromRight) * 0.5f;
+			flowY = (fromUp - m_fluxUp[index] + m_fluxDown[index] - fromDown) * 0.5f;
+
+			// A lot of water moving fast down a steep slope carries more. Going by the flow rather than the speed
+			// keeps the thin film left by the rain from scouring, flat ground still gets a little so lakes fill in.
+			xLow = std::max(x - 1, 0);
+			xHigh = std::min(x + 1, m_width - 1);
+			yLow = std::max(y - 1, 0);
+			yHigh = std::min(y + 1, m_height - 1);
+			slopeX = (xHigh > xLow) ? ((m_terrain[(y * m_width) + xHigh] - m_terrain[(y * m_width) + xLow]) / (float)(xHigh - xLow)) : 0.0f;
+			slopeY = (yHigh > yLow) ? ((m_terrain[(yHigh * m_width) + x] - m_terrain[(yLow * m_width) + x]) / (float)(yHigh - yLow)) : 0.0f;
+			slope = std::sqrt((slopeX * slopeX) + (slopeY * slopeY));
+			tilt = std::max(slope / std::sqrt(1.0f + (slope * slope)), EROSION_MIN_TILT);
+			capacity = EROSION_CAPACITY * tilt * std::sqrt((flowX * flowX) + (flowY * flowY));
+
+			// Dissolve ground up to the capacity, or drop what is carried over it.
+			sediment = m_sediment[index];
+			if(capacity > sediment)
+			{
+				amount = EROSION_DISSOLVE * (capacity - sediment);
+				m_nextTerrain[index] = m_terrain[index] - amount;
+				m_nextSediment[index] = sediment + amount;
+			}
+			else
+			{
+				amount = EROSION_DEPOSIT * (sediment - capacity);
+				m_nextTerrain[index] = m_terrain[index] + amount;
+				m_nextSediment[index] = sediment - amount;
+			}
+
+			// Sediment leaves with the water, this is the share of it each unit of outflow takes.
+			m_nextWater[index] = newDepth;
+			m_sedimentShare[index] = EROSION_TIME_STEP / depth;
+		}
+	}
+
+	return;
+}
+
+
+void ErosionClass::TransportBand(const BandType& band)
+{
+	float outflow, carried;
+	int index;
+
+
+	for(int y=band.rowStart; y<band.rowEnd; y++)
+	{
+		for(int x=0; x<m_width; x++)
+		{
+			index = (y * m_width) + x;
+
+			// Send sediment down the same pipes as the water and take in what the neighbours send this way.
+			outflow = m_fluxLeft[index] + m_fluxRight[index] + m_fluxUp[index] + m_fluxDown[index];
+			carried = m_nextSediment[index] * (1.0f - (outflow * m_sedimentShare[index]));
+
+			if(x > 0)
+			{
+				carried += m_nextSediment[index - 1] * m_fluxRight[index - 1] * m_sedimentShare[index - 1];
+			}
+			if(x < (m_width - 1))
+			{
+				carried += m_nextSediment[index + 1] * m_fluxLeft[index + 1] * m_sedimentShare[index + 1];
+			}
+			if(y > 0)
+			{
+				carried += m_nextSediment[index - m_width] * m_fluxDown[index - m_width] * m_sedimentShare[index - m_width];
+			}
+			if(y < (m_height - 1))
+			{
+				carried += m_nextSediment[index + m_width] * m_fluxUp[index + m_width] * m_sedimentShare[index + m_width];
+			}
+
+			m_sediment[index] = carried;
+
+			// Some of the water dries up every iteration.
+			m_water[index] = m_nextWater[index] * (1.0f - EROSION_EVAPORATION);
+		}
+	}
+
+	return;
+}
+
+
+void ErosionClass::TalusBand(const BandType& band)
+{
+	float height, difference, steepest, total;
+	int index, nx, ny;
+
+
+	// Work out how much of each cell slides and what share of it goes per unit of drop, the rest is done by the gather.
+	for(int y=band.rowStart; y<band.rowEnd; y++)
+	{
+		for(int x=0; x<m_width; x++)
+		{
+			index = (y * m_width) + x;
+			height = m_terrain[index];
+			steepest = 0.0f;
+			total = 0.0f;
+
+			for(int k=0; k<8; k++)
+			{
+				nx = x + NEIGHBOUR_X[k];
+				ny = y + NEIGHBOUR_Y[k];
+				if((nx < 0) || (ny < 0) || (nx >= m_width) || (ny >= m_height))
+				{
+					continue;
+				}
+
+				difference = height - m_terrain[(ny * m_width) + nx];
+				if(difference > THERMAL_TALUS)
+				{
+					total += difference;
+					steepest = std::max(steepest, difference);
+				}
+			}
+
+			m_talus[index] = (total > 0.0f) ? ((THERMAL_RATE * (steepest - THERMAL_TALUS)) / total) : 0.0f;
+		}
+	}
+
+	return;
+}
+
+
+void ErosionClass::ThermalBand(const BandType& band)
+{
+	float height, difference, moved;
+	int index, neighbour, nx, ny;
+
+
+	// Every cell takes in what slides off the neighbours above it and loses what slides to those below, so nothing is lost.
+	for(int y=band.rowStart; y<band.rowEnd; y++)
+	{
+		for(int x=0; x<m_width; x++)
+		{
+			index = (y * m_width) + x;
+			height = m_terrain[index];
+			moved = 0.0f;
+
+			for(int k=0; k<8; k++)
+			{
+				nx = x + NEIGHBOUR_X[k];
+				ny = y + NEIGHBOUR_Y[k];
+				if((nx < 0) || (ny < 0) || (nx >= m_width) || (ny >= m_height))
+				{
+					continue;
+				}
+
+				neighbour = (ny * m_width) + nx;
+				difference = m_terrain[neighbour] - height;
+				if(difference > THERMAL_TALUS)
+				{
+					moved += m_talus[neighbour] * difference;
+				}
+				else if(-difference > THERMAL_TALUS)
+				{
+					moved += m_talus[index] * difference;
+				}
+			}
+
+			m_nextTerrain[index] = height + moved;
+		}
+	}
+
+	return;
+}
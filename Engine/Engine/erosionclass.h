@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: erosionclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _EROSIONCLASS_H_
+#define _EROSIONCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "heightfieldclass.h"
+#include "threadpoolclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int EROSION_ITERATIONS = 200;
+const int MAX_EROSION_ITERATIONS = 2000;
+const float EROSION_TIME_STEP = 0.05f;
+const float EROSION_GRAVITY = 9.81f;
+const float EROSION_RAIN = 0.01f;
+const float EROSION_EVAPORATION = 0.02f;
+const float EROSION_CAPACITY = 1.0f;
+const float EROSION_DISSOLVE = 0.3f;
+const float EROSION_DEPOSIT = 0.3f;
+const float EROSION_MIN_TILT = 0.05f;
+const float THERMAL_TALUS = 1.0f;
+const float THERMAL_RATE = 0.25f;
+const int EROSION_PART_ROWS = 16;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ErosionClass
+////////////////////////////////////////////////////////////////////////////////
+// Wears a height field down with rain and with slumping. The water is the pipe
+// model: every cell keeps an outflow to each of its four neighbours, driven by
+// the difference in water level, and the flow of the water sets how much
+// sediment it can carry, dissolving or dropping ground to match. Sediment leaves
+// a cell through the pipes in step with the water, so none is lost. Thermal
+// erosion then moves ground off any slope steeper than the talus to the cells
+// below it. Each iteration is a few passes over bands of rows, one band per
+// thread of the pool Initialize is given. A pass only reads what the passes
+// before it wrote and writes its own planes, so the result does not depend on
+// the thread count. An iteration can be run a part at a time, one pass over
+// EROSION_PART_ROWS rows of every band, for callers that have to stop when their
+// time is up.
+class ErosionClass
+{
+private:
+	struct BandType
+	{
+		int rowStart, rowEnd;
+	};
+
+	enum PassType
+	{
+		PASS_FLUX,
+		PASS_WATER,
+		PASS_TRANSPORT,
+		PASS_TALUS,
+		PASS_THERMAL
+	};
+
+public:
+	ErosionClass();
+	ErosionClass(const ErosionClass&);
+	~ErosionClass();
+
+	bool Initialize(int width, int height, ThreadPoolClass* threadPool);
+	void Shutdown();
+
+	void LoadRow(const HeightFieldClass& field, int y);
+	void Iterate();
+	int GetIterationParts();
+	void IteratePart(int part);
+	void StoreRow(HeightFieldClass& field, int y);
+
+	float GetIterationTime();
+
+private:
+	void RunPass(PassType pass, int part);
+	void RunBand(PassType pass, const BandType& band, int part);
+	void FluxBand(const BandType& band);
+	void WaterBand(const BandType& band);
+	void TransportBand(const BandType& band);
+	void TalusBand(const BandType& band);
+	void ThermalBand(const BandType& band);
+
+private:
+	int m_width, m_height;
+	std::vector<BandType> m_bands;
+	int m_passParts;
+	std::vector<float> m_terrain, m_nextTerrain;
+	std::vector<float> m_water, m_nextWater;
+	std::vector<float> m_sediment, m_nextSediment;
+	std::vector<float> m_fluxLeft, m_fluxRight, m_fluxUp, m_fluxDown;
+	std::vector<float> m_sedimentShare;
+	std::vector<float> m_talus;
+	float m_iterationTime;
+	ThreadPoolClass* m_threadPool;
+};
+
+#endif
@@ -25,6 +25,11 @@ void FpsClass::Initialize()
 	m_fps = 0;
 	m_count = 0;
 	m_startTime = timeGetTime();
+
+	// Initialize the frame time tracking.
+	m_lastFrameTime = m_startTime;
+	m_slowestFrame = 0;
+	m_worstFrameTime = 0;
 	
 	return;
 }
@@ -32,13 +37,27 @@ void FpsClass::Initialize()
 
 void FpsClass::Frame()
 {
+	unsigned long currentTime;
+
+
 	m_count++;
 
+	// Keep the longest frame of this second, the frame rate alone hides single slow frames.
+	currentTime = timeGetTime();
+	if((currentTime - m_lastFrameTime) > m_slowestFrame)
+	{
+		m_slowestFrame = currentTime - m_lastFrameTime;
+	}
+	m_lastFrameTime = currentTime;
+
 	// If one second has passed then update the frame per second speed.
 	if(timeGetTime() >= (m_startTime + 1000))
 	{
 		m_fps = m_count;
 		m_count = 0;
+
+		m_worstFrameTime = m_slowestFrame;
+		m_slowestFrame = 0;
 		
 		m_startTime = timeGetTime();
 	}
@@ -48,4 +67,10 @@ void FpsClass::Frame()
 int FpsClass::GetFps()
 {
 	return m_fps;
+}
+
+
+int FpsClass::GetWorstFrameTime()
+{
+	return (int)m_worstFrameTime;
 }
\ No newline at end of file
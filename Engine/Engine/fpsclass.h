@@ -31,10 +31,12 @@ public:
 	void Initialize();
 	void Frame();
 	int GetFps();
+	int GetWorstFrameTime();
 
 private:
 	int m_fps, m_count;
 	unsigned long m_startTime;
+	unsigned long m_lastFrameTime, m_slowestFrame, m_worstFrameTime;
 };
 
 #endif
\ No newline at end of file
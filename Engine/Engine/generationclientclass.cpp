@@ -0,0 +1,362 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: generationclientclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "generationclientclass.h"
+#include <cstring>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+
+GenerationClientClass::GenerationClientClass()
+{
+	m_DiskCache = 0;
+	m_cacheVersion = 0;
+	m_nextId = 0;
+	m_terrainWidth = 0;
+	m_terrainHeight = 0;
+
+#ifdef _WIN32
+	m_pipe = INVALID_HANDLE_VALUE;
+#else
+	m_socket = -1;
+#endif
+}
+
+
+GenerationClientClass::GenerationClientClass(const GenerationClientClass& other)
+{
+}
+
+
+GenerationClientClass::~GenerationClientClass()
+{
+}
+
+
+bool GenerationClientClass::Initialize(const char* name, const char* cacheDirectory)
+{
+	std::string path;
+
+
+	m_cacheDirectory = cacheDirectory;
+
+	// Connect to the service by the name it was started with.
+#ifdef _WIN32
+	path = std::string("\\\\.\\pipe\\") + name;
+
+	// Every instance of the pipe may be taken for a moment, so wait for one to come free.
+	while(true)
+	{
+		m_pipe = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+		if(m_pipe != INVALID_HANDLE_VALUE)
+		{
+			break;
+		}
+
+		if((GetLastError() != ERROR_PIPE_BUSY) || !WaitNamedPipeA(path.c_str(), 5000))
+		{
+			return false;
+		}
+	}
+#else
+	struct sockaddr_un address;
+
+	path = std::string("/tmp/") + name + ".sock";
+	if(path.size() >= sizeof(address.sun_path))
+	{
+		return false;
+	}
+
+	m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(m_socket == -1)
+	{
+		return false;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path.c_str());
+
+	if(connect(m_socket, (struct sockaddr*)&address, sizeof(address)) != 0)
+	{
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+
+void GenerationClientClass::Shutdown()
+{
+	if(m_DiskCache)
+	{
+		m_DiskCache->Shutdown();
+		delete m_DiskCache;
+		m_DiskCache = 0;
+	}
+
+#ifdef _WIN32
+	if(m_pipe != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_pipe);
+		m_pipe = INVALID_HANDLE_VALUE;
+	}
+#else
+	if(m_socket != -1)
+	{
+		close(m_socket);
+		m_socket = -1;
+	}
+#endif
+
+	return;
+}
+
+
+bool GenerationClientClass::Generate(const generationOperationData* operations, int operationCount, unsigned long long& key)
+{
+	generationRequestData request;
+	generationResponseData response;
+
+
+	if((operationCount < 1) || (operationCount > GENERATION_MAX_OPERATIONS))
+	{
+		return false;
+	}
+
+	memset(&request, 0, sizeof(request));
+	request.message = GENERATION_MESSAGE_GENERATE;
+	request.operationCount = operationCount;
+	memcpy(request.operations, operations, operationCount * sizeof(generationOperationData));
+
+	if(!Send(request, response) || (response.status != GENERATION_STATUS_OK))
+	{
+		return false;
+	}
+
+	key = response.key;
+
+	return true;
+}
+
+
+bool GenerationClientClass::FetchTile(unsigned long long key, int x, int y, int width, int height, std::vector<float>& heights)
+{
+	return Fetch(GENERATION_MESSAGE_FETCH_TILE, key, x, y, width, height, 1, heights);
+}
+
+
+bool GenerationClientClass::FetchChunk(unsigned long long key, int x, int y, int width, int height, std::vector<float>& cells)
+{
+	return Fetch(GENERATION_MESSAGE_FETCH_CHUNK, key, x, y, width, height, 4, cells);
+}
+
+
+bool GenerationClientClass::FetchDelta(unsigned long long baseKey, unsigned long long key, TerrainDeltaClass& delta)
+{
+	generationRequestData request;
+	generationResponseData response;
+
+
+	memset(&request, 0, sizeof(request));
+	request.message = GENERATION_MESSAGE_FETCH_DELTA;
+	request.key = key;
+	request.baseKey = baseKey;
+
+	if(!Send(request, response) || (response.status != GENERATION_STATUS_OK) || (response.size <= 0))
+	{
+		return false;
+	}
+
+	delta.GetData().resize((size_t)response.size);
+
+	return ReadAll(&delta.GetData()[0], (int)response.size);
+}
+
+
+const unsigned char* GenerationClientClass::Map(unsigned long long key, long long& size)
+{
+	bool result;
+
+
+	// The cache is opened to read once the service has said which version it writes, evicting is left to the service.
+	if(!m_DiskCache)
+	{
+		if(m_cacheVersion == 0)
+		{
+			return 0;
+		}
+
+		m_DiskCache = new DiskCacheClass;
+		if(!m_DiskCache)
+		{
+			return 0;
+		}
+
+		result = m_DiskCache->Initialize(m_cacheDirectory.c_str(), 0, m_cacheVersion);
+		if(!result)
+		{
+			delete m_DiskCache;
+			m_DiskCache = 0;
+			return 0;
+		}
+	}
+
+	return m_DiskCache->Map(key, size);
+}
+
+
+void GenerationClientClass::Unmap()
+{
+	if(m_DiskCache)
+	{
+		m_DiskCache->Unmap();
+	}
+
+	return;
+}
+
+
+int GenerationClientClass::GetTerrainWidth()
+{
+	return m_terrainWidth;
+}
+
+
+int GenerationClientClass::GetTerrainHeight()
+{
+	return m_terrainHeight;
+}
+
+
+bool GenerationClientClass::Send(generationRequestData& request, generationResponseData& response)
+{
+	request.magic = GENERATION_MESSAGE_MAGIC;
+	request.id = m_nextId++;
+
+	if(!WriteAll(&request, sizeof(request)) || !ReadAll(&response, sizeof(response)))
+	{
+		return false;
+	}
+
+	if((response.magic != GENERATION_MESSAGE_MAGIC) || (response.id != request.id))
+	{
+		return false;
+	}
+
+	m_cacheVersion = response.cacheVersion;
+	m_terrainWidth = response.terrainWidth;
+	m_terrainHeight = response.terrainHeight;
+
+	return true;
+}
+
+
+bool GenerationClientClass::Fetch(int message, unsigned long long key, int x, int y, int width, int height, int cellFloats, std::vector<float>& output)
+{
+	generationRequestData request;
+	generationResponseData response;
+
+
+	memset(&request, 0, sizeof(request));
+	request.message = message;
+	request.key = key;
+	request.x = x;
+	request.y = y;
+	request.width = width;
+	request.height = height;
+
+	if(!Send(request, response) || (response.status != GENERATION_STATUS_OK))
+	{
+		return false;
+	}
+
+	// The cells follow the answer, a row at a time.
+	if(response.size != ((long long)width * height * cellFloats * (long long)sizeof(float)))
+	{
+		return false;
+	}
+
+	output.resize(width * height * cellFloats);
+
+	return ReadAll(&output[0], (int)response.size);
+}
+
+
+bool GenerationClientClass::ReadAll(void* data, int size)
+{
+	char* output;
+
+
+	output = (char*)data;
+	while(size > 0)
+	{
+#ifdef _WIN32
+		DWORD bytesRead;
+
+		if(!ReadFile(m_pipe, output, size, &bytesRead, NULL) || (bytesRead == 0))
+		{
+			return false;
+		}
+#else
+		ssize_t bytesRead;
+
+		bytesRead = recv(m_socket, output, size, 0);
+		if((bytesRead == -1) && (errno == EINTR))
+		{
+			continue;
+		}
+		if(bytesRead <= 0)
+		{
+			return false;
+		}
+#endif
+
+		output += bytesRead;
+		size -= (int)bytesRead;
+	}
+
+	return true;
+}
+
+
+bool GenerationClientClass::WriteAll(const void* data, int size)
+{
+	const char* input;
+
+
+	input = (const char*)data;
+	while(size > 0)
+	{
+#ifdef _WIN32
+		DWORD bytesWritten;
+
+		if(!WriteFile(m_pipe, input, size, &bytesWritten, NULL))
+		{
+			return false;
+		}
+#else
+		ssize_t bytesWritten;
+
+		bytesWritten = send(m_socket, input, size, MSG_NOSIGNAL);
+		if((bytesWritten == -1) && (errno == EINTR))
+		{
+			continue;
+		}
+		if(bytesWritten <= 0)
+		{
+			return false;
+		}
+#endif
+
+		input += bytesWritten;
+		size -= (int)bytesWritten;
+	}
+
+	return true;
+}
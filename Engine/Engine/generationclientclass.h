@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: generationclientclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _GENERATIONCLIENTCLASS_H_
+#define _GENERATIONCLIENTCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <vector>
+#include <string>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "diskcacheclass.h"
+#include "terraindeltaclass.h"
+#include "generationmessagedata.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: GenerationClientClass
+////////////////////////////////////////////////////////////////////////////////
+// The other end of GenerationServiceClass, for processes that want terrains
+// without making them. It needs nothing of the renderer, only this, the message
+// structs, TerrainDeltaClass and DiskCacheClass, which maps a generated terrain
+// straight out of the service's cache directory. Calls block until the answer
+// is in, so a process that wants several at once opens a connection for each.
+class GenerationClientClass
+{
+public:
+	GenerationClientClass();
+	GenerationClientClass(const GenerationClientClass&);
+	~GenerationClientClass();
+
+	bool Initialize(const char* name, const char* cacheDirectory);
+	void Shutdown();
+
+	bool Generate(const generationOperationData* operations, int operationCount, unsigned long long& key);
+	bool FetchTile(unsigned long long key, int x, int y, int width, int height, std::vector<float>& heights);
+	bool FetchChunk(unsigned long long key, int x, int y, int width, int height, std::vector<float>& cells);
+	bool FetchDelta(unsigned long long baseKey, unsigned long long key, TerrainDeltaClass& delta);
+	const unsigned char* Map(unsigned long long key, long long& size);
+	void Unmap();
+
+	int GetTerrainWidth();
+	int GetTerrainHeight();
+
+private:
+	bool Send(generationRequestData& request, generationResponseData& response);
+	bool Fetch(int message, unsigned long long key, int x, int y, int width, int height, int cellFloats, std::vector<float>& output);
+	bool ReadAll(void* data, int size);
+	bool WriteAll(const void* data, int size);
+
+private:
+	std::string m_cacheDirectory;
+	DiskCacheClass* m_DiskCache;
+	unsigned int m_cacheVersion;
+	unsigned int m_nextId;
+	int m_terrainWidth, m_terrainHeight;
+
+#ifdef _WIN32
+	HANDLE m_pipe;
+#else
+	int m_socket;
+#endif
+};
+
+#endif
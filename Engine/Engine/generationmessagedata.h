@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: generationmessagedata.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _GENERATIONMESSAGEDATA_H_
+#define _GENERATIONMESSAGEDATA_H_
+
+
+/////////////
+// GLOBALS //
+/////////////
+const unsigned int GENERATION_MESSAGE_MAGIC = 0x4D474744;
+const int GENERATION_MAX_OPERATIONS = 8;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Enum name: generationMessageType
+////////////////////////////////////////////////////////////////////////////////
+// What a request asks the generation service for. A generate request answers
+// with the key of the finished terrain in the disk cache, the fetches answer
+// with part of a terrain already made, the heights alone or the heights and
+// normals of every cell. A delta answers with a TerrainDeltaClass from the
+// terrain of the base key to that of the key.
+enum generationMessageType
+{
+	GENERATION_MESSAGE_GENERATE,
+	GENERATION_MESSAGE_FETCH_TILE,
+	GENERATION_MESSAGE_FETCH_CHUNK,
+	GENERATION_MESSAGE_FETCH_DELTA
+};
+
+enum generationStatusType
+{
+	GENERATION_STATUS_OK,
+	GENERATION_STATUS_BAD_REQUEST,
+	GENERATION_STATUS_FAILED,
+	GENERATION_STATUS_NOT_FOUND
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Struct name: generationOperationData
+////////////////////////////////////////////////////////////////////////////////
+// One operation of a recipe, applied to the flat starting terrain in order. The
+// types are numbered as in TerrainClass: random field, smooth, perlin, dungeon,
+// cave and erosion. A smoothing operation takes its number of passes from runs.
+struct generationOperationData
+{
+	int type;
+	int runs;
+	unsigned int seed;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Struct name: generationRequestData
+////////////////////////////////////////////////////////////////////////////////
+// Sent as is by the client. A generate request fills the operations, a fetch
+// the key and the rectangle of cells, and a delta the key and the base key.
+struct generationRequestData
+{
+	unsigned int magic;
+	int message;
+	unsigned int id;
+	int operationCount;
+	generationOperationData operations[GENERATION_MAX_OPERATIONS];
+	unsigned long long key, baseKey;
+	int x, y, width, height;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Struct name: generationResponseData
+////////////////////////////////////////////////////////////////////////////////
+// Sent back for every request, followed by size bytes for a fetch. For a
+// generate request size is that of the blob in the cache, which the client can
+// map itself rather than have it sent.
+struct generationResponseData
+{
+	unsigned int magic;
+	unsigned int id;
+	int status;
+	unsigned int cacheVersion;
+	int terrainWidth, terrainHeight;
+	unsigned long long key;
+	long long size;
+};
+
+#endif
@@ -0,0 +1,843 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: generationserviceclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "generationserviceclass.h"
+#include <cstring>
+#include <climits>
+#include <chrono>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+
+GenerationServiceClass::GenerationServiceClass()
+{
+	m_terrainWidth = 0;
+	m_terrainHeight = 0;
+	m_DiskCache = 0;
+	m_requestCount = 0;
+	m_coalescedCount = 0;
+	m_generatedCount = 0;
+	m_connectionCount = 0;
+	m_listening = false;
+	m_quit = false;
+
+#ifdef _WIN32
+	m_listenPipe = INVALID_HANDLE_VALUE;
+#else
+	m_listenSocket = -1;
+#endif
+}
+
+
+GenerationServiceClass::GenerationServiceClass(const GenerationServiceClass& other)
+{
+}
+
+
+GenerationServiceClass::~GenerationServiceClass()
+{
+}
+
+
+bool GenerationServiceClass::Initialize(const char* name, int terrainWidth, int terrainHeight, int workerCount)
+{
+	WorkerType worker;
+	bool result;
+
+
+	m_terrainWidth = terrainWidth;
+	m_terrainHeight = terrainHeight;
+
+	// Finished terrains go in the same cache the engine keeps its own in, which the clients map them from.
+	m_DiskCache = new DiskCacheClass;
+	if(!m_DiskCache)
+	{
+		return false;
+	}
+
+	result = m_DiskCache->Initialize(DISK_CACHE_DIRECTORY, DISK_CACHE_SIZE, DISK_CACHE_VERSION);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the worker terrains, each generates on a thread of its own. They are never drawn, so they are
+	// made without a device and hold no textures or buffers.
+	for(int i=0; i<workerCount; i++)
+	{
+		worker.terrain = new TerrainClass;
+		if(!worker.terrain)
+		{
+			return false;
+		}
+
+		worker.key = 0;
+		worker.busy = false;
+		m_workers.push_back(worker);
+
+		result = worker.terrain->InitializeTerrain(0, terrainWidth, terrainHeight, 0, 0, 0);
+		if(!result)
+		{
+			return false;
+		}
+	}
+
+	// Take the name, failing if another service already has it.
+#ifdef _WIN32
+	m_name = std::string("\\\\.\\pipe\\") + name;
+
+	m_listenPipe = CreateNamedPipeA(m_name.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, GENERATION_MAX_CONNECTIONS, 64 * 1024, 64 * 1024, 0, NULL);
+	if(m_listenPipe == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+#else
+	struct sockaddr_un address;
+
+	m_name = std::string("/tmp/") + name + ".sock";
+	if(m_name.size() >= sizeof(address.sun_path))
+	{
+		return false;
+	}
+
+	m_listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(m_listenSocket == -1)
+	{
+		return false;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, m_name.c_str());
+
+	// A service that answers has the name, a socket file nobody answers on was left by one that did not shut down.
+	if(connect(m_listenSocket, (struct sockaddr*)&address, sizeof(address)) == 0)
+	{
+		return false;
+	}
+	close(m_listenSocket);
+	unlink(m_name.c_str());
+
+	m_listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(m_listenSocket == -1)
+	{
+		return false;
+	}
+
+	if((bind(m_listenSocket, (struct sockaddr*)&address, sizeof(address)) != 0) || (listen(m_listenSocket, 64) != 0))
+	{
+		return false;
+	}
+#endif
+
+	m_listening = true;
+	m_listenThread = std::thread(&GenerationServiceClass::ListenThread, this);
+
+	return true;
+}
+
+
+void GenerationServiceClass::Shutdown()
+{
+	std::list<ConnectionType>::iterator connection;
+	bool listening;
+
+
+	// Wake everything waiting on a job, then the thread waiting for connections.
+	m_jobMutex.lock();
+	m_quit = true;
+	listening = m_listening;
+	m_jobMutex.unlock();
+	m_jobCondition.notify_all();
+	m_connectionCondition.notify_all();
+
+	while(listening)
+	{
+#ifdef _WIN32
+		HANDLE pipe;
+
+		// Connecting is the only way to wake a waiting ConnectNamedPipe, and there may be a moment with no pipe to connect to.
+		pipe = CreateFileA(m_name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+		if(pipe != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(pipe);
+		}
+#else
+		shutdown(m_listenSocket, SHUT_RDWR);
+#endif
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		m_jobMutex.lock();
+		listening = m_listening;
+		m_jobMutex.unlock();
+	}
+
+	if(m_listenThread.joinable())
+	{
+		m_listenThread.join();
+#ifndef _WIN32
+		unlink(m_name.c_str());
+#endif
+	}
+
+#ifdef _WIN32
+	if(m_listenPipe != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_listenPipe);
+		m_listenPipe = INVALID_HANDLE_VALUE;
+	}
+#else
+	if(m_listenSocket != -1)
+	{
+		close(m_listenSocket);
+		m_listenSocket = -1;
+	}
+#endif
+
+	// Break off the connections still open, a thread blocked reading one fails out of the read.
+	for(connection = m_connections.begin(); connection != m_connections.end(); ++connection)
+	{
+#ifdef _WIN32
+		bool finished;
+
+		DisconnectNamedPipe(connection->pipe);
+		do
+		{
+			CancelSynchronousIo(connection->thread.native_handle());
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			m_jobMutex.lock();
+			finished = connection->finished;
+			m_jobMutex.unlock();
+		}
+		while(!finished);
+#else
+		shutdown(connection->socket, SHUT_RDWR);
+#endif
+
+		connection->thread.join();
+		CloseConnection(&(*connection));
+	}
+	m_connections.clear();
+
+	// Release the worker terrains and the cache.
+	for(unsigned int i=0; i<m_workers.size(); i++)
+	{
+		if(m_workers[i].terrain)
+		{
+			m_workers[i].terrain->Shutdown();
+			delete m_workers[i].terrain;
+		}
+	}
+	std::vector<WorkerType>().swap(m_workers);
+
+	if(m_DiskCache)
+	{
+		m_DiskCache->Shutdown();
+		delete m_DiskCache;
+		m_DiskCache = 0;
+	}
+
+	m_jobs.clear();
+	m_queue.clear();
+	std::vector<unsigned char>().swap(m_packedTerrain);
+
+	return;
+}
+
+
+void GenerationServiceClass::Frame(int budget)
+{
+	std::map<unsigned long long, JobType>::iterator job;
+	bool result;
+
+
+	// Put away what the workers have finished. Packing reads the shown terrain, so it is done here on the frame thread.
+	for(unsigned int i=0; i<m_workers.size(); i++)
+	{
+		if(!m_workers[i].busy)
+		{
+			continue;
+		}
+
+		m_workers[i].terrain->UpdateGeneration(budget);
+		if(m_workers[i].terrain->IsGenerating())
+		{
+			continue;
+		}
+
+		result = m_workers[i].terrain->PackTerrain(m_packedTerrain);
+		if(result)
+		{
+			result = m_DiskCache->Store(m_workers[i].key, m_packedTerrain);
+		}
+
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		job = m_jobs.find(m_workers[i].key);
+		if(job != m_jobs.end())
+		{
+			job->second.done = true;
+			job->second.status = result ? GENERATION_STATUS_OK : GENERATION_STATUS_FAILED;
+		}
+		m_generatedCount++;
+		m_workers[i].busy = false;
+		m_jobCondition.notify_all();
+	}
+
+	// Hand out as much of the queue as there are idle workers for.
+	std::lock_guard<std::mutex> lock(m_jobMutex);
+	for(unsigned int i=0; (i<m_workers.size()) && !m_queue.empty(); i++)
+	{
+		if(m_workers[i].busy)
+		{
+			continue;
+		}
+
+		job = m_jobs.find(m_queue.front());
+		m_queue.pop_front();
+		if(job == m_jobs.end())
+		{
+			continue;
+		}
+
+		result = m_workers[i].terrain->RequestRecipe(0, &job->second.operations[0], (int)job->second.operations.size());
+		if(!result)
+		{
+			job->second.done = true;
+			job->second.status = GENERATION_STATUS_BAD_REQUEST;
+			m_jobCondition.notify_all();
+			continue;
+		}
+
+		m_workers[i].key = job->first;
+		m_workers[i].busy = true;
+	}
+
+	return;
+}
+
+
+int GenerationServiceClass::GetRequestCount()
+{
+	std::lock_guard<std::mutex> lock(m_jobMutex);
+
+
+	return m_requestCount;
+}
+
+
+int GenerationServiceClass::GetCoalescedCount()
+{
+	std::lock_guard<std::mutex> lock(m_jobMutex);
+
+
+	return m_coalescedCount;
+}
+
+
+int GenerationServiceClass::GetGeneratedCount()
+{
+	std::lock_guard<std::mutex> lock(m_jobMutex);
+
+
+	return m_generatedCount;
+}
+
+
+void GenerationServiceClass::ListenThread()
+{
+	std::list<ConnectionType>::iterator connection;
+	bool connected, retry;
+
+
+	while(true)
+	{
+		// Wait for a free place, letting go of the connections that have closed meanwhile. Their pipes are
+		// closed before a new one is made, so there are never more than the most instances asked for.
+		{
+			std::unique_lock<std::mutex> lock(m_jobMutex);
+			m_connectionCondition.wait(lock, [&] { return m_quit || (m_connectionCount < GENERATION_MAX_CONNECTIONS); });
+
+			connection = m_connections.begin();
+			while(connection != m_connections.end())
+			{
+				if(connection->finished)
+				{
+					connection->thread.join();
+					CloseConnection(&(*connection));
+					connection = m_connections.erase(connection);
+				}
+				else
+				{
+					++connection;
+				}
+			}
+
+			if(m_quit)
+			{
+				break;
+			}
+		}
+
+#ifdef _WIN32
+		HANDLE client;
+
+		// The first instance of the pipe was made by Initialize, every connection takes one and leaves a new one.
+		client = m_listenPipe;
+		m_listenPipe = INVALID_HANDLE_VALUE;
+		if(client == INVALID_HANDLE_VALUE)
+		{
+			client = CreateNamedPipeA(m_name.c_str(), PIPE_ACCESS_DUPLEX, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, GENERATION_MAX_CONNECTIONS, 64 * 1024, 64 * 1024, 0, NULL);
+		}
+
+		connected = (client != INVALID_HANDLE_VALUE) && (ConnectNamedPipe(client, NULL) || (GetLastError() == ERROR_PIPE_CONNECTED));
+		retry = (client != INVALID_HANDLE_VALUE);
+		if(!connected && retry)
+		{
+			CloseHandle(client);
+		}
+#else
+		int client;
+
+		client = accept(m_listenSocket, 0, 0);
+		connected = (client != -1);
+		retry = connected || (errno == EINTR) || (errno == ECONNABORTED);
+#endif
+
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+
+		// A connection made to wake this thread up is dropped.
+		if(m_quit || !connected)
+		{
+			if(connected)
+			{
+#ifdef _WIN32
+				CloseHandle(client);
+#else
+				close(client);
+#endif
+			}
+
+			if(m_quit || !retry)
+			{
+				break;
+			}
+			continue;
+		}
+
+		m_connectionCount++;
+		m_connections.push_back(ConnectionType());
+#ifdef _WIN32
+		m_connections.back().pipe = client;
+#else
+		m_connections.back().socket = client;
+#endif
+		m_connections.back().finished = false;
+		m_connections.back().thread = std::thread(&GenerationServiceClass::ConnectionThread, this, &m_connections.back());
+	}
+
+	std::lock_guard<std::mutex> lock(m_jobMutex);
+	m_listening = false;
+
+	return;
+}
+
+
+void GenerationServiceClass::ConnectionThread(ConnectionType* connection)
+{
+	generationRequestData request;
+	generationResponseData response;
+	DiskCacheClass cache, baseCache;
+	TerrainDeltaClass delta;
+	bool result;
+
+
+	// Every connection maps the finished terrains through caches of its own, a second for the base of a delta.
+	result = cache.Initialize(DISK_CACHE_DIRECTORY, 0, DISK_CACHE_VERSION) && baseCache.Initialize(DISK_CACHE_DIRECTORY, 0, DISK_CACHE_VERSION);
+
+	while(result)
+	{
+		result = ReadAll(connection, &request, sizeof(request));
+		if(!result || (request.magic != GENERATION_MESSAGE_MAGIC))
+		{
+			break;
+		}
+
+		memset(&response, 0, sizeof(response));
+		response.magic = GENERATION_MESSAGE_MAGIC;
+		response.id = request.id;
+		response.cacheVersion = DISK_CACHE_VERSION;
+		response.terrainWidth = m_terrainWidth;
+		response.terrainHeight = m_terrainHeight;
+
+		switch(request.message)
+		{
+			case GENERATION_MESSAGE_GENERATE:
+				Generate(request, response, cache);
+				result = WriteAll(connection, &response, sizeof(response));
+				break;
+			case GENERATION_MESSAGE_FETCH_TILE:
+			case GENERATION_MESSAGE_FETCH_CHUNK:
+				result = Fetch(connection, request, response, cache);
+				break;
+			case GENERATION_MESSAGE_FETCH_DELTA:
+				result = FetchDelta(connection, request, response, cache, baseCache, delta);
+				break;
+			default:
+				response.status = GENERATION_STATUS_BAD_REQUEST;
+				result = WriteAll(connection, &response, sizeof(response));
+				break;
+		}
+	}
+
+	cache.Shutdown();
+	baseCache.Shutdown();
+
+	std::lock_guard<std::mutex> lock(m_jobMutex);
+	connection->finished = true;
+	m_connectionCount--;
+	m_connectionCondition.notify_one();
+
+	return;
+}
+
+
+bool GenerationServiceClass::Generate(const generationRequestData& request, generationResponseData& response, DiskCacheClass& cache)
+{
+	std::map<unsigned long long, JobType>::iterator job;
+	const unsigned char* data;
+	long long size;
+	unsigned int seed;
+	int status, runs;
+
+
+	if((request.operationCount < 1) || (request.operationCount > GENERATION_MAX_OPERATIONS))
+	{
+		response.status = GENERATION_STATUS_BAD_REQUEST;
+		return false;
+	}
+
+	// Turn away what the terrain would, before it is keyed or queued.
+	for(int i=0; i<request.operationCount; i++)
+	{
+		runs = request.operations[i].runs;
+		seed = request.operations[i].seed;
+		if(!TerrainClass::NormalizeOperation(request.operations[i].type, runs, seed))
+		{
+			response.status = GENERATION_STATUS_BAD_REQUEST;
+			return false;
+		}
+	}
+
+	response.key = GetKey(request);
+
+	// A recipe made before, by this run or any other, is answered from the cache without queueing.
+	data = cache.Map(response.key, size);
+	if(data)
+	{
+		cache.Unmap();
+
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_requestCount++;
+		response.size = size;
+		response.status = GENERATION_STATUS_OK;
+		return true;
+	}
+
+	// Join the job for this recipe if there is one, or queue a new one, then wait for it to be made.
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	m_requestCount++;
+
+	job = m_jobs.find(response.key);
+	if(job == m_jobs.end())
+	{
+		job = m_jobs.insert(std::make_pair(response.key, JobType())).first;
+		job->second.operations.assign(request.operations, request.operations + request.operationCount);
+		job->second.waiters = 0;
+		job->second.done = false;
+		job->second.status = GENERATION_STATUS_FAILED;
+		m_queue.push_back(response.key);
+	}
+	else
+	{
+		m_coalescedCount++;
+	}
+
+	job->second.waiters++;
+	m_jobCondition.wait(lock, [&] { return job->second.done || m_quit; });
+
+	status = job->second.done ? job->second.status : GENERATION_STATUS_FAILED;
+
+	// The last one waiting on a finished job lets go of it.
+	job->second.waiters--;
+	if(job->second.done && (job->second.waiters == 0))
+	{
+		m_jobs.erase(job);
+	}
+	lock.unlock();
+
+	if(status != GENERATION_STATUS_OK)
+	{
+		response.status = status;
+		return false;
+	}
+
+	data = cache.Map(response.key, size);
+	if(!data)
+	{
+		response.status = GENERATION_STATUS_FAILED;
+		return false;
+	}
+	cache.Unmap();
+
+	response.size = size;
+	response.status = GENERATION_STATUS_OK;
+
+	return true;
+}
+
+
+bool GenerationServiceClass::Fetch(ConnectionType* connection, const generationRequestData& request, generationResponseData& response, DiskCacheClass& cache)
+{
+	std::vector<float> heights;
+	const unsigned char* data;
+	const unsigned char* row;
+	long long size;
+	int cellSize;
+	bool result;
+
+
+	response.key = request.key;
+
+	// The rectangle has to lie on the terrain.
+	if((request.width < 1) || (request.height < 1) || (request.x < 0) || (request.y < 0) || (request.x > (m_terrainWidth - request.width)) || (request.y > (m_terrainHeight - request.height)))
+	{
+		response.status = GENERATION_STATUS_BAD_REQUEST;
+		return WriteAll(connection, &response, sizeof(response));
+	}
+
+	// The blob starts with the component count, then the height and normal of every cell.
+	data = cache.Map(request.key, size);
+	if(!data || (size < (long long)(sizeof(int) + ((long long)m_terrainWidth * m_terrainHeight * 4 * sizeof(float)))))
+	{
+		cache.Unmap();
+		response.status = GENERATION_STATUS_NOT_FOUND;
+		return WriteAll(connection, &response, sizeof(response));
+	}
+
+	// A tile is the heights alone, a mesh chunk the heights and normals, both a row at a time.
+	cellSize = (request.message == GENERATION_MESSAGE_FETCH_TILE) ? sizeof(float) : (4 * sizeof(float));
+	response.size = (long long)request.width * request.height * cellSize;
+	response.status = GENERATION_STATUS_OK;
+
+	result = WriteAll(connection, &response, sizeof(response));
+
+	heights.resize(request.width);
+	for(int y=request.y; result && (y<(request.y + request.height)); y++)
+	{
+		row = data + sizeof(int) + ((((long long)y * m_terrainWidth) + request.x) * 4 * sizeof(float));
+
+		// The rows of a chunk are sent straight out of the mapped file.
+		if(request.message == GENERATION_MESSAGE_FETCH_CHUNK)
+		{
+			result = WriteAll(connection, row, request.width * cellSize);
+			continue;
+		}
+
+		for(int x=0; x<request.width; x++)
+		{
+			memcpy(&heights[x], row + (x * 4 * sizeof(float)), sizeof(float));
+		}
+		result = WriteAll(connection, &heights[0], request.width * cellSize);
+	}
+
+	cache.Unmap();
+
+	return result;
+}
+
+
+bool GenerationServiceClass::FetchDelta(ConnectionType* connection, const generationRequestData& request, generationResponseData& response, DiskCacheClass& cache, DiskCacheClass& baseCache, TerrainDeltaClass& delta)
+{
+	TerrainType terrain, baseTerrain;
+	const unsigned char* data;
+	const unsigned char* baseData;
+	long long size, baseSize;
+	bool result;
+
+
+	response.key = request.key;
+
+	// Both terrains have to still be in the cache.
+	data = cache.Map(request.key, size);
+	baseData = baseCache.Map(request.baseKey, baseSize);
+	result = data && baseData && ReadTerrain(data, size, terrain) && ReadTerrain(baseData, baseSize, baseTerrain) && (terrain.wordCount == baseTerrain.wordCount);
+	if(!result)
+	{
+		cache.Unmap();
+		baseCache.Unmap();
+		response.status = GENERATION_STATUS_NOT_FOUND;
+		return WriteAll(connection, &response, sizeof(response));
+	}
+
+	// The heights only, a client works its normals out again from them.
+	delta.Encode(baseTerrain.heights, terrain.heights, m_terrainWidth * m_terrainHeight, 4, baseTerrain.words, terrain.words, terrain.wordCount, baseTerrain.rooms, terrain.rooms, baseTerrain.corridors, terrain.corridors);
+
+	cache.Unmap();
+	baseCache.Unmap();
+
+	response.size = (long long)delta.GetData().size();
+	response.status = GENERATION_STATUS_OK;
+
+	return WriteAll(connection, &response, sizeof(response)) && WriteAll(connection, &delta.GetData()[0], (int)response.size);
+}
+
+
+bool GenerationServiceClass::ReadTerrain(const unsigned char* data, long long size, TerrainType& terrain)
+{
+	int position;
+
+
+	// Laid out as TerrainClass packs it: the component count, a height and normal per cell, the walk grid words,
+	// then the rooms and corridors as DungeonFileClass writes them.
+	terrain.wordCount = ((m_terrainWidth + 63) / 64) * m_terrainHeight;
+	position = sizeof(int) + (m_terrainWidth * m_terrainHeight * 4 * sizeof(float)) + (terrain.wordCount * sizeof(unsigned long long));
+	if((size > INT_MAX) || (position > size))
+	{
+		return false;
+	}
+
+	terrain.heights = (const float*)(data + sizeof(int));
+	terrain.words = (const unsigned long long*)(data + position - (terrain.wordCount * sizeof(unsigned long long)));
+
+	return DungeonFileClass::ReadRects(data, position, (int)size, terrain.rooms) && DungeonFileClass::ReadRects(data, position, (int)size, terrain.corridors) && (position == (int)size);
+}
+
+
+unsigned long long GenerationServiceClass::GetKey(const generationRequestData& request)
+{
+	int values[3 + (3 * GENERATION_MAX_OPERATIONS)];
+	unsigned int seed;
+	int count, runs;
+
+
+	// The recipe and the size it is made at are all that decide the terrain. Runs and seeds are hashed the way
+	// the terrain normalizes them, so requests that make the same terrain share a key.
+	count = 0;
+	values[count++] = m_terrainWidth;
+	values[count++] = m_terrainHeight;
+	values[count++] = request.operationCount;
+
+	for(int i=0; i<request.operationCount; i++)
+	{
+		runs = request.operations[i].runs;
+		seed = request.operations[i].seed;
+		TerrainClass::NormalizeOperation(request.operations[i].type, runs, seed);
+
+		values[count++] = request.operations[i].type;
+		values[count++] = runs;
+		values[count++] = (int)seed;
+	}
+
+	return DungeonFileClass::Hash(values, count * sizeof(int));
+}
+
+
+bool GenerationServiceClass::ReadAll(ConnectionType* connection, void* data, int size)
+{
+	char* output;
+
+
+	output = (char*)data;
+	while(size > 0)
+	{
+#ifdef _WIN32
+		DWORD bytesRead;
+
+		if(!ReadFile(connection->pipe, output, size, &bytesRead, NULL) || (bytesRead == 0))
+		{
+			return false;
+		}
+#else
+		ssize_t bytesRead;
+
+		bytesRead = recv(connection->socket, output, size, 0);
+		if((bytesRead == -1) && (errno == EINTR))
+		{
+			continue;
+		}
+		if(bytesRead <= 0)
+		{
+			return false;
+		}
+#endif
+
+		output += bytesRead;
+		size -= (int)bytesRead;
+	}
+
+	return true;
+}
+
+
+bool GenerationServiceClass::WriteAll(ConnectionType* connection, const void* data, int size)
+{
+	const char* input;
+
+
+	input = (const char*)data;
+	while(size > 0)
+	{
+#ifdef _WIN32
+		DWORD bytesWritten;
+
+		if(!WriteFile(connection->pipe, input, size, &bytesWritten, NULL))
+		{
+			return false;
+		}
+#else
+		ssize_t bytesWritten;
+
+		// A client gone away shows up as a failed write rather than a signal.
+		bytesWritten = send(connection->socket, input, size, MSG_NOSIGNAL);
+		if((bytesWritten == -1) && (errno == EINTR))
+		{
+			continue;
+		}
+		if(bytesWritten <= 0)
+		{
+			return false;
+		}
+#endif
+
+		input += bytesWritten;
+		size -= (int)bytesWritten;
+	}
+
+	return true;
+}
+
+
+void GenerationServiceClass::CloseConnection(ConnectionType* connection)
+{
+#ifdef _WIN32
+	if(connection->pipe != INVALID_HANDLE_VALUE)
+	{
+		DisconnectNamedPipe(connection->pipe);
+		CloseHandle(connection->pipe);
+		connection->pipe = INVALID_HANDLE_VALUE;
+	}
+#else
+	if(connection->socket != -1)
+	{
+		close(connection->socket);
+		connection->socket = -1;
+	}
+#endif
+
+	return;
+}
@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: generationserviceclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _GENERATIONSERVICECLASS_H_
+#define _GENERATIONSERVICECLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+#include <list>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "terrainclass.h"
+#include "diskcacheclass.h"
+#include "terraindeltaclass.h"
+#include "generationmessagedata.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int GENERATION_MAX_CONNECTIONS = 16;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: GenerationServiceClass
+////////////////////////////////////////////////////////////////////////////////
+// Generates terrains for other processes on the same machine. Requests come in
+// over a named pipe on Windows and a Unix domain socket elsewhere, one thread
+// per connection, as the fixed size messages of generationmessagedata.h. At
+// most GENERATION_MAX_CONNECTIONS are served at once, more clients wait to be
+// let in until one of them closes.
+//
+// A generate request names a recipe. Its finished heights and normals are put
+// in the disk cache under a hash of the recipe and the terrain size, and the
+// answer is that key, which the client maps from the cache directory itself, so
+// a whole terrain is never copied through the connection. A recipe already in
+// the cache is answered straight away. Requests for a recipe that is already
+// queued or being made wait for that one rather than making it again, and the
+// queue is handed out to a pool of worker terrains, each with a generation
+// thread of its own, from the frame loop. The workers have no Direct3D device,
+// they only make terrains and never draw them. Fetches of a few tiles or mesh chunks,
+// and deltas between two terrains for clients that have the first, are read out
+// of the cache on the connection's thread and never queue.
+class GenerationServiceClass
+{
+private:
+	struct ConnectionType
+	{
+		std::thread thread;
+#ifdef _WIN32
+		HANDLE pipe;
+#else
+		int socket;
+#endif
+		bool finished;
+	};
+
+	struct JobType
+	{
+		std::vector<generationOperationData> operations;
+		int waiters;
+		bool done;
+		int status;
+	};
+
+	struct TerrainType
+	{
+		const float* heights;
+		const unsigned long long* words;
+		int wordCount;
+		std::vector<dungeonCellData> rooms, corridors;
+	};
+
+	struct WorkerType
+	{
+		TerrainClass* terrain;
+		unsigned long long key;
+		bool busy;
+	};
+
+public:
+	GenerationServiceClass();
+	GenerationServiceClass(const GenerationServiceClass&);
+	~GenerationServiceClass();
+
+	bool Initialize(const char* name, int terrainWidth, int terrainHeight, int workerCount);
+	void Shutdown();
+	void Frame(int budget);
+
+	int GetRequestCount();
+	int GetCoalescedCount();
+	int GetGeneratedCount();
+
+private:
+	void ListenThread();
+	void ConnectionThread(ConnectionType* connection);
+	bool Generate(const generationRequestData& request, generationResponseData& response, DiskCacheClass& cache);
+	bool Fetch(ConnectionType* connection, const generationRequestData& request, generationResponseData& response, DiskCacheClass& cache);
+	bool FetchDelta(ConnectionType* connection, const generationRequestData& request, generationResponseData& response, DiskCacheClass& cache, DiskCacheClass& baseCache, TerrainDeltaClass& delta);
+	bool ReadTerrain(const unsigned char* data, long long size, TerrainType& terrain);
+	unsigned long long GetKey(const generationRequestData& request);
+	bool ReadAll(ConnectionType* connection, void* data, int size);
+	bool WriteAll(ConnectionType* connection, const void* data, int size);
+	void CloseConnection(ConnectionType* connection);
+
+private:
+	std::string m_name;
+	int m_terrainWidth, m_terrainHeight;
+
+	std::vector<WorkerType> m_workers;
+	std::vector<unsigned char> m_packedTerrain;
+	DiskCacheClass* m_DiskCache;
+
+	std::mutex m_jobMutex;
+	std::condition_variable m_jobCondition;
+	std::map<unsigned long long, JobType> m_jobs;
+	std::deque<unsigned long long> m_queue;
+	int m_requestCount, m_coalescedCount, m_generatedCount;
+
+	std::thread m_listenThread;
+	std::list<ConnectionType> m_connections;
+	std::condition_variable m_connectionCondition;
+	int m_connectionCount;
+	bool m_listening, m_quit;
+
+#ifdef _WIN32
+	HANDLE m_listenPipe;
+#else
+	int m_listenSocket;
+#endif
+};
+
+#endif
@@ -0,0 +1,265 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfieldclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "heightfieldclass.h"
+#include <algorithm>
+#include <cstring>
+
+
+HeightFieldClass::HeightFieldClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_layout = LAYOUT_ROW_MAJOR;
+	m_Store = 0;
+}
+
+
+HeightFieldClass::HeightFieldClass(const HeightFieldClass& other)
+{
+}
+
+
+HeightFieldClass::~HeightFieldClass()
+{
+}
+
+
+bool HeightFieldClass::Initialize(int width, int height, LayoutType layout)
+{
+	if((width <= 0) || (height <= 0))
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_layout = layout;
+	m_tilesX = (width + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+	m_tilesY = (height + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+
+	// The tiled layout is padded out to whole tiles, the cells past the edge are never read.
+	if(m_layout == LAYOUT_TILED)
+	{
+		m_heights.assign((m_tilesX * m_tilesY) << (2 * HEIGHTFIELD_TILE_SHIFT), 0.0f);
+	}
+	else
+	{
+		m_heights.assign(width * height, 0.0f);
+	}
+
+	return true;
+}
+
+
+bool HeightFieldClass::InitializeStreamed(const char* filename, int width, int height, int residentTiles)
+{
+	bool result;
+
+
+	if((width <= 0) || (height <= 0))
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_layout = LAYOUT_STREAMED;
+	m_tilesX = (width + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+	m_tilesY = (height + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+
+	// Create the tile store object.
+	m_Store = new TileStoreClass;
+	if(!m_Store)
+	{
+		return false;
+	}
+
+	// Initialize the tile store object.
+	result = m_Store->Initialize(filename, width, height, residentTiles);
+	if(!result)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+void HeightFieldClass::Shutdown()
+{
+	// Release the tile store object.
+	if(m_Store)
+	{
+		m_Store->Shutdown();
+		delete m_Store;
+		m_Store = 0;
+	}
+
+	std::vector<float>().swap(m_heights);
+
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+
+	return;
+}
+
+
+void HeightFieldClass::Swap(HeightFieldClass& other)
+{
+	std::swap(m_width, other.m_width);
+	std::swap(m_height, other.m_height);
+	std::swap(m_tilesX, other.m_tilesX);
+	std::swap(m_tilesY, other.m_tilesY);
+	std::swap(m_layout, other.m_layout);
+	m_heights.swap(other.m_heights);
+	std::swap(m_Store, other.m_Store);
+
+	return;
+}
+
+
+float HeightFieldClass::Get(int x, int y) const
+{
+	if(m_Store)
+	{
+		return *m_Store->GetCell(x, y);
+	}
+
+	return m_heights[GetIndex(x, y)];
+}
+
+
+void HeightFieldClass::Set(int x, int y, float value)
+{
+	if(m_Store)
+	{
+		*m_Store->GetCell(x, y) = value;
+		return;
+	}
+
+	m_heights[GetIndex(x, y)] = value;
+
+	return;
+}
+
+
+float* HeightFieldClass::GetSpan(int x, int y, int& length)
+{
+	// The cells from (x, y) that follow on in memory: the rest of the row, or the rest of the tile row.
+	if(m_layout != LAYOUT_ROW_MAJOR)
+	{
+		length = std::min(HEIGHTFIELD_TILE_SIZE - (x & (HEIGHTFIELD_TILE_SIZE - 1)), m_width - x);
+	}
+	else
+	{
+		length = m_width - x;
+	}
+
+	if(m_Store)
+	{
+		return m_Store->GetCell(x, y);
+	}
+
+	return &m_heights[GetIndex(x, y)];
+}
+
+
+const float* HeightFieldClass::GetSpan(int x, int y, int& length) const
+{
+	return const_cast<HeightFieldClass*>(this)->GetSpan(x, y, length);
+}
+
+
+int HeightFieldClass::GetTileCount() const
+{
+	return m_tilesX * m_tilesY;
+}
+
+
+void HeightFieldClass::GetTile(int tile, int& xStart, int& yStart, int& xEnd, int& yEnd) const
+{
+	xStart = (tile % m_tilesX) * HEIGHTFIELD_TILE_SIZE;
+	yStart = (tile / m_tilesX) * HEIGHTFIELD_TILE_SIZE;
+	xEnd = std::min(xStart + HEIGHTFIELD_TILE_SIZE, m_width);
+	yEnd = std::min(yStart + HEIGHTFIELD_TILE_SIZE, m_height);
+
+	return;
+}
+
+
+void HeightFieldClass::ReadTile(int tile, float* block) const
+{
+	int xStart, yStart, xEnd, yEnd, y, length;
+	const float* span;
+	float* row;
+
+
+	// Copy the tile into the middle of a HEIGHTFIELD_BLOCK_SIZE square block with a one cell border
+	// around it, so a 3x3 stencil never has to check an edge. Past the edge of the map the edge cells
+	// are repeated.
+	GetTile(tile, xStart, yStart, xEnd, yEnd);
+
+	for(int by=0; by<(yEnd - yStart) + 2; by++)
+	{
+		y = std::min(std::max(yStart + by - 1, 0), m_height - 1);
+		row = &block[by * HEIGHTFIELD_BLOCK_SIZE];
+
+		span = GetSpan(xStart, y, length);
+		memcpy(&row[1], span, (xEnd - xStart) * sizeof(float));
+
+		row[0] = Get(std::max(xStart - 1, 0), y);
+		row[(xEnd - xStart) + 1] = Get(std::min(xEnd, m_width - 1), y);
+	}
+
+	return;
+}
+
+
+int HeightFieldClass::GetWidth() const
+{
+	return m_width;
+}
+
+
+int HeightFieldClass::GetHeight() const
+{
+	return m_height;
+}
+
+
+HeightFieldClass::LayoutType HeightFieldClass::GetLayout() const
+{
+	return m_layout;
+}
+
+
+void HeightFieldClass::Prefetch(int x, int y)
+{
+	if(m_Store)
+	{
+		m_Store->Prefetch(x, y);
+	}
+
+	return;
+}
+
+
+int HeightFieldClass::GetIndex(int x, int y) const
+{
+	int tile;
+
+
+	if(m_layout == LAYOUT_ROW_MAJOR)
+	{
+		return (y * m_width) + x;
+	}
+
+	tile = ((y >> HEIGHTFIELD_TILE_SHIFT) * m_tilesX) + (x >> HEIGHTFIELD_TILE_SHIFT);
+
+	return (tile << (2 * HEIGHTFIELD_TILE_SHIFT)) + ((y & (HEIGHTFIELD_TILE_SIZE - 1)) << HEIGHTFIELD_TILE_SHIFT) + (x & (HEIGHTFIELD_TILE_SIZE - 1));
+}
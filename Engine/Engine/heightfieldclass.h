@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightfieldclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _HEIGHTFIELDCLASS_H_
+#define _HEIGHTFIELDCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "tilestoreclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int HEIGHTFIELD_TILE_SHIFT = 5;
+const int HEIGHTFIELD_TILE_SIZE = 1 << HEIGHTFIELD_TILE_SHIFT;
+const int HEIGHTFIELD_BLOCK_SIZE = HEIGHTFIELD_TILE_SIZE + 2;
+const long long STREAMED_HEIGHTFIELD_CELLS = 4096LL * 4096LL;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: HeightFieldClass
+////////////////////////////////////////////////////////////////////////////////
+// A grid of heights for the stencil stages to work on. Stored row by row, a cell
+// and the one below it are a whole row apart, so on big maps every vertical
+// neighbour is another cache line and often another page. The tiled layout keeps
+// each 32x32 tile in one 4KB run instead, row by row inside the tile. Stencils go
+// a tile at a time through ReadTile, which copies the tile and a one cell border
+// into a small block, so they work the same on either layout.
+//
+// A streamed field keeps the tiled order but lives in a file through a
+// TileStoreClass, for maps that do not fit in memory. Its tiles line up with the
+// store's, so a span never crosses from one mapped view into another.
+class HeightFieldClass
+{
+public:
+	enum LayoutType
+	{
+		LAYOUT_ROW_MAJOR,
+		LAYOUT_TILED,
+		LAYOUT_STREAMED
+	};
+
+public:
+	HeightFieldClass();
+	HeightFieldClass(const HeightFieldClass&);
+	~HeightFieldClass();
+
+	bool Initialize(int width, int height, LayoutType layout);
+	bool InitializeStreamed(const char* filename, int width, int height, int residentTiles);
+	void Shutdown();
+	void Swap(HeightFieldClass& other);
+
+	float Get(int x, int y) const;
+	void Set(int x, int y, float value);
+	float* GetSpan(int x, int y, int& length);
+	const float* GetSpan(int x, int y, int& length) const;
+
+	int GetTileCount() const;
+	void GetTile(int tile, int& xStart, int& yStart, int& xEnd, int& yEnd) const;
+	void ReadTile(int tile, float* block) const;
+
+	int GetWidth() const;
+	int GetHeight() const;
+	LayoutType GetLayout() const;
+	void Prefetch(int x, int y);
+
+private:
+	int GetIndex(int x, int y) const;
+
+private:
+	int m_width, m_height, m_tilesX, m_tilesY;
+	LayoutType m_layout;
+	std::vector<float> m_heights;
+	TileStoreClass* m_Store;
+};
+
+#endif
@@ -0,0 +1,540 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightmapfileclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "heightmapfileclass.h"
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <climits>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+HeightMapFileClass::HeightMapFileClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_format = FORMAT_BMP24;
+	m_fileSize = 0;
+	m_dataOffset = 0;
+	m_rowBytes = 0;
+	m_bottomUp = true;
+	m_levelScale = 1.0f;
+	m_view = 0;
+	m_viewStart = 0;
+	m_viewEnd = 0;
+
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = 0;
+#else
+	m_file = -1;
+#endif
+}
+
+
+HeightMapFileClass::HeightMapFileClass(const HeightMapFileClass& other)
+{
+}
+
+
+HeightMapFileClass::~HeightMapFileClass()
+{
+}
+
+
+bool HeightMapFileClass::Initialize(const char* filename)
+{
+	const unsigned char* header;
+	bool result;
+
+
+	// Open the file and map it for reading.
+#ifdef _WIN32
+	LARGE_INTEGER fileSize;
+
+
+	m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	if(!GetFileSizeEx(m_file, &fileSize))
+	{
+		return false;
+	}
+	m_fileSize = fileSize.QuadPart;
+
+	if(m_fileSize < 4)
+	{
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(!m_mapping)
+	{
+		return false;
+	}
+#else
+	struct stat fileStat;
+
+
+	m_file = open(filename, O_RDONLY);
+	if(m_file == -1)
+	{
+		return false;
+	}
+
+	if(fstat(m_file, &fileStat) != 0)
+	{
+		return false;
+	}
+	m_fileSize = fileStat.st_size;
+
+	if(m_fileSize < 4)
+	{
+		return false;
+	}
+#endif
+
+	// Work out the format from the first bytes, falling back on the extension for headerless files.
+	header = MapRange(0, std::min(m_fileSize, (long long)HEIGHTMAP_VIEW_ALIGNMENT), false);
+	if(!header)
+	{
+		return false;
+	}
+
+	if((header[0] == 'B') && (header[1] == 'M'))
+	{
+		result = ParseBitmap();
+	}
+	else if((header[0] == 'P') && (header[1] == '5'))
+	{
+		result = ParsePixmap();
+	}
+	else
+	{
+		result = ParseRaw(filename);
+	}
+
+	if(!result)
+	{
+		return false;
+	}
+
+	if((m_width <= 0) || (m_height <= 0) || (m_width > HEIGHTMAP_MAX_SIZE) || (m_height > HEIGHTMAP_MAX_SIZE))
+	{
+		return false;
+	}
+
+	// Every row has to be in the file. Dividing the space left keeps a huge header from overflowing the check.
+	if((m_dataOffset > m_fileSize) || (m_rowBytes > ((m_fileSize - m_dataOffset) / m_height)))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+void HeightMapFileClass::Shutdown()
+{
+	UnmapView();
+
+#ifdef _WIN32
+	if(m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = 0;
+	}
+
+	if(m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if(m_file != -1)
+	{
+		close(m_file);
+		m_file = -1;
+	}
+#endif
+
+	return;
+}
+
+
+bool HeightMapFileClass::ReadRow(int row, float* heights, int stride, float scale)
+{
+	const unsigned char* data;
+	float levels[256];
+	unsigned short word;
+	float value;
+	int storedRow;
+
+
+	// Row 0 is the bottom of the image, whichever way up the file keeps its rows.
+	storedRow = m_bottomUp ? row : (m_height - 1 - row);
+
+	data = MapRange(m_dataOffset + ((long long)storedRow * m_rowBytes), m_rowBytes, !m_bottomUp);
+	if(!data)
+	{
+		return false;
+	}
+
+	// Write every cell once, straight from the mapped row, with the scale applied on the way.
+	switch(m_format)
+	{
+		case FORMAT_BMP8:
+		case FORMAT_BMP24:
+		case FORMAT_BMP32:
+		case FORMAT_PGM8:
+			// The 8 bit formats go through a table of scaled levels.
+			for(int i=0; i<256; i++)
+			{
+				levels[i] = m_palette[i] * scale;
+			}
+
+			if(m_format == FORMAT_BMP8 || m_format == FORMAT_PGM8)
+			{
+				for(int i=0; i<m_width; i++)
+				{
+					heights[i * stride] = levels[data[i]];
+				}
+			}
+			else
+			{
+				// Take the blue channel, the first byte of each pixel.
+				for(int i=0; i<m_width; i++)
+				{
+					heights[i * stride] = levels[data[i * (m_format == FORMAT_BMP24 ? 3 : 4)]];
+				}
+			}
+			break;
+
+		case FORMAT_PGM16:
+			// Big endian, scaled to the 0-255 range of the 8 bit formats.
+			value = m_levelScale * scale;
+			for(int i=0; i<m_width; i++)
+			{
+				heights[i * stride] = (float)((data[i * 2] << 8) | data[(i * 2) + 1]) * value;
+			}
+			break;
+
+		case FORMAT_RAW16:
+			value = m_levelScale * scale;
+			for(int i=0; i<m_width; i++)
+			{
+				word = (unsigned short)(data[i * 2] | (data[(i * 2) + 1] << 8));
+				heights[i * stride] = (float)word * value;
+			}
+			break;
+
+		case FORMAT_RAW32:
+			for(int i=0; i<m_width; i++)
+			{
+				memcpy(&value, &data[i * 4], sizeof(float));
+				heights[i * stride] = value * scale;
+			}
+			break;
+	}
+
+	return true;
+}
+
+
+int HeightMapFileClass::GetWidth()
+{
+	return m_width;
+}
+
+
+int HeightMapFileClass::GetHeight()
+{
+	return m_height;
+}
+
+
+HeightMapFileClass::FormatType HeightMapFileClass::GetFormat()
+{
+	return m_format;
+}
+
+
+bool HeightMapFileClass::ParseBitmap()
+{
+	const unsigned char* header;
+	unsigned int dataOffset, infoSize, compression, colorsUsed;
+	int width, height;
+	unsigned short bitCount;
+	const unsigned char* palette;
+
+
+	// The headers are read field by field from the mapped bytes, all little endian. The view starts at
+	// the beginning of the file, so its end is how many bytes there are to read.
+	header = m_view;
+	if(m_viewEnd < 54)
+	{
+		return false;
+	}
+
+	memcpy(&dataOffset, &header[10], 4);
+	memcpy(&infoSize, &header[14], 4);
+	memcpy(&width, &header[18], 4);
+	memcpy(&height, &header[22], 4);
+	memcpy(&bitCount, &header[28], 2);
+	memcpy(&compression, &header[30], 4);
+	memcpy(&colorsUsed, &header[46], 4);
+
+	// Only uncompressed bitmaps with at least a BITMAPINFOHEADER. A height of INT_MIN has no positive size.
+	if((infoSize < 40) || (compression != 0) || (height == INT_MIN))
+	{
+		return false;
+	}
+
+	switch(bitCount)
+	{
+		case 8:
+			m_format = FORMAT_BMP8;
+			break;
+		case 24:
+			m_format = FORMAT_BMP24;
+			break;
+		case 32:
+			m_format = FORMAT_BMP32;
+			break;
+		default:
+			return false;
+	}
+
+	// A negative height means the rows are stored top row first.
+	m_width = width;
+	m_height = std::abs(height);
+	m_bottomUp = (height > 0);
+	m_dataOffset = dataOffset;
+
+	// Rows are padded out to a multiple of four bytes.
+	m_rowBytes = ((((long long)m_width * bitCount) + 31) / 32) * 4;
+
+	// An 8 bit bitmap is looked up through the blue channel of its palette, the others use their blue channel as it is.
+	for(int i=0; i<256; i++)
+	{
+		m_palette[i] = (float)i;
+	}
+
+	if(m_format == FORMAT_BMP8)
+	{
+		if((colorsUsed == 0) || (colorsUsed > 256))
+		{
+			colorsUsed = 256;
+		}
+
+		if((14LL + infoSize + (colorsUsed * 4)) > m_viewEnd)
+		{
+			return false;
+		}
+
+		palette = &header[14 + infoSize];
+		for(unsigned int i=0; i<colorsUsed; i++)
+		{
+			m_palette[i] = (float)palette[i * 4];
+		}
+	}
+
+	return true;
+}
+
+
+bool HeightMapFileClass::ParsePixmap()
+{
+	const unsigned char* header;
+	int fields[3];
+	int position, field;
+
+
+	// P5, then width, height and the maximum value as text, each after white space and any # comments.
+	header = m_view;
+	position = 2;
+	for(field=0; field<3; field++)
+	{
+		while(position < m_viewEnd)
+		{
+			if(header[position] == '#')
+			{
+				while((position < m_viewEnd) && (header[position] != '\n'))
+				{
+					position++;
+				}
+			}
+			else if(isspace(header[position]))
+			{
+				position++;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		if((position >= m_viewEnd) || !isdigit(header[position]))
+		{
+			return false;
+		}
+
+		// No field is allowed past 65535, so a long number is turned down before it can overflow.
+		fields[field] = 0;
+		while((position < m_viewEnd) && isdigit(header[position]))
+		{
+			fields[field] = (fields[field] * 10) + (header[position] - '0');
+			if(fields[field] > 65535)
+			{
+				return false;
+			}
+			position++;
+		}
+	}
+
+	// A single white space character separates the header from the data.
+	if((position >= m_viewEnd) || (fields[2] <= 0) || (fields[2] > 65535))
+	{
+		return false;
+	}
+
+	m_width = fields[0];
+	m_height = fields[1];
+	m_format = (fields[2] < 256) ? FORMAT_PGM8 : FORMAT_PGM16;
+	m_bottomUp = false;
+	m_dataOffset = position + 1;
+	m_rowBytes = (long long)m_width * ((m_format == FORMAT_PGM8) ? 1 : 2);
+
+	// Levels are stretched to 0-255 whatever the maximum.
+	m_levelScale = 255.0f / (float)fields[2];
+	for(int i=0; i<256; i++)
+	{
+		m_palette[i] = (float)i * m_levelScale;
+	}
+
+	return true;
+}
+
+
+bool HeightMapFileClass::ParseRaw(const char* filename)
+{
+	const char* extension;
+	char lower[4];
+	int cellBytes;
+	long long side;
+
+
+	// Headerless files say what they hold by their extension and are taken to be square.
+	extension = strrchr(filename, '.');
+	if(!extension || (strlen(extension) != 4))
+	{
+		return false;
+	}
+
+	for(int i=0; i<4; i++)
+	{
+		lower[i] = (char)tolower(extension[i]);
+	}
+
+	if(memcmp(lower, ".r16", 4) == 0)
+	{
+		m_format = FORMAT_RAW16;
+		m_levelScale = 1.0f / 257.0f;
+		cellBytes = 2;
+	}
+	else if(memcmp(lower, ".r32", 4) == 0)
+	{
+		m_format = FORMAT_RAW32;
+		cellBytes = 4;
+	}
+	else
+	{
+		return false;
+	}
+
+	side = (long long)sqrt((double)(m_fileSize / cellBytes));
+	if((side * side * cellBytes) != m_fileSize)
+	{
+		return false;
+	}
+
+	m_width = (int)side;
+	m_height = (int)side;
+	m_bottomUp = true;
+	m_dataOffset = 0;
+	m_rowBytes = side * cellBytes;
+
+	return true;
+}
+
+
+const unsigned char* HeightMapFileClass::MapRange(long long offset, long long size, bool backwards)
+{
+	long long start, end, window;
+
+
+	if((offset >= m_viewStart) && ((offset + size) <= m_viewEnd) && m_view)
+	{
+		return m_view + (offset - m_viewStart);
+	}
+
+	UnmapView();
+
+	// Map a window of at least HEIGHTMAP_VIEW_BYTES around the range, reaching ahead in the direction
+	// the rows are being read. Views have to start on the allocation granularity.
+	window = std::max(size, (long long)HEIGHTMAP_VIEW_BYTES);
+	start = backwards ? std::max((offset + size) - window, 0LL) : offset;
+	start -= start % HEIGHTMAP_VIEW_ALIGNMENT;
+	end = std::min(std::max(start + window, offset + size), m_fileSize);
+
+#ifdef _WIN32
+	m_view = (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, (DWORD)(start >> 32), (DWORD)(start & 0xffffffff), (SIZE_T)(end - start));
+	if(!m_view)
+	{
+		return 0;
+	}
+#else
+	void* view;
+
+
+	view = mmap(0, (size_t)(end - start), PROT_READ, MAP_PRIVATE, m_file, (off_t)start);
+	if(view == MAP_FAILED)
+	{
+		return 0;
+	}
+	m_view = (const unsigned char*)view;
+#endif
+
+	m_viewStart = start;
+	m_viewEnd = end;
+
+	return m_view + (offset - m_viewStart);
+}
+
+
+void HeightMapFileClass::UnmapView()
+{
+	if(m_view)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_view);
+#else
+		munmap((void*)m_view, (size_t)(m_viewEnd - m_viewStart));
+#endif
+		m_view = 0;
+	}
+
+	m_viewStart = 0;
+	m_viewEnd = 0;
+
+	return;
+}
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: heightmapfileclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _HEIGHTMAPFILECLASS_H_
+#define _HEIGHTMAPFILECLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int HEIGHTMAP_VIEW_ALIGNMENT = 64 * 1024;
+const int HEIGHTMAP_VIEW_BYTES = 16 * 1024 * 1024;
+const int HEIGHTMAP_MAX_SIZE = 16384;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: HeightMapFileClass
+////////////////////////////////////////////////////////////////////////////////
+// Reads height maps straight out of a mapped view of the file, with nothing
+// copied in between. Takes 8, 24 and 32 bit BMPs, either way up and with their
+// rows padded to four bytes, where an 8 bit BMP goes through its palette and the
+// others use the blue channel. Also takes 8 and 16 bit binary PGMs, and square
+// headerless .r16 (16 bit little endian) and .r32 (float) files stored bottom
+// row first. Only a window of rows is mapped at a time, moved along as the rows
+// are read, so a file of any size costs the same address space. Maps wider or
+// taller than HEIGHTMAP_MAX_SIZE are turned down, which keeps the cell and vertex
+// counts of a terrain made from one inside an int.
+class HeightMapFileClass
+{
+public:
+	enum FormatType
+	{
+		FORMAT_BMP8,
+		FORMAT_BMP24,
+		FORMAT_BMP32,
+		FORMAT_PGM8,
+		FORMAT_PGM16,
+		FORMAT_RAW16,
+		FORMAT_RAW32
+	};
+
+public:
+	HeightMapFileClass();
+	HeightMapFileClass(const HeightMapFileClass&);
+	~HeightMapFileClass();
+
+	bool Initialize(const char* filename);
+	void Shutdown();
+
+	bool ReadRow(int row, float* heights, int stride, float scale);
+
+	int GetWidth();
+	int GetHeight();
+	FormatType GetFormat();
+
+private:
+	bool ParseBitmap();
+	bool ParsePixmap();
+	bool ParseRaw(const char* filename);
+	const unsigned char* MapRange(long long offset, long long size, bool backwards);
+	void UnmapView();
+
+private:
+	int m_width, m_height;
+	FormatType m_format;
+	long long m_fileSize, m_dataOffset, m_rowBytes;
+	bool m_bottomUp;
+	float m_palette[256];
+	float m_levelScale;
+
+	const unsigned char* m_view;
+	long long m_viewStart, m_viewEnd;
+
+#ifdef _WIN32
+	HANDLE m_file, m_mapping;
+#else
+	int m_file;
+#endif
+};
+
+#endif
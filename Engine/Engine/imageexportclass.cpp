@@ -0,0 +1,1081 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: imageexportclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "imageexportclass.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+
+namespace
+{
+	const int WINDOW_SIZE = 32768;
+	const int HASH_BITS = 15;
+	const int MIN_MATCH = 3;
+	const int MAX_MATCH = 258;
+	const int MAX_INSERT = 16;
+
+	const unsigned short LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned short DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned char DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const unsigned char CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	const unsigned int MATCH_FLAG = 0x80000000;
+
+	inline unsigned int HashBytes(const unsigned char* data)
+	{
+		return ((((unsigned int)data[0] << 16) | ((unsigned int)data[1] << 8) | data[2]) * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	unsigned int Adler(const unsigned char* data, size_t size)
+	{
+		unsigned int a, b;
+		size_t block;
+
+
+		// Sums of at most 5552 bytes cannot overflow before they are reduced.
+		a = 1;
+		b = 0;
+		while(size > 0)
+		{
+			block = std::min(size, (size_t)5552);
+			size -= block;
+			while(block--)
+			{
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+
+		return (b << 16) | a;
+	}
+
+	unsigned int CombineAdler(unsigned int first, unsigned int second, unsigned int secondLength)
+	{
+		const unsigned int BASE = 65521;
+		unsigned int remainder, sum1, sum2;
+
+
+		// The checksum of two runs of bytes one after the other, from the checksums of each.
+		remainder = secondLength % BASE;
+		sum1 = first & 0xffff;
+		sum2 = (remainder * sum1) % BASE;
+		sum1 += (second & 0xffff) + BASE - 1;
+		sum2 += (first >> 16) + (second >> 16) + BASE - remainder;
+		if(sum1 >= BASE) sum1 -= BASE;
+		if(sum1 >= BASE) sum1 -= BASE;
+		if(sum2 >= (BASE << 1)) sum2 -= (BASE << 1);
+		if(sum2 >= BASE) sum2 -= BASE;
+
+		return sum1 | (sum2 << 16);
+	}
+
+	void PutBigEndian(unsigned char* data, unsigned int value)
+	{
+		data[0] = (unsigned char)(value >> 24);
+		data[1] = (unsigned char)(value >> 16);
+		data[2] = (unsigned char)(value >> 8);
+		data[3] = (unsigned char)value;
+
+		return;
+	}
+}
+
+
+ImageExportClass::ImageExportClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_channels = 0;
+	m_bitDepth = 0;
+	m_rowBytes = 0;
+	m_encodeTime = 0.0f;
+	m_nextJob = 0;
+
+	m_workRound = 0;
+	m_workPending = 0;
+	m_workQuit = false;
+}
+
+
+ImageExportClass::ImageExportClass(const ImageExportClass& other)
+{
+}
+
+
+ImageExportClass::~ImageExportClass()
+{
+}
+
+
+bool ImageExportClass::Initialize(int width, int height)
+{
+	unsigned int crc;
+	int workerCount, distance, count;
+
+
+	if((width <= 0) || (height <= 0))
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+
+	// Tables for the chunk checksums and for turning match lengths and distances into their deflate codes.
+	for(int i=0; i<256; i++)
+	{
+		crc = (unsigned int)i;
+		for(int k=0; k<8; k++)
+		{
+			crc = (crc & 1) ? (0xEDB88320 ^ (crc >> 1)) : (crc >> 1);
+		}
+		m_crcTable[i] = crc;
+	}
+
+	for(int code=0; code<29; code++)
+	{
+		count = (code == 28) ? 1 : (1 << LENGTH_EXTRA[code]);
+		for(int k=0; k<count; k++)
+		{
+			m_lengthCodes[LENGTH_BASE[code] + k] = (unsigned char)code;
+		}
+	}
+
+	for(int code=0; code<30; code++)
+	{
+		for(int k=0; k<(1 << DISTANCE_EXTRA[code]); k++)
+		{
+			distance = DISTANCE_BASE[code] + k - 1;
+			if(distance < 256)
+			{
+				m_distanceCodes[distance] = (unsigned char)code;
+			}
+			else
+			{
+				m_distanceCodes[256 + (distance >> 7)] = (unsigned char)code;
+			}
+		}
+	}
+
+	// Every thread compresses with its own window and tables.
+	workerCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	m_scratch.resize(workerCount);
+	for(int i=0; i<workerCount; i++)
+	{
+		m_scratch[i].head.assign(1 << HASH_BITS, -1);
+		m_scratch[i].chain.assign(WINDOW_SIZE, -1);
+		m_scratch[i].symbols.reserve(IMAGEEXPORT_BLOCK_SYMBOLS);
+	}
+
+	// Start a thread for every core but the first, which is the caller's.
+	m_workQuit = false;
+	m_workRound = 0;
+	for(int i=1; i<workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&ImageExportClass::WorkerThread, this, i));
+	}
+
+	return true;
+}
+
+
+void ImageExportClass::Shutdown()
+{
+	// Wake the threads to quit and wait for them.
+	m_workMutex.lock();
+	m_workQuit = true;
+	m_workMutex.unlock();
+
+	m_workCondition.notify_all();
+	for(unsigned int i=0; i<m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	std::vector<std::thread>().swap(m_workers);
+
+	std::vector<JobType>().swap(m_jobs);
+	std::vector<ScratchType>().swap(m_scratch);
+	std::vector<unsigned char>().swap(m_pixels);
+	std::vector<unsigned char>().swap(m_zeroRow);
+
+	return;
+}
+
+
+bool ImageExportClass::SetPixelType(int channels, int bitDepth)
+{
+	if(((channels != 1) && (channels != 3)) || ((bitDepth != 8) && (bitDepth != 16)))
+	{
+		return false;
+	}
+
+	m_channels = channels;
+	m_bitDepth = bitDepth;
+	m_rowBytes = m_width * channels * (bitDepth / 8);
+
+	// The storage is kept between images and only grows.
+	m_pixels.resize((size_t)m_rowBytes * m_height);
+	m_zeroRow.assign(m_rowBytes, 0);
+	m_comment.clear();
+
+	return true;
+}
+
+
+unsigned char* ImageExportClass::GetRow(int row)
+{
+	return &m_pixels[(size_t)row * m_rowBytes];
+}
+
+
+void ImageExportClass::SetComment(const char* comment)
+{
+	m_comment = comment;
+
+	return;
+}
+
+
+bool ImageExportClass::Write(const char* filename, FormatType format)
+{
+	FILE* file;
+	bool result;
+
+
+	if(m_rowBytes == 0)
+	{
+		return false;
+	}
+
+	if(fopen_s(&file, filename, "wb") != 0)
+	{
+		return false;
+	}
+
+	switch(format)
+	{
+		case FORMAT_PNG:
+			result = WritePng(file);
+			break;
+		case FORMAT_PGM:
+			result = WritePixmap(file);
+			break;
+		default:
+			result = WriteRaw(file);
+			break;
+	}
+
+	if(fclose(file) != 0)
+	{
+		result = false;
+	}
+
+	return result;
+}
+
+
+float ImageExportClass::GetEncodeTime()
+{
+	return m_encodeTime;
+}
+
+
+bool ImageExportClass::WritePng(FILE* file)
+{
+	const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::chrono::high_resolution_clock::time_point start;
+	unsigned char header[13], ending[6];
+	std::vector<unsigned char> text;
+	unsigned int adler;
+	int rowsPerJob, jobCount;
+	bool result;
+
+
+	start = std::chrono::high_resolution_clock::now();
+
+	// Cut the rows into jobs, each with a filter byte in front of every row.
+	rowsPerJob = std::max(IMAGEEXPORT_JOB_BYTES / (m_rowBytes + 1), 1);
+	jobCount = (m_height + rowsPerJob - 1) / rowsPerJob;
+	m_jobs.resize(jobCount);
+	for(int i=0; i<jobCount; i++)
+	{
+		m_jobs[i].rowStart = i * rowsPerJob;
+		m_jobs[i].rowEnd = std::min((i + 1) * rowsPerJob, m_height);
+	}
+
+	// Hand the jobs out to every thread, this one included, and wait for the lot.
+	m_workMutex.lock();
+	m_nextJob = 0;
+	m_workPending = (int)m_workers.size();
+	m_workRound++;
+	m_workMutex.unlock();
+
+	m_workCondition.notify_all();
+	RunJobs(0);
+
+	{
+		std::unique_lock<std::mutex> lock(m_workMutex);
+		m_doneCondition.wait(lock, [this]() { return m_workPending == 0; });
+	}
+
+	m_encodeTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	result = (fwrite(SIGNATURE, 1, sizeof(SIGNATURE), file) == sizeof(SIGNATURE));
+
+	PutBigEndian(&header[0], m_width);
+	PutBigEndian(&header[4], m_height);
+	header[8] = (unsigned char)m_bitDepth;
+	header[9] = (m_channels == 3) ? 2 : 0;
+	header[10] = 0;
+	header[11] = 0;
+	header[12] = 0;
+	result = result && WriteChunk(file, "IHDR", header, sizeof(header));
+
+	if(!m_comment.empty())
+	{
+		text.assign("Comment", "Comment" + 8);
+		text.insert(text.end(), m_comment.begin(), m_comment.end());
+		result = result && WriteChunk(file, "tEXt", &text[0], (int)text.size());
+	}
+
+	// The jobs are already whole IDAT chunks.
+	adler = 1;
+	for(int i=0; (i<jobCount) && result; i++)
+	{
+		result = (fwrite(&m_jobs[i].output[0], 1, m_jobs[i].output.size(), file) == m_jobs[i].output.size());
+		adler = CombineAdler(adler, m_jobs[i].adler, m_jobs[i].length);
+		std::vector<unsigned char>().swap(m_jobs[i].output);
+	}
+
+	// An empty last block closes the stream, then its checksum.
+	ending[0] = 0x03;
+	ending[1] = 0x00;
+	PutBigEndian(&ending[2], adler);
+	result = result && WriteChunk(file, "IDAT", ending, sizeof(ending));
+	result = result && WriteChunk(file, "IEND", 0, 0);
+
+	return result;
+}
+
+
+bool ImageExportClass::WritePixmap(FILE* file)
+{
+	char header[512];
+	int length;
+
+
+	// PGM and PPM keep 16 bit samples high byte first as well, so the rows go out as they are.
+	length = snprintf(header, sizeof(header), "%s\n%s%s%s%d %d\n%d\n", (m_channels == 3) ? "P6" : "P5", m_comment.empty() ? "" : "# ",
+		m_comment.c_str(), m_comment.empty() ? "" : "\n", m_width, m_height, (m_bitDepth == 16) ? 65535 : 255);
+	if((length <= 0) || (length >= (int)sizeof(header)))
+	{
+		return false;
+	}
+
+	if(fwrite(header, 1, length, file) != (size_t)length)
+	{
+		return false;
+	}
+
+	return (fwrite(&m_pixels[0], 1, m_pixels.size(), file) == m_pixels.size());
+}
+
+
+bool ImageExportClass::WriteRaw(FILE* file)
+{
+	std::vector<unsigned char> row;
+	const unsigned char* pixels;
+
+
+	// Bottom row first, with 16 bit samples swapped to low byte first.
+	row.resize(m_rowBytes);
+	for(int j=m_height-1; j>=0; j--)
+	{
+		pixels = GetRow(j);
+		if(m_bitDepth == 16)
+		{
+			for(int i=0; i<m_rowBytes; i+=2)
+			{
+				row[i] = pixels[i + 1];
+				row[i + 1] = pixels[i];
+			}
+			pixels = &row[0];
+		}
+
+		if(fwrite(pixels, 1, m_rowBytes, file) != (size_t)m_rowBytes)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool ImageExportClass::WriteChunk(FILE* file, const char* type, const unsigned char* data, int size)
+{
+	unsigned char bytes[8];
+	unsigned int crc;
+
+
+	PutBigEndian(&bytes[0], size);
+	memcpy(&bytes[4], type, 4);
+
+	crc = Crc(0xffffffff, (const unsigned char*)type, 4);
+	crc = Crc(crc, data, size) ^ 0xffffffff;
+
+	if(fwrite(bytes, 1, 8, file) != 8)
+	{
+		return false;
+	}
+	if((size > 0) && (fwrite(data, 1, size, file) != (size_t)size))
+	{
+		return false;
+	}
+
+	PutBigEndian(&bytes[0], crc);
+
+	return (fwrite(bytes, 1, 4, file) == 4);
+}
+
+
+void ImageExportClass::WorkerThread(int worker)
+{
+	std::unique_lock<std::mutex> lock(m_workMutex);
+	unsigned int round;
+
+
+	// Initialize resets the round before starting the threads, so an image started before this thread first waits is not missed.
+	round = 0;
+	while(true)
+	{
+		// Sleep until the next image.
+		m_workCondition.wait(lock, [this, round]() { return m_workQuit || (m_workRound != round); });
+		if(m_workQuit)
+		{
+			break;
+		}
+		round = m_workRound;
+
+		lock.unlock();
+		RunJobs(worker);
+		lock.lock();
+
+		m_workPending--;
+		if(m_workPending == 0)
+		{
+			m_doneCondition.notify_one();
+		}
+	}
+
+	return;
+}
+
+
+void ImageExportClass::RunJobs(int worker)
+{
+	int job;
+
+
+	// Take jobs until there are none left.
+	job = m_nextJob++;
+	while(job < (int)m_jobs.size())
+	{
+		EncodeJob(job, m_scratch[worker]);
+		job = m_nextJob++;
+	}
+
+	return;
+}
+
+
+void ImageExportClass::EncodeJob(int job, ScratchType& scratch)
+{
+	JobType& current = m_jobs[job];
+	std::vector<unsigned char>& output = current.output;
+	unsigned int crc;
+	int size;
+
+
+	// Filter the rows, which only look at the row above, so a job does not depend on the others.
+	size = (current.rowEnd - current.rowStart) * (m_rowBytes + 1);
+	scratch.filtered.resize(size);
+	for(int j=current.rowStart; j<current.rowEnd; j++)
+	{
+		FilterRow(j, &scratch.filtered[(j - current.rowStart) * (m_rowBytes + 1)]);
+	}
+
+	current.adler = Adler(&scratch.filtered[0], size);
+	current.length = (unsigned int)size;
+
+	// Room for the chunk length and type, then the stream header in front of the first job.
+	output.clear();
+	output.reserve(size / 2);
+	output.resize(8);
+	memcpy(&output[4], "IDAT", 4);
+	if(job == 0)
+	{
+		output.push_back(0x78);
+		output.push_back(0x01);
+	}
+
+	scratch.output = &output;
+	scratch.bits = 0;
+	scratch.bitCount = 0;
+	Deflate(&scratch.filtered[0], size, scratch);
+
+	// End on a byte with an empty stored block, which the next job's blocks can follow.
+	PutBits(scratch, 0, 3);
+	while(scratch.bitCount > 0)
+	{
+		output.push_back((unsigned char)scratch.bits);
+		scratch.bits >>= 8;
+		scratch.bitCount -= 8;
+	}
+	output.push_back(0x00);
+	output.push_back(0x00);
+	output.push_back(0xff);
+	output.push_back(0xff);
+
+	PutBigEndian(&output[0], (unsigned int)(output.size() - 8));
+	crc = Crc(0xffffffff, &output[4], output.size() - 4) ^ 0xffffffff;
+	output.resize(output.size() + 4);
+	PutBigEndian(&output[output.size() - 4], crc);
+
+	return;
+}
+
+
+void ImageExportClass::FilterRow(int row, unsigned char* output)
+{
+	const unsigned char *pixels, *above;
+	unsigned int sums[5], sumNone, sumSub, sumUp, sumAverage, sumPaeth;
+	int rowBytes, bytesPerPixel, best, value, left, up, upLeft, distanceLeft, distanceUp, distanceUpLeft, paeth;
+
+
+	pixels = GetRow(row);
+	above = (row > 0) ? GetRow(row - 1) : &m_zeroRow[0];
+	rowBytes = m_rowBytes;
+	bytesPerPixel = m_channels * (m_bitDepth / 8);
+
+	// Score each filter by the sum of its bytes taken as signed, the smallest usually compresses best. The
+	// first pixel has nothing on its left, so it is done apart and the loop over the rest has no branches.
+	sumNone = 0;
+	sumSub = 0;
+	sumUp = 0;
+	sumAverage = 0;
+	sumPaeth = 0;
+	for(int i=0; i<bytesPerPixel; i++)
+	{
+		value = pixels[i];
+		sumNone += abs((signed char)value);
+		sumSub += abs((signed char)value);
+		sumUp += abs((signed char)(value - above[i]));
+		sumAverage += abs((signed char)(value - (above[i] >> 1)));
+		sumPaeth += abs((signed char)(value - above[i]));
+	}
+
+	for(int i=bytesPerPixel; i<rowBytes; i++)
+	{
+		value = pixels[i];
+		left = pixels[i - bytesPerPixel];
+		up = above[i];
+		upLeft = above[i - bytesPerPixel];
+
+		distanceLeft = abs(up - upLeft);
+		distanceUp = abs(left - upLeft);
+		distanceUpLeft = abs(left + up - (2 * upLeft));
+		paeth = (distanceUp < distanceLeft) ? up : left;
+		paeth = (distanceUpLeft < std::min(distanceLeft, distanceUp)) ? upLeft : paeth;
+
+		sumNone += abs((signed char)value);
+		sumSub += abs((signed char)(value - left));
+		sumUp += abs((signed char)(value - up));
+		sumAverage += abs((signed char)(value - ((left + up) >> 1)));
+		sumPaeth += abs((signed char)(value - paeth));
+	}
+
+	sums[0] = sumNone;
+	sums[1] = sumSub;
+	sums[2] = sumUp;
+	sums[3] = sumAverage;
+	sums[4] = sumPaeth;
+
+	best = 0;
+	for(int k=1; k<5; k++)
+	{
+		if(sums[k] < sums[best])
+		{
+			best = k;
+		}
+	}
+
+	// Then write out the one picked, again with the first pixel apart.
+	output[0] = (unsigned char)best;
+	output++;
+	for(int i=0; i<bytesPerPixel; i++)
+	{
+		output[i] = (unsigned char)(pixels[i] - ((best == 0) || (best == 1) ? 0 : (best == 3) ? (above[i] >> 1) : above[i]));
+	}
+
+	switch(best)
+	{
+		case 0:
+			memcpy(output, pixels, rowBytes);
+			break;
+
+		case 1:
+			for(int i=bytesPerPixel; i<rowBytes; i++)
+			{
+				output[i] = (unsigned char)(pixels[i] - pixels[i - bytesPerPixel]);
+			}
+			break;
+
+		case 2:
+			for(int i=bytesPerPixel; i<rowBytes; i++)
+			{
+				output[i] = (unsigned char)(pixels[i] - above[i]);
+			}
+			break;
+
+		case 3:
+			for(int i=bytesPerPixel; i<rowBytes; i++)
+			{
+				output[i] = (unsigned char)(pixels[i] - ((pixels[i - bytesPerPixel] + above[i]) >> 1));
+			}
+			break;
+
+		default:
+			for(int i=bytesPerPixel; i<rowBytes; i++)
+			{
+				left = pixels[i - bytesPerPixel];
+				up = above[i];
+				upLeft = above[i - bytesPerPixel];
+				distanceLeft = abs(up - upLeft);
+				distanceUp = abs(left - upLeft);
+				distanceUpLeft = abs(left + up - (2 * upLeft));
+				paeth = (distanceUp < distanceLeft) ? up : left;
+				paeth = (distanceUpLeft < std::min(distanceLeft, distanceUp)) ? upLeft : paeth;
+				output[i] = (unsigned char)(pixels[i] - paeth);
+			}
+			break;
+	}
+
+	return;
+}
+
+
+void ImageExportClass::Deflate(const unsigned char* data, int size, ScratchType& scratch)
+{
+	unsigned int hash;
+	int position, candidate, length, bestLength, bestDistance, maxLength, depth, next;
+
+
+	std::fill(scratch.head.begin(), scratch.head.end(), -1);
+	memset(scratch.literalCounts, 0, sizeof(scratch.literalCounts));
+	memset(scratch.distanceCounts, 0, sizeof(scratch.distanceCounts));
+	scratch.symbols.clear();
+
+	// Greedy matching against a short chain of earlier places with the same three bytes.
+	position = 0;
+	while(position < size)
+	{
+		bestLength = 0;
+		bestDistance = 0;
+		if((position + MIN_MATCH) <= size)
+		{
+			hash = HashBytes(&data[position]);
+			candidate = scratch.head[hash];
+			scratch.chain[position & (WINDOW_SIZE - 1)] = candidate;
+			scratch.head[hash] = position;
+
+			maxLength = std::min(MAX_MATCH, size - position);
+			depth = IMAGEEXPORT_CHAIN_DEPTH;
+			while((candidate >= 0) && ((position - candidate) < WINDOW_SIZE) && (depth > 0))
+			{
+				if(data[candidate + bestLength] == data[position + bestLength])
+				{
+					length = 0;
+					while((length < maxLength) && (data[candidate + length] == data[position + length]))
+					{
+						length++;
+					}
+
+					if(length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = position - candidate;
+						if(length == maxLength)
+						{
+							break;
+						}
+					}
+				}
+
+				candidate = scratch.chain[candidate & (WINDOW_SIZE - 1)];
+				depth--;
+			}
+		}
+
+		if(bestLength >= MIN_MATCH)
+		{
+			scratch.symbols.push_back(MATCH_FLAG | (bestLength << 16) | bestDistance);
+			scratch.literalCounts[257 + m_lengthCodes[bestLength]]++;
+			scratch.distanceCounts[(bestDistance <= 256) ? m_distanceCodes[bestDistance - 1] : m_distanceCodes[256 + ((bestDistance - 1) >> 7)]]++;
+
+			// The places inside a match can be matched later too. Only the ends of a long one are kept, which
+			// is enough to carry on a run without hashing every byte of it.
+			for(int k=1; k<bestLength; k++)
+			{
+				if((k == MAX_INSERT) && (bestLength > (2 * MAX_INSERT)))
+				{
+					k = bestLength - MAX_INSERT;
+				}
+
+				next = position + k;
+				if((next + MIN_MATCH) <= size)
+				{
+					hash = HashBytes(&data[next]);
+					scratch.chain[next & (WINDOW_SIZE - 1)] = scratch.head[hash];
+					scratch.head[hash] = next;
+				}
+			}
+			position += bestLength;
+		}
+		else
+		{
+			scratch.symbols.push_back(data[position]);
+			scratch.literalCounts[data[position]]++;
+			position++;
+		}
+
+		if((int)scratch.symbols.size() >= IMAGEEXPORT_BLOCK_SYMBOLS)
+		{
+			WriteBlock(scratch);
+		}
+	}
+
+	if(!scratch.symbols.empty())
+	{
+		WriteBlock(scratch);
+	}
+
+	return;
+}
+
+
+void ImageExportClass::WriteBlock(ScratchType& scratch)
+{
+	unsigned char lengths[286 + 30], literalLengths[286], distanceLengths[30], codeLengthLengths[19];
+	unsigned short literalCodes[286], distanceCodes[30], codeLengthCodes[19];
+	unsigned int codeLengthCounts[19];
+	std::vector<unsigned short> runs;
+	unsigned int symbol;
+	int literalCount, distanceCount, codeLengthCount, total, run, step, length, distance, code;
+
+
+	// No symbol takes more than six bytes, so the block cannot outgrow this.
+	scratch.output->reserve(scratch.output->size() + (scratch.symbols.size() * 6) + 1024);
+
+	// Each block gets its own Huffman codes, built from what is in it.
+	scratch.literalCounts[256] = 1;
+	BuildLengths(scratch.literalCounts, 286, 15, literalLengths);
+	BuildLengths(scratch.distanceCounts, 30, 15, distanceLengths);
+	BuildCodes(literalLengths, 286, literalCodes);
+	BuildCodes(distanceLengths, 30, distanceCodes);
+
+	literalCount = 286;
+	while((literalCount > 257) && (literalLengths[literalCount - 1] == 0))
+	{
+		literalCount--;
+	}
+	distanceCount = 30;
+	while((distanceCount > 1) && (distanceLengths[distanceCount - 1] == 0))
+	{
+		distanceCount--;
+	}
+
+	// The code lengths go out run length coded, each run as a symbol and its extra bits.
+	memcpy(&lengths[0], literalLengths, literalCount);
+	memcpy(&lengths[literalCount], distanceLengths, distanceCount);
+	total = literalCount + distanceCount;
+
+	memset(codeLengthCounts, 0, sizeof(codeLengthCounts));
+	for(int i=0; i<total; )
+	{
+		run = 1;
+		while(((i + run) < total) && (lengths[i + run] == lengths[i]))
+		{
+			run++;
+		}
+
+		if((lengths[i] == 0) && (run >= 3))
+		{
+			step = std::min(run, 138);
+			runs.push_back((step >= 11) ? (unsigned short)(18 | ((step - 11) << 8)) : (unsigned short)(17 | ((step - 3) << 8)));
+			codeLengthCounts[(step >= 11) ? 18 : 17]++;
+			i += step;
+		}
+		else if((lengths[i] != 0) && (run >= 4))
+		{
+			runs.push_back(lengths[i]);
+			codeLengthCounts[lengths[i]]++;
+			step = std::min(run - 1, 6);
+			runs.push_back((unsigned short)(16 | ((step - 3) << 8)));
+			codeLengthCounts[16]++;
+			i += step + 1;
+		}
+		else
+		{
+			runs.push_back(lengths[i]);
+			codeLengthCounts[lengths[i]]++;
+			i++;
+		}
+	}
+
+	BuildLengths(codeLengthCounts, 19, 7, codeLengthLengths);
+	BuildCodes(codeLengthLengths, 19, codeLengthCodes);
+
+	codeLengthCount = 19;
+	while((codeLengthCount > 4) && (codeLengthLengths[CODE_LENGTH_ORDER[codeLengthCount - 1]] == 0))
+	{
+		codeLengthCount--;
+	}
+
+	// A block that is not the last, with dynamic codes.
+	PutBits(scratch, 0, 1);
+	PutBits(scratch, 2, 2);
+	PutBits(scratch, literalCount - 257, 5);
+	PutBits(scratch, distanceCount - 1, 5);
+	PutBits(scratch, codeLengthCount - 4, 4);
+	for(int i=0; i<codeLengthCount; i++)
+	{
+		PutBits(scratch, codeLengthLengths[CODE_LENGTH_ORDER[i]], 3);
+	}
+
+	for(unsigned int i=0; i<runs.size(); i++)
+	{
+		code = runs[i] & 0xff;
+		PutBits(scratch, codeLengthCodes[code], codeLengthLengths[code]);
+		if(code == 16)
+		{
+			PutBits(scratch, runs[i] >> 8, 2);
+		}
+		else if(code == 17)
+		{
+			PutBits(scratch, runs[i] >> 8, 3);
+		}
+		else if(code == 18)
+		{
+			PutBits(scratch, runs[i] >> 8, 7);
+		}
+	}
+
+	for(unsigned int i=0; i<scratch.symbols.size(); i++)
+	{
+		symbol = scratch.symbols[i];
+		if(!(symbol & MATCH_FLAG))
+		{
+			PutBits(scratch, literalCodes[symbol], literalLengths[symbol]);
+			continue;
+		}
+
+		length = (symbol >> 16) & 0x1ff;
+		distance = symbol & 0xffff;
+
+		code = m_lengthCodes[length];
+		PutBits(scratch, literalCodes[257 + code], literalLengths[257 + code]);
+		PutBits(scratch, length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+		code = (distance <= 256) ? m_distanceCodes[distance - 1] : m_distanceCodes[256 + ((distance - 1) >> 7)];
+		PutBits(scratch, distanceCodes[code], distanceLengths[code]);
+		PutBits(scratch, distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+	}
+
+	PutBits(scratch, literalCodes[256], literalLengths[256]);
+
+	memset(scratch.literalCounts, 0, sizeof(scratch.literalCounts));
+	memset(scratch.distanceCounts, 0, sizeof(scratch.distanceCounts));
+	scratch.symbols.clear();
+
+	return;
+}
+
+
+void ImageExportClass::BuildLengths(const unsigned int* counts, int count, int limit, unsigned char* lengths)
+{
+	unsigned int weights[286 * 3];
+	int leaves[286], parents[286 * 2], depths[286 * 2];
+	int leafCount, nodeCount, nextLeaf, nextNode, child, maxDepth;
+
+
+	memset(lengths, 0, count);
+
+	// A code needs at least two symbols to be complete, so unused ones are brought in if need be.
+	leafCount = 0;
+	for(int i=0; i<count; i++)
+	{
+		weights[i] = counts[i];
+		if(counts[i] > 0)
+		{
+			leafCount++;
+		}
+	}
+	for(int i=0; (i<count) && (leafCount < 2); i++)
+	{
+		if(weights[i] == 0)
+		{
+			weights[i] = 1;
+			leafCount++;
+		}
+	}
+
+	leafCount = 0;
+	for(int i=0; i<count; i++)
+	{
+		if(weights[i] > 0)
+		{
+			leaves[leafCount++] = i;
+		}
+	}
+
+	while(true)
+	{
+		std::sort(leaves, leaves + leafCount, [&weights](int a, int b) { return weights[a] < weights[b]; });
+
+		// Huffman's merge with two queues: the sorted leaves, and the joined nodes, which come out in order.
+		// Leaves are nodes 0 to leafCount - 1 in sorted order, joined nodes follow.
+		for(int i=0; i<leafCount; i++)
+		{
+			weights[count + i] = weights[leaves[i]];
+		}
+
+		nextLeaf = 0;
+		nextNode = leafCount;
+		nodeCount = leafCount;
+		while(nodeCount < ((2 * leafCount) - 1))
+		{
+			weights[count + nodeCount] = 0;
+			for(int k=0; k<2; k++)
+			{
+				if((nextLeaf < leafCount) && ((nextNode >= nodeCount) || (weights[count + nextLeaf] <= weights[count + nextNode])))
+				{
+					child = nextLeaf++;
+				}
+				else
+				{
+					child = nextNode++;
+				}
+				parents[child] = nodeCount;
+				weights[count + nodeCount] += weights[count + child];
+			}
+			nodeCount++;
+		}
+
+		// Parents always come after their children, so depths can be filled in from the root down.
+		depths[nodeCount - 1] = 0;
+		maxDepth = 0;
+		for(int i=nodeCount-2; i>=0; i--)
+		{
+			depths[i] = depths[parents[i]] + 1;
+			maxDepth = std::max(maxDepth, depths[i]);
+		}
+
+		if(maxDepth <= limit)
+		{
+			break;
+		}
+
+		// Too deep, so flatten the weights and try again.
+		for(int i=0; i<leafCount; i++)
+		{
+			weights[leaves[i]] = (weights[leaves[i]] + 1) >> 1;
+		}
+	}
+
+	for(int i=0; i<leafCount; i++)
+	{
+		lengths[leaves[i]] = (unsigned char)depths[i];
+	}
+
+	return;
+}
+
+
+void ImageExportClass::BuildCodes(const unsigned char* lengths, int count, unsigned short* codes)
+{
+	int lengthCounts[16], nextCodes[16];
+	int code, reversed;
+
+
+	// Canonical codes, reversed since deflate sends them from their last bit.
+	memset(lengthCounts, 0, sizeof(lengthCounts));
+	for(int i=0; i<count; i++)
+	{
+		lengthCounts[lengths[i]]++;
+	}
+	lengthCounts[0] = 0;
+
+	code = 0;
+	for(int bits=1; bits<16; bits++)
+	{
+		code = (code + lengthCounts[bits - 1]) << 1;
+		nextCodes[bits] = code;
+	}
+
+	for(int i=0; i<count; i++)
+	{
+		codes[i] = 0;
+		if(lengths[i] == 0)
+		{
+			continue;
+		}
+
+		code = nextCodes[lengths[i]]++;
+		reversed = 0;
+		for(int k=0; k<lengths[i]; k++)
+		{
+			reversed = (reversed << 1) | ((code >> k) & 1);
+		}
+		codes[i] = (unsigned short)reversed;
+	}
+
+	return;
+}
+
+
+void ImageExportClass::PutBits(ScratchType& scratch, unsigned int value, int count)
+{
+	std::vector<unsigned char>& output = *scratch.output;
+
+
+	scratch.bits |= (unsigned long long)value << scratch.bitCount;
+	scratch.bitCount += count;
+	if(scratch.bitCount >= 32)
+	{
+		output.push_back((unsigned char)scratch.bits);
+		output.push_back((unsigned char)(scratch.bits >> 8));
+		output.push_back((unsigned char)(scratch.bits >> 16));
+		output.push_back((unsigned char)(scratch.bits >> 24));
+		scratch.bits >>= 32;
+		scratch.bitCount -= 32;
+	}
+
+	return;
+}
+
+
+unsigned int ImageExportClass::Crc(unsigned int crc, const unsigned char* data, size_t size)
+{
+	for(size_t i=0; i<size; i++)
+	{
+		crc = m_crcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+
+	return crc;
+}
@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: imageexportclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _IMAGEEXPORTCLASS_H_
+#define _IMAGEEXPORTCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int IMAGEEXPORT_JOB_BYTES = 2 * 1024 * 1024;
+const int IMAGEEXPORT_BLOCK_SYMBOLS = 16384;
+const int IMAGEEXPORT_CHAIN_DEPTH = 4;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ImageExportClass
+////////////////////////////////////////////////////////////////////////////////
+// Writes an 8 or 16 bit gray or RGB image as a PNG, a binary PGM or PPM, or raw
+// samples. The caller fills the rows, top row first and in PNG byte order, so 16
+// bit samples go high byte first, and the same pixels can be written out in as
+// many formats as wanted.
+//
+// A PNG is cut into jobs of a couple of megabytes of rows. Each job picks a
+// filter for every row, then deflates the rows with its own matcher and Huffman
+// tables into a run of blocks that ends on a byte, so the jobs can be done on
+// any thread in any order and their IDAT chunks simply written one after
+// another. The checksum of the whole stream is put together from those of the
+// jobs. A thread is started for every core but the first, which is the caller's.
+//
+// Raw files are written bottom row first with 16 bit samples low byte first, the
+// way HeightMapFileClass reads .r16.
+class ImageExportClass
+{
+public:
+	enum FormatType
+	{
+		FORMAT_PNG,
+		FORMAT_PGM,
+		FORMAT_RAW
+	};
+
+private:
+	struct JobType
+	{
+		int rowStart, rowEnd;
+		std::vector<unsigned char> output;
+		unsigned int adler;
+		unsigned int length;
+	};
+
+	struct ScratchType
+	{
+		std::vector<unsigned char> filtered;
+		std::vector<int> head, chain;
+		std::vector<unsigned int> symbols;
+		unsigned int literalCounts[286], distanceCounts[30];
+		std::vector<unsigned char>* output;
+		unsigned long long bits;
+		int bitCount;
+	};
+
+public:
+	ImageExportClass();
+	ImageExportClass(const ImageExportClass&);
+	~ImageExportClass();
+
+	bool Initialize(int width, int height);
+	void Shutdown();
+
+	bool SetPixelType(int channels, int bitDepth);
+	unsigned char* GetRow(int row);
+	void SetComment(const char* comment);
+
+	bool Write(const char* filename, FormatType format);
+	float GetEncodeTime();
+
+private:
+	bool WritePng(FILE* file);
+	bool WritePixmap(FILE* file);
+	bool WriteRaw(FILE* file);
+	bool WriteChunk(FILE* file, const char* type, const unsigned char* data, int size);
+
+	void WorkerThread(int worker);
+	void RunJobs(int worker);
+	void EncodeJob(int job, ScratchType& scratch);
+	void FilterRow(int row, unsigned char* output);
+	void Deflate(const unsigned char* data, int size, ScratchType& scratch);
+	void WriteBlock(ScratchType& scratch);
+	void BuildLengths(const unsigned int* counts, int count, int limit, unsigned char* lengths);
+	void BuildCodes(const unsigned char* lengths, int count, unsigned short* codes);
+	void PutBits(ScratchType& scratch, unsigned int value, int count);
+	unsigned int Crc(unsigned int crc, const unsigned char* data, size_t size);
+
+private:
+	int m_width, m_height, m_channels, m_bitDepth, m_rowBytes;
+	std::vector<unsigned char> m_pixels, m_zeroRow;
+	std::string m_comment;
+	float m_encodeTime;
+
+	unsigned int m_crcTable[256];
+	unsigned char m_lengthCodes[259], m_distanceCodes[512];
+
+	std::vector<JobType> m_jobs;
+	std::vector<ScratchType> m_scratch;
+	std::atomic<int> m_nextJob;
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_workMutex;
+	std::condition_variable m_workCondition, m_doneCondition;
+	unsigned int m_workRound;
+	int m_workPending;
+	bool m_workQuit;
+};
+
+#endif
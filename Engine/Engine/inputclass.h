@@ -50,6 +50,7 @@ public:
 	bool IsQPressed();
 	bool IsRPressed();
 	bool IsCPressed();
+	bool IsEPressed();
 	bool IsWPressed();
 	bool IsSPressed();
 	bool IsDPressed();
@@ -57,6 +58,14 @@ public:
 	bool IsPPressed();
 	bool IsZPressed();
 	bool IsKPressed();
+	bool IsLPressed();
+	bool IsUPressed();
+	bool IsF2Pressed();
+	bool IsF3Pressed();
+	bool IsF5Pressed();
+	bool IsF6Pressed();
+	bool IsF7Pressed();
+	bool IsF9Pressed();
 	bool IsPgUpPressed();
 	bool IsPgDownPressed();
 
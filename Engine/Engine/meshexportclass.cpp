@@ -0,0 +1,489 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: meshexportclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "meshexportclass.h"
+#include <cstring>
+#include <cmath>
+
+
+MeshExportClass::MeshExportClass()
+{
+	m_file = 0;
+	m_format = FORMAT_GLB;
+	m_width = 0;
+	m_height = 0;
+	m_minHeight = 0.0f;
+	m_maxHeight = 0.0f;
+	m_textureScale = 0.0f;
+	m_row = 0;
+	m_sign = 1.0f;
+	m_bufferUsed = 0;
+	m_failed = false;
+}
+
+
+MeshExportClass::MeshExportClass(const MeshExportClass& other)
+{
+}
+
+
+MeshExportClass::~MeshExportClass()
+{
+}
+
+
+bool MeshExportClass::Initialize(const char* filename, FormatType format, int width, int height, float minHeight, float maxHeight, float textureScale)
+{
+	if((width < 2) || (height < 2))
+	{
+		return false;
+	}
+
+	m_filename = filename;
+	m_format = format;
+	m_width = width;
+	m_height = height;
+	m_minHeight = minHeight;
+	m_maxHeight = maxHeight;
+	m_textureScale = textureScale;
+	m_row = 0;
+	m_failed = false;
+
+	// Everything but the raw format is mirrored into right handed space.
+	m_sign = (m_format == FORMAT_RAW) ? 1.0f : -1.0f;
+
+	m_buffer.resize(MESHEXPORT_CHUNK_BYTES);
+	m_bufferUsed = 0;
+
+	return WriteHeader();
+}
+
+
+void MeshExportClass::Shutdown()
+{
+	if(m_file)
+	{
+		fclose(m_file);
+		m_file = 0;
+	}
+
+	std::vector<char>().swap(m_buffer);
+	m_bufferUsed = 0;
+
+	return;
+}
+
+
+bool MeshExportClass::WriteRow(const float* heights, const float* normals, int stride)
+{
+	float vertex[8];
+
+
+	if(m_failed || (m_row >= m_height))
+	{
+		return false;
+	}
+
+	for(int i=0; i<m_width; i++)
+	{
+		// Position, normal and texture coordinates, with z and the normal's z mirrored outside the raw format.
+		vertex[0] = (float)i;
+		vertex[1] = heights[i * stride];
+		vertex[2] = (float)m_row * m_sign;
+		vertex[3] = normals[i * stride];
+		vertex[4] = normals[(i * stride) + 1];
+		vertex[5] = normals[(i * stride) + 2] * m_sign;
+		vertex[6] = (float)i * m_textureScale;
+		vertex[7] = 1.0f - ((float)m_row * m_textureScale);
+
+		if(m_format != FORMAT_OBJ)
+		{
+			WriteBytes(vertex, sizeof(vertex));
+			continue;
+		}
+
+		WriteText("v ");
+		WriteDecimal(vertex[0]);
+		WriteText(" ");
+		WriteDecimal(vertex[1]);
+		WriteText(" ");
+		WriteDecimal(vertex[2]);
+		WriteText("\nvn ");
+		WriteDecimal(vertex[3]);
+		WriteText(" ");
+		WriteDecimal(vertex[4]);
+		WriteText(" ");
+		WriteDecimal(vertex[5]);
+		WriteText("\nvt ");
+		WriteDecimal(vertex[6]);
+		WriteText(" ");
+		WriteDecimal(vertex[7]);
+		WriteText("\n");
+	}
+
+	// An OBJ face can come as soon as its vertices have, so the faces of a row of quads follow its top row.
+	if((m_format == FORMAT_OBJ) && (m_row > 0))
+	{
+		WriteObjFaces(m_row - 1);
+	}
+
+	m_row++;
+
+	return !m_failed;
+}
+
+
+bool MeshExportClass::Finish()
+{
+	// Every row has to be in before the indices, which are worked out rather than stored.
+	if(m_failed || (m_row != m_height))
+	{
+		return false;
+	}
+
+	if(m_format != FORMAT_OBJ)
+	{
+		for(int j=0; j<(m_height - 1); j++)
+		{
+			WriteIndexRow(j);
+		}
+	}
+
+	Flush();
+
+	if(fclose(m_file) != 0)
+	{
+		m_failed = true;
+	}
+	m_file = 0;
+
+	return !m_failed;
+}
+
+
+bool MeshExportClass::WriteHeader()
+{
+	unsigned long long vertexCount, indexCount, vertexBytes, indexBytes, totalBytes;
+	unsigned int words[5];
+	std::string json, binaryName, binaryFile;
+	char text[2048];
+	size_t slash, dot;
+	FILE* jsonFile;
+
+
+	vertexCount = (unsigned long long)m_width * m_height;
+	indexCount = (unsigned long long)(m_width - 1) * (m_height - 1) * 6;
+	vertexBytes = vertexCount * 8 * sizeof(float);
+	indexBytes = indexCount * sizeof(unsigned int);
+	totalBytes = 0;
+
+	// Indices are 32 bit.
+	if(vertexCount > 0xffffffffULL)
+	{
+		return false;
+	}
+
+	// The data of a .gltf goes in a .bin next to it.
+	binaryFile = m_filename;
+	if(m_format == FORMAT_GLTF)
+	{
+		dot = binaryFile.find_last_of('.');
+		slash = binaryFile.find_last_of("/\\");
+		if((dot != std::string::npos) && ((slash == std::string::npos) || (dot > slash)))
+		{
+			binaryFile.erase(dot);
+		}
+		binaryFile += ".bin";
+
+		slash = binaryFile.find_last_of("/\\");
+		binaryName = (slash == std::string::npos) ? binaryFile : binaryFile.substr(slash + 1);
+	}
+
+	if((m_format == FORMAT_GLB) || (m_format == FORMAT_GLTF))
+	{
+		// One mesh with the vertices interleaved in one buffer view and the indices in another. The position
+		// accessor has to carry its bounds.
+		snprintf(text, sizeof(text),
+			"{\"asset\":{\"version\":\"2.0\",\"generator\":\"DungeonGen\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+			"\"buffers\":[{%s%s%s\"byteLength\":%llu}],"
+			"\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%llu,\"byteStride\":32,\"target\":34962},"
+			"{\"buffer\":0,\"byteOffset\":%llu,\"byteLength\":%llu,\"target\":34963}],"
+			"\"accessors\":[{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":%llu,\"type\":\"VEC3\",\"min\":[0,%.9g,%d],\"max\":[%d,%.9g,0]},"
+			"{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":%llu,\"type\":\"VEC3\"},"
+			"{\"bufferView\":0,\"byteOffset\":24,\"componentType\":5126,\"count\":%llu,\"type\":\"VEC2\"},"
+			"{\"bufferView\":1,\"byteOffset\":0,\"componentType\":5125,\"count\":%llu,\"type\":\"SCALAR\"}]}",
+			(m_format == FORMAT_GLTF) ? "\"uri\":\"" : "", binaryName.c_str(), (m_format == FORMAT_GLTF) ? "\"," : "",
+			vertexBytes + indexBytes, vertexBytes, vertexBytes, indexBytes,
+			vertexCount, m_minHeight, -(m_height - 1), m_width - 1, m_maxHeight, vertexCount, vertexCount, indexCount);
+		json = text;
+	}
+
+	if(m_format == FORMAT_GLB)
+	{
+		// The JSON chunk is padded with spaces to four bytes. Vertices and indices are already multiples of four.
+		while(json.size() % 4)
+		{
+			json += ' ';
+		}
+
+		// Sizes in a .glb are 32 bit, so a bigger mesh has to go to a .gltf and .bin.
+		totalBytes = 12 + 8 + json.size() + 8 + vertexBytes + indexBytes;
+		if(totalBytes > 0xffffffffULL)
+		{
+			return false;
+		}
+	}
+
+	if(m_format == FORMAT_GLTF)
+	{
+		if(fopen_s(&jsonFile, m_filename.c_str(), "wb") != 0)
+		{
+			return false;
+		}
+
+		fwrite(json.c_str(), 1, json.size(), jsonFile);
+		if(fclose(jsonFile) != 0)
+		{
+			return false;
+		}
+	}
+
+	if(fopen_s(&m_file, binaryFile.c_str(), "wb") != 0)
+	{
+		m_file = 0;
+		return false;
+	}
+
+	switch(m_format)
+	{
+		case FORMAT_GLB:
+			words[0] = 0x46546C67;
+			words[1] = 2;
+			words[2] = (unsigned int)totalBytes;
+			words[3] = (unsigned int)json.size();
+			words[4] = 0x4E4F534A;
+			WriteBytes(words, sizeof(words));
+			WriteBytes(json.c_str(), (int)json.size());
+
+			words[0] = (unsigned int)(vertexBytes + indexBytes);
+			words[1] = 0x004E4942;
+			WriteBytes(words, 2 * sizeof(unsigned int));
+			break;
+
+		case FORMAT_RAW:
+			WriteBytes("DGMR", 4);
+			words[0] = 1;
+			words[1] = m_width;
+			words[2] = m_height;
+			WriteBytes(words, 3 * sizeof(unsigned int));
+			WriteBytes(&vertexCount, sizeof(vertexCount));
+			WriteBytes(&indexCount, sizeof(indexCount));
+			break;
+
+		case FORMAT_OBJ:
+			snprintf(text, sizeof(text), "# DungeonGen terrain, %d x %d cells\n", m_width, m_height);
+			WriteText(text);
+			break;
+
+		default:
+			break;
+	}
+
+	return !m_failed;
+}
+
+
+bool MeshExportClass::WriteIndexRow(int row)
+{
+	unsigned int indices[6];
+	unsigned int bottomLeft, bottomRight, upperLeft, upperRight;
+
+
+	for(int i=0; i<(m_width - 1); i++)
+	{
+		bottomLeft = (row * m_width) + i;
+		bottomRight = bottomLeft + 1;
+		upperLeft = bottomLeft + m_width;
+		upperRight = upperLeft + 1;
+
+		// The renderer's triangles, turned round when mirrored so they still face up.
+		if(m_format == FORMAT_RAW)
+		{
+			indices[0] = upperLeft;
+			indices[1] = upperRight;
+			indices[2] = bottomLeft;
+			indices[3] = bottomLeft;
+			indices[4] = upperRight;
+			indices[5] = bottomRight;
+		}
+		else
+		{
+			indices[0] = upperLeft;
+			indices[1] = bottomLeft;
+			indices[2] = upperRight;
+			indices[3] = bottomLeft;
+			indices[4] = bottomRight;
+			indices[5] = upperRight;
+		}
+
+		WriteBytes(indices, sizeof(indices));
+	}
+
+	return !m_failed;
+}
+
+
+void MeshExportClass::WriteObjFaces(int row)
+{
+	unsigned long long corners[6];
+
+
+	for(int i=0; i<(m_width - 1); i++)
+	{
+		// OBJ counts from one, and each corner uses the same index for its position, coordinates and normal.
+		corners[0] = ((unsigned long long)(row + 1) * m_width) + i + 1;
+		corners[1] = ((unsigned long long)row * m_width) + i + 1;
+		corners[2] = corners[0] + 1;
+		corners[3] = corners[1];
+		corners[4] = corners[1] + 1;
+		corners[5] = corners[2];
+
+		for(int k=0; k<6; k++)
+		{
+			WriteText(((k % 3) == 0) ? "f " : " ");
+			WriteInteger(corners[k]);
+			WriteText("/");
+			WriteInteger(corners[k]);
+			WriteText("/");
+			WriteInteger(corners[k]);
+			if((k % 3) == 2)
+			{
+				WriteText("\n");
+			}
+		}
+	}
+
+	return;
+}
+
+
+void MeshExportClass::WriteText(const char* text)
+{
+	WriteBytes(text, (int)strlen(text));
+
+	return;
+}
+
+
+void MeshExportClass::WriteDecimal(float value)
+{
+	char digits[32];
+	long long scaled, whole;
+	int fraction, count, length;
+
+
+	// printf is far too slow for a file of this many numbers. Up to five decimal places, with the trailing
+	// zeros left off, is finer than a float holds at terrain heights.
+	if(!(fabs(value) < 1.0e9f))
+	{
+		length = snprintf(digits, sizeof(digits), "%g", value);
+		WriteBytes(digits, length);
+		return;
+	}
+
+	scaled = (long long)floor((fabs(value) * 100000.0) + 0.5);
+	whole = scaled / 100000;
+	fraction = (int)(scaled % 100000);
+
+	length = 0;
+	if((value < 0.0f) && (scaled != 0))
+	{
+		digits[length++] = '-';
+	}
+
+	count = 0;
+	do
+	{
+		digits[31 - count] = (char)('0' + (whole % 10));
+		whole /= 10;
+		count++;
+	}
+	while(whole > 0);
+	memmove(&digits[length], &digits[32 - count], count);
+	length += count;
+
+	if(fraction != 0)
+	{
+		digits[length++] = '.';
+		for(int divisor=10000; (divisor > 0) && (fraction != 0); divisor/=10)
+		{
+			digits[length++] = (char)('0' + (fraction / divisor));
+			fraction %= divisor;
+		}
+	}
+
+	WriteBytes(digits, length);
+
+	return;
+}
+
+
+void MeshExportClass::WriteInteger(unsigned long long value)
+{
+	char digits[24];
+	int count;
+
+
+	count = 0;
+	do
+	{
+		digits[23 - count] = (char)('0' + (value % 10));
+		value /= 10;
+		count++;
+	}
+	while(value > 0);
+
+	WriteBytes(&digits[24 - count], count);
+
+	return;
+}
+
+
+void MeshExportClass::WriteBytes(const void* data, int size)
+{
+	// Small writes go through the buffer, which is written out whenever it fills.
+	if((m_bufferUsed + size) > (int)m_buffer.size())
+	{
+		Flush();
+	}
+
+	if(size > (int)m_buffer.size())
+	{
+		if(fwrite(data, 1, size, m_file) != (size_t)size)
+		{
+			m_failed = true;
+		}
+		return;
+	}
+
+	memcpy(&m_buffer[m_bufferUsed], data, size);
+	m_bufferUsed += size;
+
+	return;
+}
+
+
+bool MeshExportClass::Flush()
+{
+	if(m_bufferUsed > 0)
+	{
+		if(fwrite(&m_buffer[0], 1, m_bufferUsed, m_file) != (size_t)m_bufferUsed)
+		{
+			m_failed = true;
+		}
+		m_bufferUsed = 0;
+	}
+
+	return !m_failed;
+}
@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: meshexportclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _MESHEXPORTCLASS_H_
+#define _MESHEXPORTCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <stdio.h>
+#include <vector>
+#include <string>
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int MESHEXPORT_CHUNK_BYTES = 1024 * 1024;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: MeshExportClass
+////////////////////////////////////////////////////////////////////////////////
+// Writes a height field out as an indexed triangle mesh for other tools, with no
+// Direct3D involved. Rows of heights and normals are handed over one at a time
+// and go to the file through a fixed size buffer, so the mesh is never held
+// whole and a map of any size exports in the same memory. Every cell is one
+// vertex, with the position and normal of the height map and texture coordinates
+// that carry on across the map rather than wrapping, and each quad is the same
+// two triangles the renderer draws.
+//
+// Binary glTF, and glTF with the data in a .bin beside it for meshes over the
+// 4GB a .glb can hold, turn the left handed terrain into the right handed glTF
+// space by mirroring z. So does OBJ, which is text and so much slower. The raw
+// format is the renderer's own layout: a small header, the vertices as they go
+// in the vertex buffer, then 32 bit indices.
+class MeshExportClass
+{
+public:
+	enum FormatType
+	{
+		FORMAT_GLB,
+		FORMAT_GLTF,
+		FORMAT_OBJ,
+		FORMAT_RAW
+	};
+
+public:
+	MeshExportClass();
+	MeshExportClass(const MeshExportClass&);
+	~MeshExportClass();
+
+	bool Initialize(const char* filename, FormatType format, int width, int height, float minHeight, float maxHeight, float textureScale);
+	void Shutdown();
+
+	bool WriteRow(const float* heights, const float* normals, int stride);
+	bool Finish();
+
+private:
+	bool WriteHeader();
+	bool WriteIndexRow(int row);
+	void WriteObjFaces(int row);
+	void WriteText(const char* text);
+	void WriteDecimal(float value);
+	void WriteInteger(unsigned long long value);
+	void WriteBytes(const void* data, int size);
+	bool Flush();
+
+private:
+	FILE* m_file;
+	std::string m_filename;
+	FormatType m_format;
+	int m_width, m_height;
+	float m_minHeight, m_maxHeight, m_textureScale;
+	int m_row;
+	float m_sign;
+	std::vector<char> m_buffer;
+	int m_bufferUsed;
+	bool m_failed;
+};
+
+#endif
@@ -0,0 +1,305 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noisecombinerclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "noisecombinerclass.h"
+#include <cmath>
+
+
+FractalNoiseClass::FractalNoiseClass()
+{
+	m_source = 0;
+	m_octaves = 0;
+	m_frequency = 0.0f;
+	m_lacunarity = 0.0f;
+	m_gain = 0.0f;
+}
+
+
+FractalNoiseClass::FractalNoiseClass(const FractalNoiseClass& other)
+{
+}
+
+
+FractalNoiseClass::~FractalNoiseClass()
+{
+}
+
+
+bool FractalNoiseClass::Initialize(const NoiseSourceClass* source, int octaves, float frequency, float lacunarity, float gain)
+{
+	if(!source || (octaves < 1))
+	{
+		return false;
+	}
+
+	m_source = source;
+	m_octaves = octaves;
+	m_frequency = frequency;
+	m_lacunarity = lacunarity;
+	m_gain = gain;
+
+	return true;
+}
+
+
+void FractalNoiseClass::Sample(const float* x, const float* y, int count, float* values) const
+{
+	float xs[NOISE_BATCH_SIZE], ys[NOISE_BATCH_SIZE], octave[NOISE_BATCH_SIZE];
+	float frequency, amplitude, total;
+	int batch;
+
+
+	for(int start=0; start<count; start+=NOISE_BATCH_SIZE)
+	{
+		batch = (count - start < NOISE_BATCH_SIZE) ? (count - start) : NOISE_BATCH_SIZE;
+		for(int i=0; i<batch; i++)
+		{
+			values[start + i] = 0.0f;
+		}
+
+		// Add each octave of the batch, the whole batch at a time.
+		frequency = m_frequency;
+		amplitude = 1.0f;
+		total = 0.0f;
+		for(int k=0; k<m_octaves; k++)
+		{
+			for(int i=0; i<batch; i++)
+			{
+				xs[i] = x[start + i] * frequency;
+				ys[i] = y[start + i] * frequency;
+			}
+
+			m_source->Sample(xs, ys, batch, octave);
+			for(int i=0; i<batch; i++)
+			{
+				values[start + i] += octave[i] * amplitude;
+			}
+
+			total += amplitude;
+			frequency *= m_lacunarity;
+			amplitude *= m_gain;
+		}
+
+		for(int i=0; i<batch; i++)
+		{
+			values[start + i] /= total;
+		}
+	}
+
+	return;
+}
+
+
+RidgedNoiseClass::RidgedNoiseClass()
+{
+	m_source = 0;
+}
+
+
+RidgedNoiseClass::RidgedNoiseClass(const RidgedNoiseClass& other)
+{
+}
+
+
+RidgedNoiseClass::~RidgedNoiseClass()
+{
+}
+
+
+bool RidgedNoiseClass::Initialize(const NoiseSourceClass* source)
+{
+	if(!source)
+	{
+		return false;
+	}
+
+	m_source = source;
+
+	return true;
+}
+
+
+void RidgedNoiseClass::Sample(const float* x, const float* y, int count, float* values) const
+{
+	float ridge;
+
+
+	m_source->Sample(x, y, count, values);
+
+	// Squaring sharpens the ridge, then it is put back into -1 to 1.
+	for(int i=0; i<count; i++)
+	{
+		ridge = 1.0f - std::fabs(values[i]);
+		values[i] = (2.0f * ridge * ridge) - 1.0f;
+	}
+
+	return;
+}
+
+
+BillowNoiseClass::BillowNoiseClass()
+{
+	m_source = 0;
+}
+
+
+BillowNoiseClass::BillowNoiseClass(const BillowNoiseClass& other)
+{
+}
+
+
+BillowNoiseClass::~BillowNoiseClass()
+{
+}
+
+
+bool BillowNoiseClass::Initialize(const NoiseSourceClass* source)
+{
+	if(!source)
+	{
+		return false;
+	}
+
+	m_source = source;
+
+	return true;
+}
+
+
+void BillowNoiseClass::Sample(const float* x, const float* y, int count, float* values) const
+{
+	m_source->Sample(x, y, count, values);
+
+	for(int i=0; i<count; i++)
+	{
+		values[i] = (2.0f * std::fabs(values[i])) - 1.0f;
+	}
+
+	return;
+}
+
+
+DomainWarpNoiseClass::DomainWarpNoiseClass()
+{
+	m_source = 0;
+	m_warp = 0;
+	m_strength = 0.0f;
+}
+
+
+DomainWarpNoiseClass::DomainWarpNoiseClass(const DomainWarpNoiseClass& other)
+{
+}
+
+
+DomainWarpNoiseClass::~DomainWarpNoiseClass()
+{
+}
+
+
+bool DomainWarpNoiseClass::Initialize(const NoiseSourceClass* source, const NoiseSourceClass* warp, float strength)
+{
+	if(!source || !warp)
+	{
+		return false;
+	}
+
+	m_source = source;
+	m_warp = warp;
+	m_strength = strength;
+
+	return true;
+}
+
+
+void DomainWarpNoiseClass::Sample(const float* x, const float* y, int count, float* values) const
+{
+	const float apartX = 5.2f, apartY = 1.3f;
+	float xs[NOISE_BATCH_SIZE], ys[NOISE_BATCH_SIZE], warpX[NOISE_BATCH_SIZE], warpY[NOISE_BATCH_SIZE];
+	int batch;
+
+
+	for(int start=0; start<count; start+=NOISE_BATCH_SIZE)
+	{
+		batch = (count - start < NOISE_BATCH_SIZE) ? (count - start) : NOISE_BATCH_SIZE;
+
+		// The warp for x is sampled at the point, the one for y at a point well away from it.
+		m_warp->Sample(x + start, y + start, batch, warpX);
+		for(int i=0; i<batch; i++)
+		{
+			xs[i] = x[start + i] + apartX;
+			ys[i] = y[start + i] + apartY;
+		}
+		m_warp->Sample(xs, ys, batch, warpY);
+
+		for(int i=0; i<batch; i++)
+		{
+			xs[i] = x[start + i] + (warpX[i] * m_strength);
+			ys[i] = y[start + i] + (warpY[i] * m_strength);
+		}
+		m_source->Sample(xs, ys, batch, values + start);
+	}
+
+	return;
+}
+
+
+ScaleOffsetNoiseClass::ScaleOffsetNoiseClass()
+{
+	m_source = 0;
+	m_frequency = 0.0f;
+	m_scale = 0.0f;
+	m_offset = 0.0f;
+}
+
+
+ScaleOffsetNoiseClass::ScaleOffsetNoiseClass(const ScaleOffsetNoiseClass& other)
+{
+}
+
+
+ScaleOffsetNoiseClass::~ScaleOffsetNoiseClass()
+{
+}
+
+
+bool ScaleOffsetNoiseClass::Initialize(const NoiseSourceClass* source, float frequency, float scale, float offset)
+{
+	if(!source)
+	{
+		return false;
+	}
+
+	m_source = source;
+	m_frequency = frequency;
+	m_scale = scale;
+	m_offset = offset;
+
+	return true;
+}
+
+
+void ScaleOffsetNoiseClass::Sample(const float* x, const float* y, int count, float* values) const
+{
+	float xs[NOISE_BATCH_SIZE], ys[NOISE_BATCH_SIZE];
+	int batch;
+
+
+	for(int start=0; start<count; start+=NOISE_BATCH_SIZE)
+	{
+		batch = (count - start < NOISE_BATCH_SIZE) ? (count - start) : NOISE_BATCH_SIZE;
+		for(int i=0; i<batch; i++)
+		{
+			xs[i] = x[start + i] * m_frequency;
+			ys[i] = y[start + i] * m_frequency;
+		}
+
+		m_source->Sample(xs, ys, batch, values + start);
+		for(int i=0; i<batch; i++)
+		{
+			values[start + i] = (values[start + i] * m_scale) + m_offset;
+		}
+	}
+
+	return;
+}
@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noisecombinerclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _NOISECOMBINERCLASS_H_
+#define _NOISECOMBINERCLASS_H_
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "noisesourceclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int NOISE_OCTAVES = 5;
+const float NOISE_FREQUENCY = 1.0f / 128.0f;
+const float NOISE_WARP = 32.0f;
+const float NOISE_AMPLITUDE = 4.0f;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: FractalNoiseClass
+////////////////////////////////////////////////////////////////////////////////
+// Sums octaves of a source, each at a higher frequency and lower amplitude than
+// the one before, scaled back into the range of one octave.
+class FractalNoiseClass : public NoiseSourceClass
+{
+public:
+	FractalNoiseClass();
+	FractalNoiseClass(const FractalNoiseClass&);
+	~FractalNoiseClass();
+
+	bool Initialize(const NoiseSourceClass* source, int octaves, float frequency, float lacunarity, float gain);
+
+	void Sample(const float* x, const float* y, int count, float* values) const;
+
+private:
+	const NoiseSourceClass* m_source;
+	int m_octaves;
+	float m_frequency, m_lacunarity, m_gain;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: RidgedNoiseClass
+////////////////////////////////////////////////////////////////////////////////
+// Folds a source about zero and flips it, so its zero crossings become sharp
+// ridges.
+class RidgedNoiseClass : public NoiseSourceClass
+{
+public:
+	RidgedNoiseClass();
+	RidgedNoiseClass(const RidgedNoiseClass&);
+	~RidgedNoiseClass();
+
+	bool Initialize(const NoiseSourceClass* source);
+
+	void Sample(const float* x, const float* y, int count, float* values) const;
+
+private:
+	const NoiseSourceClass* m_source;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: BillowNoiseClass
+////////////////////////////////////////////////////////////////////////////////
+// Folds a source about zero, so its zero crossings become creases between
+// rounded lumps.
+class BillowNoiseClass : public NoiseSourceClass
+{
+public:
+	BillowNoiseClass();
+	BillowNoiseClass(const BillowNoiseClass&);
+	~BillowNoiseClass();
+
+	bool Initialize(const NoiseSourceClass* source);
+
+	void Sample(const float* x, const float* y, int count, float* values) const;
+
+private:
+	const NoiseSourceClass* m_source;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: DomainWarpNoiseClass
+////////////////////////////////////////////////////////////////////////////////
+// Samples a source at points pushed around by a second source, one sample of it
+// for each axis taken far enough apart not to be alike.
+class DomainWarpNoiseClass : public NoiseSourceClass
+{
+public:
+	DomainWarpNoiseClass();
+	DomainWarpNoiseClass(const DomainWarpNoiseClass&);
+	~DomainWarpNoiseClass();
+
+	bool Initialize(const NoiseSourceClass* source, const NoiseSourceClass* warp, float strength);
+
+	void Sample(const float* x, const float* y, int count, float* values) const;
+
+private:
+	const NoiseSourceClass* m_source;
+	const NoiseSourceClass* m_warp;
+	float m_strength;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ScaleOffsetNoiseClass
+////////////////////////////////////////////////////////////////////////////////
+// Samples a source at a different frequency and scales and offsets its values.
+class ScaleOffsetNoiseClass : public NoiseSourceClass
+{
+public:
+	ScaleOffsetNoiseClass();
+	ScaleOffsetNoiseClass(const ScaleOffsetNoiseClass&);
+	~ScaleOffsetNoiseClass();
+
+	bool Initialize(const NoiseSourceClass* source, float frequency, float scale, float offset);
+
+	void Sample(const float* x, const float* y, int count, float* values) const;
+
+private:
+	const NoiseSourceClass* m_source;
+	float m_frequency, m_scale, m_offset;
+};
+
+#endif
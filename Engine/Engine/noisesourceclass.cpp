@@ -0,0 +1,292 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noisesourceclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "noisesourceclass.h"
+#include "perlin.h"
+
+
+namespace
+{
+	float Fade(float t)
+	{
+		return t * t * t * ((t * ((t * 6.0f) - 15.0f)) + 10.0f);
+	}
+
+	float Lerp(float t, float a, float b)
+	{
+		return a + (t * (b - a));
+	}
+
+	float Gradient(int hash, float x, float y)
+	{
+		// One of eight directions, the diagonals and the axes.
+		switch(hash & 7)
+		{
+			case 0: return x + y;
+			case 1: return -x + y;
+			case 2: return x - y;
+			case 3: return -x - y;
+			case 4: return x;
+			case 5: return -x;
+			case 6: return y;
+			default: return -y;
+		}
+	}
+
+	int FastFloor(float value)
+	{
+		int truncated = (int)value;
+		return (value < (float)truncated) ? (truncated - 1) : truncated;
+	}
+}
+
+
+NoiseSourceClass::NoiseSourceClass()
+{
+}
+
+
+NoiseSourceClass::~NoiseSourceClass()
+{
+}
+
+
+void NoiseSourceClass::SampleRow(float xStart, float y, float xStep, int count, float* values) const
+{
+	float xs[NOISE_BATCH_SIZE], ys[NOISE_BATCH_SIZE];
+	int batch;
+
+
+	// Lay the row out a batch at a time and sample each batch in one call.
+	for(int start=0; start<count; start+=NOISE_BATCH_SIZE)
+	{
+		batch = (count - start < NOISE_BATCH_SIZE) ? (count - start) : NOISE_BATCH_SIZE;
+		for(int i=0; i<batch; i++)
+		{
+			xs[i] = xStart + ((float)(start + i) * xStep);
+			ys[i] = y;
+		}
+
+		Sample(xs, ys, batch, values + start);
+	}
+
+	return;
+}
+
+
+PerlinNoiseClass::PerlinNoiseClass()
+{
+}
+
+
+PerlinNoiseClass::PerlinNoiseClass(const PerlinNoiseClass& other)
+{
+}
+
+
+PerlinNoiseClass::~PerlinNoiseClass()
+{
+}
+
+
+bool PerlinNoiseClass::Initialize(unsigned int seed)
+{
+	// The perlin class shuffles and doubles the table the same way, so take its.
+	m_permutation = perlin(seed).p;
+
+	return true;
+}
+
+
+void PerlinNoiseClass::Shutdown()
+{
+	std::vector<int>().swap(m_permutation);
+
+	return;
+}
+
+
+void PerlinNoiseClass::Sample(const float* x, const float* y, int count, float* values) const
+{
+	const int* p;
+	float xf, yf, u, v;
+	int X, Y, A, B;
+
+
+	p = &m_permutation[0];
+	for(int i=0; i<count; i++)
+	{
+		// Find the grid square the point is in and where in it.
+		X = FastFloor(x[i]);
+		Y = FastFloor(y[i]);
+		xf = x[i] - (float)X;
+		yf = y[i] - (float)Y;
+		X &= 255;
+		Y &= 255;
+
+		u = Fade(xf);
+		v = Fade(yf);
+
+		// Blend the gradients of the four corners.
+		A = p[X] + Y;
+		B = p[X + 1] + Y;
+		values[i] = Lerp(v, Lerp(u, Gradient(p[A], xf, yf), Gradient(p[B], xf - 1.0f, yf)),
+		                    Lerp(u, Gradient(p[A + 1], xf, yf - 1.0f), Gradient(p[B + 1], xf - 1.0f, yf - 1.0f)));
+	}
+
+	return;
+}
+
+
+SimplexNoiseClass::SimplexNoiseClass()
+{
+}
+
+
+SimplexNoiseClass::SimplexNoiseClass(const SimplexNoiseClass& other)
+{
+}
+
+
+SimplexNoiseClass::~SimplexNoiseClass()
+{
+}
+
+
+bool SimplexNoiseClass::Initialize(unsigned int seed)
+{
+	m_permutation = perlin(seed).p;
+
+	return true;
+}
+
+
+void SimplexNoiseClass::Shutdown()
+{
+	std::vector<int>().swap(m_permutation);
+
+	return;
+}
+
+
+void SimplexNoiseClass::Sample(const float* x, const float* y, int count, float* values) const
+{
+	const float skew = 0.36602540f, unskew = 0.21132487f;
+	const int* p;
+	float s, t, x0, y0, x1, y1, x2, y2, t0, t1, t2, total;
+	int i0, j0, i1, j1, ii, jj;
+
+
+	p = &m_permutation[0];
+	for(int i=0; i<count; i++)
+	{
+		// Skew the plane onto the triangle grid to find the cell, then unskew to get the offsets from its corners.
+		s = (x[i] + y[i]) * skew;
+		i0 = FastFloor(x[i] + s);
+		j0 = FastFloor(y[i] + s);
+		t = (float)(i0 + j0) * unskew;
+		x0 = x[i] - ((float)i0 - t);
+		y0 = y[i] - ((float)j0 - t);
+
+		// Which of the two triangles of the cell the point is in decides the middle corner.
+		i1 = (x0 > y0) ? 1 : 0;
+		j1 = 1 - i1;
+
+		x1 = x0 - (float)i1 + unskew;
+		y1 = y0 - (float)j1 + unskew;
+		x2 = x0 - 1.0f + (2.0f * unskew);
+		y2 = y0 - 1.0f + (2.0f * unskew);
+
+		ii = i0 & 255;
+		jj = j0 & 255;
+
+		// Each corner adds its gradient fading out with distance.
+		total = 0.0f;
+		t0 = 0.5f - (x0 * x0) - (y0 * y0);
+		if(t0 > 0.0f)
+		{
+			t0 *= t0;
+			total += t0 * t0 * Gradient(p[ii + p[jj]], x0, y0);
+		}
+
+		t1 = 0.5f - (x1 * x1) - (y1 * y1);
+		if(t1 > 0.0f)
+		{
+			t1 *= t1;
+			total += t1 * t1 * Gradient(p[ii + i1 + p[jj + j1]], x1, y1);
+		}
+
+		t2 = 0.5f - (x2 * x2) - (y2 * y2);
+		if(t2 > 0.0f)
+		{
+			t2 *= t2;
+			total += t2 * t2 * Gradient(p[ii + 1 + p[jj + 1]], x2, y2);
+		}
+
+		values[i] = 70.0f * total;
+	}
+
+	return;
+}
+
+
+ValueNoiseClass::ValueNoiseClass()
+{
+}
+
+
+ValueNoiseClass::ValueNoiseClass(const ValueNoiseClass& other)
+{
+}
+
+
+ValueNoiseClass::~ValueNoiseClass()
+{
+}
+
+
+bool ValueNoiseClass::Initialize(unsigned int seed)
+{
+	m_permutation = perlin(seed).p;
+
+	return true;
+}
+
+
+void ValueNoiseClass::Shutdown()
+{
+	std::vector<int>().swap(m_permutation);
+
+	return;
+}
+
+
+void ValueNoiseClass::Sample(const float* x, const float* y, int count, float* values) const
+{
+	const float scale = 2.0f / 255.0f;
+	const int* p;
+	float xf, yf, u, v;
+	int X, Y, A, B;
+
+
+	p = &m_permutation[0];
+	for(int i=0; i<count; i++)
+	{
+		X = FastFloor(x[i]);
+		Y = FastFloor(y[i]);
+		xf = x[i] - (float)X;
+		yf = y[i] - (float)Y;
+		X &= 255;
+		Y &= 255;
+
+		u = Fade(xf);
+		v = Fade(yf);
+
+		// The corner values are the permutation itself, mapped to -1 to 1.
+		A = p[X] + Y;
+		B = p[X + 1] + Y;
+		values[i] = (Lerp(v, Lerp(u, (float)p[p[A]], (float)p[p[B]]), Lerp(u, (float)p[p[A + 1]], (float)p[p[B + 1]])) * scale) - 1.0f;
+	}
+
+	return;
+}
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: noisesourceclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _NOISESOURCECLASS_H_
+#define _NOISESOURCECLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int NOISE_BATCH_SIZE = 256;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: NoiseSourceClass
+////////////////////////////////////////////////////////////////////////////////
+// Anything that gives a noise value at a point of the plane, roughly in -1 to 1.
+// Points are asked for in batches, so a graph of sources costs one virtual call
+// per source per batch rather than per sample. Sources keep no state between
+// calls and can be sampled from several threads at once.
+class NoiseSourceClass
+{
+public:
+	NoiseSourceClass();
+	virtual ~NoiseSourceClass();
+
+	virtual void Sample(const float* x, const float* y, int count, float* values) const = 0;
+	void SampleRow(float xStart, float y, float xStep, int count, float* values) const;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: PerlinNoiseClass
+////////////////////////////////////////////////////////////////////////////////
+// Ken Perlin's improved gradient noise in two dimensions, with the permutation of
+// the perlin class for the same seed.
+class PerlinNoiseClass : public NoiseSourceClass
+{
+public:
+	PerlinNoiseClass();
+	PerlinNoiseClass(const PerlinNoiseClass&);
+	~PerlinNoiseClass();
+
+	bool Initialize(unsigned int seed);
+	void Shutdown();
+
+	void Sample(const float* x, const float* y, int count, float* values) const;
+
+private:
+	std::vector<int> m_permutation;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: SimplexNoiseClass
+////////////////////////////////////////////////////////////////////////////////
+// Gradient noise over a grid of triangles rather than squares: three corners to
+// blend instead of four and no grid aligned artefacts.
+class SimplexNoiseClass : public NoiseSourceClass
+{
+public:
+	SimplexNoiseClass();
+	SimplexNoiseClass(const SimplexNoiseClass&);
+	~SimplexNoiseClass();
+
+	bool Initialize(unsigned int seed);
+	void Shutdown();
+
+	void Sample(const float* x, const float* y, int count, float* values) const;
+
+private:
+	std::vector<int> m_permutation;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ValueNoiseClass
+////////////////////////////////////////////////////////////////////////////////
+// A random value at every grid corner, smoothly blended in between. Cheaper and
+// blockier than the gradient noises.
+class ValueNoiseClass : public NoiseSourceClass
+{
+public:
+	ValueNoiseClass();
+	ValueNoiseClass(const ValueNoiseClass&);
+	~ValueNoiseClass();
+
+	bool Initialize(unsigned int seed);
+	void Shutdown();
+
+	void Sample(const float* x, const float* y, int count, float* values) const;
+
+private:
+	std::vector<int> m_permutation;
+};
+
+#endif
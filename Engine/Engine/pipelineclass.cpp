@@ -0,0 +1,263 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: pipelineclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "pipelineclass.h"
+#include <cstring>
+#include <utility>
+
+
+PipelineClass::PipelineClass()
+{
+	m_stageCount = 0;
+	m_cacheSize = 0;
+	m_cachedBytes = 0;
+	m_useClock = 0;
+	m_hitCount = 0;
+	m_missCount = 0;
+}
+
+
+PipelineClass::PipelineClass(const PipelineClass& other)
+{
+}
+
+
+PipelineClass::~PipelineClass()
+{
+}
+
+
+bool PipelineClass::Initialize(int cacheSize)
+{
+	if(cacheSize <= 0)
+	{
+		return false;
+	}
+
+	m_cacheSize = cacheSize;
+
+	return true;
+}
+
+
+void PipelineClass::Shutdown()
+{
+	std::vector<StageType>().swap(m_stages);
+	std::vector<EntryType>().swap(m_entries);
+	std::vector<std::vector<unsigned char> >().swap(m_freeData);
+	m_stageCount = 0;
+	m_cachedBytes = 0;
+
+	return;
+}
+
+
+void PipelineClass::ClearStages()
+{
+	// The graph is rebuilt for every job, the cache outlives it. The stage slots are kept for the next graph.
+	m_stageCount = 0;
+
+	return;
+}
+
+
+int PipelineClass::AddStage(const char* name, const std::vector<int>& inputs, const void* parameters, int parameterSize)
+{
+	unsigned long long key;
+
+
+	// Inputs have to be added first, which keeps the graph acyclic and lets the key be worked out now.
+	key = Hash(14695981039346656037ULL, name, (int)strlen(name));
+	key = Hash(key, parameters, parameterSize);
+	for(unsigned int i=0; i<inputs.size(); i++)
+	{
+		if((inputs[i] < 0) || (inputs[i] >= m_stageCount))
+		{
+			return -1;
+		}
+
+		key = Hash(key, &m_stages[inputs[i]].key, sizeof(unsigned long long));
+	}
+
+	if(m_stageCount == (int)m_stages.size())
+	{
+		m_stages.push_back(StageType());
+	}
+
+	StageType& stage = m_stages[m_stageCount];
+	stage.name.assign(name);
+	stage.inputs.assign(inputs.begin(), inputs.end());
+	stage.key = key;
+
+	m_stageCount++;
+
+	return m_stageCount - 1;
+}
+
+
+unsigned long long PipelineClass::GetKey(int stage)
+{
+	return m_stages[stage].key;
+}
+
+
+int PipelineClass::GetStageCount()
+{
+	return m_stageCount;
+}
+
+
+const std::vector<unsigned char>* PipelineClass::Find(unsigned long long key)
+{
+	for(unsigned int i=0; i<m_entries.size(); i++)
+	{
+		if(m_entries[i].key == key)
+		{
+			m_entries[i].lastUse = ++m_useClock;
+			m_hitCount++;
+			return &m_entries[i].data;
+		}
+	}
+
+	m_missCount++;
+
+	return 0;
+}
+
+
+void PipelineClass::Store(unsigned long long key, const std::vector<unsigned char>& data, bool pinned)
+{
+	EntryType entry;
+
+
+	// Replace an older copy of the same output.
+	for(unsigned int i=0; i<m_entries.size(); i++)
+	{
+		if(m_entries[i].key == key)
+		{
+			RemoveEntry((int)i);
+			break;
+		}
+	}
+
+	// Something bigger than the whole cache is not worth keeping unless it has to be.
+	if(!pinned && ((int)data.size() > m_cacheSize))
+	{
+		return;
+	}
+
+	Evict((int)data.size());
+
+	// Copy into the storage of an output dropped earlier, it is usually the same size.
+	if(!m_freeData.empty())
+	{
+		entry.data.swap(m_freeData.back());
+		m_freeData.pop_back();
+	}
+
+	entry.key = key;
+	entry.data.assign(data.begin(), data.end());
+	entry.lastUse = ++m_useClock;
+	entry.pinned = pinned;
+	m_entries.push_back(std::move(entry));
+
+	m_cachedBytes += (int)data.size();
+
+	return;
+}
+
+
+void PipelineClass::Unpin(unsigned long long key)
+{
+	// The output stays cached, it just goes like any other when it is the oldest.
+	for(unsigned int i=0; i<m_entries.size(); i++)
+	{
+		if(m_entries[i].key == key)
+		{
+			m_entries[i].pinned = false;
+			break;
+		}
+	}
+
+	return;
+}
+
+
+int PipelineClass::GetHitCount()
+{
+	return m_hitCount;
+}
+
+
+int PipelineClass::GetMissCount()
+{
+	return m_missCount;
+}
+
+
+int PipelineClass::GetCachedBytes()
+{
+	return m_cachedBytes;
+}
+
+
+unsigned long long PipelineClass::Hash(unsigned long long hash, const void* data, int size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+
+
+	// 64 bit FNV-1a.
+	for(int i=0; i<size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+void PipelineClass::Evict(int needed)
+{
+	int oldest;
+
+
+	// Drop the least recently used outputs until the new one fits, pinned ones always stay.
+	while((m_cachedBytes + needed) > m_cacheSize)
+	{
+		oldest = -1;
+		for(unsigned int i=0; i<m_entries.size(); i++)
+		{
+			if(!m_entries[i].pinned && ((oldest == -1) || (m_entries[i].lastUse < m_entries[oldest].lastUse)))
+			{
+				oldest = (int)i;
+			}
+		}
+
+		if(oldest == -1)
+		{
+			return;
+		}
+
+		RemoveEntry(oldest);
+	}
+
+	return;
+}
+
+
+void PipelineClass::RemoveEntry(int entry)
+{
+	// Keep the storage for the next output stored.
+	m_cachedBytes -= (int)m_entries[entry].data.size();
+	m_freeData.push_back(std::move(m_entries[entry].data));
+
+	// Order does not matter, so fill the gap with the last entry.
+	if(entry != (int)m_entries.size() - 1)
+	{
+		m_entries[entry] = std::move(m_entries.back());
+	}
+	m_entries.pop_back();
+
+	return;
+}
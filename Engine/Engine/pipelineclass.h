@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: pipelineclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _PIPELINECLASS_H_
+#define _PIPELINECLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+#include <string>
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int PIPELINE_CACHE_SIZE = 64 * 1024 * 1024;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: PipelineClass
+////////////////////////////////////////////////////////////////////////////////
+// A graph of generation stages and a cache of what they produced. Each stage
+// declares its name, parameters and input stages, and its key is a hash of those
+// and of the input keys, so a key names the output exactly. Outputs are kept as
+// byte blobs under their key until the cache runs over its size, when the least
+// recently used are dropped. Running the stages is left to the caller. Stage
+// slots and the storage of dropped outputs are reused, so a cache that has filled
+// up stops taking memory from the heap.
+class PipelineClass
+{
+private:
+	struct StageType
+	{
+		std::string name;
+		std::vector<int> inputs;
+		unsigned long long key;
+	};
+
+	struct EntryType
+	{
+		unsigned long long key;
+		std::vector<unsigned char> data;
+		unsigned int lastUse;
+		bool pinned;
+	};
+
+public:
+	PipelineClass();
+	PipelineClass(const PipelineClass&);
+	~PipelineClass();
+
+	bool Initialize(int cacheSize);
+	void Shutdown();
+
+	void ClearStages();
+	int AddStage(const char* name, const std::vector<int>& inputs, const void* parameters, int parameterSize);
+	unsigned long long GetKey(int stage);
+	int GetStageCount();
+
+	const std::vector<unsigned char>* Find(unsigned long long key);
+	void Store(unsigned long long key, const std::vector<unsigned char>& data, bool pinned);
+	void Unpin(unsigned long long key);
+
+	int GetHitCount();
+	int GetMissCount();
+	int GetCachedBytes();
+
+private:
+	unsigned long long Hash(unsigned long long hash, const void* data, int size);
+	void Evict(int needed);
+	void RemoveEntry(int entry);
+
+private:
+	std::vector<StageType> m_stages;
+	int m_stageCount;
+	std::vector<EntryType> m_entries;
+	std::vector<std::vector<unsigned char> > m_freeData;
+	int m_cacheSize, m_cachedBytes;
+	unsigned int m_useClock;
+	int m_hitCount, m_missCount;
+};
+
+#endif
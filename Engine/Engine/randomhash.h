@@ -0,0 +1,42 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: randomhash.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _RANDOMHASH_H_
+#define _RANDOMHASH_H_
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Functions: MixBits, NextRandom, RandomRange
+////////////////////////////////////////////////////////////////////////////////
+// The hash and the random sequence the generators share. MixBits is the
+// splitmix64 finalizer, for turning a seed and a coordinate into a well spread
+// key. NextRandom is xorshift64*, a whole word of random bits per call from a
+// state the caller keeps, which must not be 0. Nothing here is shared between
+// calls, so every thread gets the same numbers from the same seed.
+inline unsigned long long MixBits(unsigned long long value)
+{
+	value ^= value >> 30;
+	value *= 0xbf58476d1ce4e5b9ULL;
+	value ^= value >> 27;
+	value *= 0x94d049bb133111ebULL;
+	value ^= value >> 31;
+	return value;
+}
+
+
+inline unsigned long long NextRandom(unsigned long long& state)
+{
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 2685821657736338717ULL;
+}
+
+
+// A number from low to high, both included, taken from the high bits which are the best mixed.
+inline int RandomRange(unsigned long long& state, int low, int high)
+{
+	return low + (int)((NextRandom(state) >> 33) % (unsigned long long)(high - low + 1));
+}
+
+#endif
@@ -0,0 +1,381 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: roomindexclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "roomindexclass.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+
+RoomIndexClass::RoomIndexClass()
+{
+	m_cellSize = 0;
+	m_gridWidth = 0;
+	m_gridHeight = 0;
+	m_queryStamp = 0;
+}
+
+
+RoomIndexClass::RoomIndexClass(const RoomIndexClass& other)
+{
+}
+
+
+RoomIndexClass::~RoomIndexClass()
+{
+}
+
+
+bool RoomIndexClass::Initialize(int worldWidth, int worldHeight, int cellSize)
+{
+	if((worldWidth <= 0) || (worldHeight <= 0) || (cellSize <= 0))
+	{
+		return false;
+	}
+
+	// Work out how many grid cells are needed to cover the whole terrain.
+	m_cellSize = cellSize;
+	m_gridWidth = (worldWidth + cellSize - 1) / cellSize;
+	m_gridHeight = (worldHeight + cellSize - 1) / cellSize;
+
+	// Every cell starts with an empty bucket.
+	m_cellHeads.assign(m_gridWidth * m_gridHeight, -1);
+
+	Clear();
+
+	return true;
+}
+
+
+void RoomIndexClass::Shutdown()
+{
+	// Release the grid and room storage.
+	std::vector<int>().swap(m_cellHeads);
+	std::vector<EntryType>().swap(m_entries);
+	std::vector<dungeonCellData>().swap(m_rooms);
+	std::vector<unsigned int>().swap(m_roomStamps);
+	std::vector<NeighbourType>().swap(m_nearest);
+
+	m_gridWidth = 0;
+	m_gridHeight = 0;
+
+	return;
+}
+
+
+void RoomIndexClass::Clear()
+{
+	// Empty the buckets but keep the allocations so the next generation can reuse them.
+	std::fill(m_cellHeads.begin(), m_cellHeads.end(), -1);
+	m_entries.clear();
+	m_rooms.clear();
+	m_roomStamps.clear();
+	m_queryStamp = 0;
+
+	return;
+}
+
+
+int RoomIndexClass::Insert(const dungeonCellData& room)
+{
+	int minX, minY, maxX, maxY, roomId, cell;
+	EntryType entry;
+
+
+	roomId = (int)m_rooms.size();
+	m_rooms.push_back(room);
+	m_roomStamps.push_back(0);
+
+	// Link the room into the bucket of every grid cell it touches.
+	GetCellRange(room, minX, minY, maxX, maxY);
+	for(int y=minY; y<=maxY; y++)
+	{
+		for(int x=minX; x<=maxX; x++)
+		{
+			cell = (y * m_gridWidth) + x;
+
+			entry.room = roomId;
+			entry.next = m_cellHeads[cell];
+			m_cellHeads[cell] = (int)m_entries.size();
+			m_entries.push_back(entry);
+		}
+	}
+
+	return roomId;
+}
+
+
+bool RoomIndexClass::Overlaps(const dungeonCellData& rect, int ignoreRoom)
+{
+	int minX, minY, maxX, maxY, entry;
+
+
+	GetCellRange(rect, minX, minY, maxX, maxY);
+	for(int y=minY; y<=maxY; y++)
+	{
+		for(int x=minX; x<=maxX; x++)
+		{
+			for(entry = m_cellHeads[(y * m_gridWidth) + x]; entry != -1; entry = m_entries[entry].next)
+			{
+				const dungeonCellData& room = m_rooms[m_entries[entry].room];
+
+				if(m_entries[entry].room == ignoreRoom)
+				{
+					continue;
+				}
+
+				// Rooms cover [bottom left, top right) so touching edges do not count as overlapping.
+				if((rect.xBottomLeft < room.xTopRight) && (room.xBottomLeft < rect.xTopRight) &&
+				   (rect.yBottomLeft < room.yTopRight) && (room.yBottomLeft < rect.yTopRight))
+				{
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+
+int RoomIndexClass::FindOverlaps(const dungeonCellData& rect, std::vector<int>& rooms)
+{
+	int minX, minY, maxX, maxY, entry, roomId;
+
+
+	rooms.clear();
+	NextQuery();
+
+	GetCellRange(rect, minX, minY, maxX, maxY);
+	for(int y=minY; y<=maxY; y++)
+	{
+		for(int x=minX; x<=maxX; x++)
+		{
+			for(entry = m_cellHeads[(y * m_gridWidth) + x]; entry != -1; entry = m_entries[entry].next)
+			{
+				roomId = m_entries[entry].room;
+
+				// A room spanning several cells is only reported once per query.
+				if(m_roomStamps[roomId] == m_queryStamp)
+				{
+					continue;
+				}
+				m_roomStamps[roomId] = m_queryStamp;
+
+				const dungeonCellData& room = m_rooms[roomId];
+				if((rect.xBottomLeft < room.xTopRight) && (room.xBottomLeft < rect.xTopRight) &&
+				   (rect.yBottomLeft < room.yTopRight) && (room.yBottomLeft < rect.yTopRight))
+				{
+					rooms.push_back(roomId);
+				}
+			}
+		}
+	}
+
+	return (int)rooms.size();
+}
+
+
+int RoomIndexClass::FindRoomAt(float x, float y)
+{
+	int cellX, cellY, entry;
+
+
+	if(m_cellHeads.empty())
+	{
+		return -1;
+	}
+
+	cellX = std::min(std::max((int)floor(x / m_cellSize), 0), m_gridWidth - 1);
+	cellY = std::min(std::max((int)floor(y / m_cellSize), 0), m_gridHeight - 1);
+
+	// Only the bucket under the point can hold a room containing it.
+	for(entry = m_cellHeads[(cellY * m_gridWidth) + cellX]; entry != -1; entry = m_entries[entry].next)
+	{
+		const dungeonCellData& room = m_rooms[m_entries[entry].room];
+
+		if((x >= room.xBottomLeft) && (x < room.xTopRight) && (y >= room.yBottomLeft) && (y < room.yTopRight))
+		{
+			return m_entries[entry].room;
+		}
+	}
+
+	return -1;
+}
+
+
+int RoomIndexClass::FindNearest(float x, float y, int count, std::vector<int>& rooms)
+{
+	int cellX, cellY, ring, maxRing;
+
+
+	rooms.clear();
+	if((count <= 0) || m_rooms.empty())
+	{
+		return 0;
+	}
+
+	NextQuery();
+	m_nearest.clear();
+
+	cellX = std::min(std::max((int)floor(x / m_cellSize), 0), m_gridWidth - 1);
+	cellY = std::min(std::max((int)floor(y / m_cellSize), 0), m_gridHeight - 1);
+	maxRing = std::max(m_gridWidth, m_gridHeight);
+
+	// Search outwards one square ring of cells at a time from the cell under the point, or the edge
+	// cell nearest it when the point is off the grid. Any room not seen yet lies outside the rings
+	// searched, so we can stop as soon as the k-th best distance is closer than the point is to that.
+	for(ring = 0; ring <= maxRing; ring++)
+	{
+		for(int i=-ring; i<=ring; i++)
+		{
+			VisitCell(cellX + i, cellY - ring, x, y, count);
+			if(ring > 0)
+			{
+				VisitCell(cellX + i, cellY + ring, x, y, count);
+			}
+		}
+		for(int i=-ring+1; i<=ring-1; i++)
+		{
+			VisitCell(cellX - ring, cellY + i, x, y, count);
+			VisitCell(cellX + ring, cellY + i, x, y, count);
+		}
+
+		if(((int)m_nearest.size() == count) && (m_nearest.front().distance <= DistanceOutsideRing(cellX, cellY, ring, x, y)))
+		{
+			break;
+		}
+	}
+
+	// Return the rooms closest first.
+	std::sort_heap(m_nearest.begin(), m_nearest.end(), [](const NeighbourType& a, const NeighbourType& b) { return a.distance < b.distance; });
+	for(unsigned int i=0; i<m_nearest.size(); i++)
+	{
+		rooms.push_back(m_nearest[i].room);
+	}
+
+	return (int)rooms.size();
+}
+
+
+int RoomIndexClass::GetRoomCount()
+{
+	return (int)m_rooms.size();
+}
+
+
+const dungeonCellData& RoomIndexClass::GetRoom(int room)
+{
+	return m_rooms[room];
+}
+
+
+void RoomIndexClass::GetCellRange(const dungeonCellData& rect, int& minX, int& minY, int& maxX, int& maxY)
+{
+	// Clamp the rectangle to the grid so rooms hanging off the terrain still land in the edge cells.
+	minX = std::min(std::max((int)floor(rect.xBottomLeft / m_cellSize), 0), m_gridWidth - 1);
+	minY = std::min(std::max((int)floor(rect.yBottomLeft / m_cellSize), 0), m_gridHeight - 1);
+	maxX = std::min(std::max((int)floor((rect.xTopRight - 1.0f) / m_cellSize), minX), m_gridWidth - 1);
+	maxY = std::min(std::max((int)floor((rect.yTopRight - 1.0f) / m_cellSize), minY), m_gridHeight - 1);
+
+	return;
+}
+
+
+void RoomIndexClass::VisitCell(int cellX, int cellY, float x, float y, int count)
+{
+	int entry, roomId;
+	NeighbourType neighbour;
+	auto further = [](const NeighbourType& a, const NeighbourType& b) { return a.distance < b.distance; };
+
+
+	if((cellX < 0) || (cellY < 0) || (cellX >= m_gridWidth) || (cellY >= m_gridHeight))
+	{
+		return;
+	}
+
+	for(entry = m_cellHeads[(cellY * m_gridWidth) + cellX]; entry != -1; entry = m_entries[entry].next)
+	{
+		roomId = m_entries[entry].room;
+		if(m_roomStamps[roomId] == m_queryStamp)
+		{
+			continue;
+		}
+		m_roomStamps[roomId] = m_queryStamp;
+
+		neighbour.room = roomId;
+		neighbour.distance = DistanceToRoom(m_rooms[roomId], x, y);
+
+		// Keep the best k in a max heap so the worst candidate is always at the front.
+		if((int)m_nearest.size() < count)
+		{
+			m_nearest.push_back(neighbour);
+			std::push_heap(m_nearest.begin(), m_nearest.end(), further);
+		}
+		else if(neighbour.distance < m_nearest.front().distance)
+		{
+			std::pop_heap(m_nearest.begin(), m_nearest.end(), further);
+			m_nearest.back() = neighbour;
+			std::push_heap(m_nearest.begin(), m_nearest.end(), further);
+		}
+	}
+
+	return;
+}
+
+
+float RoomIndexClass::DistanceOutsideRing(int cellX, int cellY, int ring, float x, float y)
+{
+	float distance;
+
+
+	// The cells not searched yet lie past one of the four sides of the square of rings, the point
+	// is at least as far from them as from the nearest of those sides that still has grid beyond it.
+	distance = FLT_MAX;
+	if((cellX - ring) > 0)
+	{
+		distance = std::min(distance, std::max(x - (float)((cellX - ring) * m_cellSize), 0.0f));
+	}
+	if((cellX + ring) < (m_gridWidth - 1))
+	{
+		distance = std::min(distance, std::max((float)((cellX + ring + 1) * m_cellSize) - x, 0.0f));
+	}
+	if((cellY - ring) > 0)
+	{
+		distance = std::min(distance, std::max(y - (float)((cellY - ring) * m_cellSize), 0.0f));
+	}
+	if((cellY + ring) < (m_gridHeight - 1))
+	{
+		distance = std::min(distance, std::max((float)((cellY + ring + 1) * m_cellSize) - y, 0.0f));
+	}
+
+	return distance;
+}
+
+
+float RoomIndexClass::DistanceToRoom(const dungeonCellData& room, float x, float y)
+{
+	float dx, dy;
+
+
+	// Distance from the point to the closest point of the room, zero when it is inside.
+	dx = std::max(std::max(room.xBottomLeft - x, 0.0f), x - room.xTopRight);
+	dy = std::max(std::max(room.yBottomLeft - y, 0.0f), y - room.yTopRight);
+
+	return sqrt((dx * dx) + (dy * dy));
+}
+
+
+void RoomIndexClass::NextQuery()
+{
+	m_queryStamp++;
+
+	// On wrap around the old stamps could collide with new queries, so wipe them.
+	if(m_queryStamp == 0)
+	{
+		std::fill(m_roomStamps.begin(), m_roomStamps.end(), 0);
+		m_queryStamp = 1;
+	}
+
+	return;
+}
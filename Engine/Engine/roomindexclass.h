@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: roomindexclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _ROOMINDEXCLASS_H_
+#define _ROOMINDEXCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "dungeoncelldata.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int ROOM_INDEX_CELL_SIZE = 16;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: RoomIndexClass
+////////////////////////////////////////////////////////////////////////////////
+// Uniform grid over the terrain that buckets every inserted rectangle into the
+// grid cells it touches. Queries only visit the buckets under the query area, so
+// overlap tests and point lookups cost the local room density instead of a scan
+// over every room.
+class RoomIndexClass
+{
+private:
+	struct EntryType
+	{
+		int room;
+		int next;
+	};
+
+	struct NeighbourType
+	{
+		int room;
+		float distance;
+	};
+
+public:
+	RoomIndexClass();
+	RoomIndexClass(const RoomIndexClass&);
+	~RoomIndexClass();
+
+	bool Initialize(int worldWidth, int worldHeight, int cellSize);
+	void Shutdown();
+	void Clear();
+
+	int Insert(const dungeonCellData& room);
+	bool Overlaps(const dungeonCellData& rect, int ignoreRoom = -1);
+	int FindOverlaps(const dungeonCellData& rect, std::vector<int>& rooms);
+	int FindRoomAt(float x, float y);
+	int FindNearest(float x, float y, int count, std::vector<int>& rooms);
+
+	int GetRoomCount();
+	const dungeonCellData& GetRoom(int room);
+
+private:
+	void GetCellRange(const dungeonCellData& rect, int& minX, int& minY, int& maxX, int& maxY);
+	void VisitCell(int cellX, int cellY, float x, float y, int count);
+	float DistanceOutsideRing(int cellX, int cellY, int ring, float x, float y);
+	float DistanceToRoom(const dungeonCellData& room, float x, float y);
+	void NextQuery();
+
+private:
+	int m_cellSize;
+	int m_gridWidth, m_gridHeight;
+	std::vector<int> m_cellHeads;
+	std::vector<EntryType> m_entries;
+	std::vector<dungeonCellData> m_rooms;
+	std::vector<unsigned int> m_roomStamps;
+	std::vector<NeighbourType> m_nearest;
+	unsigned int m_queryStamp;
+};
+
+#endif
@@ -2,7 +2,10 @@
 // Filename: terrainclass.cpp
 ////////////////////////////////////////////////////////////////////////////////
 #include "terrainclass.h"
+#include "dungeonstackclass.h"
+#include "randomhash.h"
 #include <cmath>
+#include <cstring>
 
 
 TerrainClass::TerrainClass()
@@ -12,11 +15,85 @@ TerrainClass::TerrainClass()
 	m_heightMap = 0;
 	m_terrainGeneratedToggle = false;
 	m_terrainSmoothToggle = false;
+	m_terrainPartitionToggle = false;
+	m_terrainPerlinToggle = false;
+	m_terrainPassesToggle = false;
+	m_terrainCaveToggle = false;
+	m_terrainErosionToggle = false;
+	m_terrainSaveToggle = false;
+	m_terrainLoadToggle = false;
+	m_terrainExportToggle = false;
+	m_terrainImageToggle = false;
+	m_terrainUndoToggle = false;
+	m_terrainRedoToggle = false;
+	m_terrainLevelDownToggle = false;
+	m_terrainLevelUpToggle = false;
+	m_stackLevel = -1;
 
 	m_GrassTexture = 0;
 	m_SlopeTexture = 0;
 	m_RockTexture = 0;
 
+	m_RoomIndex = 0;
+	m_CorridorPlanner = 0;
+	m_CorridorRouter = 0;
+	m_Connectivity = 0;
+	m_Cave = 0;
+	m_DistanceField = 0;
+	m_Erosion = 0;
+	m_componentCount = 0;
+
+	m_frontHeightMap = 0;
+	m_noiseOffsetX = 0.0f;
+	m_noiseOffsetY = 0.0f;
+	m_randomState = 1;
+	m_wallDistances = 0;
+	m_frontWallDistances = 0;
+	m_frontComponentCount = 0;
+	m_backVertexBuffer = 0;
+	m_generationDevice = 0;
+	m_latestGeneration = 0;
+	m_startedGeneration = 0;
+	m_jobGeneration = 0;
+	m_smoothPasses = 1;
+	m_generationThreaded = false;
+
+	m_stage = STAGE_DONE;
+	m_stageStep = 0;
+	m_jobOperation = 0;
+	m_stepTimed = false;
+	m_faceNormals = 0;
+	m_meshVertices = 0;
+	m_vertexCount = 0;
+	m_indexCount = 0;
+	m_stageVertexBuffer = 0;
+	m_corridorEdgeCount = 0;
+	m_Pipeline = 0;
+	m_normalsKey = 0;
+	m_DiskCache = 0;
+	m_History = 0;
+	m_historyTilesX = 0;
+	m_historyTilesY = 0;
+	m_historyTileCount = 0;
+	m_historyVersion = -1;
+	m_jobHistoryVersion = -1;
+	m_baseKey = 0;
+	m_loadOperationCount = 0;
+	m_jobTerrainOperations = 0;
+	m_jobAllocationCount = 0;
+	m_generationAllocationCount = 0;
+	m_jobAllocatedBytes = 0;
+	m_generationAllocatedBytes = 0;
+	m_generationArenaBytes = 0;
+	m_viewX = 0;
+	m_viewZ = 0;
+	m_prefetchX = -1;
+	m_prefetchZ = -1;
+	m_cellHead = 0;
+	m_roomHead = 0;
+	m_generationBusy = false;
+	m_generationReady = false;
+	m_generationQuit = false;
 }
 
 TerrainClass::TerrainClass(const TerrainClass& other)
@@ -37,6 +114,10 @@ bool TerrainClass::InitializeTerrain(ID3D11Device* device, int terrainWidth, int
 	m_terrainWidth = terrainWidth;
 	m_terrainHeight = terrainHeight;
 
+	// Set the size of the mesh here, as a terrain without a device never makes its buffers.
+	m_vertexCount = (m_terrainWidth - 1) * (m_terrainHeight - 1) * 6;
+	m_indexCount = m_vertexCount;
+
 	// Create the structure to hold the terrain data.
 	m_heightMap = new HeightMapType[m_terrainWidth * m_terrainHeight];
 	if(!m_heightMap)
@@ -58,6 +139,13 @@ bool TerrainClass::InitializeTerrain(ID3D11Device* device, int terrainWidth, int
 		}
 	}
 
+	// Create the height fields the stencil stages work on.
+	result = InitializeHeightFields();
+	if(!result)
+	{
+		return false;
+	}
+
 	//even though we are generating a flat terrain, we still need to normalise it. 
 	// Calculate the normals for the terrain data.
 	result = CalculateNormals();
@@ -68,17 +156,36 @@ bool TerrainClass::InitializeTerrain(ID3D11Device* device, int terrainWidth, int
 
 
 
-	// Calculate the texture coordinates.
-	CalculateTextureCoordinates();
-	// Load the texture.
-	result = LoadTextures(device, grassTextureFilename, slopeTextureFilename, rockTextureFilename);
+	// Create the dungeon, cave, erosion and distance subsystems over the whole terrain.
+	result = InitializeSubsystems();
 	if(!result)
 	{
 		return false;
 	}
 
-	// Initialize the vertex and index buffer that hold the geometry for the terrain.
-	result = InitializeBuffers(device);
+	// Calculate the texture coordinates.
+	CalculateTextureCoordinates();
+
+	// A terrain made without a device only generates, for the generation service, and is never drawn.
+	if(device)
+	{
+		// Load the texture.
+		result = LoadTextures(device, grassTextureFilename, slopeTextureFilename, rockTextureFilename);
+		if(!result)
+		{
+			return false;
+		}
+
+		// Initialize the vertex and index buffer that hold the geometry for the terrain.
+		result = InitializeBuffers(device);
+		if(!result)
+		{
+			return false;
+		}
+	}
+
+	// Start the background generation, later terrains are built off the frame thread.
+	result = InitializeGeneration();
 	if(!result)
 	{
 		return false;
@@ -98,8 +205,12 @@ bool TerrainClass::Initialize(ID3D11Device* device, char* heightMapFilename, WCH
 		return false;
 	}
 
-	// Normalize the height of the height map.
-	NormalizeHeightMap();
+	// Create the height fields the stencil stages work on.
+	result = InitializeHeightFields();
+	if(!result)
+	{
+		return false;
+	}
 
 	// Calculate the normals for the terrain data.
 	result = CalculateNormals();
@@ -108,6 +219,13 @@ bool TerrainClass::Initialize(ID3D11Device* device, char* heightMapFilename, WCH
 		return false;
 	}
 
+	// Create the dungeon, cave, erosion and distance subsystems over the whole terrain.
+	result = InitializeSubsystems();
+	if(!result)
+	{
+		return false;
+	}
+
 	// Calculate the texture coordinates.
 	CalculateTextureCoordinates();
 	// Load the texture.
@@ -125,11 +243,21 @@ bool TerrainClass::Initialize(ID3D11Device* device, char* heightMapFilename, WCH
 		return false;
 	}
 
+	// Start the background generation, later terrains are built off the frame thread.
+	result = InitializeGeneration();
+	if(!result)
+	{
+		return false;
+	}
+
 	return true;
 }
 
 void TerrainClass::Shutdown()
 {
+	// Stop the generation thread before anything it works on is released.
+	ShutdownGeneration();
+
 	// Release the texture.
 	ReleaseTextures();
 
@@ -139,7 +267,8 @@ void TerrainClass::Shutdown()
 	// Release the height map data.
 	ShutdownHeightMap();
 
-	
+	// Release the dungeon, cave, erosion and distance subsystems.
+	ShutdownSubsystems();
 
 	return;
 }
@@ -157,68 +286,173 @@ int TerrainClass::GetIndexCount()
 	return m_indexCount;
 }
 
-ID3D11ShaderResourceView* TerrainClass::GetGrassTexture()
+bool TerrainClass::IsWalkable(int x, int y)
 {
-	return m_GrassTexture->GetTexture();
+	if((x < 0) || (y < 0) || (x >= m_terrainWidth) || (y >= m_terrainHeight))
+	{
+		return false;
+	}
+
+	return m_frontWalkGrid.Get(x, y);
 }
 
-ID3D11ShaderResourceView* TerrainClass::GetSlopeTexture()
+float TerrainClass::GetWallDistance(int x, int y)
 {
-	return m_SlopeTexture->GetTexture();
+	if((x < 0) || (y < 0) || (x >= m_terrainWidth) || (y >= m_terrainHeight))
+	{
+		return 0.0f;
+	}
+
+	return m_frontWallDistances[(y * m_terrainWidth) + x];
 }
 
-ID3D11ShaderResourceView* TerrainClass::GetRockTexture()
+const BitGridClass& TerrainClass::GetWalkGrid()
 {
-	return m_RockTexture->GetTexture();
+	return m_frontWalkGrid;
 }
 
-bool TerrainClass::GenerateHeightMap(ID3D11Device* device, bool keydown)
+int TerrainClass::GetDungeonComponentCount()
 {
+	return m_frontComponentCount;
+}
 
-	bool result;
-	//the toggle is just a bool that I use to make sure this is only called ONCE when you press a key
-	//until you release the key and start again. We dont want to be generating the terrain 500
-	//times per second. 
-	if(keydown&&(!m_terrainGeneratedToggle))
-	{
-		int index;
-		float height = 0.0;
-		
+int TerrainClass::GetGenerationAllocationCount()
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
 
-		//loop through the terrain and set the hieghts how we want. This is where we generate the terrain
-		//in this case I will run a sin-wave through the terrain in one axis.
 
- 		for(int j=0; j<m_terrainHeight; j++)
-		{
-			for(int i=0; i<m_terrainWidth; i++)
-			{			
-				index = (m_terrainHeight * j) + i;
+	return m_generationAllocationCount;
+}
 
-				m_heightMap[index].x = (float)i;
-				m_heightMap[index].y = (float)(RandomHeightField()); //magic numbers ahoy, just to ramp up the height of the sin function so its visible.
-				m_heightMap[index].z = (float)j;
-			}
+long long TerrainClass::GetGenerationAllocatedBytes()
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+
+
+	return m_generationAllocatedBytes;
+}
+
+int TerrainClass::GetGenerationArenaBytes()
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+
+
+	return m_generationArenaBytes;
+}
+
+int TerrainClass::GetHistoryCount()
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+
+
+	return m_History->GetVersionCount();
+}
+
+int TerrainClass::GetHistoryPosition()
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+
+
+	return m_History->GetPosition();
+}
+
+long long TerrainClass::GetHistoryBytes()
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+
+
+	return m_History->GetChunkBytes();
+}
+
+int TerrainClass::CompareHistory(int first, int second, std::vector<int>& tiles)
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+
+
+	tiles.clear();
+	if ((first < 0) || (first >= m_History->GetVersionCount()) || (second < 0) || (second >= m_History->GetVersionCount()))
+	{
+		return -1;
+	}
+
+	// A tile the two versions share is the same in both, so only the ones they do not are listed.
+	for (int i = 0; i < m_historyTileCount; i++)
+	{
+		if (!m_History->IsShared(first, second, i))
+		{
+			tiles.push_back(i);
 		}
+	}
 
-		result = CalculateNormals();
-		if(!result)
+	return (int)tiles.size();
+}
+
+bool TerrainClass::ReadHistory(int version, std::vector<float>& heights)
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+	const std::vector<unsigned char>* tile;
+	int xStart, yStart, width, height;
+
+
+	if ((version < 0) || (version >= m_History->GetVersionCount()))
+	{
+		return false;
+	}
+
+	// Lay the tiles of the version out as a height map, to show next to the one on screen.
+	heights.resize(m_terrainWidth * m_terrainHeight);
+	for (int i = 0; i < m_historyTileCount; i++)
+	{
+		tile = m_History->GetChunk(version, i);
+		if (!tile)
 		{
 			return false;
 		}
 
-		// Initialize the vertex and index buffer that hold the geometry for the terrain.
-		result = InitializeBuffers(device);
-		if(!result)
+		xStart = (i % m_historyTilesX) * HISTORY_TILE_SIZE;
+		yStart = (i / m_historyTilesX) * HISTORY_TILE_SIZE;
+		width = std::min(HISTORY_TILE_SIZE, m_terrainWidth - xStart);
+		height = std::min(HISTORY_TILE_SIZE, m_terrainHeight - yStart);
+		for (int j = 0; j < height; j++)
 		{
-			return false;
+			memcpy(&heights[((yStart + j) * m_terrainWidth) + xStart], &(*tile)[j * width * sizeof(float)], width * sizeof(float));
 		}
+	}
+
+	return true;
+}
+
+ID3D11ShaderResourceView* TerrainClass::GetGrassTexture()
+{
+	return m_GrassTexture->GetTexture();
+}
+
+ID3D11ShaderResourceView* TerrainClass::GetSlopeTexture()
+{
+	return m_SlopeTexture->GetTexture();
+}
+
+ID3D11ShaderResourceView* TerrainClass::GetRockTexture()
+{
+	return m_RockTexture->GetTexture();
+}
+
+bool TerrainClass::GenerateHeightMap(ID3D11Device* device, bool keydown)
+{
+	//the toggle is just a bool that I use to make sure this is only called ONCE when you press a key
+	//until you release the key and start again. We dont want to be generating the terrain 500
+	//times per second. 
+	if(keydown&&(!m_terrainGeneratedToggle))
+	{
+		// Fill the back height map with random heights on the generation thread.
+		RequestGeneration(device, GENERATE_RANDOM_FIELD, 0, (unsigned int)time(NULL));
 
 		m_terrainGeneratedToggle = true;
 	}
-	/*if (!keydown && (m_terrainGeneratedToggle))
+	if (!keydown && (m_terrainGeneratedToggle))
 	{
 		m_terrainGeneratedToggle = false;
-	}*/
+	}
 
 	return true;
 }
@@ -229,424 +463,460 @@ int TerrainClass::RandomHeightField()
 
 	//srand(NULL);
 	
-	randomHeight = rand() % 12 + 1;
+	randomHeight = Random() % 12 + 1;
 
 	return randomHeight;
 }
 
+int TerrainClass::Random()
+{
+	// Xorshift, cut down to the range rand() gives so the dungeon code reads as it did.
+	return (int)((NextRandom(m_randomState) >> 33) % ((unsigned long long)RAND_MAX + 1ULL));
+}
+
 int TerrainClass::SmoothVertex(ID3D11Device* device, bool keydown)
 {
-	bool result;
 	//the toggle is just a bool that I use to make sure this is only called ONCE when you press a key
 	//until you release the key and start again. We dont want to be generating the terrain 500
 	//times per second. 
 	if (keydown && (!m_terrainSmoothToggle))
 	{
-		int index;
-		float average;
-		float height = 0.0;
-
-
-		//loop through the terrain and set the hieghts how we want. This is where we generate the terrain
-		//in this case I will run a sin-wave through the terrain in one axis.
-
-		for (int j = 0; j < m_terrainHeight; j++)
-		{
-			for (int i = 0; i < m_terrainWidth; i++)
-			{
-				average = 0.0f;
-				//// Grab the average of the surrounding points
-				// (-1, -1)
-				index = (m_terrainHeight * (j - 1) + (i - 1));
-				if ((index < m_terrainHeight * m_terrainWidth) && (index > 0))
-				{
-					average += m_heightMap[index].y;
-				}
+		// Average the back height map on the generation thread.
+		RequestGeneration(device, GENERATE_SMOOTH, 0, (unsigned int)time(NULL));
 
-				// (0, -1)
-				index = (m_terrainHeight * (j - 1) + i);
-				if ((index < m_terrainHeight * m_terrainWidth) && (index > 0))
-				{
-					average += m_heightMap[index].y;
-				}
-				// (1, -1)
-				index = (m_terrainHeight * (j - 1) + (i + 1));
-				if ((index < m_terrainHeight * m_terrainWidth) && (index > 0))
-				{
-					average += m_heightMap[index].y;
-				}
-				// (-1, 0)
-				index = (m_terrainHeight * j + (i - 1));
-				if ((index < m_terrainHeight * m_terrainWidth) && (index > 0))
-				{
-					average += m_heightMap[index].y;
-				}
-				// (0, 0)
-				index = (m_terrainHeight * j) + i;
-				if ((index < m_terrainHeight * m_terrainWidth) && (index > 0))
-				{
-					average += m_heightMap[index].y;
-				}
-				// (1, 0)
-				index = (m_terrainHeight * j + (i + 1));
-				if ((index < m_terrainHeight * m_terrainWidth) && (index > 0))
-				{
-					average += m_heightMap[index].y;
-				}
-				// (-1, 1)
-				index = (m_terrainHeight * (j + 1) + (i - 1));
-				if ((index < m_terrainHeight * m_terrainWidth) && (index > 0))
-				{
-					average += m_heightMap[index].y;
-				}
-				// (0, 1)
-				index = (m_terrainHeight * (j + 1) + i);
-				if ((index < m_terrainHeight * m_terrainWidth) && (index > 0))
-				{
-					average += m_heightMap[index].y;
-				}
-				// (1, 1)
-				index = (m_terrainHeight * (j + 1) + (i + 1));
-				if ((index < m_terrainHeight * m_terrainWidth) && (index > 0))
-				{
-					average += m_heightMap[index].y;
-				}
+		m_terrainSmoothToggle = true;
+	}
+	if (!keydown && (m_terrainSmoothToggle))
+	{
+		m_terrainSmoothToggle = false;
+	}
 
-				average = average / 9;
+	return true;
+}
 
-				index = (m_terrainHeight * j) + i;
+int TerrainClass::SmoothPasses(ID3D11Device* device, bool keydown)
+{
+	if (keydown && (!m_terrainPassesToggle))
+	{
+		// Step the number of smoothing passes, a smoothing operation just done is redone from the cached terrain under it.
+		RequestSmoothPasses(device, (m_smoothPasses % MAX_SMOOTH_PASSES) + 1);
 
-				m_heightMap[index].x = (float)i;
-				m_heightMap[index].y = average;
-				m_heightMap[index].z = (float)j;
-			}
-		}
+		m_terrainPassesToggle = true;
+	}
+	if (!keydown && (m_terrainPassesToggle))
+	{
+		m_terrainPassesToggle = false;
+	}
 
-		result = CalculateNormals();
-		if (!result)
-		{
-			return false;
-		}
+	return true;
+}
 
-		// Initialize the vertex and index buffer that hold the geometry for the terrain.
-		result = InitializeBuffers(device);
-		if (!result)
-		{
-			return false;
-		}
+int TerrainClass::performPerlin(ID3D11Device * device, bool keydown)
+{
+	if (keydown && (!m_terrainPerlinToggle))
+	{
+		// Run the noise passes over the back height map on the generation thread.
+		RequestGeneration(device, GENERATE_PERLIN, 0, (unsigned int)time(NULL));
 
-		m_terrainSmoothToggle = false;
+		m_terrainPerlinToggle = true;
+	}
+	if (!keydown && (m_terrainPerlinToggle))
+	{
+		m_terrainPerlinToggle = false;
 	}
-
-//else
-//{
-//	m_terrainSmoothToggle = false;
-//}
 
 	return true;
 }
 
-int TerrainClass::performPerlin(ID3D11Device * device, bool keydown)
+void TerrainClass::corridorGeneration(int roomHeight)
 {
-	bool result;
+	int edgeCount;
+
 
-	if (keydown && (!m_terrainGeneratedToggle))
+	// Plan the connections, then route each one in turn.
+	edgeCount = planCorridors();
+	for (int i = 0; i < edgeCount; i++)
 	{
-		int index;
-		float height = 1.0;
+		routeCorridor(i);
+	}
 
-		perlin Perlin(58);
+	// Sink the corridors to floor level.
+	for (unsigned int i = 0; i < m_corridors.size(); i++)
+	{
+		carveRect(m_corridors[i], roomHeight);
+	}
 
-		for (int performPerlin = 0; performPerlin < 4; performPerlin++)
-		{
-			for (int j = 0; j<m_terrainHeight; j++)
-			{
-				for (int i = 0; i<m_terrainWidth; i++)
-				{
-					index = (m_terrainHeight * j) + i;
+	return;
+}
 
-					m_heightMap[index].x = (float)i;
-					m_heightMap[index].y = m_heightMap[index].y + 0.1* (float)((Perlin.noise(i, j, 1.1))*m_heightMap[index].y);
-					m_heightMap[index].z = (float)j;
-				}
-			}
-		}
-		
+int TerrainClass::planCorridors()
+{
+	bool result;
 
-		result = CalculateNormals();
-		if (!result)
-		{
-			return false;
-		}
 
-		result = InitializeBuffers(device);
-		if (!result)
-		{
-			return false;
-		}
+	m_corridorRooms.assign(roomCopy.begin(), roomCopy.end());
+	m_corridors.clear();
+	roomCopy.clear();
 
-		m_terrainGeneratedToggle = true;
+	// Join the rooms with a spanning tree of their Delaunay graph plus a few loops, so every room is reachable.
+	result = m_CorridorPlanner->Plan(m_corridorRooms, CORRIDOR_LOOP_FRACTION, m_arena);
+	if (!result)
+	{
+		return 0;
 	}
-	if (!keydown && (m_terrainGeneratedToggle))
+
+	// The router always learns the rooms, the connectivity repair routes through it either way.
+	m_CorridorRouter->Clear();
+	m_CorridorRouter->ResetStatistics();
+	for (unsigned int i = 0; i < m_corridorRooms.size(); i++)
 	{
-		m_terrainGeneratedToggle = false;
+		m_CorridorRouter->MarkRoom(m_corridorRooms[i]);
 	}
 
-	return true;
+	if (!ROUTE_CORRIDORS_AROUND_ROOMS)
+	{
+		// Lay each connection out as straight or L-shaped corridor pieces, there is nothing left to route.
+		m_CorridorPlanner->RouteCorridors(m_corridorRooms, m_corridors);
+		return 0;
+	}
+
+	return (int)m_CorridorPlanner->GetEdges().size();
 }
 
-void TerrainClass::corridorGeneration(int roomHeight)
+void TerrainClass::routeCorridor(int edge)
 {
-	dungeonCellData roomConnections[2];
-	dungeonCellData roomsToConnect[2];
+	const CorridorPlannerClass::EdgeType& link = m_CorridorPlanner->GetEdges()[edge];
 
-	int index = 0;
-	int roomCopySize = roomCopy.size();
 
+	// Path find the connection round the other rooms, reusing the corridors already dug where it can.
+	m_CorridorRouter->RouteRooms(m_corridorRooms[link.roomA], m_corridorRooms[link.roomB], m_corridors);
 
-	for (int i = 0; i < roomCopySize - 1; i++)
-	{
-		// The two rooms to connect are the first two in the queue
-		roomsToConnect[0] = roomCopy.front();
-		roomCopy.pop_front();
-		roomsToConnect[1] = roomCopy.front();
-
-		// Connects the two cells by two rectangles, one in X and one in Y
-		// to the Top Left
-		if ((roomsToConnect[0].xBottomLeft > roomsToConnect[1].xTopRight) && (roomsToConnect[0].yTopRight < roomsToConnect[1].yBottomLeft))
-		{
-			roomConnections[0].xBottomLeft = roomsToConnect[0].xBottomLeft;
-			roomConnections[0].yBottomLeft = roomsToConnect[0].yTopRight;
+	return;
+}
 
-			roomConnections[0].xTopRight = roomsToConnect[0].xBottomLeft + 3;
-			roomConnections[0].yTopRight = roomsToConnect[1].yBottomLeft + 3;
+int TerrainClass::connectivityCheck(int roomHeight)
+{
+	int step;
 
-			roomConnections[1].xBottomLeft = roomsToConnect[1].xTopRight;
-			roomConnections[1].yBottomLeft = roomsToConnect[1].yBottomLeft;
 
-			roomConnections[1].xTopRight = roomConnections[0].xTopRight;
-			roomConnections[1].yTopRight = roomsToConnect[1].yBottomLeft + 3;
+	step = 0;
+	while (!connectivityStep(step, roomHeight))
+	{
+		step++;
+	}
 
-			for (int y = roomConnections[0].yBottomLeft; y < roomConnections[0].yTopRight; y++)
-			{
-				for (int x = roomConnections[0].xBottomLeft; x < roomConnections[0].xTopRight; x++)
-				{
-					index = (y * m_terrainWidth) + (x);
-					if (index < (m_terrainHeight * m_terrainWidth) + 1)
-					{
-						m_heightMap[index].y = -roomHeight;
-					}
-				}
-			}
-			for (int y = roomConnections[1].yBottomLeft; y < roomConnections[0].yTopRight; y++)
-			{
-				for (int x = roomConnections[1].xBottomLeft; x < roomConnections[1].xTopRight; x++)
-				{
-					index = (y * m_terrainWidth) + (x);
-					if (index < (m_terrainHeight * m_terrainWidth) + 1)
-					{
-						m_heightMap[index].y = -roomHeight;
-					}
-				}
-			}
-		}
+	return m_Connectivity->GetComponentCount();
+}
 
-		// to the Top Right
-		if ((roomsToConnect[0].xTopRight < roomsToConnect[1].xBottomLeft) && (roomsToConnect[0].yTopRight < roomsToConnect[1].yBottomLeft))
-		{
-			roomConnections[0].xBottomLeft = roomsToConnect[0].xTopRight - 3;
-			roomConnections[0].yBottomLeft = roomsToConnect[0].yTopRight;
+bool TerrainClass::connectivityStep(int step, int roomHeight)
+{
+	int labelParts, roomCount, componentCount, target, room;
+	float dx, dy, distance, bestDistance;
 
-			roomConnections[0].xTopRight = roomsToConnect[0].xTopRight;
-			roomConnections[0].yTopRight = roomsToConnect[1].yBottomLeft + 3;
 
-			roomConnections[1].xBottomLeft = roomsToConnect[0].xTopRight - 3;
-			roomConnections[1].yBottomLeft = roomsToConnect[1].yBottomLeft;
+	// Label the floor a part per step, a fully connected dungeon is a single component. Then repair a room per
+	// step, sink the repair corridors and label again, so a time budget can stop between any two of them.
+	labelParts = m_Connectivity->GetLabelParts();
+	roomCount = m_RoomIndex->GetRoomCount();
 
-			roomConnections[1].xTopRight = roomConnections[1].xBottomLeft;
-			roomConnections[1].yTopRight = roomsToConnect[1].yBottomLeft + 3;
+	if (step < labelParts)
+	{
+		m_Connectivity->LabelPart(m_walkGrid, m_arena, step);
+		return false;
+	}
 
-			for (int y = roomConnections[0].yBottomLeft; y < roomConnections[0].yTopRight; y++)
-			{
-				for (int x = roomConnections[0].xBottomLeft; x < roomConnections[0].xTopRight; x++)
-				{
-					index = (y * m_terrainWidth) + (x);
-					if (index < (m_terrainHeight * m_terrainWidth) + 1)
-					{
-						m_heightMap[index].y = -roomHeight;
-					}
-				}
-			}
-			for (int y = roomConnections[1].yBottomLeft; y < roomConnections[0].yTopRight; y++)
-			{
-				for (int x = roomConnections[1].xBottomLeft; x < roomConnections[1].xTopRight; x++)
-				{
-					index = (y * m_terrainWidth) + (x);
-					if (index < (m_terrainHeight * m_terrainWidth) + 1)
-					{
-						m_heightMap[index].y = -roomHeight;
-					}
-				}
-			}
+	if (step == labelParts)
+	{
+		componentCount = m_Connectivity->GetComponentCount();
+		if (!REPAIR_DISCONNECTED_ROOMS || (componentCount <= 1))
+		{
+			return true;
 		}
 
-		// to the Bottom Left
-		if ((roomsToConnect[0].xBottomLeft > roomsToConnect[1].xTopRight) && (roomsToConnect[0].yBottomLeft < roomsToConnect[1].yTopRight))
+		// Find which component each room ended up in from a cell inside it.
+		m_repairComponents.resize(roomCount);
+		for (int i = 0; i < roomCount; i++)
 		{
-			roomConnections[0].xBottomLeft = roomsToConnect[1].xTopRight - 3;
-			roomConnections[0].yBottomLeft = roomsToConnect[0].yBottomLeft;
+			const dungeonCellData& room = m_RoomIndex->GetRoom(i);
+			m_repairComponents[i] = m_Connectivity->GetComponentAt((int)room.xBottomLeft, (int)room.yBottomLeft);
+		}
 
-			roomConnections[0].xTopRight = roomsToConnect[0].xBottomLeft;
-			roomConnections[0].yTopRight = roomsToConnect[0].yBottomLeft + 3;
+		// Component 0 is the largest, every other one gets joined to it.
+		m_repairJoined.assign(componentCount, false);
+		m_repairJoined[0] = true;
+		m_repairCorridors.clear();
 
-			roomConnections[1].xBottomLeft = roomsToConnect[1].xTopRight - 3;
-			roomConnections[1].yBottomLeft = roomsToConnect[1].yTopRight;
+		return false;
+	}
+
+	if (step <= (labelParts + roomCount))
+	{
+		// Join one room of every other component to the nearest room in the largest.
+		room = step - (labelParts + 1);
+		if ((m_repairComponents[room] < 0) || m_repairJoined[m_repairComponents[room]])
+		{
+			return false;
+		}
 
-			roomConnections[1].xTopRight = roomConnections[1].xTopRight;
-			roomConnections[1].yTopRight = roomsToConnect[0].yBottomLeft + 3;
+		const dungeonCellData& current = m_RoomIndex->GetRoom(room);
 
-			for (int y = roomConnections[0].yBottomLeft; y < roomConnections[0].yTopRight; y++)
+		target = -1;
+		bestDistance = 0.0f;
+		for (int j = 0; j < roomCount; j++)
+		{
+			if (m_repairComponents[j] != 0)
 			{
-				for (int x = roomConnections[0].xBottomLeft; x < roomConnections[0].xTopRight; x++)
-				{
-					index = (y * m_terrainWidth) + (x);
-					if (index < (m_terrainHeight * m_terrainWidth) + 1)
-					{
-						m_heightMap[index].y = -roomHeight;
-					}
-				}
+				continue;
 			}
-			for (int y = roomConnections[1].yBottomLeft; y < roomConnections[0].yTopRight; y++)
+
+			const dungeonCellData& other = m_RoomIndex->GetRoom(j);
+			dx = ((other.xBottomLeft + other.xTopRight) - (current.xBottomLeft + current.xTopRight)) * 0.5f;
+			dy = ((other.yBottomLeft + other.yTopRight) - (current.yBottomLeft + current.yTopRight)) * 0.5f;
+			distance = (dx * dx) + (dy * dy);
+			if ((target == -1) || (distance < bestDistance))
 			{
-				for (int x = roomConnections[1].xBottomLeft; x < roomConnections[1].xTopRight; x++)
-				{
-					index = (y * m_terrainWidth) + (x);
-					if (index < (m_terrainHeight * m_terrainWidth) + 1)
-					{
-						m_heightMap[index].y = -roomHeight;
-					}
-				}
+				target = j;
+				bestDistance = distance;
 			}
 		}
 
-		// to the Bottom Right
-		if ((roomsToConnect[0].xTopRight < roomsToConnect[1].xBottomLeft) && (roomsToConnect[0].yBottomLeft > roomsToConnect[1].yTopRight))
+		if ((target != -1) && m_CorridorRouter->RouteRooms(current, m_RoomIndex->GetRoom(target), m_repairCorridors))
 		{
-			roomConnections[0].xBottomLeft = roomsToConnect[0].xTopRight;
-			roomConnections[0].yBottomLeft = roomsToConnect[0].yBottomLeft;
+			m_repairJoined[m_repairComponents[room]] = true;
+		}
 
-			roomConnections[0].xTopRight = roomsToConnect[1].xBottomLeft + 3;
-			roomConnections[0].yTopRight = roomsToConnect[0].yBottomLeft + 3;
+		return false;
+	}
 
-			roomConnections[1].xBottomLeft = roomsToConnect[1].xBottomLeft;
-			roomConnections[1].yBottomLeft = roomsToConnect[1].yTopRight;
+	if (step == (labelParts + roomCount + 1))
+	{
+		// Sink the repair corridors, the label after them reports what is left.
+		for (unsigned int i = 0; i < m_repairCorridors.size(); i++)
+		{
+			carveRect(m_repairCorridors[i], roomHeight);
+		}
 
-			roomConnections[1].xTopRight = roomConnections[1].xBottomLeft + 3;
-			roomConnections[1].yTopRight = roomsToConnect[0].yBottomLeft + 3;
+		return false;
+	}
 
-			for (int y = roomConnections[0].yBottomLeft; y < roomConnections[0].yTopRight; y++)
-			{
-				for (int x = roomConnections[0].xBottomLeft; x < roomConnections[0].xTopRight; x++)
-				{
-					index = (y * m_terrainWidth) + (x);
-					if (index < (m_terrainHeight * m_terrainWidth) + 1)
-					{
-						m_heightMap[index].y = -roomHeight;
-					}
-				}
-			}
-			for (int y = roomConnections[1].yBottomLeft; y < roomConnections[0].yTopRight; y++)
-			{
-				for (int x = roomConnections[1].xBottomLeft; x < roomConnections[1].xTopRight; x++)
-				{
-					index = (y * m_terrainWidth) + (x);
-					if (index < (m_terrainHeight * m_terrainWidth) + 1)
-					{
-						m_heightMap[index].y = -roomHeight;
-					}
-				}
-			}
+	m_Connectivity->LabelPart(m_walkGrid, m_arena, step - (labelParts + roomCount + 2));
+
+	return (step == (labelParts + roomCount + 1 + labelParts));
+}
+
+void TerrainClass::carveRect(const dungeonCellData& rect, int roomHeight)
+{
+	int index, xStart, yStart, xEnd, yEnd;
+
+
+	// Clip the rectangle to the terrain so nothing is written outside the height map.
+	xStart = std::max((int)rect.xBottomLeft, 0);
+	yStart = std::max((int)rect.yBottomLeft, 0);
+	xEnd = std::min((int)rect.xTopRight, m_terrainWidth);
+	yEnd = std::min((int)rect.yTopRight, m_terrainHeight);
+
+	for (int y = yStart; y < yEnd; y++)
+	{
+		for (int x = xStart; x < xEnd; x++)
+		{
+			index = (y * m_terrainWidth) + (x);
+			m_heightMap[index].y = -roomHeight;
 		}
 	}
 
+	// Everything carved out is floor that can be walked on.
+	m_walkGrid.FillRect(xStart, yStart, xEnd, yEnd, true);
+
 	return;
 }
 
-void TerrainClass::roomHeight(int roomHeight)
+void TerrainClass::carveCaveRow(const BitGridClass& floor, int y, int roomHeight)
 {
-	dungeonCellData room;
-	int index = 0;
-	int indexB = 0;
-	std::deque<int>::size_type roomQueueSize = roomQueue.size();
+	int start, end;
 
-	// Resets the rest of the map to have height 0 so that rooms dont stack on top of each other over time
-	for (int xLoop = 0; xLoop < m_terrainWidth; xLoop++)
+
+	// Lower each run of cave floor in the row like a room.
+	start = floor.FindNextSet(0, y, m_terrainWidth);
+	while (start != -1)
 	{
-		for (int yLoop = 0; yLoop < m_terrainHeight; yLoop++)
+		end = floor.FindNextClear(start, y, m_terrainWidth);
+		if (end == -1)
+		{
+			end = m_terrainWidth;
+		}
+
+		for (int x = start; x < end; x++)
 		{
-			indexB = (yLoop * m_terrainWidth) + (xLoop);
-			m_heightMap[indexB].y = 0;
+			m_heightMap[(y * m_terrainWidth) + x].y = -roomHeight;
 		}
+
+		start = floor.FindNextSet(end, y, m_terrainWidth);
+	}
+
+	return;
+}
+
+void TerrainClass::roomHeight(int roomHeight)
+{
+	// Resets the rest of the map to have height 0 so that rooms dont stack on top of each other over time
+	for (int yLoop = 0; yLoop < m_terrainHeight; yLoop++)
+	{
+		flattenRow(yLoop);
 	}
 
+	// With the map flat again there is no floor left until the rooms are carved.
+	m_walkGrid.Clear();
+
 	// Loops through room queue, and brings whole height down to 5
-	for (int roomNum = 0; roomNum < roomQueue.size();)
+	while (m_roomHead < (int)roomQueue.size())
 	{
-		room = roomQueue.front();
+		carveRect(roomQueue[m_roomHead], roomHeight);
+		m_roomHead++;
+	}
+}
 
-		for (int y = room.yBottomLeft; y < room.yTopRight; y++)
-		{
-			for (int x = room.xBottomLeft; x < room.xTopRight; x++)
-			{
-				index = (y * m_terrainWidth) + (x);
-				if (index < (m_terrainHeight * m_terrainWidth) + 1)
-				{
-					m_heightMap[index].y = -roomHeight;
-				}
-			}
-		}
-		roomQueue.pop_front();
+void TerrainClass::flattenRow(int y)
+{
+	int index;
+
+
+	for (int x = 0; x < m_terrainWidth; x++)
+	{
+		index = (y * m_terrainWidth) + (x);
+		m_heightMap[index].y = 0;
 	}
+
+	return;
 }
 
 void TerrainClass::roomGeneration()
+{
+	// For each cell in the queue, randomly generate a size within the outer bounds
+	while (placeNextRoom())
+	{
+	}
+
+	// Copies queue for use in the height/corridor generation functions
+	roomCopy.assign(roomQueue.begin() + m_roomHead, roomQueue.end());
+
+	roomHeight(ROOM_DEPTH);
+	corridorGeneration(ROOM_DEPTH);
+	m_componentCount = connectivityCheck(ROOM_DEPTH);
+
+	return;
+}
+
+bool TerrainClass::placeNextRoom()
 {
 	int cellMid[2];
 	dungeonCellData newRoom;
-	
-	// For each cell in the queue, randomly generate a size within the outer bounds
-	for (int cellNum = 0; cellNum < cellQueue.size(); )
-		{
-			heightCell = cellQueue.front();
 
-			cellMid[0] = (heightCell.xBottomLeft + heightCell.xTopRight) / 2;
-			cellMid[1] = (heightCell.yBottomLeft + heightCell.yTopRight) / 2;
 
-			newRoom.xBottomLeft = (rand() % cellMid[0] + heightCell.xBottomLeft);
-			newRoom.yBottomLeft = (rand() % cellMid[1] + heightCell.yBottomLeft);
+	if (m_cellHead == (int)cellQueue.size())
+	{
+		return false;
+	}
+
+	heightCell = cellQueue[m_cellHead];
+	m_cellHead++;
+
+	cellMid[0] = (heightCell.xBottomLeft + heightCell.xTopRight) / 2;
+	cellMid[1] = (heightCell.yBottomLeft + heightCell.yTopRight) / 2;
+
+	// Skip cells too small to hold a room (this also keeps the modulo below away from zero).
+	if ((cellMid[0] <= 0) || (cellMid[1] <= 0) || ((int)heightCell.xTopRight <= 0) || ((int)heightCell.yTopRight <= 0))
+	{
+		return true;
+	}
+
+	newRoom.xBottomLeft = (Random() % cellMid[0] + heightCell.xBottomLeft);
+	newRoom.yBottomLeft = (Random() % cellMid[1] + heightCell.yBottomLeft);
+
+	newRoom.xTopRight = (Random() % (int)heightCell.xTopRight + cellMid[0]);
+	newRoom.yTopRight = (Random() % (int)heightCell.yTopRight + cellMid[1]);
+
+	// Only keep the room if it fits on the terrain without overlapping the rooms already placed.
+	if (placeRoom(newRoom))
+	{
+		roomQueue.push_back(newRoom);
+	}
+
+	return true;
+}
+
+bool TerrainClass::placeRoom(dungeonCellData& newRoom)
+{
+	dungeonCellData trims[4];
+	float area, bestArea;
+	int best;
 
-			newRoom.xTopRight = (rand() % (int)heightCell.xTopRight + cellMid[0]);
-			newRoom.yTopRight = (rand() % (int)heightCell.yTopRight + cellMid[1]);
 
-			roomQueue.push_back(newRoom);
+	// Keep the room on the terrain, random extents can run off the far edges.
+	newRoom.xBottomLeft = std::max(newRoom.xBottomLeft, 1.0f);
+	newRoom.yBottomLeft = std::max(newRoom.yBottomLeft, 1.0f);
+	newRoom.xTopRight = std::min(newRoom.xTopRight, (float)(m_terrainWidth - 1));
+	newRoom.yTopRight = std::min(newRoom.yTopRight, (float)(m_terrainHeight - 1));
 
-			cellQueue.pop_front();
+	// Each pass cuts the room back off one room it m_overlaps, the room only ever shrinks so this ends quickly.
+	for (int pass = 0; pass < 8; pass++)
+	{
+		if (((newRoom.xTopRight - newRoom.xBottomLeft) < MIN_ROOM_SIZE) || ((newRoom.yTopRight - newRoom.yBottomLeft) < MIN_ROOM_SIZE))
+		{
+			return false;
 		}
 
-	// Copies queue for use in the height/corridor generation functions
-	roomCopy = roomQueue;
+		if (m_RoomIndex->FindOverlaps(newRoom, m_overlaps) == 0)
+		{
+			m_RoomIndex->Insert(newRoom);
+			return true;
+		}
 
-	roomHeight(8);
-	corridorGeneration(8);
+		const dungeonCellData& other = m_RoomIndex->GetRoom(m_overlaps[0]);
 
-	return;
+		// Try cutting each side of the new room back to the other room, leaving a one cell wall between them.
+		for (int side = 0; side < 4; side++)
+		{
+			trims[side] = newRoom;
+		}
+		trims[0].xTopRight = other.xBottomLeft - 1.0f;
+		trims[1].xBottomLeft = other.xTopRight + 1.0f;
+		trims[2].yTopRight = other.yBottomLeft - 1.0f;
+		trims[3].yBottomLeft = other.yTopRight + 1.0f;
+
+		// Keep whichever cut leaves the biggest room.
+		best = -1;
+		bestArea = 0.0f;
+		for (int side = 0; side < 4; side++)
+		{
+			if (((trims[side].xTopRight - trims[side].xBottomLeft) < MIN_ROOM_SIZE) || ((trims[side].yTopRight - trims[side].yBottomLeft) < MIN_ROOM_SIZE))
+			{
+				continue;
+			}
+
+			area = (trims[side].xTopRight - trims[side].xBottomLeft) * (trims[side].yTopRight - trims[side].yBottomLeft);
+			if (area > bestArea)
+			{
+				bestArea = area;
+				best = side;
+			}
+		}
+
+		if (best == -1)
+		{
+			return false;
+		}
+
+		newRoom = trims[best];
+	}
+
+	return false;
 }
 
 void TerrainClass::cellDivision(dungeonCellData currentCell)
 {
 
 	// Sets the initial parent cell as the first to be split
-	currentCell = cellQueue.front();
+	currentCell = cellQueue[m_cellHead];
 
 	midpointX = (currentCell.xTopRight + currentCell.xBottomLeft) / 2.0f;
 	midpointY = (currentCell.yTopRight + currentCell.yBottomLeft) / 2.0f;
@@ -752,319 +1022,2556 @@ void TerrainClass::cellDivision(dungeonCellData currentCell)
 	}
 	//================================================================
 	// Removes the parent cell from the queue
-	cellQueue.pop_front();
+	m_cellHead++;
 }
 
 int TerrainClass::spacePartitioning(ID3D11Device* device, bool keydown, int runs)
 {
-	if (keydown && (!m_terrainGeneratedToggle))
+	if (keydown && (!m_terrainPartitionToggle))
 	{
-		srand(time(NULL));
-		m_terrainGeneratedToggle = true;
-		bool result;
-
-		// First cell is full terrain, current cell iterates through created cell list to make more
-		currentCell.xBottomLeft = 0.0f;
-		currentCell.yBottomLeft = 0.0f;
-		currentCell.xTopRight = m_terrainWidth;
-		currentCell.yTopRight = m_terrainHeight;
-
-		// Cell for adjusting height values after loop
-		heightCell.xBottomLeft = 0.0f;
-		heightCell.yBottomLeft = 0.0f;
-		heightCell.xTopRight = 0.0f;
-		heightCell.yTopRight = 0.0f;
-	
-		cellQueue.push_front(currentCell);
-
-		// Storage for new cells to be created from old
-	
-		for (int newCell = 0; newCell < 4; newCell++)
-		{
-			newCells[newCell].xBottomLeft = 0.0f;
-			newCells[newCell].yBottomLeft = 0.0f;
-			newCells[newCell].xTopRight = 0.0f;
-			newCells[newCell].yTopRight = 0.0f;
-		}
-	
-		// Calls the cell division function (quad tree) for a random amount of times between 10 and a random number (20-40)
-		for (int divisionPass = 0; divisionPass < (rand() % (rand() % 50 + 40) + 20); divisionPass++)
-		{
-			cellDivision(cellQueue.front());
-		}
-
-		// Calls the room generation function to split up the new cells into smaller rooms within each
-		roomGeneration();
+		// Build a new dungeon into the back height map on the generation thread.
+		RequestGeneration(device, GENERATE_DUNGEON, runs, (unsigned int)time(NULL));
 
-		result = CalculateNormals();
-		if (!result)
-		{
-			return false;
-		}
+		m_terrainPartitionToggle = true;
+	}
+	if (!keydown && (m_terrainPartitionToggle))
+	{
+		m_terrainPartitionToggle = false;
+	}
 
-		// Initialize the vertex and index buffer that hold the geometry for the terrain.
-		result = InitializeBuffers(device);
-		if (!result)
-		{
-			return false;
-		}
+	return true;
+}
 
-		m_terrainGeneratedToggle = false;
+int TerrainClass::erodeTerrain(ID3D11Device* device, bool keydown, int iterations)
+{
+	if (keydown && (!m_terrainErosionToggle))
+	{
+		// Wear the terrain down with rain and slumping on the generation thread.
+		RequestGeneration(device, GENERATE_EROSION, iterations, (unsigned int)time(NULL));
 
+		m_terrainErosionToggle = true;
+	}
+	if (!keydown && (m_terrainErosionToggle))
+	{
+		m_terrainErosionToggle = false;
 	}
-	
 
 	return true;
 }
 
-bool TerrainClass::LoadHeightMap(char* filename)
+int TerrainClass::cellularCaves(ID3D11Device* device, bool keydown, int iterations)
 {
-	FILE* filePtr;
-	int error;
-	unsigned int count;
-	BITMAPFILEHEADER bitmapFileHeader;
-	BITMAPINFOHEADER bitmapInfoHeader;
-	int imageSize, i, j, k, index;
-	unsigned char* bitmapImage;
-	unsigned char height;
-
+	if (keydown && (!m_terrainCaveToggle))
+	{
+		// Grow caves into the back height map on the generation thread.
+		RequestGeneration(device, GENERATE_CAVE, iterations, (unsigned int)time(NULL));
 
-	// Open the height map file in binary.
-	error = fopen_s(&filePtr, filename, "rb");
-	if(error != 0)
+		m_terrainCaveToggle = true;
+	}
+	if (!keydown && (m_terrainCaveToggle))
 	{
-		return false;
+		m_terrainCaveToggle = false;
 	}
 
-	// Read in the file header.
-	count = fread(&bitmapFileHeader, sizeof(BITMAPFILEHEADER), 1, filePtr);
-	if(count != 1)
+	return true;
+}
+
+int TerrainClass::saveDungeon(bool keydown, const char* filename)
+{
+	if (keydown && (!m_terrainSaveToggle))
 	{
-		return false;
-	}
+		// Save the recipe of the dungeon on screen.
+		SaveDungeon(filename, SAVE_GENERATED_TERRAIN);
 
-	// Read in the bitmap info header.
-	count = fread(&bitmapInfoHeader, sizeof(BITMAPINFOHEADER), 1, filePtr);
-	if(count != 1)
+		m_terrainSaveToggle = true;
+	}
+	if (!keydown && (m_terrainSaveToggle))
 	{
-		return false;
+		m_terrainSaveToggle = false;
 	}
 
-	// Save the dimensions of the terrain.
-	m_terrainWidth = bitmapInfoHeader.biWidth;
-	m_terrainHeight = bitmapInfoHeader.biHeight;
+	return true;
+}
 
-	// Calculate the size of the bitmap image data.
-	imageSize = m_terrainWidth * m_terrainHeight * 3;
+int TerrainClass::loadDungeon(ID3D11Device* device, bool keydown, const char* filename)
+{
+	if (keydown && (!m_terrainLoadToggle))
+	{
+		// Read a saved dungeon and build it on the generation thread.
+		LoadDungeon(device, filename);
 
-	// Allocate memory for the bitmap image data.
-	bitmapImage = new unsigned char[imageSize];
-	if(!bitmapImage)
+		m_terrainLoadToggle = true;
+	}
+	if (!keydown && (m_terrainLoadToggle))
 	{
-		return false;
+		m_terrainLoadToggle = false;
 	}
 
-	// Move to the beginning of the bitmap data.
-	fseek(filePtr, bitmapFileHeader.bfOffBits, SEEK_SET);
+	return true;
+}
+
+int TerrainClass::exportMesh(bool keydown, const char* filename, MeshExportClass::FormatType format)
+{
+	if (keydown && (!m_terrainExportToggle))
+	{
+		// Write the terrain on screen out as a mesh.
+		ExportMesh(filename, format);
 
-	// Read in the bitmap image data.
-	count = fread(bitmapImage, 1, imageSize, filePtr);
-	if(count != imageSize)
+		m_terrainExportToggle = true;
+	}
+	if (!keydown && (m_terrainExportToggle))
 	{
-		return false;
+		m_terrainExportToggle = false;
 	}
 
-	// Close the file.
-	error = fclose(filePtr);
-	if(error != 0)
+	return true;
+}
+
+int TerrainClass::exportImages(bool keydown, const char* filename, ImageExportClass::FormatType format)
+{
+	if (keydown && (!m_terrainImageToggle))
 	{
-		return false;
-	}
+		// Write the heights on screen out as an image, along with the other layers.
+		ExportImages(filename, format, EXPORT_IMAGE_LAYERS);
 
-	// Create the structure to hold the height map data.
-	m_heightMap = new HeightMapType[m_terrainWidth * m_terrainHeight];
-	if(!m_heightMap)
+		m_terrainImageToggle = true;
+	}
+	if (!keydown && (m_terrainImageToggle))
 	{
-		return false;
+		m_terrainImageToggle = false;
 	}
 
-	// Initialize the position in the image data buffer.
-	k=0;
+	return true;
+}
 
-	// Read the image data into the height map.
-	for(j=0; j<m_terrainHeight; j++)
+int TerrainClass::undoTerrain(ID3D11Device* device, bool keydown)
+{
+	if (keydown && (!m_terrainUndoToggle))
 	{
-		for(i=0; i<m_terrainWidth; i++)
-		{
-			height = bitmapImage[k];
-			
-			index = (m_terrainHeight * j) + i;
-
-			m_heightMap[index].x = (float)i;
-			m_heightMap[index].y = (float)height;
-			m_heightMap[index].z = (float)j;
+		// Go back to the terrain before this one.
+		RequestHistory(device, false);
 
-			k+=3;
-		}
+		m_terrainUndoToggle = true;
+	}
+	if (!keydown && (m_terrainUndoToggle))
+	{
+		m_terrainUndoToggle = false;
 	}
-
-	// Release the bitmap image data.
-	delete [] bitmapImage;
-	bitmapImage = 0;
 
 	return true;
 }
 
-void TerrainClass::NormalizeHeightMap()
+int TerrainClass::redoTerrain(ID3D11Device* device, bool keydown)
 {
-	int i, j;
-
-
-	for(j=0; j<m_terrainHeight; j++)
+	if (keydown && (!m_terrainRedoToggle))
 	{
+		// Go forward again to a terrain that was undone.
+		RequestHistory(device, true);
+
+		m_terrainRedoToggle = true;
+	}
+	if (!keydown && (m_terrainRedoToggle))
+	{
+		m_terrainRedoToggle = false;
+	}
+
+	return true;
+}
+
+int TerrainClass::levelDown(ID3D11Device* device, bool keydown, DungeonStackClass* stack)
+{
+	bool result;
+
+
+	if (keydown && (!m_terrainLevelDownToggle))
+	{
+		// Go down the stairs to the next level of the stack, the first press goes to the top one.
+		if (stack && (m_stackLevel < (stack->GetLevelCount() - 1)))
+		{
+			result = RequestLevel(device, stack, m_stackLevel + 1);
+			if (result)
+			{
+				m_stackLevel++;
+			}
+		}
+
+		m_terrainLevelDownToggle = true;
+	}
+	if (!keydown && (m_terrainLevelDownToggle))
+	{
+		m_terrainLevelDownToggle = false;
+	}
+
+	return true;
+}
+
+int TerrainClass::levelUp(ID3D11Device* device, bool keydown, DungeonStackClass* stack)
+{
+	bool result;
+
+
+	if (keydown && (!m_terrainLevelUpToggle))
+	{
+		// Go back up the stairs to the level above.
+		if (stack && (m_stackLevel > 0))
+		{
+			result = RequestLevel(device, stack, m_stackLevel - 1);
+			if (result)
+			{
+				m_stackLevel--;
+			}
+		}
+
+		m_terrainLevelUpToggle = true;
+	}
+	if (!keydown && (m_terrainLevelUpToggle))
+	{
+		m_terrainLevelUpToggle = false;
+	}
+
+	return true;
+}
+
+void TerrainClass::RequestGeneration(ID3D11Device* device, GenerationType type, int runs, unsigned int seed)
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+	OperationType operation;
+
+
+	operation.type = type;
+	operation.seed = seed;
+	operation.runs = (type == GENERATE_SMOOTH) ? m_smoothPasses : runs;
+	operation.passes = m_smoothPasses;
+	NormalizeOperation(type, operation.runs, operation.seed);
+
+	// A new random field starts the recipe over, everything else is applied on top of what is there.
+	if (type == GENERATE_RANDOM_FIELD)
+	{
+		m_recipe.clear();
+	}
+	m_recipe.push_back(operation);
+
+	// A newer request replaces any older one, bumping the generation number also cancels a job in flight.
+	m_historyVersion = -1;
+	m_generationDevice = device;
+	m_latestGeneration++;
+
+	m_generationCondition.notify_one();
+
+	return;
+}
+
+bool TerrainClass::RequestRecipe(ID3D11Device* device, const generationOperationData* operations, int operationCount)
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+	OperationType operation;
+	unsigned int seed;
+	int runs;
+
+
+	// A bad recipe is turned away whole and the current one left alone.
+	if ((operationCount < 1) || (operationCount > GENERATION_MAX_OPERATIONS))
+	{
+		return false;
+	}
+
+	for (int i = 0; i < operationCount; i++)
+	{
+		runs = operations[i].runs;
+		seed = operations[i].seed;
+		if (!NormalizeOperation(operations[i].type, runs, seed))
+		{
+			return false;
+		}
+	}
+
+	// The recipe replaces the current one and starts from the starting terrain, so the same operations always give the same terrain.
+	operation.type = GENERATE_INITIAL;
+	operation.seed = (unsigned int)DungeonFileClass::Hash(&m_baseDelta[0], (int)m_baseDelta.size());
+	operation.runs = 0;
+	operation.passes = 0;
+	m_recipe.assign(1, operation);
+
+	for (int i = 0; i < operationCount; i++)
+	{
+		operation.type = (GenerationType)operations[i].type;
+		operation.seed = operations[i].seed;
+		operation.runs = operations[i].runs;
+		operation.passes = m_smoothPasses;
+		NormalizeOperation(operation.type, operation.runs, operation.seed);
+
+		// A smooth's run count is its number of passes.
+		if (operation.type == GENERATE_SMOOTH)
+		{
+			operation.passes = operation.runs;
+		}
+
+		if (operation.type == GENERATE_RANDOM_FIELD)
+		{
+			m_recipe.clear();
+		}
+		m_recipe.push_back(operation);
+	}
+
+	m_historyVersion = -1;
+	m_generationDevice = device;
+	m_latestGeneration++;
+
+	m_generationCondition.notify_one();
+
+	return true;
+}
+
+bool TerrainClass::NormalizeOperation(int type, int& runs, unsigned int& seed)
+{
+	// Only operations a recipe may ask for, with a run count that is not negative.
+	if ((type < GENERATE_RANDOM_FIELD) || (type >= GENERATE_INITIAL) || (runs < 0))
+	{
+		return false;
+	}
+
+	// Only the cave, erosion and smooth stages repeat, and each only so far. Any other run count, and the seed
+	// of an operation that does not use one, is dropped so it can not make two keys for the same terrain.
+	if ((type == GENERATE_SMOOTH) || (type == GENERATE_EROSION))
+	{
+		seed = 0;
+	}
+
+	switch (type)
+	{
+		case GENERATE_SMOOTH:
+			runs = std::min(std::max(runs, 1), MAX_SMOOTH_PASSES);
+			break;
+		case GENERATE_CAVE:
+			runs = std::min(runs, MAX_CAVE_STEPS);
+			break;
+		case GENERATE_EROSION:
+			runs = std::min(runs, MAX_EROSION_ITERATIONS);
+			break;
+		default:
+			runs = 0;
+			break;
+	}
+
+	return true;
+}
+
+bool TerrainClass::PackTerrain(std::vector<unsigned char>& data)
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+
+
+	// Only the terrain of the latest recipe is wanted, a job that failed left the one before it on screen.
+	if (m_frontRecipe.size() != m_recipe.size())
+	{
+		return false;
+	}
+
+	for (unsigned int i = 0; i < m_recipe.size(); i++)
+	{
+		if ((m_frontRecipe[i].type != m_recipe[i].type) || (m_frontRecipe[i].seed != m_recipe[i].seed) || (m_frontRecipe[i].runs != m_recipe[i].runs) || (m_frontRecipe[i].passes != m_recipe[i].passes))
+		{
+			return false;
+		}
+	}
+
+	// The shown terrain with its normals, laid out as the cache keeps it.
+	PackHeights(data, true, true);
+
+	return true;
+}
+
+void TerrainClass::RequestSmoothPasses(ID3D11Device* device, int passes)
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+
+
+	m_smoothPasses = passes;
+
+	// Only a smoothing pass at the end of the recipe is redone, the cache has everything before it.
+	if (m_recipe.empty() || (m_recipe.back().type != GENERATE_SMOOTH) || (m_recipe.back().passes == passes))
+	{
+		return;
+	}
+	m_recipe.back().passes = passes;
+
+	m_historyVersion = -1;
+	m_generationDevice = device;
+	m_latestGeneration++;
+
+	m_generationCondition.notify_one();
+
+	return;
+}
+
+void TerrainClass::RequestLoad(ID3D11Device* device, std::vector<OperationType>& recipe, std::vector<unsigned char>& baseDelta, std::vector<float>& baseHeights, std::vector<unsigned char>& terrain)
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+
+
+	// The loaded recipe replaces the current one, the next job puts its starting terrain in the cache first.
+	// A recipe that starts with a random field has no starting terrain and leaves the current one alone.
+	m_recipe.swap(recipe);
+	if (!baseHeights.empty())
+	{
+		m_baseDelta.swap(baseDelta);
+	}
+	m_loadBaseHeights.swap(baseHeights);
+	m_loadTerrain.swap(terrain);
+	m_loadOperationCount = (int)m_recipe.size();
+
+	m_historyVersion = -1;
+	m_generationDevice = device;
+	m_latestGeneration++;
+
+	m_generationCondition.notify_one();
+
+	return;
+}
+
+bool TerrainClass::RequestLevel(ID3D11Device* device, DungeonStackClass* stack, int level)
+{
+	std::vector<OperationType> recipe;
+	std::vector<unsigned char> baseDelta, terrain;
+	std::vector<float> baseHeights;
+	OperationType operation;
+	bool result;
+
+
+	// A level can only be shown on a terrain the size of the stack.
+	if ((stack->GetWidth() != m_terrainWidth) || (stack->GetHeight() != m_terrainHeight))
+	{
+		return false;
+	}
+
+	result = stack->ReadLevel(level, baseHeights);
+	if (!result)
+	{
+		return false;
+	}
+
+	// The level is loaded as a starting terrain with nothing done to it, the way a saved dungeon is.
+	DungeonFileClass::EncodeDelta(&baseHeights[0], m_terrainWidth * m_terrainHeight, 1, baseDelta);
+
+	operation.type = GENERATE_INITIAL;
+	operation.seed = (unsigned int)DungeonFileClass::Hash(&baseDelta[0], (int)baseDelta.size());
+	operation.runs = 0;
+	operation.passes = 0;
+	recipe.push_back(operation);
+
+	RequestLoad(device, recipe, baseDelta, baseHeights, terrain);
+
+	return true;
+}
+
+void TerrainClass::RequestHistory(ID3D11Device* device, bool redo)
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+	bool result;
+
+
+	// Stepping through the history only moves which version is current, a job then builds it from its tiles.
+	result = redo ? m_History->Redo() : m_History->Undo();
+	if (!result)
+	{
+		return;
+	}
+
+	// The recipe goes back with it, so what is asked for next is applied on top of this version.
+	m_historyVersion = m_History->GetPosition();
+	UnpackHistory(m_historyVersion, &m_recipe, false);
+
+	m_generationDevice = device;
+	m_latestGeneration++;
+
+	m_generationCondition.notify_one();
+
+	return;
+}
+
+bool TerrainClass::SaveDungeon(const char* filename, bool terrain)
+{
+	DungeonFileClass saveFile;
+	DungeonFileClass::OperationType operation;
+
+
+	// Everything saved is what is on screen, which only the frame thread changes. Just after a load the starting
+	// terrain is already the loaded one while the old dungeon is still shown, so there is nothing to save until it is built.
+	if (m_frontRecipe.empty())
+	{
+		return false;
+	}
+
+	if ((m_frontRecipe[0].type == GENERATE_INITIAL) && (m_frontRecipe[0].seed != (unsigned int)DungeonFileClass::Hash(&m_baseDelta[0], (int)m_baseDelta.size())))
+	{
+		return false;
+	}
+
+	saveFile.SetSize(m_terrainWidth, m_terrainHeight);
+
+	for (unsigned int i = 0; i < m_frontRecipe.size(); i++)
+	{
+		operation.type = m_frontRecipe[i].type;
+		operation.seed = m_frontRecipe[i].seed;
+		operation.runs = m_frontRecipe[i].runs;
+		operation.passes = m_frontRecipe[i].passes;
+		saveFile.GetOperations().push_back(operation);
+	}
+
+	saveFile.GetRooms().assign(m_frontRooms.begin(), m_frontRooms.end());
+	saveFile.GetCorridors().assign(m_frontCorridors.begin(), m_frontCorridors.end());
+
+	// A recipe that starts with a random field does not need the starting terrain.
+	if (m_frontRecipe[0].type == GENERATE_INITIAL)
+	{
+		saveFile.GetBaseDelta().assign(m_baseDelta.begin(), m_baseDelta.end());
+	}
+
+	// The finished terrain with its normals, as the cache keeps it, makes a load skip straight to the mesh.
+	if (terrain)
+	{
+		PackHeights(saveFile.GetTerrain(), true, true);
+	}
+
+	return saveFile.Write(filename);
+}
+
+bool TerrainClass::ExportMesh(const char* filename, MeshExportClass::FormatType format)
+{
+	MeshExportClass meshExport;
+	float minHeight, maxHeight;
+	int stride, index;
+	bool result;
+
+
+	// The shown terrain is only changed by the frame thread, so it can be read here while the next one is generated.
+	if (!m_frontHeightMap)
+	{
+		return false;
+	}
+
+	// The mesh format wants the bounds of the positions before any of them.
+	minHeight = m_frontHeightMap[0].y;
+	maxHeight = m_frontHeightMap[0].y;
+	for (int i = 1; i < m_terrainWidth * m_terrainHeight; i++)
+	{
+		minHeight = std::min(minHeight, m_frontHeightMap[i].y);
+		maxHeight = std::max(maxHeight, m_frontHeightMap[i].y);
+	}
+
+	result = meshExport.Initialize(filename, format, m_terrainWidth, m_terrainHeight, minHeight, maxHeight, (float)TEXTURE_REPEAT / (float)m_terrainWidth);
+	if (!result)
+	{
+		meshExport.Shutdown();
+		return false;
+	}
+
+	// Hand the rows over straight from the height map, stepping over the fields in between.
+	stride = sizeof(HeightMapType) / sizeof(float);
+	for (int j = 0; (j < m_terrainHeight) && result; j++)
+	{
+		index = m_terrainWidth * j;
+		result = meshExport.WriteRow(&m_frontHeightMap[index].y, &m_frontHeightMap[index].nx, stride);
+	}
+
+	if (result)
+	{
+		result = meshExport.Finish();
+	}
+
+	meshExport.Shutdown();
+
+	return result;
+}
+
+bool TerrainClass::ExportImages(const char* filename, ImageExportClass::FormatType format, bool layers)
+{
+	ImageExportClass imageExport;
+	std::string name;
+	unsigned char* row;
+	const HeightMapType* cell;
+	char comment[128];
+	float minHeight, maxHeight, scale;
+	unsigned int value;
+	int xStart, yStart, xEnd, yEnd, start, end;
+	bool result;
+
+
+	if (!m_frontHeightMap)
+	{
+		return false;
+	}
+
+	result = imageExport.Initialize(m_terrainWidth, m_terrainHeight);
+	if (!result)
+	{
+		imageExport.Shutdown();
+		return false;
+	}
+
+	// The heights are stretched over the whole 16 bit range, with the range they came from kept in the comment.
+	minHeight = m_frontHeightMap[0].y;
+	maxHeight = m_frontHeightMap[0].y;
+	for (int i = 1; i < m_terrainWidth * m_terrainHeight; i++)
+	{
+		minHeight = std::min(minHeight, m_frontHeightMap[i].y);
+		maxHeight = std::max(maxHeight, m_frontHeightMap[i].y);
+	}
+	scale = (maxHeight > minHeight) ? (65535.0f / (maxHeight - minHeight)) : 0.0f;
+
+	// Images go top row first, which is the far end of the height map.
+	imageExport.SetPixelType(1, 16);
+	for (int j = 0; j < m_terrainHeight; j++)
+	{
+		row = imageExport.GetRow(m_terrainHeight - 1 - j);
+		cell = &m_frontHeightMap[m_terrainWidth * j];
+		for (int i = 0; i < m_terrainWidth; i++)
+		{
+			value = (unsigned int)(((cell[i].y - minHeight) * scale) + 0.5f);
+			row[i * 2] = (unsigned char)(value >> 8);
+			row[(i * 2) + 1] = (unsigned char)value;
+		}
+	}
+
+	snprintf(comment, sizeof(comment), "heights %g to %g", minHeight, maxHeight);
+	imageExport.SetComment(comment);
+
+	name = filename;
+	name += (format == ImageExportClass::FORMAT_PNG) ? ".png" : (format == ImageExportClass::FORMAT_PGM) ? ".pgm" : ".r16";
+	result = imageExport.Write(name.c_str(), format);
+
+	if (result && layers)
+	{
+		// The room map numbers the rooms from one, zero is anything else.
+		imageExport.SetPixelType(1, 16);
+		for (int j = 0; j < m_terrainHeight; j++)
+		{
+			memset(imageExport.GetRow(j), 0, m_terrainWidth * 2);
+		}
+
+		for (unsigned int k = 0; k < m_frontRooms.size(); k++)
+		{
+			xStart = std::max((int)m_frontRooms[k].xBottomLeft, 0);
+			yStart = std::max((int)m_frontRooms[k].yBottomLeft, 0);
+			xEnd = std::min((int)m_frontRooms[k].xTopRight, m_terrainWidth);
+			yEnd = std::min((int)m_frontRooms[k].yTopRight, m_terrainHeight);
+
+			for (int j = yStart; j < yEnd; j++)
+			{
+				row = imageExport.GetRow(m_terrainHeight - 1 - j);
+				for (int i = xStart; i < xEnd; i++)
+				{
+					row[i * 2] = (unsigned char)((k + 1) >> 8);
+					row[(i * 2) + 1] = (unsigned char)(k + 1);
+				}
+			}
+		}
+
+		name = filename;
+		name += (format == ImageExportClass::FORMAT_PNG) ? "_rooms.png" : (format == ImageExportClass::FORMAT_PGM) ? "_rooms.pgm" : "_rooms.raw";
+		result = imageExport.Write(name.c_str(), format);
+	}
+
+	if (result && layers)
+	{
+		// The walkable mask is white where there is floor.
+		imageExport.SetPixelType(1, 8);
+		for (int j = 0; j < m_terrainHeight; j++)
+		{
+			row = imageExport.GetRow(m_terrainHeight - 1 - j);
+			memset(row, 0, m_terrainWidth);
+
+			start = m_frontWalkGrid.FindNextSet(0, j, m_terrainWidth);
+			while (start != -1)
+			{
+				end = m_frontWalkGrid.FindNextClear(start, j, m_terrainWidth);
+				if (end == -1)
+				{
+					end = m_terrainWidth;
+				}
+				memset(&row[start], 255, end - start);
+				start = m_frontWalkGrid.FindNextSet(end, j, m_terrainWidth);
+			}
+		}
+
+		name = filename;
+		name += (format == ImageExportClass::FORMAT_PNG) ? "_walk.png" : (format == ImageExportClass::FORMAT_PGM) ? "_walk.pgm" : "_walk.raw";
+		result = imageExport.Write(name.c_str(), format);
+	}
+
+	if (result && layers)
+	{
+		// Normals go from -1 to 1 on each axis into 0 to 255 of red, green and blue.
+		imageExport.SetPixelType(3, 8);
+		for (int j = 0; j < m_terrainHeight; j++)
+		{
+			row = imageExport.GetRow(m_terrainHeight - 1 - j);
+			cell = &m_frontHeightMap[m_terrainWidth * j];
+			for (int i = 0; i < m_terrainWidth; i++)
+			{
+				row[i * 3] = (unsigned char)((std::min(std::max(cell[i].nx, -1.0f), 1.0f) * 127.5f) + 127.5f);
+				row[(i * 3) + 1] = (unsigned char)((std::min(std::max(cell[i].ny, -1.0f), 1.0f) * 127.5f) + 127.5f);
+				row[(i * 3) + 2] = (unsigned char)((std::min(std::max(cell[i].nz, -1.0f), 1.0f) * 127.5f) + 127.5f);
+			}
+		}
+
+		name = filename;
+		name += (format == ImageExportClass::FORMAT_PNG) ? "_normals.png" : (format == ImageExportClass::FORMAT_PGM) ? "_normals.ppm" : "_normals.raw";
+		result = imageExport.Write(name.c_str(), format);
+	}
+
+	imageExport.Shutdown();
+
+	return result;
+}
+
+bool TerrainClass::LoadDungeon(ID3D11Device* device, const char* filename)
+{
+	DungeonFileClass saveFile;
+	std::vector<OperationType> recipe;
+	std::vector<float> baseHeights;
+	std::vector<dungeonCellData> rects;
+	OperationType operation;
+	int cellCount, packedSize, position;
+	bool result;
+
+
+	result = saveFile.Read(filename);
+	if (!result)
+	{
+		return false;
+	}
+
+	// A dungeon can only be loaded into a terrain the size it was saved from.
+	if ((saveFile.GetWidth() != m_terrainWidth) || (saveFile.GetHeight() != m_terrainHeight))
+	{
+		return false;
+	}
+
+	// The recipe starts from the starting terrain or a random field, and the rest has to be operations this version knows.
+	std::vector<DungeonFileClass::OperationType>& operations = saveFile.GetOperations();
+	if (operations.empty() || ((operations[0].type != GENERATE_INITIAL) && (operations[0].type != GENERATE_RANDOM_FIELD)))
+	{
+		return false;
+	}
+
+	for (unsigned int i = 0; i < operations.size(); i++)
+	{
+		if ((operations[i].type < 0) || (operations[i].type > GENERATE_INITIAL) || ((i > 0) && (operations[i].type == GENERATE_INITIAL)))
+		{
+			return false;
+		}
+
+		if ((operations[i].runs < 0) || (operations[i].passes < 0) || (operations[i].passes > MAX_SMOOTH_PASSES))
+		{
+			return false;
+		}
+
+		operation.type = (GenerationType)operations[i].type;
+		operation.seed = operations[i].seed;
+		operation.runs = operations[i].runs;
+		operation.passes = operations[i].passes;
+		NormalizeOperation(operation.type, operation.runs, operation.seed);
+		recipe.push_back(operation);
+	}
+
+	// Rebuild the starting terrain if the recipe uses it, its hash keys it in the cache.
+	cellCount = m_terrainWidth * m_terrainHeight;
+	if (recipe[0].type == GENERATE_INITIAL)
+	{
+		baseHeights.resize(cellCount);
+		result = DungeonFileClass::DecodeDelta(saveFile.GetBaseDelta(), &baseHeights[0], cellCount, 1);
+		if (!result)
+		{
+			return false;
+		}
+		recipe[0].seed = (unsigned int)DungeonFileClass::Hash(&saveFile.GetBaseDelta()[0], (int)saveFile.GetBaseDelta().size());
+	}
+
+	// A finished terrain has to be laid out the way PackHeights leaves it.
+	std::vector<unsigned char>& terrain = saveFile.GetTerrain();
+	if (!terrain.empty())
+	{
+		packedSize = sizeof(int) + (cellCount * 4 * sizeof(float)) + (m_frontWalkGrid.GetWordCount() * sizeof(unsigned long long));
+		if ((int)terrain.size() < packedSize)
+		{
+			return false;
+		}
+
+		position = packedSize;
+		if (!DungeonFileClass::ReadRects(terrain, position, (int)terrain.size(), rects) || !DungeonFileClass::ReadRects(terrain, position, (int)terrain.size(), rects) || (position != (int)terrain.size()))
+		{
+			return false;
+		}
+	}
+
+	RequestLoad(device, recipe, saveFile.GetBaseDelta(), baseHeights, terrain);
+
+	return true;
+}
+
+void TerrainClass::UpdateGeneration(int budget)
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+	HeightMapType* heightMap;
+	float* wallDistances;
+	bool result, finished;
+
+
+	// Without a spare core the frame loop runs the job itself, one budgeted slice per frame.
+	if (!m_generationThreaded)
+	{
+		if (m_startedGeneration != m_latestGeneration)
+		{
+			m_startedGeneration = m_latestGeneration;
+			StartGeneration();
+			m_generationReady = false;
+			m_generationBusy = true;
+		}
+
+		if (m_generationBusy)
+		{
+			result = StepGeneration(budget, finished);
+			if (!result || finished)
+			{
+				FinishGeneration(result);
+			}
+		}
+	}
+
+	if (!m_generationReady)
+	{
+		return;
+	}
+
+	// Swap the finished terrain to the front. The old vertex buffer can go as nothing draws with it after this.
+	if (m_vertexBuffer)
+	{
+		m_vertexBuffer->Release();
+	}
+	m_vertexBuffer = m_backVertexBuffer;
+	m_backVertexBuffer = 0;
+
+	heightMap = m_frontHeightMap;
+	m_frontHeightMap = m_heightMap;
+	m_heightMap = heightMap;
+
+	wallDistances = m_frontWallDistances;
+	m_frontWallDistances = m_wallDistances;
+	m_wallDistances = wallDistances;
+
+	m_frontWalkGrid.CopyFrom(m_walkGrid);
+	m_frontComponentCount = m_componentCount;
+	m_frontRooms.assign(m_corridorRooms.begin(), m_corridorRooms.end());
+	m_frontCorridors.assign(m_corridors.begin(), m_corridors.end());
+	m_frontRecipe = m_jobRecipe;
+
+	m_generationReady = false;
+
+	return;
+}
+
+bool TerrainClass::IsGenerating()
+{
+	std::lock_guard<std::mutex> lock(m_generationMutex);
+
+
+	return m_generationBusy || (m_startedGeneration != m_latestGeneration) || m_generationReady;
+}
+
+void TerrainClass::SetViewPosition(float x, float z)
+{
+	// Only recorded here, the frame thread never touches the height fields.
+	m_viewX = (int)x;
+	m_viewZ = (int)z;
+
+	return;
+}
+
+bool TerrainClass::InitializeGeneration()
+{
+	OperationType operation;
+	bool result;
+
+
+	// Create the front copy of the height map, the terrain on screen was built from it.
+	m_frontHeightMap = new HeightMapType[m_terrainWidth * m_terrainHeight];
+	if (!m_frontHeightMap)
+	{
+		return false;
+	}
+	memcpy(m_frontHeightMap, m_heightMap, sizeof(HeightMapType) * m_terrainWidth * m_terrainHeight);
+
+	// Create the front copy of the walkability grid.
+	result = m_frontWalkGrid.Initialize(m_terrainWidth, m_terrainHeight);
+	if (!result)
+	{
+		return false;
+	}
+	m_frontWalkGrid.CopyFrom(m_walkGrid);
+
+	// Create the wall distance planes, the front one measured from the starting walkability grid.
+	m_wallDistances = new float[m_terrainWidth * m_terrainHeight];
+	if (!m_wallDistances)
+	{
+		return false;
+	}
+
+	m_frontWallDistances = new float[m_terrainWidth * m_terrainHeight];
+	if (!m_frontWallDistances)
+	{
+		return false;
+	}
+	m_DistanceField->Compute(m_walkGrid, m_frontWallDistances);
+
+	// Create the face normal array the normal stages share between slices.
+	m_faceNormals = new VectorType[(m_terrainHeight - 1) * (m_terrainWidth - 1)];
+	if (!m_faceNormals)
+	{
+		return false;
+	}
+
+	// Create the arena for the scratch arrays of the stages.
+	result = m_arena.Initialize(GENERATION_ARENA_SIZE);
+	if (!result)
+	{
+		return false;
+	}
+
+	// The noise graph never changes, so it is made once rather than for every noise pass.
+	result = InitializeNoise();
+	if (!result)
+	{
+		return false;
+	}
+
+	// Create the stage cache.
+	m_Pipeline = new PipelineClass;
+	if (!m_Pipeline)
+	{
+		return false;
+	}
+
+	result = m_Pipeline->Initialize(PIPELINE_CACHE_SIZE);
+	if (!result)
+	{
+		return false;
+	}
+
+	// Create the disk cache. Without a directory to write to the terrain is just generated every time.
+	m_DiskCache = new DiskCacheClass;
+	if (!m_DiskCache)
+	{
+		return false;
+	}
+
+	result = m_DiskCache->Initialize(DISK_CACHE_DIRECTORY, DISK_CACHE_SIZE, DISK_CACHE_VERSION);
+	if (!result)
+	{
+		delete m_DiskCache;
+		m_DiskCache = 0;
+	}
+
+	// The recipe starts from the loaded terrain, which can not be made again so it is pinned in the cache. It is
+	// kept as a delta against flat ground for saving, and the hash of that tells starting terrains apart.
+	DungeonFileClass::EncodeDelta(&m_heightMap[0].y, m_terrainWidth * m_terrainHeight, sizeof(HeightMapType) / sizeof(float), m_baseDelta);
+
+	operation.type = GENERATE_INITIAL;
+	operation.seed = (unsigned int)DungeonFileClass::Hash(&m_baseDelta[0], (int)m_baseDelta.size());
+	operation.runs = 0;
+	operation.passes = 0;
+	m_recipe.assign(1, operation);
+	m_frontRecipe = m_recipe;
+
+	m_jobRecipe = m_recipe;
+	BuildPipeline();
+	PackHeights(m_packedHeights, false, false);
+	m_Pipeline->Store(m_jobKeys[0], m_packedHeights, true);
+	m_baseKey = m_jobKeys[0];
+
+	// Create the history, with the starting terrain as its first version.
+	m_historyTilesX = (m_terrainWidth + HISTORY_TILE_SIZE - 1) / HISTORY_TILE_SIZE;
+	m_historyTilesY = (m_terrainHeight + HISTORY_TILE_SIZE - 1) / HISTORY_TILE_SIZE;
+	m_historyTileCount = m_historyTilesX * m_historyTilesY;
+	m_historyTile.resize(HISTORY_TILE_SIZE * HISTORY_TILE_SIZE);
+
+	m_History = new TerrainHistoryClass;
+	if (!m_History)
+	{
+		return false;
+	}
+
+	result = m_History->Initialize(m_historyTileCount + m_historyTilesY, HISTORY_VERSIONS, HISTORY_SIZE);
+	if (!result)
+	{
+		return false;
+	}
+
+	m_History->Begin();
+	for (int i = 0; i < m_History->GetChunkCount(); i++)
+	{
+		result = SnapshotChunk(i);
+		if (!result)
+		{
+			return false;
+		}
+	}
+	PackHistory(m_historyExtra);
+	m_History->Commit(m_historyExtra);
+
+	// Start the thread that runs the generation jobs, unless there is no other core for it to run on.
+	m_generationThreaded = BACKGROUND_GENERATION && (std::thread::hardware_concurrency() > 1);
+	if (m_generationThreaded)
+	{
+		m_generationThread = std::thread(&TerrainClass::GenerationThread, this);
+	}
+
+	return true;
+}
+
+bool TerrainClass::InitializeNoise()
+{
+	bool result;
+
+
+	// The base noises.
+	result = m_perlinNoise.Initialize(58);
+	if (!result)
+	{
+		return false;
+	}
+
+	result = m_simplexNoise.Initialize(59);
+	if (!result)
+	{
+		return false;
+	}
+
+	// Ridged perlin octaves make the mountains.
+	result = m_ridgedNoise.Initialize(&m_perlinNoise);
+	if (!result)
+	{
+		return false;
+	}
+
+	result = m_ridgedFractal.Initialize(&m_ridgedNoise, NOISE_OCTAVES, NOISE_FREQUENCY, 2.0f, 0.5f);
+	if (!result)
+	{
+		return false;
+	}
+
+	// Two broad octaves of simplex bend them about so the ridges do not run along the grid.
+	result = m_warpFractal.Initialize(&m_simplexNoise, 2, NOISE_FREQUENCY * 0.5f, 2.0f, 0.5f);
+	if (!result)
+	{
+		return false;
+	}
+
+	result = m_warpedNoise.Initialize(&m_ridgedFractal, &m_warpFractal, NOISE_WARP);
+	if (!result)
+	{
+		return false;
+	}
+
+	// Scale it to terrain heights.
+	result = m_terrainNoise.Initialize(&m_warpedNoise, 1.0f, NOISE_AMPLITUDE, 0.0f);
+	if (!result)
+	{
+		return false;
+	}
+
+	m_noiseRow.resize(m_terrainWidth);
+	m_noiseOffsetX = 0.0f;
+	m_noiseOffsetY = 0.0f;
+
+	return true;
+}
+
+void TerrainClass::ShutdownGeneration()
+{
+	// Cancel whatever is running and wait for the generation thread to finish.
+	if (m_generationThread.joinable())
+	{
+		m_generationMutex.lock();
+		m_generationQuit = true;
+		m_latestGeneration++;
+		m_generationMutex.unlock();
+
+		m_generationCondition.notify_one();
+		m_generationThread.join();
+	}
+
+	// Release vertex buffers that were never swapped in.
+	if (m_stageVertexBuffer)
+	{
+		m_stageVertexBuffer->Release();
+		m_stageVertexBuffer = 0;
+	}
+
+	if (m_backVertexBuffer)
+	{
+		m_backVertexBuffer->Release();
+		m_backVertexBuffer = 0;
+	}
+
+	// Release the stage caches and the arena.
+	if (m_DiskCache)
+	{
+		m_DiskCache->Shutdown();
+		delete m_DiskCache;
+		m_DiskCache = 0;
+	}
+
+	if (m_Pipeline)
+	{
+		m_Pipeline->Shutdown();
+		delete m_Pipeline;
+		m_Pipeline = 0;
+	}
+
+	if (m_History)
+	{
+		m_History->Shutdown();
+		delete m_History;
+		m_History = 0;
+	}
+	std::vector<float>().swap(m_historyTile);
+	std::vector<unsigned char>().swap(m_historyExtra);
+
+	m_arena.Shutdown();
+
+	// Release the noise sources.
+	m_perlinNoise.Shutdown();
+	m_simplexNoise.Shutdown();
+	std::vector<float>().swap(m_noiseRow);
+
+	// Release the stage arrays.
+	if (m_meshVertices)
+	{
+		delete [] m_meshVertices;
+		m_meshVertices = 0;
+	}
+
+	if (m_faceNormals)
+	{
+		delete [] m_faceNormals;
+		m_faceNormals = 0;
+	}
+
+	// Release the wall distance planes and the front copies.
+	if (m_wallDistances)
+	{
+		delete [] m_wallDistances;
+		m_wallDistances = 0;
+	}
+
+	if (m_frontWallDistances)
+	{
+		delete [] m_frontWallDistances;
+		m_frontWallDistances = 0;
+	}
+
+	m_frontWalkGrid.Shutdown();
+
+	if (m_frontHeightMap)
+	{
+		delete [] m_frontHeightMap;
+		m_frontHeightMap = 0;
+	}
+
+	return;
+}
+
+void TerrainClass::GenerationThread()
+{
+	std::unique_lock<std::mutex> lock(m_generationMutex);
+	bool result, finished;
+
+
+	while (true)
+	{
+		// Sleep until there is a request this thread has not started on.
+		m_generationCondition.wait(lock, [this]() { return m_generationQuit || (m_startedGeneration != m_latestGeneration); });
+		if (m_generationQuit)
+		{
+			break;
+		}
+
+		// Take the newest request, a result still waiting to be swapped in is now out of date.
+		m_startedGeneration = m_latestGeneration;
+		m_jobGeneration = m_startedGeneration;
+		StartGeneration();
+		m_generationReady = false;
+		m_generationBusy = true;
+
+		lock.unlock();
+
+		// Run the job in short slices so a newer request is noticed quickly.
+		do
+		{
+			result = StepGeneration(GENERATION_SLICE, finished);
+		}
+		while (result && !finished && (m_jobGeneration == m_latestGeneration));
+
+		lock.lock();
+
+		// Only hand the result over if nothing newer was asked for while it was being built.
+		FinishGeneration(result && finished && (m_jobGeneration == m_latestGeneration));
+	}
+
+	return;
+}
+
+void TerrainClass::FinishGeneration(bool result)
+{
+	m_generationBusy = false;
+
+	if (result)
+	{
+		if (m_backVertexBuffer)
+		{
+			m_backVertexBuffer->Release();
+		}
+		m_backVertexBuffer = m_stageVertexBuffer;
+		m_generationReady = true;
+
+		m_generationAllocationCount = m_jobAllocationCount;
+		m_generationAllocatedBytes = m_jobAllocatedBytes;
+		m_generationArenaBytes = m_arena.GetUsedBytes();
+
+		// The terrain becomes the newest version, unless it is one the history had already.
+		if (m_jobHistoryVersion == -1)
+		{
+			PackHistory(m_historyExtra);
+			m_History->Commit(m_historyExtra);
+		}
+	}
+	else if (m_stageVertexBuffer)
+	{
+		m_stageVertexBuffer->Release();
+	}
+
+	// A job that did not finish leaves no version behind.
+	m_History->Cancel();
+
+	m_stageVertexBuffer = 0;
+
+	return;
+}
+
+void TerrainClass::StartGeneration()
+{
+	// Work from a copy of the recipe, the frame thread can change it while the job runs.
+	m_jobRecipe = m_recipe;
+
+	// Take what a load left for the cache.
+	m_jobBaseHeights.swap(m_loadBaseHeights);
+	m_jobTerrain.swap(m_loadTerrain);
+	m_jobTerrainOperations = m_loadOperationCount;
+	m_loadBaseHeights.clear();
+	m_loadTerrain.clear();
+
+	// A restore job builds a version the history already has, any other job's terrain is made into a new one.
+	m_jobHistoryVersion = m_historyVersion;
+	m_historyVersion = -1;
+	if (m_jobHistoryVersion == -1)
+	{
+		m_History->Begin();
+	}
+	else
+	{
+		m_History->Cancel();
+	}
+
+	// Everything the last job put in the arena goes in one reset.
+	m_arena.Reset();
+	m_jobAllocationCount = 0;
+	m_jobAllocatedBytes = 0;
+
+	NextStage(STAGE_PREPARE);
+
+	return;
+}
+
+bool TerrainClass::StartOperation()
+{
+	// Once the recipe is used up only the normals and the mesh are left.
+	if (m_jobOperation >= (int)m_jobRecipe.size())
+	{
+		NextStage(STAGE_FACE_NORMALS);
+		return true;
+	}
+
+	const OperationType& operation = m_jobRecipe[m_jobOperation];
+	switch (operation.type)
+	{
+		case GENERATE_RANDOM_FIELD:
+			m_randomState = ((unsigned long long)operation.seed << 1) | 1ULL;
+			NextStage(STAGE_RANDOM_FIELD);
+			return true;
+		case GENERATE_SMOOTH:
+			NextStage(STAGE_SMOOTH);
+			return true;
+		case GENERATE_PERLIN:
+			// The seed picks which part of the noise plane is laid over the terrain.
+			m_noiseOffsetX = (float)(operation.seed % 4096);
+			m_noiseOffsetY = (float)((operation.seed / 4096) % 4096);
+			NextStage(STAGE_PERLIN);
+			return true;
+		case GENERATE_EROSION:
+			NextStage(STAGE_EROSION);
+			return true;
+		case GENERATE_DUNGEON:
+			m_randomState = ((unsigned long long)operation.seed << 1) | 1ULL;
+			m_CorridorPlanner->Seed(operation.seed);
+			startDungeon();
+			NextStage(STAGE_DIVIDE_CELLS);
+			return true;
+		case GENERATE_CAVE:
+			m_Cave->Seed(CAVE_FILL, operation.seed);
+			NextStage(STAGE_CAVE_STEP);
+			return true;
+		default:
+			// The starting terrain is pinned in the cache and can not be made again.
+			return false;
+	}
+}
+
+bool TerrainClass::FinishOperation()
+{
+
+
+	// Keep the output so a later job that only changes what comes after this can start from here.
+	PackHeights(m_packedHeights, false, false);
+	m_Pipeline->Store(m_jobKeys[m_jobOperation], m_packedHeights, false);
+	if (m_DiskCache)
+	{
+		m_DiskCache->Store(m_jobKeys[m_jobOperation], m_packedHeights);
+	}
+
+	m_jobOperation++;
+
+	return StartOperation();
+}
+
+void TerrainClass::PackHeights(std::vector<unsigned char>& data, bool normals, bool front)
+{
+	int cellCount, cellSize, wordCount;
+	unsigned char* output;
+
+
+	// The back terrain for the cache, or the one on screen for a save.
+	const HeightMapType* heightMap = front ? m_frontHeightMap : m_heightMap;
+	const BitGridClass& walkGrid = front ? m_frontWalkGrid : m_walkGrid;
+	const std::vector<dungeonCellData>& rooms = front ? m_frontRooms : m_corridorRooms;
+	const std::vector<dungeonCellData>& corridors = front ? m_frontCorridors : m_corridors;
+
+	// The x, z and texture coordinates never change, so only the heights, the normals if asked, the floor
+	// and the rooms and corridors are kept.
+	cellCount = m_terrainWidth * m_terrainHeight;
+	cellSize = normals ? (4 * sizeof(float)) : sizeof(float);
+	wordCount = walkGrid.GetWordCount();
+
+	data.resize(sizeof(int) + (cellCount * cellSize) + (wordCount * sizeof(unsigned long long)));
+	output = &data[0];
+
+	memcpy(output, front ? &m_frontComponentCount : &m_componentCount, sizeof(int));
+	output += sizeof(int);
+
+	for (int i = 0; i < cellCount; i++)
+	{
+		memcpy(output, &heightMap[i].y, sizeof(float));
+		output += sizeof(float);
+
+		if (normals)
+		{
+			memcpy(output, &heightMap[i].nx, sizeof(float));
+			memcpy(output + sizeof(float), &heightMap[i].ny, sizeof(float));
+			memcpy(output + (2 * sizeof(float)), &heightMap[i].nz, sizeof(float));
+			output += 3 * sizeof(float);
+		}
+	}
+
+	memcpy(output, walkGrid.GetWords(), wordCount * sizeof(unsigned long long));
+
+	// The rooms and corridors go field by field after the fixed part.
+	DungeonFileClass::WriteRects(data, rooms);
+	DungeonFileClass::WriteRects(data, corridors);
+
+	return;
+}
+
+bool TerrainClass::UnpackHeights(const std::vector<unsigned char>& data, bool normals)
+{
+	int cellCount, fixedSize, position;
+	const unsigned char* input;
+
+
+	cellCount = m_terrainWidth * m_terrainHeight;
+	fixedSize = sizeof(int) + (cellCount * (normals ? (4 * sizeof(float)) : sizeof(float))) + (m_walkGrid.GetWordCount() * sizeof(unsigned long long));
+	if ((int)data.size() < fixedSize)
+	{
+		return false;
+	}
+
+	// Read the rooms and corridors first so a damaged blob leaves the terrain alone.
+	position = fixedSize;
+	if (!DungeonFileClass::ReadRects(data, position, (int)data.size(), m_rectScratch) || !DungeonFileClass::ReadRects(data, position, (int)data.size(), m_corridorScratch) || (position != (int)data.size()))
+	{
+		return false;
+	}
+
+	input = &data[0];
+
+	memcpy(&m_componentCount, input, sizeof(int));
+	input += sizeof(int);
+
+	for (int i = 0; i < cellCount; i++)
+	{
+		memcpy(&m_heightMap[i].y, input, sizeof(float));
+		input += sizeof(float);
+
+		if (normals)
+		{
+			memcpy(&m_heightMap[i].nx, input, sizeof(float));
+			memcpy(&m_heightMap[i].ny, input + sizeof(float), sizeof(float));
+			memcpy(&m_heightMap[i].nz, input + (2 * sizeof(float)), sizeof(float));
+			input += 3 * sizeof(float);
+		}
+	}
+
+	memcpy(m_walkGrid.GetWords(), input, m_walkGrid.GetWordCount() * sizeof(unsigned long long));
+
+	m_corridorRooms.swap(m_rectScratch);
+	m_corridors.swap(m_corridorScratch);
+
+	return true;
+}
+
+bool TerrainClass::RestoreStage(unsigned long long key, bool normals)
+{
+	const std::vector<unsigned char>* cached;
+	const unsigned char* mapped;
+	long long size;
+
+
+	// Memory first, then the disk, whose blobs are put in memory so going back to them again is free.
+	cached = m_Pipeline->Find(key);
+	if (cached)
+	{
+		return UnpackHeights(*cached, normals);
+	}
+
+	if (!m_DiskCache)
+	{
+		return false;
+	}
+
+	mapped = m_DiskCache->Map(key, size);
+	if (!mapped)
+	{
+		return false;
+	}
+
+	m_packedHeights.assign(mapped, mapped + size);
+	m_DiskCache->Unmap();
+
+	// A blob that does not read back is left out of memory so the stage is run again instead.
+	if (!UnpackHeights(m_packedHeights, normals))
+	{
+		return false;
+	}
+
+	m_Pipeline->Store(key, m_packedHeights, false);
+
+	return true;
+}
+
+bool TerrainClass::SnapshotChunk(int chunk)
+{
+	int xStart, yStart, width, height, wordsPerRow;
+
+
+	// A walk grid band is whole rows of words, so it is already in one piece.
+	if (chunk >= m_historyTileCount)
+	{
+		wordsPerRow = m_walkGrid.GetWordCount() / m_terrainHeight;
+		yStart = (chunk - m_historyTileCount) * HISTORY_TILE_SIZE;
+		height = std::min(HISTORY_TILE_SIZE, m_terrainHeight - yStart);
+
+		return m_History->Update(chunk, m_walkGrid.GetWords() + (yStart * wordsPerRow), height * wordsPerRow * sizeof(unsigned long long));
+	}
+
+	// A height tile is gathered out of the height map a row at a time.
+	xStart = (chunk % m_historyTilesX) * HISTORY_TILE_SIZE;
+	yStart = (chunk / m_historyTilesX) * HISTORY_TILE_SIZE;
+	width = std::min(HISTORY_TILE_SIZE, m_terrainWidth - xStart);
+	height = std::min(HISTORY_TILE_SIZE, m_terrainHeight - yStart);
+
+	for (int j = 0; j < height; j++)
+	{
+		for (int i = 0; i < width; i++)
+		{
+			m_historyTile[(j * width) + i] = m_heightMap[((yStart + j) * m_terrainWidth) + xStart + i].y;
+		}
+	}
+
+	return m_History->Update(chunk, &m_historyTile[0], width * height * sizeof(float));
+}
+
+void TerrainClass::RestoreChunk(int version, int chunk)
+{
+	const std::vector<unsigned char>* data;
+	int xStart, yStart, width, wordsPerRow;
+	float height;
+
+
+	data = m_History->GetChunk(version, chunk);
+	if (!data || data->empty())
+	{
+		return;
+	}
+
+	if (chunk >= m_historyTileCount)
+	{
+		wordsPerRow = m_walkGrid.GetWordCount() / m_terrainHeight;
+		yStart = (chunk - m_historyTileCount) * HISTORY_TILE_SIZE;
+		memcpy(m_walkGrid.GetWords() + (yStart * wordsPerRow), &(*data)[0], data->size());
+		return;
+	}
+
+	xStart = (chunk % m_historyTilesX) * HISTORY_TILE_SIZE;
+	yStart = (chunk / m_historyTilesX) * HISTORY_TILE_SIZE;
+	width = std::min(HISTORY_TILE_SIZE, m_terrainWidth - xStart);
+
+	for (int i = 0; i < (int)(data->size() / sizeof(float)); i++)
+	{
+		memcpy(&height, &(*data)[i * sizeof(float)], sizeof(float));
+		m_heightMap[((yStart + (i / width)) * m_terrainWidth) + xStart + (i % width)].y = height;
+	}
+
+	return;
+}
+
+void TerrainClass::PackHistory(std::vector<unsigned char>& extra)
+{
+	// Everything a version needs besides its tiles: the job's component count, recipe, rooms and corridors,
+	// written field by field.
+	extra.clear();
+	DungeonFileClass::WriteNumber(extra, (unsigned int)m_componentCount);
+	DungeonFileClass::WriteNumber(extra, m_jobRecipe.size());
+
+	for (unsigned int i = 0; i < m_jobRecipe.size(); i++)
+	{
+		DungeonFileClass::WriteNumber(extra, (unsigned int)m_jobRecipe[i].type);
+		DungeonFileClass::WriteNumber(extra, m_jobRecipe[i].seed);
+		DungeonFileClass::WriteNumber(extra, (unsigned int)m_jobRecipe[i].runs);
+		DungeonFileClass::WriteNumber(extra, (unsigned int)m_jobRecipe[i].passes);
+	}
+
+	DungeonFileClass::WriteRects(extra, m_corridorRooms);
+	DungeonFileClass::WriteRects(extra, m_corridors);
+
+	return;
+}
+
+void TerrainClass::UnpackHistory(int version, std::vector<OperationType>* recipe, bool terrain)
+{
+	unsigned long long componentCount, recipeCount, value[4];
+	int position, end;
+
+
+	const std::vector<unsigned char>& extra = m_History->GetExtra(version);
+	position = 0;
+	end = (int)extra.size();
+
+	// The history only holds what PackHistory wrote, so a read can only fail on a bug, which leaves things as they were.
+	if (!DungeonFileClass::ReadNumber(extra, position, end, componentCount) || !DungeonFileClass::ReadNumber(extra, position, end, recipeCount))
+	{
+		return;
+	}
+
+	if (recipe)
+	{
+		recipe->resize((int)recipeCount);
+	}
+
+	for (int i = 0; i < (int)recipeCount; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			if (!DungeonFileClass::ReadNumber(extra, position, end, value[j]))
+			{
+				return;
+			}
+		}
+
+		if (recipe)
+		{
+			(*recipe)[i].type = (GenerationType)(int)(unsigned int)value[0];
+			(*recipe)[i].seed = (unsigned int)value[1];
+			(*recipe)[i].runs = (int)(unsigned int)value[2];
+			(*recipe)[i].passes = (int)(unsigned int)value[3];
+		}
+	}
+
+	if (!terrain)
+	{
+		return;
+	}
+
+	if (!DungeonFileClass::ReadRects(extra, position, end, m_rectScratch) || !DungeonFileClass::ReadRects(extra, position, end, m_corridorScratch))
+	{
+		return;
+	}
+
+	m_componentCount = (int)(unsigned int)componentCount;
+	m_corridorRooms.swap(m_rectScratch);
+	m_corridors.swap(m_corridorScratch);
+
+	return;
+}
+
+void TerrainClass::BuildPipeline()
+{
+	int parameters[6], stage;
+	const char* names[] = { "random", "smooth", "perlin", "dungeon", "cave", "erosion", "initial" };
+	static_assert((sizeof(names) / sizeof(names[0])) == GENERATE_TYPE_COUNT, "Every generation type needs a stage name.");
+
+
+	// One stage per operation, each fed by the one before, with the normals on the end.
+	m_Pipeline->ClearStages();
+	m_jobKeys.resize(m_jobRecipe.size());
+
+	stage = -1;
+	for (unsigned int i = 0; i < m_jobRecipe.size(); i++)
+	{
+		parameters[0] = m_jobRecipe[i].type;
+		parameters[1] = (int)m_jobRecipe[i].seed;
+		parameters[2] = m_jobRecipe[i].runs;
+		parameters[3] = (m_jobRecipe[i].type == GENERATE_SMOOTH) ? m_jobRecipe[i].passes : 0;
+		parameters[4] = m_terrainWidth;
+		parameters[5] = m_terrainHeight;
+
+		// Only the operations that use them hash the seed and run count. The seed of the starting terrain is its hash.
+		if ((m_jobRecipe[i].type != GENERATE_RANDOM_FIELD) && (m_jobRecipe[i].type != GENERATE_PERLIN) && (m_jobRecipe[i].type != GENERATE_DUNGEON) && (m_jobRecipe[i].type != GENERATE_CAVE) && (m_jobRecipe[i].type != GENERATE_INITIAL))
+		{
+			parameters[1] = 0;
+		}
+		if ((m_jobRecipe[i].type != GENERATE_RANDOM_FIELD) && (m_jobRecipe[i].type != GENERATE_DUNGEON) && (m_jobRecipe[i].type != GENERATE_CAVE) && (m_jobRecipe[i].type != GENERATE_EROSION))
+		{
+			parameters[2] = 0;
+		}
+
+		m_stageInputs.clear();
+		if (stage != -1)
+		{
+			m_stageInputs.push_back(stage);
+		}
+
+		stage = m_Pipeline->AddStage(names[m_jobRecipe[i].type], m_stageInputs, parameters, sizeof(parameters));
+		m_jobKeys[i] = m_Pipeline->GetKey(stage);
+	}
+
+	m_stageInputs.clear();
+	m_stageInputs.push_back(stage);
+	m_normalsKey = m_Pipeline->GetKey(m_Pipeline->AddStage("normals", m_stageInputs, 0, 0));
+
+	return;
+}
+
+bool TerrainClass::StepGeneration(int budget, bool& finished)
+{
+	int allocationCount;
+	long long allocatedBytes;
+	bool result;
+
+
+	// A budget of zero or less runs the job to the end in one go.
+	m_stepTimed = (budget > 0);
+	m_stepDeadline = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(budget);
+
+	allocationCount = AllocationCounterClass::GetCount();
+	allocatedBytes = AllocationCounterClass::GetBytes();
+
+	// Have streamed height fields warm the tiles around the camera when it has moved.
+	if ((m_viewX != m_prefetchX) || (m_viewZ != m_prefetchZ))
+	{
+		m_prefetchX = m_viewX;
+		m_prefetchZ = m_viewZ;
+		m_heightField.Prefetch(m_prefetchX, m_prefetchZ);
+		m_smoothField.Prefetch(m_prefetchX, m_prefetchZ);
+	}
+
+	finished = false;
+	result = true;
+	while (m_stage != STAGE_DONE)
+	{
+		result = RunStage();
+		if (!result)
+		{
+			break;
+		}
+
+		if (OutOfTime())
+		{
+			break;
+		}
+	}
+
+	// The counts are per thread, so this is what the slice allocated whichever thread ran it.
+	m_jobAllocationCount += AllocationCounterClass::GetCount() - allocationCount;
+	m_jobAllocatedBytes += AllocationCounterClass::GetBytes() - allocatedBytes;
+
+	if (!result)
+	{
+		return false;
+	}
+
+	finished = (m_stage == STAGE_DONE);
+
+	return true;
+}
+
+bool TerrainClass::OutOfTime()
+{
+	return m_stepTimed && (std::chrono::high_resolution_clock::now() >= m_stepDeadline);
+}
+
+void TerrainClass::NextStage(GenerationStage stage)
+{
+	m_stage = stage;
+	m_stageStep = 0;
+
+	return;
+}
+
+bool TerrainClass::RunStage()
+{
+	int tileCount, passSteps, tile;
+	bool result;
+
+
+	// Every stage works through its rows, rooms or corridors one at a time, checking the clock after each
+	// and keeping its place in m_stageStep, so a stage cut short carries on where it left off next time.
+	switch (m_stage)
+	{
+		case STAGE_PREPARE:
+			BuildPipeline();
+
+			// A loaded starting terrain replaces the old one as the pinned root of the cache.
+			if (!m_jobBaseHeights.empty())
+			{
+				for (int i = 0; i < (m_terrainWidth * m_terrainHeight); i++)
+				{
+					m_heightMap[i].y = m_jobBaseHeights[i];
+				}
+				m_walkGrid.Clear();
+				m_componentCount = 0;
+				m_corridorRooms.clear();
+				m_corridors.clear();
+
+				PackHeights(m_packedHeights, false, false);
+				m_Pipeline->Store(m_jobKeys[0], m_packedHeights, true);
+				if (m_baseKey != m_jobKeys[0])
+				{
+					m_Pipeline->Unpin(m_baseKey);
+					m_baseKey = m_jobKeys[0];
+				}
+				m_jobBaseHeights.clear();
+			}
+
+			// A saved finished terrain is the output of the loaded recipe, unless more was asked for since.
+			if (!m_jobTerrain.empty())
+			{
+				if (m_jobTerrainOperations == (int)m_jobRecipe.size())
+				{
+					m_Pipeline->Store(m_normalsKey, m_jobTerrain, false);
+				}
+				m_jobTerrain.clear();
+			}
+
+			// With the normals cached for this exact recipe only the mesh has to be built.
+			if (RestoreStage(m_normalsKey, true))
+			{
+				if (m_generationDevice && !m_meshVertices)
+				{
+					m_meshVertices = new VertexType[m_vertexCount];
+					if (!m_meshVertices)
+					{
+						return false;
+					}
+				}
+
+				NextStage(STAGE_SNAPSHOT);
+				return true;
+			}
+
+			// A version from the history is rebuilt from its tiles, which are always there, rather than its recipe.
+			if (m_jobHistoryVersion != -1)
+			{
+				NextStage(STAGE_RESTORE);
+				return true;
+			}
+
+			// Otherwise start after the last operation whose output is still cached.
+			m_jobOperation = 0;
+			for (int i = (int)m_jobRecipe.size() - 1; i >= 0; i--)
+			{
+				if (RestoreStage(m_jobKeys[i], false))
+				{
+					m_jobOperation = i + 1;
+					break;
+				}
+			}
+
+			return StartOperation();
+
+		case STAGE_RESTORE:
+			while (m_stageStep < m_History->GetChunkCount())
+			{
+				RestoreChunk(m_jobHistoryVersion, m_stageStep);
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			UnpackHistory(m_jobHistoryVersion, 0, true);
+
+			// Cache it as the output of its recipe, so operations asked for after the undo carry on from here.
+			PackHeights(m_packedHeights, false, false);
+			m_Pipeline->Store(m_jobKeys.back(), m_packedHeights, false);
+
+			NextStage(STAGE_FACE_NORMALS);
+			return true;
+
+		case STAGE_RANDOM_FIELD:
+			while (m_stageStep < m_terrainHeight)
+			{
+				RandomHeightRow(m_stageStep);
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			// A random height field has no carved floor, rooms or corridors.
+			m_walkGrid.Clear();
+			m_componentCount = 0;
+			m_corridorRooms.clear();
+			m_corridors.clear();
+
+			return FinishOperation();
+
+		case STAGE_SMOOTH:
+			// Copy the heights into the height field, make the passes a tile at a time, then copy them back.
+			// Each pass is the same 3x3 average, more passes smooth further.
+			tileCount = m_heightField.GetTileCount();
+			passSteps = m_jobRecipe[m_jobOperation].passes * tileCount;
+			while (m_stageStep < ((2 * m_terrainHeight) + passSteps))
+			{
+				if (m_stageStep < m_terrainHeight)
+				{
+					LoadHeightRow(m_stageStep);
+				}
+				else if (m_stageStep < (m_terrainHeight + passSteps))
+				{
+					tile = (m_stageStep - m_terrainHeight) % tileCount;
+					SmoothHeightTile(tile);
+
+					// After the last tile of a pass its output is the input of the next.
+					if (tile == (tileCount - 1))
+					{
+						m_heightField.Swap(m_smoothField);
+					}
+				}
+				else
+				{
+					StoreHeightRow(m_stageStep - (m_terrainHeight + passSteps));
+				}
+
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			return FinishOperation();
+
+		case STAGE_EROSION:
+			// Copy the heights in through the height field, run the iterations a part at a time, then copy them back.
+			passSteps = m_jobRecipe[m_jobOperation].runs * m_Erosion->GetIterationParts();
+			while (m_stageStep < ((2 * m_terrainHeight) + passSteps))
+			{
+				if (m_stageStep < m_terrainHeight)
+				{
+					LoadHeightRow(m_stageStep);
+					m_Erosion->LoadRow(m_heightField, m_stageStep);
+				}
+				else if (m_stageStep < (m_terrainHeight + passSteps))
+				{
+					m_Erosion->IteratePart((m_stageStep - m_terrainHeight) % m_Erosion->GetIterationParts());
+				}
+				else
+				{
+					m_Erosion->StoreRow(m_heightField, m_stageStep - (m_terrainHeight + passSteps));
+					StoreHeightRow(m_stageStep - (m_terrainHeight + passSteps));
+				}
+
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			return FinishOperation();
+
+		case STAGE_PERLIN:
+			// Add the noise to every row.
+			while (m_stageStep < m_terrainHeight)
+			{
+				PerlinHeightRow(m_stageStep);
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			return FinishOperation();
+
+		case STAGE_DIVIDE_CELLS:
+			// Calls the cell division function (quad tree) for a random amount of times between 10 and a random number (20-40)
+			while (m_stageStep < (Random() % (Random() % 50 + 40) + 20))
+			{
+				cellDivision(cellQueue[m_cellHead]);
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			NextStage(STAGE_PLACE_ROOMS);
+			return true;
+
+		case STAGE_PLACE_ROOMS:
+			while (placeNextRoom())
+			{
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			// Copies queue for use in the height/corridor generation functions
+			roomCopy.assign(roomQueue.begin() + m_roomHead, roomQueue.end());
+
+			NextStage(STAGE_FLATTEN);
+			return true;
+
+		case STAGE_FLATTEN:
+			while (m_stageStep < m_terrainHeight)
+			{
+				flattenRow(m_stageStep);
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			// With the map flat again there is no floor left until the rooms are carved.
+			m_walkGrid.Clear();
+
+			NextStage(STAGE_CARVE_ROOMS);
+			return true;
+
+		case STAGE_CARVE_ROOMS:
+			while (m_roomHead < (int)roomQueue.size())
+			{
+				carveRect(roomQueue[m_roomHead], ROOM_DEPTH);
+				m_roomHead++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			NextStage(STAGE_PLAN_CORRIDORS);
+			return true;
+
+		case STAGE_PLAN_CORRIDORS:
+			m_corridorEdgeCount = planCorridors();
+
+			NextStage(STAGE_ROUTE_CORRIDORS);
+			return true;
+
+		case STAGE_ROUTE_CORRIDORS:
+			while (m_stageStep < m_corridorEdgeCount)
+			{
+				routeCorridor(m_stageStep);
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			NextStage(STAGE_CARVE_CORRIDORS);
+			return true;
+
+		case STAGE_CARVE_CORRIDORS:
+			// Sink the corridors to floor level.
+			while (m_stageStep < (int)m_corridors.size())
+			{
+				carveRect(m_corridors[m_stageStep], ROOM_DEPTH);
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			NextStage(STAGE_CONNECTIVITY);
+			return true;
+
+		case STAGE_CONNECTIVITY:
+			while (!connectivityStep(m_stageStep, ROOM_DEPTH))
+			{
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			m_componentCount = m_Connectivity->GetComponentCount();
+			return FinishOperation();
+
+		case STAGE_CAVE_STEP:
+			// Every step of the automaton is made in parts of a few rows of each band.
+			while (m_stageStep < (m_jobRecipe[m_jobOperation].runs * m_Cave->GetStepParts()))
+			{
+				m_Cave->StepPart(m_stageStep % m_Cave->GetStepParts());
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			m_Cave->BuildFloor();
+			NextStage(STAGE_CAVE_CARVE);
+			return true;
+
+		case STAGE_CAVE_CARVE:
+			// Sink the cave floor to room level a row at a time, add it to the walkable floor, then label it in parts.
+			while (m_stageStep < (m_terrainHeight + 1 + m_Connectivity->GetLabelParts()))
+			{
+				if (m_stageStep < m_terrainHeight)
+				{
+					carveCaveRow(m_Cave->GetFloor(), m_stageStep, ROOM_DEPTH);
+				}
+				else if (m_stageStep == m_terrainHeight)
+				{
+					m_walkGrid.Union(m_Cave->GetFloor());
+				}
+				else
+				{
+					m_Connectivity->LabelPart(m_walkGrid, m_arena, m_stageStep - (m_terrainHeight + 1));
+				}
+
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			m_componentCount = m_Connectivity->GetComponentCount();
+
+			return FinishOperation();
+
+		case STAGE_FACE_NORMALS:
+			// Copy the heights into the height field, then work out the face normals a tile at a time.
+			tileCount = m_heightField.GetTileCount();
+			while (m_stageStep < (m_terrainHeight + tileCount))
+			{
+				if (m_stageStep < m_terrainHeight)
+				{
+					LoadHeightRow(m_stageStep);
+				}
+				else
+				{
+					CalculateFaceNormals(m_stageStep - m_terrainHeight, m_faceNormals);
+				}
+
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			NextStage(STAGE_VERTEX_NORMALS);
+			return true;
+
+		case STAGE_VERTEX_NORMALS:
+			while (m_stageStep < m_terrainHeight)
+			{
+				CalculateVertexNormals(m_stageStep, m_faceNormals);
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			// Keep the finished heights and normals, going back to this recipe then only rebuilds the mesh.
+			PackHeights(m_packedHeights, true, false);
+			m_Pipeline->Store(m_normalsKey, m_packedHeights, false);
+			if (m_DiskCache)
+			{
+				m_DiskCache->Store(m_normalsKey, m_packedHeights);
+			}
+
+			// The vertex array is made by the first job and kept, freeing tens of megabytes after every job costs a frame.
+			// A terrain without a device never builds a mesh and needs none.
+			if (m_generationDevice && !m_meshVertices)
+			{
+				m_meshVertices = new VertexType[m_vertexCount];
+				if (!m_meshVertices)
+				{
+					return false;
+				}
+			}
+
+			NextStage(STAGE_SNAPSHOT);
+			return true;
+
+		case STAGE_SNAPSHOT:
+			// Keep the finished terrain in the history, where only the tiles it changed take memory.
+			while ((m_jobHistoryVersion == -1) && (m_stageStep < m_History->GetChunkCount()))
+			{
+				result = SnapshotChunk(m_stageStep);
+				if (!result)
+				{
+					return false;
+				}
+
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			NextStage(STAGE_DISTANCE_FIELD);
+			return true;
+
+		case STAGE_DISTANCE_FIELD:
+			// The distance to the nearest wall is measured from the walkability grid, which the cache keeps with the heights.
+			while (m_stageStep < m_DistanceField->GetComputeParts())
+			{
+				m_DistanceField->ComputePart(m_walkGrid, m_wallDistances, m_stageStep);
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			// Without a device there is no mesh to build.
+			NextStage(m_generationDevice ? STAGE_MESH : STAGE_DONE);
+			return true;
+
+		case STAGE_MESH:
+			while (m_stageStep < (m_terrainHeight - 1))
+			{
+				BuildVertexRow(m_meshVertices, m_stageStep);
+				m_stageStep++;
+				if (OutOfTime())
+				{
+					return true;
+				}
+			}
+
+			NextStage(STAGE_VERTEX_BUFFER);
+			return true;
+
+		case STAGE_VERTEX_BUFFER:
+			// The device is free threaded, so the buffer is made here too and the frame loop only swaps it in.
+			result = CreateVertexBuffer(m_generationDevice, m_meshVertices, &m_stageVertexBuffer);
+			if (!result)
+			{
+				return false;
+			}
+
+			NextStage(STAGE_DONE);
+			return true;
+
+		case STAGE_DONE:
+			return true;
+	}
+
+	return false;
+}
+
+void TerrainClass::RandomHeightRow(int j)
+{
+	int index;
+
+
+	//loop through the terrain and set the hieghts how we want. This is where we generate the terrain
+	//in this case I will run a sin-wave through the terrain in one axis.
+	for(int i=0; i<m_terrainWidth; i++)
+	{			
+		index = (m_terrainWidth * j) + i;
+
+		m_heightMap[index].x = (float)i;
+		m_heightMap[index].y = (float)(RandomHeightField()); //magic numbers ahoy, just to ramp up the height of the sin function so its visible.
+		m_heightMap[index].z = (float)j;
+	}
+
+	return;
+}
+
+void TerrainClass::SmoothHeightTile(int tile)
+{
+	float block[HEIGHTFIELD_BLOCK_SIZE * HEIGHTFIELD_BLOCK_SIZE];
+	const float *above, *row, *below;
+	float* span;
+	int xStart, yStart, xEnd, yEnd, length;
+
+
+	// Average every cell with its eight neighbours. Each pass reads one field and writes the other,
+	// so the tiles can be done in any order.
+	m_heightField.ReadTile(tile, block);
+	m_heightField.GetTile(tile, xStart, yStart, xEnd, yEnd);
+
+	for (int y = yStart; y < yEnd; y++)
+	{
+		above = &block[(y - yStart) * HEIGHTFIELD_BLOCK_SIZE];
+		row = above + HEIGHTFIELD_BLOCK_SIZE;
+		below = row + HEIGHTFIELD_BLOCK_SIZE;
+
+		span = m_smoothField.GetSpan(xStart, y, length);
+		for (int x = 0; x < (xEnd - xStart); x++)
+		{
+			span[x] = (above[x] + above[x + 1] + above[x + 2] + row[x] + row[x + 1] + row[x + 2] + below[x] + below[x + 1] + below[x + 2]) / 9.0f;
+		}
+	}
+
+	return;
+}
+
+void TerrainClass::LoadHeightRow(int j)
+{
+	float* span;
+	int length;
+
+
+	// Copy a row of heights into the height field, a contiguous span at a time.
+	for (int i = 0; i < m_terrainWidth; i += length)
+	{
+		span = m_heightField.GetSpan(i, j, length);
+		for (int k = 0; k < length; k++)
+		{
+			span[k] = m_heightMap[(m_terrainWidth * j) + i + k].y;
+		}
+	}
+
+	return;
+}
+
+void TerrainClass::StoreHeightRow(int j)
+{
+	const float* span;
+	int length;
+
+
+	for (int i = 0; i < m_terrainWidth; i += length)
+	{
+		span = m_heightField.GetSpan(i, j, length);
+		for (int k = 0; k < length; k++)
+		{
+			m_heightMap[(m_terrainWidth * j) + i + k].y = span[k];
+		}
+	}
+
+	return;
+}
+
+void TerrainClass::PerlinHeightRow(int j)
+{
+	int index;
+
+
+	// The whole row of noise is sampled in one call, the graph works through it a batch at a time.
+	m_terrainNoise.SampleRow(m_noiseOffsetX, m_noiseOffsetY + (float)j, 1.0f, m_terrainWidth, &m_noiseRow[0]);
+
+	// The noise is added rather than scaled by the height, so flat ground gets it too.
+	for (int i = 0; i<m_terrainWidth; i++)
+	{
+		index = (m_terrainWidth * j) + i;
+
+		m_heightMap[index].x = (float)i;
+		m_heightMap[index].y = m_heightMap[index].y + m_noiseRow[i];
+		m_heightMap[index].z = (float)j;
+	}
+
+	return;
+}
+
+void TerrainClass::startDungeon()
+{
+	// First cell is full terrain, current cell iterates through created cell list to make more
+	currentCell.xBottomLeft = 0.0f;
+	currentCell.yBottomLeft = 0.0f;
+	currentCell.xTopRight = m_terrainWidth;
+	currentCell.yTopRight = m_terrainHeight;
+
+	// Cell for adjusting height values after loop
+	heightCell.xBottomLeft = 0.0f;
+	heightCell.yBottomLeft = 0.0f;
+	heightCell.xTopRight = 0.0f;
+	heightCell.yTopRight = 0.0f;
+
+	// A cancelled job can leave cells and rooms behind, start from empty queues.
+	cellQueue.clear();
+	roomQueue.clear();
+	roomCopy.clear();
+	m_cellHead = 0;
+	m_roomHead = 0;
+
+	cellQueue.push_back(currentCell);
+
+	// Forget the rooms of the previous dungeon.
+	m_RoomIndex->Clear();
+
+	// Storage for new cells to be created from old
+
+	for (int newCell = 0; newCell < 4; newCell++)
+	{
+		newCells[newCell].xBottomLeft = 0.0f;
+		newCells[newCell].yBottomLeft = 0.0f;
+		newCells[newCell].xTopRight = 0.0f;
+		newCells[newCell].yTopRight = 0.0f;
+	}
+
+	return;
+}
+
+bool TerrainClass::LoadHeightMap(char* filename)
+{
+	HeightMapFileClass heightMapFile;
+	bool result;
+	int i, j, index;
+
+
+	// Map the height map file and read its header in place.
+	result = heightMapFile.Initialize(filename);
+	if(!result)
+	{
+		heightMapFile.Shutdown();
+		return false;
+	}
+
+	// Save the dimensions of the terrain.
+	m_terrainWidth = heightMapFile.GetWidth();
+	m_terrainHeight = heightMapFile.GetHeight();
+
+	// Create the structure to hold the height map data.
+	m_heightMap = new HeightMapType[m_terrainWidth * m_terrainHeight];
+	if(!m_heightMap)
+	{
+		heightMapFile.Shutdown();
+		return false;
+	}
+
+	// Read the heights straight from the file into the height map, brought down to the terrain's scale
+	// on the way, then fill in the positions of the row while it is still in the cache.
+	for(j=0; j<m_terrainHeight; j++)
+	{
+		result = heightMapFile.ReadRow(j, &m_heightMap[m_terrainWidth * j].y, sizeof(HeightMapType) / sizeof(float), 1.0f / 15.0f);
+		if(!result)
+		{
+			heightMapFile.Shutdown();
+			return false;
+		}
+
 		for(i=0; i<m_terrainWidth; i++)
 		{
-			m_heightMap[(m_terrainHeight * j) + i].y /= 15.0f;
+			index = (m_terrainWidth * j) + i;
+
+			m_heightMap[index].x = (float)i;
+			m_heightMap[index].z = (float)j;
+		}
+	}
+
+	// Release the mapping.
+	heightMapFile.Shutdown();
+
+	return true;
+}
+
+bool TerrainClass::CalculateNormals()
+{
+	int j;
+	VectorType* normals;
+
+
+	// Create a temporary array to hold the un-normalized normal vectors.
+	normals = new VectorType[(m_terrainHeight-1) * (m_terrainWidth-1)];
+	if(!normals)
+	{
+		return false;
+	}
+
+	// Go through all the faces in the mesh and calculate their normals, a tile of the height field at a time.
+	for(j=0; j<m_terrainHeight; j++)
+	{
+		LoadHeightRow(j);
+	}
+
+	for(j=0; j<m_heightField.GetTileCount(); j++)
+	{
+		CalculateFaceNormals(j, normals);
+	}
+
+	// Now go through all the vertices and take an average of each face normal 	
+	// that the vertex touches to get the averaged normal for that vertex.
+	for(j=0; j<m_terrainHeight; j++)
+	{
+		CalculateVertexNormals(j, normals);
+	}
+
+	// Release the temporary normals.
+	delete [] normals;
+	normals = 0;
+
+	return true;
+}
+
+void TerrainClass::CalculateFaceNormals(int tile, VectorType* normals)
+{
+	float block[HEIGHTFIELD_BLOCK_SIZE * HEIGHTFIELD_BLOCK_SIZE];
+	const float *row, *below;
+	float edge1, edge2;
+	int xStart, yStart, xEnd, yEnd, index;
+
+
+	// Each face is the vertex, the one to its right and the one below. The vertices are one grid step
+	// apart, so only the heights are needed: the cross product of the two face edges comes down to
+	// the height differences along them.
+	m_heightField.ReadTile(tile, block);
+	m_heightField.GetTile(tile, xStart, yStart, xEnd, yEnd);
+
+	for (int y = yStart; y < std::min(yEnd, m_terrainHeight - 1); y++)
+	{
+		row = &block[((y - yStart) + 1) * HEIGHTFIELD_BLOCK_SIZE];
+		below = row + HEIGHTFIELD_BLOCK_SIZE;
+
+		for (int x = xStart; x < std::min(xEnd, m_terrainWidth - 1); x++)
+		{
+			edge1 = row[(x - xStart) + 1] - below[(x - xStart) + 1];
+			edge2 = below[(x - xStart) + 1] - row[(x - xStart) + 2];
+
+			index = (y * (m_terrainWidth - 1)) + x;
+
+			normals[index].x = edge1 + edge2;
+			normals[index].y = 1.0f;
+			normals[index].z = edge1;
 		}
 	}
 
 	return;
 }
 
-bool TerrainClass::CalculateNormals()
+void TerrainClass::CalculateVertexNormals(int j, VectorType* normals)
 {
-	int i, j, index1, index2, index3, index, count;
-	float vertex1[3], vertex2[3], vertex3[3], vector1[3], vector2[3], sum[3], length;
-	VectorType* normals;
-
+	int i, index, count;
+	float sum[3], length;
 
-	// Create a temporary array to hold the un-normalized normal vectors.
-	normals = new VectorType[(m_terrainHeight-1) * (m_terrainWidth-1)];
-	if(!normals)
-	{
-		return false;
-	}
 
-	// Go through all the faces in the mesh and calculate their normals.
-	for(j=0; j<(m_terrainHeight-1); j++)
+	for(i=0; i<m_terrainWidth; i++)
 	{
-		for(i=0; i<(m_terrainWidth-1); i++)
-		{
-			index1 = (j * m_terrainHeight) + i;
-			index2 = (j * m_terrainHeight) + (i+1);
-			index3 = ((j+1) * m_terrainHeight) + i;
-
-			// Get three vertices from the face.
-			vertex1[0] = m_heightMap[index1].x;
-			vertex1[1] = m_heightMap[index1].y;
-			vertex1[2] = m_heightMap[index1].z;
-		
-			vertex2[0] = m_heightMap[index2].x;
-			vertex2[1] = m_heightMap[index2].y;
-			vertex2[2] = m_heightMap[index2].z;
-		
-			vertex3[0] = m_heightMap[index3].x;
-			vertex3[1] = m_heightMap[index3].y;
-			vertex3[2] = m_heightMap[index3].z;
+		// Initialize the sum.
+		sum[0] = 0.0f;
+		sum[1] = 0.0f;
+		sum[2] = 0.0f;
 
-			// Calculate the two vectors for this face.
-			vector1[0] = vertex1[0] - vertex3[0];
-			vector1[1] = vertex1[1] - vertex3[1];
-			vector1[2] = vertex1[2] - vertex3[2];
-			vector2[0] = vertex3[0] - vertex2[0];
-			vector2[1] = vertex3[1] - vertex2[1];
-			vector2[2] = vertex3[2] - vertex2[2];
+		// Initialize the count.
+		count = 0;
 
-			index = (j * (m_terrainHeight-1)) + i;
+		// Bottom left face.
+		if(((i-1) >= 0) && ((j-1) >= 0))
+		{
+			index = ((j-1) * (m_terrainWidth-1)) + (i-1);
 
-			// Calculate the cross product of those two vectors to get the un-normalized value for this face normal.
-			normals[index].x = (vector1[1] * vector2[2]) - (vector1[2] * vector2[1]);
-			normals[index].y = (vector1[2] * vector2[0]) - (vector1[0] * vector2[2]);
-			normals[index].z = (vector1[0] * vector2[1]) - (vector1[1] * vector2[0]);
+			sum[0] += normals[index].x;
+			sum[1] += normals[index].y;
+			sum[2] += normals[index].z;
+			count++;
 		}
-	}
 
-	// Now go through all the vertices and take an average of each face normal 	
-	// that the vertex touches to get the averaged normal for that vertex.
-	for(j=0; j<m_terrainHeight; j++)
-	{
-		for(i=0; i<m_terrainWidth; i++)
+		// Bottom right face.
+		if((i < (m_terrainWidth-1)) && ((j-1) >= 0))
 		{
-			// Initialize the sum.
-			sum[0] = 0.0f;
-			sum[1] = 0.0f;
-			sum[2] = 0.0f;
-
-			// Initialize the count.
-			count = 0;
-
-			// Bottom left face.
-			if(((i-1) >= 0) && ((j-1) >= 0))
-			{
-				index = ((j-1) * (m_terrainHeight-1)) + (i-1);
+			index = ((j-1) * (m_terrainWidth-1)) + i;
 
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
-
-			// Bottom right face.
-			if((i < (m_terrainWidth-1)) && ((j-1) >= 0))
-			{
-				index = ((j-1) * (m_terrainHeight-1)) + i;
-
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
+			sum[0] += normals[index].x;
+			sum[1] += normals[index].y;
+			sum[2] += normals[index].z;
+			count++;
+		}
 
-			// Upper left face.
-			if(((i-1) >= 0) && (j < (m_terrainHeight-1)))
-			{
-				index = (j * (m_terrainHeight-1)) + (i-1);
+		// Upper left face.
+		if(((i-1) >= 0) && (j < (m_terrainHeight-1)))
+		{
+			index = (j * (m_terrainWidth-1)) + (i-1);
 
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
+			sum[0] += normals[index].x;
+			sum[1] += normals[index].y;
+			sum[2] += normals[index].z;
+			count++;
+		}
 
-			// Upper right face.
-			if((i < (m_terrainWidth-1)) && (j < (m_terrainHeight-1)))
-			{
-				index = (j * (m_terrainHeight-1)) + i;
+		// Upper right face.
+		if((i < (m_terrainWidth-1)) && (j < (m_terrainHeight-1)))
+		{
+			index = (j * (m_terrainWidth-1)) + i;
 
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
-			
-			// Take the average of the faces touching this vertex.
-			sum[0] = (sum[0] / (float)count);
-			sum[1] = (sum[1] / (float)count);
-			sum[2] = (sum[2] / (float)count);
+			sum[0] += normals[index].x;
+			sum[1] += normals[index].y;
+			sum[2] += normals[index].z;
+			count++;
+		}
+		
+		// Take the average of the faces touching this vertex.
+		sum[0] = (sum[0] / (float)count);
+		sum[1] = (sum[1] / (float)count);
+		sum[2] = (sum[2] / (float)count);
 
-			// Calculate the length of this normal.
-			length = sqrt((sum[0] * sum[0]) + (sum[1] * sum[1]) + (sum[2] * sum[2]));
-			
-			// Get an index to the vertex location in the height map array.
-			index = (j * m_terrainHeight) + i;
+		// Calculate the length of this normal.
+		length = sqrt((sum[0] * sum[0]) + (sum[1] * sum[1]) + (sum[2] * sum[2]));
+		
+		// Get an index to the vertex location in the height map array.
+		index = (j * m_terrainWidth) + i;
 
-			// Normalize the final shared normal for this vertex and store it in the height map array.
-			m_heightMap[index].nx = (sum[0] / length);
-			m_heightMap[index].ny = (sum[1] / length);
-			m_heightMap[index].nz = (sum[2] / length);
-		}
+		// Normalize the final shared normal for this vertex and store it in the height map array.
+		m_heightMap[index].nx = (sum[0] / length);
+		m_heightMap[index].ny = (sum[1] / length);
+		m_heightMap[index].nz = (sum[2] / length);
 	}
 
-	// Release the temporary normals.
-	delete [] normals;
-	normals = 0;
-
-	return true;
+	return;
 }
 
 void TerrainClass::CalculateTextureCoordinates()
@@ -1093,8 +3600,8 @@ void TerrainClass::CalculateTextureCoordinates()
 		for (i = 0; i<m_terrainWidth; i++)
 		{
 			// Store the texture coordinate in the height map.
-			m_heightMap[(m_terrainHeight * j) + i].tu = tuCoordinate;
-			m_heightMap[(m_terrainHeight * j) + i].tv = tvCoordinate;
+			m_heightMap[(m_terrainWidth * j) + i].tu = tuCoordinate;
+			m_heightMap[(m_terrainWidth * j) + i].tv = tvCoordinate;
 
 			// Increment the tu texture coordinate by the increment value and increment the index by one.
 			tuCoordinate += incrementValue;
@@ -1200,6 +3707,224 @@ void TerrainClass::ReleaseTextures()
 	return;
 }
 
+bool TerrainClass::InitializeSubsystems()
+{
+	bool result;
+
+
+	// Create the walkability grid, one bit per height map cell, which starts with no floor.
+	result = m_walkGrid.Initialize(m_terrainWidth, m_terrainHeight);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the spatial index used to place and look up the dungeon rooms.
+	m_RoomIndex = new RoomIndexClass;
+	if(!m_RoomIndex)
+	{
+		return false;
+	}
+
+	// Initialize the room index over the whole terrain.
+	result = m_RoomIndex->Initialize(m_terrainWidth, m_terrainHeight, ROOM_INDEX_CELL_SIZE);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the corridor planner.
+	m_CorridorPlanner = new CorridorPlannerClass;
+	if(!m_CorridorPlanner)
+	{
+		return false;
+	}
+
+	// Create the corridor router.
+	m_CorridorRouter = new CorridorRouterClass;
+	if(!m_CorridorRouter)
+	{
+		return false;
+	}
+
+	// Initialize the corridor router over the whole terrain.
+	result = m_CorridorRouter->Initialize(m_terrainWidth, m_terrainHeight);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Start the threads the connectivity, cave, distance and erosion bands all run on.
+	result = m_threadPool.Initialize();
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the connectivity checker.
+	m_Connectivity = new ConnectivityClass;
+	if(!m_Connectivity)
+	{
+		return false;
+	}
+
+	// Initialize the connectivity checker over the whole terrain.
+	result = m_Connectivity->Initialize(m_terrainWidth, m_terrainHeight, &m_threadPool);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the cave automaton.
+	m_Cave = new CaveClass;
+	if(!m_Cave)
+	{
+		return false;
+	}
+
+	// Initialize the cave automaton over the whole terrain.
+	result = m_Cave->Initialize(m_terrainWidth, m_terrainHeight, &m_threadPool);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the wall distance field.
+	m_DistanceField = new DistanceFieldClass;
+	if(!m_DistanceField)
+	{
+		return false;
+	}
+
+	// Initialize the wall distance field over the whole terrain.
+	result = m_DistanceField->Initialize(m_terrainWidth, m_terrainHeight, &m_threadPool);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the erosion simulation.
+	m_Erosion = new ErosionClass;
+	if(!m_Erosion)
+	{
+		return false;
+	}
+
+	// Initialize the erosion simulation over the whole terrain.
+	result = m_Erosion->Initialize(m_terrainWidth, m_terrainHeight, &m_threadPool);
+	if(!result)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void TerrainClass::ShutdownSubsystems()
+{
+	// Release the walkability grid.
+	m_walkGrid.Shutdown();
+
+	// Release the room index.
+	if(m_RoomIndex)
+	{
+		m_RoomIndex->Shutdown();
+		delete m_RoomIndex;
+		m_RoomIndex = 0;
+	}
+
+	// Release the corridor planner.
+	if(m_CorridorPlanner)
+	{
+		delete m_CorridorPlanner;
+		m_CorridorPlanner = 0;
+	}
+
+	// Release the corridor router.
+	if(m_CorridorRouter)
+	{
+		m_CorridorRouter->Shutdown();
+		delete m_CorridorRouter;
+		m_CorridorRouter = 0;
+	}
+
+	// Release the connectivity checker.
+	if(m_Connectivity)
+	{
+		m_Connectivity->Shutdown();
+		delete m_Connectivity;
+		m_Connectivity = 0;
+	}
+
+	// Release the cave automaton.
+	if(m_Cave)
+	{
+		m_Cave->Shutdown();
+		delete m_Cave;
+		m_Cave = 0;
+	}
+
+	// Release the wall distance field.
+	if(m_DistanceField)
+	{
+		m_DistanceField->Shutdown();
+		delete m_DistanceField;
+		m_DistanceField = 0;
+	}
+
+	// Release the erosion simulation.
+	if(m_Erosion)
+	{
+		m_Erosion->Shutdown();
+		delete m_Erosion;
+		m_Erosion = 0;
+	}
+
+	// Stop the band threads once nothing is left to use them.
+	m_threadPool.Shutdown();
+
+	return;
+}
+
+bool TerrainClass::InitializeHeightFields()
+{
+	bool result;
+
+
+	// The smoothing passes go back and forth between two fields. Past STREAMED_HEIGHTFIELD_CELLS they are
+	// kept in files with only TILESTORE_RESIDENT_TILES tiles of each mapped at once.
+	if(((long long)m_terrainWidth * m_terrainHeight) > STREAMED_HEIGHTFIELD_CELLS)
+	{
+		result = m_heightField.InitializeStreamed("heights.tiles", m_terrainWidth, m_terrainHeight, TILESTORE_RESIDENT_TILES);
+		if(!result)
+		{
+			return false;
+		}
+
+		result = m_smoothField.InitializeStreamed("smoothed.tiles", m_terrainWidth, m_terrainHeight, TILESTORE_RESIDENT_TILES);
+		if(!result)
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	result = m_heightField.Initialize(m_terrainWidth, m_terrainHeight, HEIGHTFIELD_LAYOUT);
+	if(!result)
+	{
+		return false;
+	}
+
+	result = m_smoothField.Initialize(m_terrainWidth, m_terrainHeight, HEIGHTFIELD_LAYOUT);
+	if(!result)
+	{
+		return false;
+	}
+
+	return true;
+}
+
 void TerrainClass::ShutdownHeightMap()
 {
 	if(m_heightMap)
@@ -1208,6 +3933,9 @@ void TerrainClass::ShutdownHeightMap()
 		m_heightMap = 0;
 	}
 
+	m_heightField.Shutdown();
+	m_smoothField.Shutdown();
+
 	return;
 }
 
@@ -1215,12 +3943,10 @@ bool TerrainClass::InitializeBuffers(ID3D11Device* device)
 {
 	VertexType* vertices;
 	unsigned long* indices;
-	int index, i, j;
-	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-    D3D11_SUBRESOURCE_DATA vertexData, indexData;
+	D3D11_BUFFER_DESC indexBufferDesc;
+	D3D11_SUBRESOURCE_DATA indexData;
 	HRESULT result;
-	int index1, index2, index3, index4;
-	float tu, tv;
+	bool success;
 
 
 	// Calculate the number of vertices in the terrain mesh.
@@ -1236,6 +3962,23 @@ bool TerrainClass::InitializeBuffers(ID3D11Device* device)
 		return false;
 	}
 
+	// Load the vertex array with the terrain data.
+	for(int j=0; j<(m_terrainHeight - 1); j++)
+	{
+		BuildVertexRow(vertices, j);
+	}
+
+	// Create the vertex buffer from the array.
+	success = CreateVertexBuffer(device, vertices, &m_vertexBuffer);
+	if(!success)
+	{
+		return false;
+	}
+
+	// Release the vertex array now that the buffer has been created and loaded.
+	delete [] vertices;
+	vertices = 0;
+
 	// Create the index array.
 	indices = new unsigned long[m_indexCount];
 	if(!indices)
@@ -1243,87 +3986,125 @@ bool TerrainClass::InitializeBuffers(ID3D11Device* device)
 		return false;
 	}
 
-	// Initialize the index to the vertex buffer.
-	index = 0;
-
-	// Load the vertex and index array with the terrain data.
-	// Load the vertex and index array with the terrain data.
-	for (j = 0; j<(m_terrainHeight - 1); j++)
+	// Every vertex is used once and in order, so the index buffer never changes when the terrain does.
+	for(int i=0; i<m_indexCount; i++)
 	{
-		for (i = 0; i<(m_terrainWidth - 1); i++)
-		{
-			index1 = (m_terrainHeight * j) + i;          // Bottom left.
-			index2 = (m_terrainHeight * j) + (i + 1);      // Bottom right.
-			index3 = (m_terrainHeight * (j + 1)) + i;      // Upper left.
-			index4 = (m_terrainHeight * (j + 1)) + (i + 1);  // Upper right.
-
-															 // Upper left.
-			tv = m_heightMap[index3].tv;
-
-			// Modify the texture coordinates to cover the top edge.
-			if (tv == 1.0f) { tv = 0.0f; }
-
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index3].x, m_heightMap[index3].y, m_heightMap[index3].z);
-			vertices[index].texture = D3DXVECTOR2(m_heightMap[index3].tu, tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index3].nx, m_heightMap[index3].ny, m_heightMap[index3].nz);
-			indices[index] = index;
-			index++;
+		indices[i] = i;
+	}
 
-			// Upper right.
-			tu = m_heightMap[index4].tu;
-			tv = m_heightMap[index4].tv;
+	// Set up the description of the static index buffer.
+    indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    indexBufferDesc.ByteWidth = sizeof(unsigned long) * m_indexCount;
+    indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    indexBufferDesc.CPUAccessFlags = 0;
+    indexBufferDesc.MiscFlags = 0;
+	indexBufferDesc.StructureByteStride = 0;
 
-			// Modify the texture coordinates to cover the top and right edge.
-			if (tu == 0.0f) { tu = 1.0f; }
-			if (tv == 1.0f) { tv = 0.0f; }
+	// Give the subresource structure a pointer to the index data.
+    indexData.pSysMem = indices;
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
 
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index4].x, m_heightMap[index4].y, m_heightMap[index4].z);
-			vertices[index].texture = D3DXVECTOR2(tu, tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index4].nx, m_heightMap[index4].ny, m_heightMap[index4].nz);
-			indices[index] = index;
-			index++;
+	// Create the index buffer.
+	result = device->CreateBuffer(&indexBufferDesc, &indexData, &m_indexBuffer);
+	if(FAILED(result))
+	{
+		return false;
+	}
 
-			// Bottom left.
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index1].x, m_heightMap[index1].y, m_heightMap[index1].z);
-			vertices[index].texture = D3DXVECTOR2(m_heightMap[index1].tu, m_heightMap[index1].tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index1].nx, m_heightMap[index1].ny, m_heightMap[index1].nz);
-			indices[index] = index;
-			index++;
+	// Release the array now that the buffer has been created and loaded.
+	delete [] indices;
+	indices = 0;
 
-			// Bottom left.
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index1].x, m_heightMap[index1].y, m_heightMap[index1].z);
-			vertices[index].texture = D3DXVECTOR2(m_heightMap[index1].tu, m_heightMap[index1].tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index1].nx, m_heightMap[index1].ny, m_heightMap[index1].nz);
-			indices[index] = index;
-			index++;
+	return true;
+}
 
-			// Upper right.
-			tu = m_heightMap[index4].tu;
-			tv = m_heightMap[index4].tv;
+void TerrainClass::BuildVertexRow(VertexType* vertices, int j)
+{
+	int index, i;
+	int index1, index2, index3, index4;
+	float tu, tv;
 
-			// Modify the texture coordinates to cover the top and right edge.
-			if (tu == 0.0f) { tu = 1.0f; }
-			if (tv == 1.0f) { tv = 0.0f; }
 
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index4].x, m_heightMap[index4].y, m_heightMap[index4].z);
-			vertices[index].texture = D3DXVECTOR2(tu, tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index4].nx, m_heightMap[index4].ny, m_heightMap[index4].nz);
-			indices[index] = index;
-			index++;
+	// Each quad of the row is two triangles, six vertices, laid out row after row.
+	index = j * (m_terrainWidth - 1) * 6;
 
-			// Bottom right.
-			tu = m_heightMap[index2].tu;
+	for (i = 0; i<(m_terrainWidth - 1); i++)
+	{
+		index1 = (m_terrainWidth * j) + i;          // Bottom left.
+		index2 = (m_terrainWidth * j) + (i + 1);      // Bottom right.
+		index3 = (m_terrainWidth * (j + 1)) + i;      // Upper left.
+		index4 = (m_terrainWidth * (j + 1)) + (i + 1);  // Upper right.
+
+														 // Upper left.
+		tv = m_heightMap[index3].tv;
+
+		// Modify the texture coordinates to cover the top edge.
+		if (tv == 1.0f) { tv = 0.0f; }
+
+		vertices[index].position = D3DXVECTOR3(m_heightMap[index3].x, m_heightMap[index3].y, m_heightMap[index3].z);
+		vertices[index].texture = D3DXVECTOR2(m_heightMap[index3].tu, tv);
+		vertices[index].normal = D3DXVECTOR3(m_heightMap[index3].nx, m_heightMap[index3].ny, m_heightMap[index3].nz);
+		index++;
+
+		// Upper right.
+		tu = m_heightMap[index4].tu;
+		tv = m_heightMap[index4].tv;
+
+		// Modify the texture coordinates to cover the top and right edge.
+		if (tu == 0.0f) { tu = 1.0f; }
+		if (tv == 1.0f) { tv = 0.0f; }
+
+		vertices[index].position = D3DXVECTOR3(m_heightMap[index4].x, m_heightMap[index4].y, m_heightMap[index4].z);
+		vertices[index].texture = D3DXVECTOR2(tu, tv);
+		vertices[index].normal = D3DXVECTOR3(m_heightMap[index4].nx, m_heightMap[index4].ny, m_heightMap[index4].nz);
+		index++;
+
+		// Bottom left.
+		vertices[index].position = D3DXVECTOR3(m_heightMap[index1].x, m_heightMap[index1].y, m_heightMap[index1].z);
+		vertices[index].texture = D3DXVECTOR2(m_heightMap[index1].tu, m_heightMap[index1].tv);
+		vertices[index].normal = D3DXVECTOR3(m_heightMap[index1].nx, m_heightMap[index1].ny, m_heightMap[index1].nz);
+		index++;
+
+		// Bottom left.
+		vertices[index].position = D3DXVECTOR3(m_heightMap[index1].x, m_heightMap[index1].y, m_heightMap[index1].z);
+		vertices[index].texture = D3DXVECTOR2(m_heightMap[index1].tu, m_heightMap[index1].tv);
+		vertices[index].normal = D3DXVECTOR3(m_heightMap[index1].nx, m_heightMap[index1].ny, m_heightMap[index1].nz);
+		index++;
+
+		// Upper right.
+		tu = m_heightMap[index4].tu;
+		tv = m_heightMap[index4].tv;
+
+		// Modify the texture coordinates to cover the top and right edge.
+		if (tu == 0.0f) { tu = 1.0f; }
+		if (tv == 1.0f) { tv = 0.0f; }
+
+		vertices[index].position = D3DXVECTOR3(m_heightMap[index4].x, m_heightMap[index4].y, m_heightMap[index4].z);
+		vertices[index].texture = D3DXVECTOR2(tu, tv);
+		vertices[index].normal = D3DXVECTOR3(m_heightMap[index4].nx, m_heightMap[index4].ny, m_heightMap[index4].nz);
+		index++;
+
+		// Bottom right.
+		tu = m_heightMap[index2].tu;
+
+		// Modify the texture coordinates to cover the right edge.
+		if (tu == 0.0f) { tu = 1.0f; }
+
+		vertices[index].position = D3DXVECTOR3(m_heightMap[index2].x, m_heightMap[index2].y, m_heightMap[index2].z);
+		vertices[index].texture = D3DXVECTOR2(tu, m_heightMap[index2].tv);
+		vertices[index].normal = D3DXVECTOR3(m_heightMap[index2].nx, m_heightMap[index2].ny, m_heightMap[index2].nz);
+		index++;
+	}
 
-			// Modify the texture coordinates to cover the right edge.
-			if (tu == 0.0f) { tu = 1.0f; }
+	return;
+}
 
-			vertices[index].position = D3DXVECTOR3(m_heightMap[index2].x, m_heightMap[index2].y, m_heightMap[index2].z);
-			vertices[index].texture = D3DXVECTOR2(tu, m_heightMap[index2].tv);
-			vertices[index].normal = D3DXVECTOR3(m_heightMap[index2].nx, m_heightMap[index2].ny, m_heightMap[index2].nz);
-			indices[index] = index;
-			index++;
-		}
-	}
+bool TerrainClass::CreateVertexBuffer(ID3D11Device* device, VertexType* vertices, ID3D11Buffer** vertexBuffer)
+{
+	D3D11_BUFFER_DESC vertexBufferDesc;
+	D3D11_SUBRESOURCE_DATA vertexData;
+	HRESULT result;
 
 
 	// Set up the description of the static vertex buffer.
@@ -1340,39 +4121,12 @@ bool TerrainClass::InitializeBuffers(ID3D11Device* device)
 	vertexData.SysMemSlicePitch = 0;
 
 	// Now create the vertex buffer.
-    result = device->CreateBuffer(&vertexBufferDesc, &vertexData, &m_vertexBuffer);
-	if(FAILED(result))
-	{
-		return false;
-	}
-
-	// Set up the description of the static index buffer.
-    indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    indexBufferDesc.ByteWidth = sizeof(unsigned long) * m_indexCount;
-    indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    indexBufferDesc.CPUAccessFlags = 0;
-    indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
-
-	// Give the subresource structure a pointer to the index data.
-    indexData.pSysMem = indices;
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
-
-	// Create the index buffer.
-	result = device->CreateBuffer(&indexBufferDesc, &indexData, &m_indexBuffer);
+    result = device->CreateBuffer(&vertexBufferDesc, &vertexData, vertexBuffer);
 	if(FAILED(result))
 	{
 		return false;
 	}
 
-	// Release the arrays now that the buffers have been created and loaded.
-	delete [] vertices;
-	vertices = 0;
-
-	delete [] indices;
-	indices = 0;
-
 	return true;
 }
 
@@ -12,21 +12,69 @@
 #include <d3d11.h>
 #include <d3dx10math.h>
 #include <stdio.h>
-#include "perlin.h"
+#include "noisecombinerclass.h"
+#include "dungeoncelldata.h"
+#include "generationmessagedata.h"
+#include "roomindexclass.h"
+#include "corridorplannerclass.h"
+#include "corridorrouterclass.h"
+#include "bitgridclass.h"
+#include "connectivityclass.h"
+#include "pipelineclass.h"
+#include "arenaclass.h"
+#include "threadpoolclass.h"
+#include "allocationcounterclass.h"
+#include "heightfieldclass.h"
+#include "caveclass.h"
+#include "distancefieldclass.h"
+#include "erosionclass.h"
+#include "heightmapfileclass.h"
+#include "dungeonfileclass.h"
+#include "meshexportclass.h"
+#include "imageexportclass.h"
+#include "diskcacheclass.h"
+#include "terrainhistoryclass.h"
 #include <queue>
 #include <algorithm>
 #include <time.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 
 /////////////
 // GLOBALS //
 /////////////
 const int TEXTURE_REPEAT = 16;
+const int MIN_ROOM_SIZE = 4;
+const bool ROUTE_CORRIDORS_AROUND_ROOMS = true;
+const bool REPAIR_DISCONNECTED_ROOMS = true;
+const int ROOM_DEPTH = 8;
+const bool BACKGROUND_GENERATION = true;
+const int GENERATION_SLICE = 2000;
+const int MAX_SMOOTH_PASSES = 4;
+const int GENERATION_ARENA_SIZE = 256 * 1024;
+const HeightFieldClass::LayoutType HEIGHTFIELD_LAYOUT = HeightFieldClass::LAYOUT_TILED;
+const bool SAVE_GENERATED_TERRAIN = false;
+const bool EXPORT_IMAGE_LAYERS = true;
+
+class DungeonStackClass;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Class name: TerrainClass
 ////////////////////////////////////////////////////////////////////////////////
 class TerrainClass
 {
+	// The tests run generation on the calling thread and without the disk cache.
+	friend class TerrainTestClass;
+
+	// The layout benchmark runs the smoothing and face normal stencils on fields of its own.
+	friend class LayoutBenchmarkClass;
+
+	// The delta benchmark generates as the tests do and reads each version out of the front buffers.
+	friend class DeltaBenchmarkClass;
+
 private:
 	struct VertexType
 	{
@@ -47,9 +95,51 @@ private:
 		float x, y, z;
 	};
 
-	struct dungeonCellData
+	enum GenerationType
+	{
+		GENERATE_RANDOM_FIELD,
+		GENERATE_SMOOTH,
+		GENERATE_PERLIN,
+		GENERATE_DUNGEON,
+		GENERATE_CAVE,
+		GENERATE_EROSION,
+		GENERATE_INITIAL,
+		GENERATE_TYPE_COUNT
+	};
+
+	struct OperationType
+	{
+		GenerationType type;
+		unsigned int seed;
+		int runs;
+		int passes;
+	};
+
+	enum GenerationStage
 	{
-		float xTopRight, xBottomLeft, yTopRight, yBottomLeft;
+		STAGE_PREPARE,
+		STAGE_RESTORE,
+		STAGE_RANDOM_FIELD,
+		STAGE_SMOOTH,
+		STAGE_PERLIN,
+		STAGE_EROSION,
+		STAGE_DIVIDE_CELLS,
+		STAGE_PLACE_ROOMS,
+		STAGE_FLATTEN,
+		STAGE_CARVE_ROOMS,
+		STAGE_PLAN_CORRIDORS,
+		STAGE_ROUTE_CORRIDORS,
+		STAGE_CARVE_CORRIDORS,
+		STAGE_CONNECTIVITY,
+		STAGE_CAVE_STEP,
+		STAGE_CAVE_CARVE,
+		STAGE_FACE_NORMALS,
+		STAGE_VERTEX_NORMALS,
+		STAGE_SNAPSHOT,
+		STAGE_DISTANCE_FIELD,
+		STAGE_MESH,
+		STAGE_VERTEX_BUFFER,
+		STAGE_DONE
 	};
 
 //	template<class dungeonCellData, class Container = std::index_sequence<dungeonCellData>> class queue;
@@ -63,16 +153,55 @@ public:
 	bool InitializeTerrain(ID3D11Device*, int terrainWidth, int terrainHeight, WCHAR*, WCHAR*, WCHAR*);
 	void Shutdown();
 	void Render(ID3D11DeviceContext*);
+	void UpdateGeneration(int budget);
+	bool IsGenerating();
+	void SetViewPosition(float x, float z);
 	bool GenerateHeightMap(ID3D11Device* device, bool keydown);
 	int RandomHeightField();
+	int Random();
 	int SmoothVertex(ID3D11Device* device, bool keydown);
+	int SmoothPasses(ID3D11Device* device, bool keydown);
 	int performPerlin(ID3D11Device* device, bool keydown);
+	int erodeTerrain(ID3D11Device* device, bool keydown, int iterations);
 	int spacePartitioning(ID3D11Device* device, bool keydown, int runs);
+	int cellularCaves(ID3D11Device* device, bool keydown, int iterations);
+	int saveDungeon(bool keydown, const char* filename);
+	int loadDungeon(ID3D11Device* device, bool keydown, const char* filename);
+	int exportMesh(bool keydown, const char* filename, MeshExportClass::FormatType format);
+	int exportImages(bool keydown, const char* filename, ImageExportClass::FormatType format);
+	int undoTerrain(ID3D11Device* device, bool keydown);
+	int redoTerrain(ID3D11Device* device, bool keydown);
+	int levelDown(ID3D11Device* device, bool keydown, DungeonStackClass* stack);
+	int levelUp(ID3D11Device* device, bool keydown, DungeonStackClass* stack);
+	bool RequestRecipe(ID3D11Device* device, const generationOperationData* operations, int operationCount);
+	static bool NormalizeOperation(int type, int& runs, unsigned int& seed);
+	bool PackTerrain(std::vector<unsigned char>& data);
 	void cellDivision(dungeonCellData currentCell);
 	void roomGeneration();
+	bool placeNextRoom();
+	bool placeRoom(dungeonCellData& newRoom);
 	void roomHeight(int roomHeight);
+	void flattenRow(int y);
 	void corridorGeneration(int roomHeight);
+	int planCorridors();
+	void routeCorridor(int edge);
+	void carveRect(const dungeonCellData& rect, int roomHeight);
+	int connectivityCheck(int roomHeight);
+	bool connectivityStep(int step, int roomHeight);
+	void carveCaveRow(const BitGridClass& floor, int y, int roomHeight);
 	int GetIndexCount();
+	bool IsWalkable(int x, int y);
+	float GetWallDistance(int x, int y);
+	const BitGridClass& GetWalkGrid();
+	int GetDungeonComponentCount();
+	int GetGenerationAllocationCount();
+	long long GetGenerationAllocatedBytes();
+	int GetGenerationArenaBytes();
+	int GetHistoryCount();
+	int GetHistoryPosition();
+	long long GetHistoryBytes();
+	int CompareHistory(int first, int second, std::vector<int>& tiles);
+	bool ReadHistory(int version, std::vector<float>& heights);
 
 	ID3D11ShaderResourceView* GetGrassTexture();
 	ID3D11ShaderResourceView* GetSlopeTexture();
@@ -80,8 +209,12 @@ public:
 
 private:
 	bool LoadHeightMap(char*);
-	void NormalizeHeightMap();
 	bool CalculateNormals();
+	void CalculateFaceNormals(int tile, VectorType* normals);
+	void CalculateVertexNormals(int row, VectorType* normals);
+	bool InitializeSubsystems();
+	void ShutdownSubsystems();
+	bool InitializeHeightFields();
 	void ShutdownHeightMap();
 
 	void CalculateTextureCoordinates();
@@ -89,22 +222,163 @@ private:
 	void ReleaseTextures();
 
 	bool InitializeBuffers(ID3D11Device*);
+	void BuildVertexRow(VertexType* vertices, int row);
+	bool CreateVertexBuffer(ID3D11Device*, VertexType* vertices, ID3D11Buffer** vertexBuffer);
 	void ShutdownBuffers();
 	void RenderBuffers(ID3D11DeviceContext*);
+
+	bool InitializeGeneration();
+	bool InitializeNoise();
+	void ShutdownGeneration();
+	void RequestGeneration(ID3D11Device*, GenerationType type, int runs, unsigned int seed);
+	void RequestSmoothPasses(ID3D11Device*, int passes);
+	void RequestLoad(ID3D11Device*, std::vector<OperationType>& recipe, std::vector<unsigned char>& baseDelta, std::vector<float>& baseHeights, std::vector<unsigned char>& terrain);
+	void RequestHistory(ID3D11Device*, bool redo);
+	bool RequestLevel(ID3D11Device*, DungeonStackClass* stack, int level);
+	bool SaveDungeon(const char* filename, bool terrain);
+	bool LoadDungeon(ID3D11Device*, const char* filename);
+	bool ExportMesh(const char* filename, MeshExportClass::FormatType format);
+	bool ExportImages(const char* filename, ImageExportClass::FormatType format, bool layers);
+	void GenerationThread();
+	void FinishGeneration(bool result);
+	void StartGeneration();
+	bool StartOperation();
+	bool FinishOperation();
+	void BuildPipeline();
+	void PackHeights(std::vector<unsigned char>& data, bool normals, bool front);
+	bool UnpackHeights(const std::vector<unsigned char>& data, bool normals);
+	bool RestoreStage(unsigned long long key, bool normals);
+	bool SnapshotChunk(int chunk);
+	void RestoreChunk(int version, int chunk);
+	void PackHistory(std::vector<unsigned char>& extra);
+	void UnpackHistory(int version, std::vector<OperationType>* recipe, bool terrain);
+	bool StepGeneration(int budget, bool& finished);
+	bool OutOfTime();
+	void NextStage(GenerationStage stage);
+	bool RunStage();
+	void RandomHeightRow(int row);
+	void SmoothHeightTile(int tile);
+	void LoadHeightRow(int row);
+	void StoreHeightRow(int row);
+	void PerlinHeightRow(int row);
+	void startDungeon();
 	
 private:
-	bool m_terrainGeneratedToggle, m_terrainSmoothToggle;
+	bool m_terrainGeneratedToggle, m_terrainSmoothToggle, m_terrainPartitionToggle, m_terrainPerlinToggle, m_terrainPassesToggle, m_terrainCaveToggle, m_terrainErosionToggle, m_terrainSaveToggle, m_terrainLoadToggle, m_terrainExportToggle, m_terrainImageToggle, m_terrainUndoToggle, m_terrainRedoToggle, m_terrainLevelDownToggle, m_terrainLevelUpToggle;
+	int m_stackLevel;
 	int m_terrainWidth, m_terrainHeight;
 	int m_vertexCount, m_indexCount;
 	ID3D11Buffer *m_vertexBuffer, *m_indexBuffer;
 	HeightMapType* m_heightMap;
 	TextureClass *m_GrassTexture, *m_SlopeTexture, *m_RockTexture;
+	RoomIndexClass* m_RoomIndex;
+	CorridorPlannerClass* m_CorridorPlanner;
+	CorridorRouterClass* m_CorridorRouter;
+	ConnectivityClass* m_Connectivity;
+	CaveClass* m_Cave;
+	DistanceFieldClass* m_DistanceField;
+	ErosionClass* m_Erosion;
+	ThreadPoolClass m_threadPool;
+	BitGridClass m_walkGrid;
+	HeightFieldClass m_heightField, m_smoothField;
+	int m_componentCount;
+
+	// Generation runs on its own thread against m_heightMap and m_walkGrid, the front copies are what is on screen.
+	HeightMapType* m_frontHeightMap;
+	float *m_wallDistances, *m_frontWallDistances;
+	BitGridClass m_frontWalkGrid;
+	int m_frontComponentCount;
+	std::vector<OperationType> m_frontRecipe;
+	std::vector<dungeonCellData> m_frontRooms, m_frontCorridors;
+	ID3D11Buffer* m_backVertexBuffer;
+	ID3D11Device* m_generationDevice;
+	std::thread m_generationThread;
+	std::mutex m_generationMutex;
+	std::condition_variable m_generationCondition;
+	std::atomic<unsigned int> m_latestGeneration;
+	unsigned int m_startedGeneration, m_jobGeneration;
+	std::vector<OperationType> m_recipe;
+	int m_smoothPasses;
+	bool m_generationBusy, m_generationReady, m_generationQuit, m_generationThreaded;
+
+	// Where the camera is, for the generation thread to hand to streamed height fields as the place to prefetch around.
+	std::atomic<int> m_viewX, m_viewZ;
+	int m_prefetchX, m_prefetchZ;
+
+	// The job in progress as an explicit state machine, m_stageStep is how far into the current stage it got.
+	GenerationStage m_stage;
+	int m_stageStep;
+	std::vector<OperationType> m_jobRecipe;
+	int m_jobOperation;
+	bool m_stepTimed;
+	std::chrono::high_resolution_clock::time_point m_stepDeadline;
+	VectorType* m_faceNormals;
+	VertexType* m_meshVertices;
+	ID3D11Buffer* m_stageVertexBuffer;
+	std::vector<dungeonCellData> m_corridorRooms, m_corridors, m_rectScratch, m_corridorScratch;
+	int m_corridorEdgeCount;
+
+	// The connectivity repair runs a room per step, what it has found so far is kept here between them.
+	std::vector<int> m_repairComponents;
+	std::vector<bool> m_repairJoined;
+	std::vector<dungeonCellData> m_repairCorridors;
+
+	// The noise is a graph of sources made once: ridged perlin octaves, pushed around by simplex octaves.
+	PerlinNoiseClass m_perlinNoise;
+	SimplexNoiseClass m_simplexNoise;
+	RidgedNoiseClass m_ridgedNoise;
+	FractalNoiseClass m_ridgedFractal, m_warpFractal;
+	DomainWarpNoiseClass m_warpedNoise;
+	ScaleOffsetNoiseClass m_terrainNoise;
+	std::vector<float> m_noiseRow;
+	float m_noiseOffsetX, m_noiseOffsetY;
+
+	// A random field or dungeon draws from a sequence seeded by its operation, not from rand(), which other
+	// terrains on other threads share.
+	unsigned long long m_randomState;
+
+	// The output of every operation in the recipe is cached under a hash of the recipe up to it.
+	PipelineClass* m_Pipeline;
+	std::vector<unsigned long long> m_jobKeys;
+	unsigned long long m_normalsKey;
+	std::vector<int> m_stageInputs;
+	std::vector<unsigned char> m_packedHeights;
+
+	// The same outputs go to a directory shared by every run, bump DISK_CACHE_VERSION when generation changes.
+	DiskCacheClass* m_DiskCache;
+
+	// Every finished terrain is kept as height tiles and walk grid bands shared with the versions around it, the tiles
+	// first then a band per row of tiles. A restore job rebuilds the version m_jobHistoryVersion instead of its recipe.
+	TerrainHistoryClass* m_History;
+	int m_historyTilesX, m_historyTilesY, m_historyTileCount;
+	int m_historyVersion, m_jobHistoryVersion;
+	std::vector<float> m_historyTile;
+	std::vector<unsigned char> m_historyExtra;
+
+	// The starting terrain as a delta against flat ground, its hash is the seed of the first operation. A loaded
+	// dungeon hands its starting terrain, and its finished terrain if it was saved, to the next job to put in the cache.
+	std::vector<unsigned char> m_baseDelta;
+	unsigned long long m_baseKey;
+	std::vector<float> m_loadBaseHeights, m_jobBaseHeights;
+	std::vector<unsigned char> m_loadTerrain, m_jobTerrain;
+	int m_loadOperationCount, m_jobTerrainOperations;
+
+	// Scratch arrays come from the arena, which is reset when a job starts. What the job still took from the heap is counted.
+	ArenaClass m_arena;
+	int m_jobAllocationCount, m_generationAllocationCount;
+	long long m_jobAllocatedBytes, m_generationAllocatedBytes;
+	int m_generationArenaBytes;
 
 	dungeonCellData currentCell;
 	dungeonCellData newCells[4];
-	dungeonCellData heightCell;	std::deque <dungeonCellData> cellQueue;
-	std::deque <dungeonCellData> roomQueue;
-	std::deque <dungeonCellData> roomCopy;
+	dungeonCellData heightCell;
+
+	// The queues are vectors read from a head index, cleared rather than freed so their storage is kept between jobs.
+	std::vector<dungeonCellData> cellQueue;
+	std::vector<dungeonCellData> roomQueue;
+	std::vector<dungeonCellData> roomCopy;
+	int m_cellHead, m_roomHead;
+	std::vector<int> m_overlaps;
 
 
 	float midpointX; 
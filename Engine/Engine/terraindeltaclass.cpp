@@ -0,0 +1,473 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: terraindeltaclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "terraindeltaclass.h"
+#include <cstring>
+
+
+namespace
+{
+	inline unsigned int LoadValue(const unsigned char* data)
+	{
+		unsigned int value;
+
+
+		memcpy(&value, data, sizeof(value));
+
+		return value;
+	}
+
+	inline void StoreValue(unsigned char* data, unsigned int value)
+	{
+		memcpy(data, &value, sizeof(value));
+	}
+
+	inline int NumberSize(unsigned int value)
+	{
+		return 1 + (value >= (1u << 7)) + (value >= (1u << 14)) + (value >= (1u << 21)) + (value >= (1u << 28));
+	}
+}
+
+
+TerrainDeltaClass::TerrainDeltaClass()
+{
+	m_changedCount = 0;
+}
+
+
+TerrainDeltaClass::TerrainDeltaClass(const TerrainDeltaClass& other)
+{
+}
+
+
+TerrainDeltaClass::~TerrainDeltaClass()
+{
+}
+
+
+void TerrainDeltaClass::Encode(const float* oldHeights, const float* newHeights, int cellCount, int stride, const unsigned long long* oldWords, const unsigned long long* newWords, int wordCount, const std::vector<dungeonCellData>& oldRooms, const std::vector<dungeonCellData>& newRooms, const std::vector<dungeonCellData>& oldCorridors, const std::vector<dungeonCellData>& newCorridors)
+{
+	unsigned long long hash;
+
+
+	m_data.clear();
+	m_changedCount = 0;
+
+	// The sizes and the hash of the old version go first so a delta for another terrain, or another version of
+	// this one, is refused.
+	DungeonFileClass::WriteNumber(m_data, cellCount);
+	DungeonFileClass::WriteNumber(m_data, wordCount);
+	DungeonFileClass::WriteNumber(m_data, HashBase(oldHeights, cellCount, stride, oldWords, wordCount, oldRooms, oldCorridors));
+
+	// The walk grid words are taken as pairs of 32 bit values, like the heights.
+	EncodeSpans((const unsigned char*)oldHeights, (const unsigned char*)newHeights, cellCount, stride * sizeof(float));
+	EncodeSpans((const unsigned char*)oldWords, (const unsigned char*)newWords, wordCount * 2, sizeof(unsigned int));
+
+	EncodeRects(oldRooms, newRooms);
+	EncodeRects(oldCorridors, newCorridors);
+
+	hash = DungeonFileClass::Hash(&m_data[0], (int)m_data.size());
+	m_data.insert(m_data.end(), (const unsigned char*)&hash, (const unsigned char*)&hash + sizeof(hash));
+
+	return;
+}
+
+
+bool TerrainDeltaClass::Apply(float* heights, int cellCount, int stride, unsigned long long* words, int wordCount, std::vector<dungeonCellData>& rooms, std::vector<dungeonCellData>& corridors)
+{
+	unsigned long long hash, count;
+	int start, position, end;
+
+
+	// Nothing is changed unless the whole delta arrived as it was made and is for a terrain of this size.
+	if(m_data.size() < sizeof(hash))
+	{
+		return false;
+	}
+
+	end = (int)m_data.size() - sizeof(hash);
+	memcpy(&hash, &m_data[end], sizeof(hash));
+	if(hash != DungeonFileClass::Hash(&m_data[0], end))
+	{
+		return false;
+	}
+
+	position = 0;
+	if(!DungeonFileClass::ReadNumber(m_data, position, end, count) || (count != (unsigned long long)cellCount))
+	{
+		return false;
+	}
+
+	if(!DungeonFileClass::ReadNumber(m_data, position, end, count) || (count != (unsigned long long)wordCount))
+	{
+		return false;
+	}
+
+	// Nor unless the terrain is the version the delta was made from.
+	if(!DungeonFileClass::ReadNumber(m_data, position, end, count) || (count != HashBase(heights, cellCount, stride, words, wordCount, rooms, corridors)))
+	{
+		return false;
+	}
+
+	// Read the whole delta through once without writing, so one that fails part way leaves the terrain alone,
+	// then again to apply it.
+	start = position;
+	for(int pass=0; pass<2; pass++)
+	{
+		position = start;
+
+		if(!ApplySpans(position, end, (unsigned char*)heights, cellCount, stride * sizeof(float), (pass == 1)))
+		{
+			return false;
+		}
+
+		if(!ApplySpans(position, end, (unsigned char*)words, wordCount * 2, sizeof(unsigned int), (pass == 1)))
+		{
+			return false;
+		}
+
+		if(!ApplyRects(position, end, rooms, (pass == 1)) || !ApplyRects(position, end, corridors, (pass == 1)))
+		{
+			return false;
+		}
+
+		if(position != end)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+std::vector<unsigned char>& TerrainDeltaClass::GetData()
+{
+	return m_data;
+}
+
+
+int TerrainDeltaClass::GetChangedCount()
+{
+	return m_changedCount;
+}
+
+
+void TerrainDeltaClass::EncodeSpans(const unsigned char* oldValues, const unsigned char* newValues, int count, int stride)
+{
+	unsigned int difference;
+	int i, start, end, gap, last;
+
+
+	last = 0;
+	i = 0;
+	while(i < count)
+	{
+		// Skip what has not changed, a block at a time while whole blocks match. The block is or'ed together
+		// without a branch, which the compiler can do several values at once.
+		while((i + TERRAINDELTA_BLOCK) <= count)
+		{
+			difference = 0;
+			for(int j=0; j<TERRAINDELTA_BLOCK; j++)
+			{
+				difference |= LoadValue(oldValues + ((i + j) * stride)) ^ LoadValue(newValues + ((i + j) * stride));
+			}
+
+			if(difference != 0)
+			{
+				break;
+			}
+			i += TERRAINDELTA_BLOCK;
+		}
+
+		while((i < count) && (LoadValue(oldValues + (i * stride)) == LoadValue(newValues + (i * stride))))
+		{
+			i++;
+		}
+
+		if(i == count)
+		{
+			break;
+		}
+
+		// Run the span on until enough unchanged values in a row that starting a new one is cheaper.
+		start = i;
+		end = i + 1;
+		gap = 0;
+		for(i=end; (i<count) && (gap<TERRAINDELTA_MERGE_GAP); i++)
+		{
+			if(LoadValue(oldValues + (i * stride)) == LoadValue(newValues + (i * stride)))
+			{
+				gap++;
+			}
+			else
+			{
+				gap = 0;
+				end = i + 1;
+			}
+		}
+
+		DungeonFileClass::WriteNumber(m_data, start - last);
+		EncodeSpan(oldValues, newValues, start, end, stride);
+
+		last = end;
+		i = end;
+	}
+
+	// A span with nothing in it ends the list, after the unchanged values to the end.
+	DungeonFileClass::WriteNumber(m_data, count - last);
+	DungeonFileClass::WriteNumber(m_data, 0);
+
+	return;
+}
+
+
+void TerrainDeltaClass::EncodeSpan(const unsigned char* oldValues, const unsigned char* newValues, int start, int end, int stride)
+{
+	unsigned int value, left, oldSize, leftSize;
+	bool constant;
+	SpanType type;
+	int length;
+
+
+	// Size the span each way. To the left of its first value is an unchanged one, or nothing at the very start.
+	length = end - start;
+	left = (start > 0) ? LoadValue(newValues + ((start - 1) * stride)) : 0;
+	oldSize = 0;
+	leftSize = 0;
+	constant = true;
+	for(int i=start; i<end; i++)
+	{
+		value = LoadValue(newValues + (i * stride));
+		oldSize += NumberSize(value ^ LoadValue(oldValues + (i * stride)));
+		leftSize += NumberSize(value ^ left);
+		constant = constant && (value == LoadValue(newValues + (start * stride)));
+		left = value;
+
+		if(LoadValue(oldValues + (i * stride)) != value)
+		{
+			m_changedCount++;
+		}
+	}
+
+	type = SPAN_RAW;
+	if((oldSize < (unsigned int)(length * 4)) || (leftSize < (unsigned int)(length * 4)))
+	{
+		type = (oldSize <= leftSize) ? SPAN_OLD : SPAN_LEFT;
+	}
+	if(constant && (length > 4))
+	{
+		type = SPAN_CONSTANT;
+	}
+
+	DungeonFileClass::WriteNumber(m_data, ((unsigned long long)length << 2) | type);
+
+	left = (start > 0) ? LoadValue(newValues + ((start - 1) * stride)) : 0;
+	for(int i=start; i<end; i++)
+	{
+		value = LoadValue(newValues + (i * stride));
+		switch(type)
+		{
+			case SPAN_RAW:
+				m_data.insert(m_data.end(), (const unsigned char*)&value, (const unsigned char*)&value + sizeof(value));
+				break;
+			case SPAN_OLD:
+				DungeonFileClass::WriteNumber(m_data, value ^ LoadValue(oldValues + (i * stride)));
+				break;
+			case SPAN_LEFT:
+				DungeonFileClass::WriteNumber(m_data, value ^ left);
+				break;
+			case SPAN_CONSTANT:
+				if(i == start)
+				{
+					m_data.insert(m_data.end(), (const unsigned char*)&value, (const unsigned char*)&value + sizeof(value));
+				}
+				break;
+		}
+		left = value;
+	}
+
+	return;
+}
+
+
+bool TerrainDeltaClass::ApplySpans(int& position, int end, unsigned char* values, int count, int stride, bool write)
+{
+	unsigned long long skip, header, number;
+	unsigned int value, left;
+	int i, length;
+	SpanType type;
+
+
+	i = 0;
+	while(true)
+	{
+		if(!DungeonFileClass::ReadNumber(m_data, position, end, skip) || !DungeonFileClass::ReadNumber(m_data, position, end, header))
+		{
+			return false;
+		}
+
+		// A span may not go past the end of the values.
+		if((skip > (unsigned long long)(count - i)) || ((header >> 2) > (unsigned long long)(count - i - (int)skip)))
+		{
+			return false;
+		}
+
+		i += (int)skip;
+		length = (int)(header >> 2);
+		type = (SpanType)(header & 3);
+
+		if(length == 0)
+		{
+			return (i == count);
+		}
+
+		left = (i > 0) ? LoadValue(values + ((i - 1) * stride)) : 0;
+		if((type == SPAN_RAW) || (type == SPAN_CONSTANT))
+		{
+			if((end - position) < (int)((type == SPAN_RAW) ? (length * sizeof(value)) : sizeof(value)))
+			{
+				return false;
+			}
+		}
+
+		for(int j=0; j<length; j++)
+		{
+			switch(type)
+			{
+				case SPAN_RAW:
+					value = LoadValue(&m_data[position]);
+					position += sizeof(value);
+					break;
+				case SPAN_OLD:
+					if(!DungeonFileClass::ReadNumber(m_data, position, end, number))
+					{
+						return false;
+					}
+					value = LoadValue(values + ((i + j) * stride)) ^ (unsigned int)number;
+					break;
+				case SPAN_LEFT:
+					if(!DungeonFileClass::ReadNumber(m_data, position, end, number))
+					{
+						return false;
+					}
+					value = left ^ (unsigned int)number;
+					break;
+				default:
+					value = LoadValue(&m_data[position]);
+					break;
+			}
+
+			if(write)
+			{
+				StoreValue(values + ((i + j) * stride), value);
+			}
+			left = value;
+		}
+
+		if(type == SPAN_CONSTANT)
+		{
+			position += sizeof(value);
+		}
+		i += length;
+	}
+}
+
+
+void TerrainDeltaClass::EncodeRects(const std::vector<dungeonCellData>& oldRects, const std::vector<dungeonCellData>& newRects)
+{
+	unsigned int front, back;
+
+
+	// Keep what the two lists start and end with in common, the rest of the new list is sent.
+	front = 0;
+	while((front < oldRects.size()) && (front < newRects.size()) && (memcmp(&oldRects[front], &newRects[front], sizeof(dungeonCellData)) == 0))
+	{
+		front++;
+	}
+
+	back = 0;
+	while(((front + back) < oldRects.size()) && ((front + back) < newRects.size()) && (memcmp(&oldRects[oldRects.size() - 1 - back], &newRects[newRects.size() - 1 - back], sizeof(dungeonCellData)) == 0))
+	{
+		back++;
+	}
+
+	DungeonFileClass::WriteNumber(m_data, front);
+	DungeonFileClass::WriteNumber(m_data, back);
+
+	m_rectScratch.assign(newRects.begin() + front, newRects.end() - back);
+	DungeonFileClass::WriteRects(m_data, m_rectScratch);
+
+	return;
+}
+
+
+bool TerrainDeltaClass::ApplyRects(int& position, int end, std::vector<dungeonCellData>& rects, bool write)
+{
+	unsigned long long front, back;
+	int middle;
+
+
+	if(!DungeonFileClass::ReadNumber(m_data, position, end, front) || !DungeonFileClass::ReadNumber(m_data, position, end, back))
+	{
+		return false;
+	}
+
+	if((front + back) > rects.size())
+	{
+		return false;
+	}
+
+	if(!DungeonFileClass::ReadRects(m_data, position, end, m_rectScratch))
+	{
+		return false;
+	}
+
+	if(!write)
+	{
+		return true;
+	}
+
+	// Swap the changed stretch in between the ends that stayed.
+	middle = (int)rects.size() - (int)front - (int)back;
+	rects.erase(rects.begin() + (int)front, rects.begin() + (int)front + middle);
+	rects.insert(rects.begin() + (int)front, m_rectScratch.begin(), m_rectScratch.end());
+
+	return true;
+}
+
+
+unsigned long long TerrainDeltaClass::HashBase(const float* heights, int cellCount, int stride, const unsigned long long* words, int wordCount, const std::vector<dungeonCellData>& rooms, const std::vector<dungeonCellData>& corridors)
+{
+	unsigned long long hash;
+
+
+	// FNV-1a a 32 bit value at a time rather than a byte, the heights are strided and there are a lot of them.
+	hash = 14695981039346656037ULL;
+	for(int i=0; i<cellCount; i++)
+	{
+		hash = (hash ^ LoadValue((const unsigned char*)(heights + (i * stride)))) * 1099511628211ULL;
+	}
+
+	for(int i=0; i<(wordCount * 2); i++)
+	{
+		hash = (hash ^ LoadValue((const unsigned char*)words + (i * sizeof(unsigned int)))) * 1099511628211ULL;
+	}
+
+	// The rooms, then the corridors, as their four edges each, with the counts so where one list ends is part of it.
+	for(int list=0; list<2; list++)
+	{
+		const std::vector<dungeonCellData>& rects = (list == 0) ? rooms : corridors;
+
+		hash = (hash ^ (unsigned int)rects.size()) * 1099511628211ULL;
+		for(unsigned int i=0; i<rects.size(); i++)
+		{
+			hash = (hash ^ LoadValue((const unsigned char*)&rects[i].xTopRight)) * 1099511628211ULL;
+			hash = (hash ^ LoadValue((const unsigned char*)&rects[i].xBottomLeft)) * 1099511628211ULL;
+			hash = (hash ^ LoadValue((const unsigned char*)&rects[i].yTopRight)) * 1099511628211ULL;
+			hash = (hash ^ LoadValue((const unsigned char*)&rects[i].yBottomLeft)) * 1099511628211ULL;
+		}
+	}
+
+	return hash;
+}
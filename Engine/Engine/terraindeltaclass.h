@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: terraindeltaclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _TERRAINDELTACLASS_H_
+#define _TERRAINDELTACLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "dungeoncelldata.h"
+#include "dungeonfileclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int TERRAINDELTA_MERGE_GAP = 4;
+const int TERRAINDELTA_BLOCK = 8;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: TerrainDeltaClass
+////////////////////////////////////////////////////////////////////////////////
+// The change from one version of a terrain to another, small enough to send
+// instead of the terrain: the heights and the walk grid as spans of changed
+// values, and the rooms and corridors as the stretch of each list that differs.
+//
+// Values are compared as bits, eight at a time until a block differs. A span
+// runs until TERRAINDELTA_MERGE_GAP unchanged values in a row, and its values
+// are kept whichever way is smallest: raw, one value for all of them, or as the
+// bits that changed against the old value or against the value to the left,
+// written as variable length integers. A smoothed or eroded terrain only moves
+// the low bits of a height, and a flattened room floor is the same as its
+// neighbour, so most values take a byte or two.
+//
+// The delta starts with a hash of the version it was made from and ends in a
+// checksum of itself. Apply checks both, then reads the whole delta through once
+// without writing, so a delta for another version, or one that is damaged or
+// cut short, is refused with the terrain left as it was.
+class TerrainDeltaClass
+{
+private:
+	enum SpanType
+	{
+		SPAN_RAW,
+		SPAN_OLD,
+		SPAN_LEFT,
+		SPAN_CONSTANT
+	};
+
+public:
+	TerrainDeltaClass();
+	TerrainDeltaClass(const TerrainDeltaClass&);
+	~TerrainDeltaClass();
+
+	void Encode(const float* oldHeights, const float* newHeights, int cellCount, int stride, const unsigned long long* oldWords, const unsigned long long* newWords, int wordCount, const std::vector<dungeonCellData>& oldRooms, const std::vector<dungeonCellData>& newRooms, const std::vector<dungeonCellData>& oldCorridors, const std::vector<dungeonCellData>& newCorridors);
+	bool Apply(float* heights, int cellCount, int stride, unsigned long long* words, int wordCount, std::vector<dungeonCellData>& rooms, std::vector<dungeonCellData>& corridors);
+
+	std::vector<unsigned char>& GetData();
+	int GetChangedCount();
+
+private:
+	void EncodeSpans(const unsigned char* oldValues, const unsigned char* newValues, int count, int stride);
+	void EncodeSpan(const unsigned char* oldValues, const unsigned char* newValues, int start, int end, int stride);
+	bool ApplySpans(int& position, int end, unsigned char* values, int count, int stride, bool write);
+	void EncodeRects(const std::vector<dungeonCellData>& oldRects, const std::vector<dungeonCellData>& newRects);
+	bool ApplyRects(int& position, int end, std::vector<dungeonCellData>& rects, bool write);
+	unsigned long long HashBase(const float* heights, int cellCount, int stride, const unsigned long long* words, int wordCount, const std::vector<dungeonCellData>& rooms, const std::vector<dungeonCellData>& corridors);
+
+private:
+	std::vector<unsigned char> m_data;
+	std::vector<dungeonCellData> m_rectScratch;
+	int m_changedCount;
+};
+
+#endif
@@ -0,0 +1,314 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: terrainhistoryclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "terrainhistoryclass.h"
+#include <cstring>
+
+
+TerrainHistoryClass::TerrainHistoryClass()
+{
+	m_chunkCount = 0;
+	m_maxVersions = 0;
+	m_position = -1;
+	m_maxBytes = 0;
+	m_chunkBytes = 0;
+	m_building = false;
+}
+
+
+TerrainHistoryClass::TerrainHistoryClass(const TerrainHistoryClass& other)
+{
+}
+
+
+TerrainHistoryClass::~TerrainHistoryClass()
+{
+}
+
+
+bool TerrainHistoryClass::Initialize(int chunkCount, int maxVersions, long long maxBytes)
+{
+	if((chunkCount <= 0) || (maxVersions <= 0) || (maxBytes <= 0))
+	{
+		return false;
+	}
+
+	m_chunkCount = chunkCount;
+	m_maxVersions = maxVersions;
+	m_maxBytes = maxBytes;
+
+	return true;
+}
+
+
+void TerrainHistoryClass::Shutdown()
+{
+	Cancel();
+
+	while(!m_versions.empty())
+	{
+		DropVersion((int)m_versions.size() - 1);
+	}
+	m_position = -1;
+
+	for(unsigned int i=0; i<m_freeChunks.size(); i++)
+	{
+		delete m_freeChunks[i];
+	}
+	std::vector<ChunkType*>().swap(m_freeChunks);
+	std::vector<VersionType>().swap(m_versions);
+
+	return;
+}
+
+
+void TerrainHistoryClass::Begin()
+{
+	// A version that was never committed is thrown away.
+	Cancel();
+
+	// Start out sharing every chunk of the current version, or none before the first.
+	if(m_position >= 0)
+	{
+		m_pending.chunks = m_versions[m_position].chunks;
+	}
+	else
+	{
+		m_pending.chunks.assign(m_chunkCount, 0);
+	}
+
+	m_building = true;
+
+	return;
+}
+
+
+bool TerrainHistoryClass::Update(int chunk, const void* data, int size)
+{
+	ChunkType* current;
+
+
+	if(!m_building || (chunk < 0) || (chunk >= m_chunkCount))
+	{
+		return false;
+	}
+
+	// Unchanged from the version it was begun from, so it stays shared.
+	current = m_pending.chunks[chunk];
+	if(current && ((int)current->data.size() == size) && ((size == 0) || (memcmp(&current->data[0], data, size) == 0)))
+	{
+		return true;
+	}
+
+	// A chunk no committed version holds yet is this one's own and is written in place, a shared one is copied first.
+	if(!current || (current->references > 0))
+	{
+		if(!m_freeChunks.empty())
+		{
+			current = m_freeChunks.back();
+			m_freeChunks.pop_back();
+		}
+		else
+		{
+			current = new ChunkType;
+			if(!current)
+			{
+				return false;
+			}
+		}
+
+		current->references = 0;
+		m_pending.chunks[chunk] = current;
+	}
+
+	current->data.assign((const unsigned char*)data, (const unsigned char*)data + size);
+
+	return true;
+}
+
+
+void TerrainHistoryClass::Commit(const std::vector<unsigned char>& extra)
+{
+	if(!m_building)
+	{
+		return;
+	}
+
+	// Hold the chunks first, the version may share some with the ones dropped below.
+	for(int i=0; i<m_chunkCount; i++)
+	{
+		if(m_pending.chunks[i])
+		{
+			if(m_pending.chunks[i]->references == 0)
+			{
+				m_chunkBytes += m_pending.chunks[i]->data.size();
+			}
+			m_pending.chunks[i]->references++;
+		}
+	}
+
+	// Whatever was undone is gone once something else is done instead.
+	while((int)m_versions.size() > (m_position + 1))
+	{
+		DropVersion((int)m_versions.size() - 1);
+	}
+
+	m_versions.push_back(VersionType());
+	m_versions.back().chunks.swap(m_pending.chunks);
+	m_versions.back().extra = extra;
+	m_position = (int)m_versions.size() - 1;
+	m_building = false;
+
+	// Drop the oldest versions while there are too many, always keeping the one just made.
+	while((m_versions.size() > 1) && (((int)m_versions.size() > m_maxVersions) || (m_chunkBytes > m_maxBytes)))
+	{
+		DropVersion(0);
+		m_position--;
+	}
+
+	return;
+}
+
+
+void TerrainHistoryClass::Cancel()
+{
+	if(!m_building)
+	{
+		return;
+	}
+
+	// Only the chunks the version wrote itself are freed, the rest belong to the versions it shared them with.
+	for(unsigned int i=0; i<m_pending.chunks.size(); i++)
+	{
+		if(m_pending.chunks[i] && (m_pending.chunks[i]->references == 0))
+		{
+			Recycle(m_pending.chunks[i]);
+		}
+	}
+
+	m_pending.chunks.clear();
+	m_building = false;
+
+	return;
+}
+
+
+bool TerrainHistoryClass::Undo()
+{
+	if(m_position <= 0)
+	{
+		return false;
+	}
+
+	m_position--;
+
+	return true;
+}
+
+
+bool TerrainHistoryClass::Redo()
+{
+	if((m_position + 1) >= (int)m_versions.size())
+	{
+		return false;
+	}
+
+	m_position++;
+
+	return true;
+}
+
+
+int TerrainHistoryClass::GetVersionCount()
+{
+	return (int)m_versions.size();
+}
+
+
+int TerrainHistoryClass::GetPosition()
+{
+	return m_position;
+}
+
+
+int TerrainHistoryClass::GetChunkCount()
+{
+	return m_chunkCount;
+}
+
+
+const std::vector<unsigned char>* TerrainHistoryClass::GetChunk(int version, int chunk)
+{
+	if((version < 0) || (version >= (int)m_versions.size()) || (chunk < 0) || (chunk >= m_chunkCount) || !m_versions[version].chunks[chunk])
+	{
+		return 0;
+	}
+
+	return &m_versions[version].chunks[chunk]->data;
+}
+
+
+const std::vector<unsigned char>& TerrainHistoryClass::GetExtra(int version)
+{
+	return m_versions[version].extra;
+}
+
+
+bool TerrainHistoryClass::IsShared(int first, int second, int chunk)
+{
+	// A shared chunk is the same in both, one that is not was written again and so almost always differs.
+	return m_versions[first].chunks[chunk] == m_versions[second].chunks[chunk];
+}
+
+
+long long TerrainHistoryClass::GetChunkBytes()
+{
+	return m_chunkBytes;
+}
+
+
+void TerrainHistoryClass::Release(ChunkType* chunk)
+{
+	if(!chunk)
+	{
+		return;
+	}
+
+	chunk->references--;
+	if(chunk->references == 0)
+	{
+		m_chunkBytes -= chunk->data.size();
+		Recycle(chunk);
+	}
+
+	return;
+}
+
+
+void TerrainHistoryClass::Recycle(ChunkType* chunk)
+{
+	// Keep up to a version's worth of freed chunks so their storage is reused by the next one.
+	if((int)m_freeChunks.size() < m_chunkCount)
+	{
+		m_freeChunks.push_back(chunk);
+	}
+	else
+	{
+		delete chunk;
+	}
+
+	return;
+}
+
+
+void TerrainHistoryClass::DropVersion(int version)
+{
+	for(unsigned int i=0; i<m_versions[version].chunks.size(); i++)
+	{
+		Release(m_versions[version].chunks[i]);
+	}
+
+	m_versions.erase(m_versions.begin() + version);
+
+	return;
+}
@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: terrainhistoryclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _TERRAINHISTORYCLASS_H_
+#define _TERRAINHISTORYCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int HISTORY_TILE_SIZE = 64;
+const int HISTORY_VERSIONS = 64;
+const long long HISTORY_SIZE = 128LL * 1024LL * 1024LL;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: TerrainHistoryClass
+////////////////////////////////////////////////////////////////////////////////
+// Past versions of a terrain for undo and redo, each a list of chunks and a
+// blob of whatever else the caller keeps with them. Chunks are reference counted
+// and shared between every version they did not change in, so a version costs a
+// pointer per chunk plus the chunks that are new in it.
+//
+// A version is built by Begin, which shares every chunk of the current one, then
+// Update for each chunk, which keeps the shared chunk if the data matches it and
+// otherwise writes a chunk of the new version's own, then Commit. Undo and Redo
+// only move which version is current, and drop nothing. Committing after an undo
+// drops the versions that were undone, and the oldest go once there are more
+// than the count or their chunks come to more than the size.
+//
+// Begin, Update, Commit and Cancel are for the one thread that builds versions.
+// Only Commit and Cancel free chunks, so others may read versions while Update
+// runs as long as they never do so at the same time as those two.
+class TerrainHistoryClass
+{
+private:
+	struct ChunkType
+	{
+		int references;
+		std::vector<unsigned char> data;
+	};
+
+	struct VersionType
+	{
+		std::vector<ChunkType*> chunks;
+		std::vector<unsigned char> extra;
+	};
+
+public:
+	TerrainHistoryClass();
+	TerrainHistoryClass(const TerrainHistoryClass&);
+	~TerrainHistoryClass();
+
+	bool Initialize(int chunkCount, int maxVersions, long long maxBytes);
+	void Shutdown();
+
+	void Begin();
+	bool Update(int chunk, const void* data, int size);
+	void Commit(const std::vector<unsigned char>& extra);
+	void Cancel();
+
+	bool Undo();
+	bool Redo();
+
+	int GetVersionCount();
+	int GetPosition();
+	int GetChunkCount();
+	const std::vector<unsigned char>* GetChunk(int version, int chunk);
+	const std::vector<unsigned char>& GetExtra(int version);
+	bool IsShared(int first, int second, int chunk);
+	long long GetChunkBytes();
+
+private:
+	void Release(ChunkType* chunk);
+	void Recycle(ChunkType* chunk);
+	void DropVersion(int version);
+
+private:
+	std::vector<VersionType> m_versions;
+	VersionType m_pending;
+	std::vector<ChunkType*> m_freeChunks;
+	int m_chunkCount, m_maxVersions, m_position;
+	long long m_maxBytes, m_chunkBytes;
+	bool m_building;
+};
+
+#endif
@@ -73,7 +73,7 @@ bool TextClass::Initialize(ID3D11Device* device, ID3D11DeviceContext* deviceCont
 	}
 
 	// Initialize the third sentence.
-	result = InitializeSentence(&m_sentence3, 16, device);
+	result = InitializeSentence(&m_sentence3, 32, device);
 	if(!result)
 	{
 		return false;
@@ -505,19 +505,24 @@ bool TextClass::SetVideoCardInfo(char* videoCardName, int videoCardMemory, ID3D1
 }
 
 
-bool TextClass::SetFps(int fps, ID3D11DeviceContext* deviceContext)
+bool TextClass::SetFps(int fps, int worstFrameTime, ID3D11DeviceContext* deviceContext)
 {
 	char tempString[16];
-	char fpsString[16];
+	char fpsString[32];
 	bool result;
 
 
-	// Truncate the fps to prevent a buffer over flow.
+	// Truncate the fps and frame time to prevent a buffer over flow.
 	if(fps > 9999)
 	{
 		fps = 9999;
 	}
 
+	if(worstFrameTime > 9999)
+	{
+		worstFrameTime = 9999;
+	}
+
 	// Convert the fps integer to string format.
 	_itoa_s(fps, tempString, 10);
 
@@ -525,6 +530,12 @@ bool TextClass::SetFps(int fps, ID3D11DeviceContext* deviceContext)
 	strcpy_s(fpsString, "Fps: ");
 	strcat_s(fpsString, tempString);
 
+	// Add the slowest frame of the last second, a hitch shows here even when the fps does not drop.
+	_itoa_s(worstFrameTime, tempString, 10);
+	strcat_s(fpsString, " Max: ");
+	strcat_s(fpsString, tempString);
+	strcat_s(fpsString, "ms");
+
 	// Update the sentence vertex buffer with the new string information.
 	result = UpdateSentence(m_sentence3, fpsString, 10, 70, 0.0f, 1.0f, 0.0f, deviceContext);
 	if(!result)
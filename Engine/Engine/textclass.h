@@ -41,7 +41,7 @@ public:
 	bool Render(ID3D11DeviceContext*, FontShaderClass*, D3DXMATRIX, D3DXMATRIX);
 
 	bool SetVideoCardInfo(char*, int, ID3D11DeviceContext*);
-	bool SetFps(int, ID3D11DeviceContext*);
+	bool SetFps(int, int, ID3D11DeviceContext*);
 	bool SetCpu(int, ID3D11DeviceContext*);
 	bool SetCameraPosition(float, float, float, ID3D11DeviceContext*);
 	bool SetCameraRotation(float, float, float, ID3D11DeviceContext*);
@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: threadpoolclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "threadpoolclass.h"
+#include <algorithm>
+
+
+ThreadPoolClass::ThreadPoolClass()
+{
+	m_workTask = 0;
+	m_workCount = 0;
+	m_workRound = 0;
+	m_workPending = 0;
+	m_workQuit = false;
+}
+
+
+ThreadPoolClass::ThreadPoolClass(const ThreadPoolClass& other)
+{
+}
+
+
+ThreadPoolClass::~ThreadPoolClass()
+{
+}
+
+
+bool ThreadPoolClass::Initialize(int threadCount)
+{
+	// One thread per hardware thread, unless the caller asks for a count.
+	if(threadCount <= 0)
+	{
+		threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+
+	// Start a thread for every task but the first, which is run by the caller.
+	m_workQuit = false;
+	m_workRound = 0;
+	for(int i=1; i<threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&ThreadPoolClass::WorkerThread, this, i));
+	}
+
+	return true;
+}
+
+
+void ThreadPoolClass::Shutdown()
+{
+	// Wake the threads to quit and wait for them.
+	m_workMutex.lock();
+	m_workQuit = true;
+	m_workMutex.unlock();
+
+	m_workCondition.notify_all();
+	for(unsigned int i=0; i<m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	std::vector<std::thread>().swap(m_workers);
+
+	return;
+}
+
+
+int ThreadPoolClass::GetThreadCount()
+{
+	return (int)m_workers.size() + 1;
+}
+
+
+void ThreadPoolClass::Run(int taskCount, const std::function<void(int)>& task)
+{
+	// Wake the threads with a task, the first task runs on this one.
+	m_workMutex.lock();
+	m_workTask = &task;
+	m_workCount = taskCount;
+	m_workPending = taskCount - 1;
+	m_workRound++;
+	m_workMutex.unlock();
+
+	m_workCondition.notify_all();
+	task(0);
+
+	{
+		std::unique_lock<std::mutex> lock(m_workMutex);
+		m_doneCondition.wait(lock, [this]() { return m_workPending == 0; });
+	}
+
+	m_workTask = 0;
+
+	return;
+}
+
+
+void ThreadPoolClass::WorkerThread(int thread)
+{
+	std::unique_lock<std::mutex> lock(m_workMutex);
+	const std::function<void(int)>* task;
+	unsigned int round;
+
+
+	// Initialize resets the round before starting the threads, so a run started before this thread first waits is not missed.
+	round = 0;
+	while(true)
+	{
+		// Sleep until the next run.
+		m_workCondition.wait(lock, [this, round]() { return m_workQuit || (m_workRound != round); });
+		if(m_workQuit)
+		{
+			break;
+		}
+		round = m_workRound;
+
+		// A run with fewer tasks than threads leaves the last ones asleep.
+		if(thread >= m_workCount)
+		{
+			continue;
+		}
+		task = m_workTask;
+
+		lock.unlock();
+		(*task)(thread);
+		lock.lock();
+
+		m_workPending--;
+		if(m_workPending == 0)
+		{
+			m_doneCondition.notify_one();
+		}
+	}
+
+	return;
+}
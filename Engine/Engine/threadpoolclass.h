@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: threadpoolclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _THREADPOOLCLASS_H_
+#define _THREADPOOLCLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: ThreadPoolClass
+////////////////////////////////////////////////////////////////////////////////
+// The threads the band passes of the terrain subsystems run on. They are started
+// once and wait between passes. Run hands out one task per thread, the first on
+// the calling thread and the rest on the pool, and returns when all are done, so
+// a subsystem cuts its work into at most GetThreadCount bands. The subsystems of
+// a terrain share its pool, and only one of them runs at a time.
+class ThreadPoolClass
+{
+public:
+	ThreadPoolClass();
+	ThreadPoolClass(const ThreadPoolClass&);
+	~ThreadPoolClass();
+
+	bool Initialize(int threadCount = 0);
+	void Shutdown();
+
+	int GetThreadCount();
+	void Run(int taskCount, const std::function<void(int)>& task);
+
+private:
+	void WorkerThread(int thread);
+
+private:
+	std::vector<std::thread> m_workers;
+	std::mutex m_workMutex;
+	std::condition_variable m_workCondition, m_doneCondition;
+	const std::function<void(int)>* m_workTask;
+	int m_workCount;
+	unsigned int m_workRound;
+	int m_workPending;
+	bool m_workQuit;
+};
+
+#endif
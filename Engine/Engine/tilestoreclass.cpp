@@ -0,0 +1,380 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: tilestoreclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "tilestoreclass.h"
+#include <algorithm>
+#include <cstdlib>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+TileStoreClass::TileStoreClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_slotCount = 0;
+	m_clockHand = 0;
+	m_lastTile = -1;
+	m_lastData = 0;
+	m_missCount = 0;
+
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = 0;
+#else
+	m_file = -1;
+#endif
+
+	m_prefetchTileX = 0;
+	m_prefetchTileY = 0;
+	m_prefetchRequest = 0;
+	m_prefetchCount = 0;
+	m_prefetchQuit = false;
+}
+
+
+TileStoreClass::TileStoreClass(const TileStoreClass& other)
+{
+}
+
+
+TileStoreClass::~TileStoreClass()
+{
+}
+
+
+bool TileStoreClass::Initialize(const char* filename, int width, int height, int residentTiles)
+{
+	long long fileSize;
+
+
+	if((width <= 0) || (height <= 0) || (residentTiles <= 0))
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = (width + TILESTORE_TILE_SIZE - 1) / TILESTORE_TILE_SIZE;
+	m_tilesY = (height + TILESTORE_TILE_SIZE - 1) / TILESTORE_TILE_SIZE;
+	fileSize = (long long)m_tilesX * m_tilesY * TILESTORE_TILE_BYTES;
+
+	// Open the backing file and size it to whole tiles. The part the size adds reads as zero.
+#ifdef _WIN32
+	m_file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READWRITE, (DWORD)(fileSize >> 32), (DWORD)(fileSize & 0xffffffff), NULL);
+	if(!m_mapping)
+	{
+		return false;
+	}
+#else
+	m_file = open(filename, O_RDWR | O_CREAT, 0644);
+	if(m_file == -1)
+	{
+		return false;
+	}
+
+	if(ftruncate(m_file, (off_t)fileSize) != 0)
+	{
+		return false;
+	}
+#endif
+
+	// No tile is mapped to start with.
+	m_tileSlots.assign(m_tilesX * m_tilesY, -1);
+	m_slots.resize(residentTiles);
+	m_slotCount = 0;
+	m_clockHand = 0;
+	m_lastTile = -1;
+	m_lastData = 0;
+	m_missCount = 0;
+
+	// Start the prefetch thread.
+	m_prefetchQuit = false;
+	m_prefetchRequest = 0;
+	m_prefetchCount = 0;
+	m_prefetchThread = std::thread(&TileStoreClass::PrefetchThread, this);
+
+	return true;
+}
+
+
+void TileStoreClass::Shutdown()
+{
+	// Stop the prefetch thread.
+	if(m_prefetchThread.joinable())
+	{
+		m_prefetchMutex.lock();
+		m_prefetchQuit = true;
+		m_prefetchMutex.unlock();
+
+		m_prefetchCondition.notify_one();
+		m_prefetchThread.join();
+	}
+
+	// Unmap every tile, the system writes back what changed.
+	for(int i=0; i<m_slotCount; i++)
+	{
+		UnmapTile(m_slots[i].data);
+	}
+	m_slotCount = 0;
+	m_lastTile = -1;
+	m_lastData = 0;
+
+	std::vector<int>().swap(m_tileSlots);
+	std::vector<SlotType>().swap(m_slots);
+
+#ifdef _WIN32
+	if(m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = 0;
+	}
+
+	if(m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if(m_file != -1)
+	{
+		close(m_file);
+		m_file = -1;
+	}
+#endif
+
+	return;
+}
+
+
+float* TileStoreClass::GetCell(int x, int y)
+{
+	float* data;
+
+
+	data = GetTileData(((y >> TILESTORE_TILE_SHIFT) * m_tilesX) + (x >> TILESTORE_TILE_SHIFT));
+	if(!data)
+	{
+		return 0;
+	}
+
+	return data + ((y & (TILESTORE_TILE_SIZE - 1)) << TILESTORE_TILE_SHIFT) + (x & (TILESTORE_TILE_SIZE - 1));
+}
+
+
+void TileStoreClass::Prefetch(int x, int y)
+{
+	// Only the newest point counts, the prefetch thread drops an older one it is part way through.
+	m_prefetchMutex.lock();
+	m_prefetchTileX = std::min(std::max(x, 0), m_width - 1) >> TILESTORE_TILE_SHIFT;
+	m_prefetchTileY = std::min(std::max(y, 0), m_height - 1) >> TILESTORE_TILE_SHIFT;
+	m_prefetchRequest++;
+	m_prefetchMutex.unlock();
+
+	m_prefetchCondition.notify_one();
+
+	return;
+}
+
+
+int TileStoreClass::GetResidentCount()
+{
+	return m_slotCount;
+}
+
+
+int TileStoreClass::GetMissCount()
+{
+	return m_missCount;
+}
+
+
+int TileStoreClass::GetPrefetchCount()
+{
+	return m_prefetchCount;
+}
+
+
+float* TileStoreClass::GetTileData(int tile)
+{
+	float* data;
+	int slot;
+
+
+	// Runs of cells in one tile are the common case.
+	if(tile == m_lastTile)
+	{
+		return m_lastData;
+	}
+
+	slot = m_tileSlots[tile];
+	if(slot == -1)
+	{
+		m_missCount++;
+
+		if(m_slotCount < (int)m_slots.size())
+		{
+			slot = m_slotCount;
+			m_slotCount++;
+		}
+		else
+		{
+			// Sweep the clock for a slot not used since it last came round, clearing the marks it passes.
+			while(m_slots[m_clockHand].referenced)
+			{
+				m_slots[m_clockHand].referenced = false;
+				m_clockHand = (m_clockHand + 1) % m_slotCount;
+			}
+
+			slot = m_clockHand;
+			m_clockHand = (m_clockHand + 1) % m_slotCount;
+
+			UnmapTile(m_slots[slot].data);
+			m_tileSlots[m_slots[slot].tile] = -1;
+		}
+
+		data = MapTile(tile);
+		if(!data)
+		{
+			// Give the slot up by moving the last one into it.
+			m_slotCount--;
+			if(slot != m_slotCount)
+			{
+				m_slots[slot] = m_slots[m_slotCount];
+				m_tileSlots[m_slots[slot].tile] = slot;
+			}
+			if(m_clockHand >= m_slotCount)
+			{
+				m_clockHand = 0;
+			}
+			m_lastTile = -1;
+			return 0;
+		}
+
+		m_slots[slot].tile = tile;
+		m_slots[slot].data = data;
+		m_tileSlots[tile] = slot;
+	}
+
+	m_slots[slot].referenced = true;
+	m_lastTile = tile;
+	m_lastData = m_slots[slot].data;
+
+	return m_lastData;
+}
+
+
+float* TileStoreClass::MapTile(int tile)
+{
+	long long offset;
+	void* view;
+
+
+	offset = (long long)tile * TILESTORE_TILE_BYTES;
+
+#ifdef _WIN32
+	view = MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, (DWORD)(offset >> 32), (DWORD)(offset & 0xffffffff), TILESTORE_TILE_BYTES);
+	if(!view)
+	{
+		return 0;
+	}
+#else
+	view = mmap(0, TILESTORE_TILE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, (off_t)offset);
+	if(view == MAP_FAILED)
+	{
+		return 0;
+	}
+#endif
+
+	return (float*)view;
+}
+
+
+void TileStoreClass::UnmapTile(float* data)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap(data, TILESTORE_TILE_BYTES);
+#endif
+
+	return;
+}
+
+
+void TileStoreClass::PrefetchThread()
+{
+	std::unique_lock<std::mutex> lock(m_prefetchMutex);
+	volatile float touch;
+	unsigned int request;
+	int centreX, centreY, tileX, tileY;
+	float* data;
+
+
+	request = 0;
+	while(true)
+	{
+		m_prefetchCondition.wait(lock, [this, request]() { return m_prefetchQuit || (m_prefetchRequest != request); });
+		if(m_prefetchQuit)
+		{
+			break;
+		}
+		request = m_prefetchRequest;
+		centreX = m_prefetchTileX;
+		centreY = m_prefetchTileY;
+		lock.unlock();
+
+		// Go out a ring of tiles at a time so the nearest come in first, starting over if the point moves.
+		for(int ring=0; (ring <= TILESTORE_PREFETCH_RADIUS) && (m_prefetchRequest == request); ring++)
+		{
+			for(int dy=-ring; (dy <= ring) && (m_prefetchRequest == request); dy++)
+			{
+				for(int dx=-ring; dx<=ring; dx++)
+				{
+					if((std::abs(dx) != ring) && (std::abs(dy) != ring))
+					{
+						continue;
+					}
+
+					tileX = centreX + dx;
+					tileY = centreY + dy;
+					if((tileX < 0) || (tileY < 0) || (tileX >= m_tilesX) || (tileY >= m_tilesY))
+					{
+						continue;
+					}
+
+					// Reading one value a page faults the whole tile into the system cache, the view itself is let go.
+					data = MapTile((tileY * m_tilesX) + tileX);
+					if(!data)
+					{
+						continue;
+					}
+
+					for(int i=0; i<TILESTORE_TILE_BYTES; i+=TILESTORE_PAGE_BYTES)
+					{
+						touch = data[i / sizeof(float)];
+					}
+					(void)touch;
+
+					UnmapTile(data);
+					m_prefetchCount++;
+				}
+			}
+		}
+
+		lock.lock();
+	}
+
+	return;
+}
@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: tilestoreclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _TILESTORECLASS_H_
+#define _TILESTORECLASS_H_
+
+
+//////////////
+// INCLUDES //
+//////////////
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int TILESTORE_TILE_SHIFT = 7;
+const int TILESTORE_TILE_SIZE = 1 << TILESTORE_TILE_SHIFT;
+const int TILESTORE_TILE_BYTES = TILESTORE_TILE_SIZE * TILESTORE_TILE_SIZE * sizeof(float);
+const int TILESTORE_PAGE_BYTES = 4096;
+const int TILESTORE_PREFETCH_RADIUS = 4;
+const int TILESTORE_RESIDENT_TILES = 256;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: TileStoreClass
+////////////////////////////////////////////////////////////////////////////////
+// A grid of floats kept in a file rather than in memory, so it can be far bigger
+// than RAM or, in a 32 bit process, than the address space. The file is cut into
+// 128x128 tiles of 64KB, the granularity views of a file can be mapped at, and
+// only a fixed number of tiles are mapped at a time. Asking for a tile that is
+// not mapped maps it in place of one picked by the clock: the slots are swept in
+// turn and the first not used since the last sweep goes. Unmapped tiles are left
+// to the system to write back.
+//
+// Prefetch warms the system file cache around a point on its own thread, through
+// views of its own, so the tiles are already in memory when they are mapped. The
+// rest of the class belongs to one thread, and a cell pointer is good until that
+// thread has asked for as many other tiles as there are slots.
+class TileStoreClass
+{
+private:
+	struct SlotType
+	{
+		int tile;
+		float* data;
+		bool referenced;
+	};
+
+public:
+	TileStoreClass();
+	TileStoreClass(const TileStoreClass&);
+	~TileStoreClass();
+
+	bool Initialize(const char* filename, int width, int height, int residentTiles);
+	void Shutdown();
+
+	float* GetCell(int x, int y);
+	void Prefetch(int x, int y);
+
+	int GetResidentCount();
+	int GetMissCount();
+	int GetPrefetchCount();
+
+private:
+	float* GetTileData(int tile);
+	float* MapTile(int tile);
+	void UnmapTile(float* data);
+	void PrefetchThread();
+
+private:
+	int m_width, m_height, m_tilesX, m_tilesY;
+	std::vector<int> m_tileSlots;
+	std::vector<SlotType> m_slots;
+	int m_slotCount, m_clockHand;
+	int m_lastTile;
+	float* m_lastData;
+	int m_missCount;
+
+#ifdef _WIN32
+	HANDLE m_file, m_mapping;
+#else
+	int m_file;
+#endif
+
+	std::thread m_prefetchThread;
+	std::mutex m_prefetchMutex;
+	std::condition_variable m_prefetchCondition;
+	int m_prefetchTileX, m_prefetchTileY;
+	std::atomic<unsigned int> m_prefetchRequest;
+	std::atomic<int> m_prefetchCount;
+	bool m_prefetchQuit;
+};
+
+#endif
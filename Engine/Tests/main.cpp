@@ -0,0 +1,33 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: main.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "terraintestclass.h"
+
+
+int main()
+{
+	TerrainTestClass* Test;
+	bool result;
+
+
+	// Create the test object.
+	Test = new TerrainTestClass;
+	if(!Test)
+	{
+		return 1;
+	}
+
+	// Initialize and run the test object.
+	result = Test->Initialize();
+	if(result)
+	{
+		result = Test->Run();
+	}
+
+	// Shutdown and release the test object.
+	Test->Shutdown();
+	delete Test;
+	Test = 0;
+
+	return result ? 0 : 1;
+}
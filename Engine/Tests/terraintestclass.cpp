@@ -0,0 +1,219 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: terraintestclass.cpp
+////////////////////////////////////////////////////////////////////////////////
+#include "terraintestclass.h"
+#include <cstdio>
+#include <cstring>
+
+
+TerrainTestClass::TerrainTestClass()
+{
+	m_SteppedTerrain = 0;
+	m_WholeTerrain = 0;
+}
+
+
+TerrainTestClass::TerrainTestClass(const TerrainTestClass& other)
+{
+}
+
+
+TerrainTestClass::~TerrainTestClass()
+{
+}
+
+
+bool TerrainTestClass::Initialize()
+{
+	bool result;
+
+
+	// Create the terrain generated a step at a time.
+	result = InitializeTerrain(&m_SteppedTerrain);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the terrain generated in one go.
+	result = InitializeTerrain(&m_WholeTerrain);
+	if(!result)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+void TerrainTestClass::Shutdown()
+{
+	ShutdownTerrain(&m_WholeTerrain);
+	ShutdownTerrain(&m_SteppedTerrain);
+
+	std::vector<unsigned char>().swap(m_steppedData);
+	std::vector<unsigned char>().swap(m_wholeData);
+
+	return;
+}
+
+
+bool TerrainTestClass::Run()
+{
+	const generationOperationData dungeon[] = { { TerrainClass::GENERATE_PERLIN, 0, 1 }, { TerrainClass::GENERATE_DUNGEON, 5, 77 } };
+	const generationOperationData cave[] = { { TerrainClass::GENERATE_RANDOM_FIELD, 0, 5 }, { TerrainClass::GENERATE_CAVE, 5, 9 } };
+	const generationOperationData erosion[] = { { TerrainClass::GENERATE_RANDOM_FIELD, 0, 6 }, { TerrainClass::GENERATE_SMOOTH, 2, 0 }, { TerrainClass::GENERATE_EROSION, 12, 0 } };
+	const generationOperationData dungeonCave[] = { { TerrainClass::GENERATE_PERLIN, 0, 2 }, { TerrainClass::GENERATE_DUNGEON, 5, 78 }, { TerrainClass::GENERATE_CAVE, 4, 3 } };
+	bool result;
+
+
+	// Every recipe is tried even after one fails so the output shows all of them.
+	result = TestRecipe("dungeon", dungeon, 2);
+	result = TestRecipe("cave", cave, 2) && result;
+	result = TestRecipe("erosion", erosion, 3) && result;
+	result = TestRecipe("dungeon and cave", dungeonCave, 3) && result;
+
+	printf("%s\n", result ? "All tests passed." : "Some tests FAILED.");
+
+	return result;
+}
+
+
+bool TerrainTestClass::InitializeTerrain(TerrainClass** terrain)
+{
+	bool result;
+
+
+	*terrain = new TerrainClass;
+	if(!*terrain)
+	{
+		return false;
+	}
+
+	// Without a device there are no textures or buffers, the generation is all there is.
+	result = (*terrain)->InitializeTerrain(0, TEST_TERRAIN_SIZE, TEST_TERRAIN_SIZE, 0, 0, 0);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Stop the generation thread so UpdateGeneration runs the jobs with the budget it is given.
+	if((*terrain)->m_generationThread.joinable())
+	{
+		(*terrain)->m_generationMutex.lock();
+		(*terrain)->m_generationQuit = true;
+		(*terrain)->m_generationMutex.unlock();
+
+		(*terrain)->m_generationCondition.notify_one();
+		(*terrain)->m_generationThread.join();
+		(*terrain)->m_generationQuit = false;
+	}
+	(*terrain)->m_generationThreaded = false;
+
+	// Shut the disk cache, or the second terrain would load what the first one stored.
+	if((*terrain)->m_DiskCache)
+	{
+		(*terrain)->m_DiskCache->Shutdown();
+		delete (*terrain)->m_DiskCache;
+		(*terrain)->m_DiskCache = 0;
+	}
+
+	return true;
+}
+
+
+void TerrainTestClass::ShutdownTerrain(TerrainClass** terrain)
+{
+	if(*terrain)
+	{
+		(*terrain)->Shutdown();
+		delete *terrain;
+		*terrain = 0;
+	}
+
+	return;
+}
+
+
+bool TerrainTestClass::Generate(TerrainClass* terrain, const generationOperationData* operations, int operationCount, int budget, std::vector<unsigned char>& data)
+{
+	bool result;
+
+
+	result = terrain->RequestRecipe(0, operations, operationCount);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Keep giving the job slices until the result has been swapped to the front.
+	while(terrain->IsGenerating())
+	{
+		terrain->UpdateGeneration(budget);
+	}
+
+	// A job that failed leaves the terrain before it at the front, which does not pack.
+	return terrain->PackTerrain(data);
+}
+
+
+bool TerrainTestClass::TestRecipe(const char* name, const generationOperationData* operations, int operationCount)
+{
+	float steppedDistance, wholeDistance;
+	int distanceMismatches;
+	bool result;
+
+
+	result = Generate(m_SteppedTerrain, operations, operationCount, TEST_STEPPED_BUDGET, m_steppedData);
+	if(!result)
+	{
+		printf("%s: FAILED, the stepped job did not finish\n", name);
+		return false;
+	}
+
+	// A budget of zero runs the job to the end in one slice.
+	result = Generate(m_WholeTerrain, operations, operationCount, 0, m_wholeData);
+	if(!result)
+	{
+		printf("%s: FAILED, the whole job did not finish\n", name);
+		return false;
+	}
+
+	// The heights, normals, walk grid, rooms and corridors all go in the packed terrain.
+	if((m_steppedData.size() != m_wholeData.size()) || (memcmp(&m_steppedData[0], &m_wholeData[0], m_wholeData.size()) != 0))
+	{
+		printf("%s: FAILED, the packed terrains differ\n", name);
+		return false;
+	}
+
+	if(m_SteppedTerrain->GetDungeonComponentCount() != m_WholeTerrain->GetDungeonComponentCount())
+	{
+		printf("%s: FAILED, %d components stepped against %d whole\n", name, m_SteppedTerrain->GetDungeonComponentCount(), m_WholeTerrain->GetDungeonComponentCount());
+		return false;
+	}
+
+	// The wall distances are not cached with the terrain, compare them bit for bit too.
+	distanceMismatches = 0;
+	for(int y=0; y<TEST_TERRAIN_SIZE; y++)
+	{
+		for(int x=0; x<TEST_TERRAIN_SIZE; x++)
+		{
+			steppedDistance = m_SteppedTerrain->GetWallDistance(x, y);
+			wholeDistance = m_WholeTerrain->GetWallDistance(x, y);
+			if(memcmp(&steppedDistance, &wholeDistance, sizeof(float)) != 0)
+			{
+				distanceMismatches++;
+			}
+		}
+	}
+
+	if(distanceMismatches > 0)
+	{
+		printf("%s: FAILED, %d wall distances differ\n", name, distanceMismatches);
+		return false;
+	}
+
+	printf("%s: passed, %d components\n", name, m_WholeTerrain->GetDungeonComponentCount());
+
+	return true;
+}
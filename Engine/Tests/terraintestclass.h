@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: terraintestclass.h
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _TERRAINTESTCLASS_H_
+#define _TERRAINTESTCLASS_H_
+
+
+/////////////
+// LINKING //
+/////////////
+#pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "d3dx11.lib")
+#pragma comment(lib, "d3dx10.lib")
+
+
+//////////////
+// INCLUDES //
+//////////////
+#include <vector>
+
+
+///////////////////////
+// MY CLASS INCLUDES //
+///////////////////////
+#include "terrainclass.h"
+
+
+/////////////
+// GLOBALS //
+/////////////
+const int TEST_TERRAIN_SIZE = 512;
+const int TEST_STEPPED_BUDGET = 1;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Class name: TerrainTestClass
+////////////////////////////////////////////////////////////////////////////////
+// Checks that a recipe generated a step at a time, stopping after every step as
+// the frame loop does when its budget runs out, comes out bit for bit the same
+// as the recipe run to the end in one go. Two terrains without a device are used
+// so neither can pick up what the other made, and both run their jobs on the
+// calling thread with the disk cache shut.
+class TerrainTestClass
+{
+public:
+	TerrainTestClass();
+	TerrainTestClass(const TerrainTestClass&);
+	~TerrainTestClass();
+
+	bool Initialize();
+	void Shutdown();
+	bool Run();
+
+private:
+	bool InitializeTerrain(TerrainClass** terrain);
+	void ShutdownTerrain(TerrainClass** terrain);
+	bool Generate(TerrainClass* terrain, const generationOperationData* operations, int operationCount, int budget, std::vector<unsigned char>& data);
+	bool TestRecipe(const char* name, const generationOperationData* operations, int operationCount);
+
+private:
+	TerrainClass *m_SteppedTerrain, *m_WholeTerrain;
+	std::vector<unsigned char> m_steppedData, m_wholeData;
+};
+
+#endif